@@ -0,0 +1,179 @@
+#include "Benchmarks.hpp"
+#include "StlDecode.hpp"
+#include "ModelLoader.hpp"
+
+#include <zip.h>
+
+#include <chrono>
+#include <cstring>
+#include <algorithm>
+#include <string>
+#include <cstdio>
+
+/// Binary STL facets of a bumpy grid. Flat cells share their vertices like the faces of a CAD part, 
+/// every fourth facet has a zero normal so the normal repair runs too. 
+static std::vector<char> makeBenchmarkFacets(size_t facetCount) {
+
+	std::vector<char> facets(facetCount * mload::c_StlFacetSize, 0);
+	size_t gridWidth = 1;
+	while (2 * gridWidth * gridWidth < facetCount) gridWidth++;
+
+	auto height = [](size_t x, size_t y) { return (float)((x / 8 + y / 8) % 3); };
+
+	for (size_t facet = 0; facet < facetCount; facet++) {
+
+		size_t cell = facet / 2;
+		size_t x = cell % gridWidth, y = cell / gridWidth;
+		float p[4][3] = {
+			{ (float)x,     (float)y,     height(x, y)         },
+			{ (float)x + 1, (float)y,     height(x + 1, y)     },
+			{ (float)x + 1, (float)y + 1, height(x + 1, y + 1) },
+			{ (float)x,     (float)y + 1, height(x, y + 1)     },
+		};
+		const int corners[2][3] = { { 0, 1, 2 }, { 0, 2, 3 } };
+
+		float f[12] = { 0.0f, 0.0f, facet % 4 == 3 ? 0.0f : 1.0f };
+		for (int v = 0; v < 3; v++) memcpy(&f[3 + 3 * v], p[corners[facet % 2][v]], 3 * sizeof(float));
+		memcpy(&facets[facet * mload::c_StlFacetSize], f, sizeof(f));
+
+	}
+	return facets;
+
+}
+
+template<typename F>
+static double timeSeconds(F&& func) {
+	auto start = std::chrono::steady_clock::now();
+	func();
+	return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+void mload::benchmarkStlDedupScaling(size_t facetCount, uint32_t maxThreadCount, std::vector<BenchmarkResult>* results) {
+
+	std::vector<char> facets = makeBenchmarkFacets(facetCount);
+
+	{
+		std::vector<Vertex>   vertices;
+		std::vector<uint32_t> indices;
+		vertices.reserve(facetCount);
+		indices.reserve(3 * facetCount);
+		double seconds = timeSeconds([&]() {
+			Map<Vertex, uint32_t> uniqueVertices((size_t)(4.5 * facetCount), facetCount);
+			StlFacetBlock block;
+			for (size_t first = 0; first < facetCount; first += c_StlDecodeBlock) {
+				size_t count = std::min(c_StlDecodeBlock, facetCount - first);
+				decodeStlFacets(&facets[first * c_StlFacetSize], count, &block);
+				dedupStlBlock(block, count, uniqueVertices, &vertices, &indices);
+			}
+		});
+		results->push_back({ "Map", 1, seconds, true });
+	}
+
+	for (uint32_t threadCount = 1; threadCount <= maxThreadCount; threadCount *= 2) {
+
+		// The calling thread is one of the threads
+		WorkerPool pool(threadCount - 1);
+		std::vector<Vertex>   vertices;
+		std::vector<uint32_t> indices;
+		double seconds = timeSeconds([&]() { dedupStlFacetsParallel(pool, facets.data(), facetCount, &vertices, &indices); });
+		results->push_back({ "ConcurrentMap", threadCount, seconds, threadCount == 1 });
+
+	}
+
+}
+
+void mload::benchmarkCompressedOpen(size_t facetCount, const char* tempDir, std::vector<BenchmarkResult>* results) {
+
+	std::string zipPath       = std::string(tempDir) + "SV3D_benchmark.zip";
+	std::string extractedPath = std::string(tempDir) + "SV3D_benchmark.stl";
+
+	{
+		std::vector<char> facets = makeBenchmarkFacets(facetCount);
+		char header[c_StlHeaderSize]{};
+		uint32_t headerFacetCount = (uint32_t)facetCount;
+		memcpy(&header[80], &headerFacetCount, sizeof(headerFacetCount));
+
+		zip_t* zip = zip_open(zipPath.c_str(), ZIP_DEFAULT_COMPRESSION_LEVEL, 'w');
+		if (zip == nullptr) return;
+		zip_entry_open(zip, "benchmark.stl");
+		zip_entry_write(zip, header, sizeof(header));
+		zip_entry_write(zip, facets.data(), facets.size());
+		zip_entry_close(zip);
+		zip_close(zip);
+	}
+
+	std::vector<Vertex>   vertices;
+	std::vector<uint32_t> indices;
+	bool isTextFormat;
+
+	double seconds = timeSeconds([&]() {
+		zip_t* zip = zip_open(zipPath.c_str(), 0, 'r');
+		zip_entry_open(zip, "benchmark.stl");
+		zip_entry_fread(zip, extractedPath.c_str());
+		zip_entry_close(zip);
+		zip_close(zip);
+		openModelPipelined(extractedPath.c_str(), &vertices, &indices, &isTextFormat);
+	});
+	results->push_back({ "Extract+open", 1, seconds, true });
+
+	vertices.clear();
+	indices.clear();
+	PipelineStats stats;
+	seconds = timeSeconds([&]() { openModelPipelined(zipPath.c_str(), &vertices, &indices, &isTextFormat, nullptr, nullptr, &stats); });
+	// Reader, parser and dedup threads, or the parallel dedup of openModel for large models
+	results->push_back({ "Open .zip", stats.pipelined ? 3u : WorkerPool::shared().threadCount(), seconds, false });
+
+	remove(extractedPath.c_str());
+	remove(zipPath.c_str());
+
+}
+
+void mload::benchmarkPlyVsStl(size_t facetCount, const char* tempDir, std::vector<BenchmarkResult>* results) {
+
+	std::string stlPath = std::string(tempDir) + "SV3D_benchmark.stl";
+	std::string plyPath = std::string(tempDir) + "SV3D_benchmark.ply";
+
+	{
+		std::vector<char> facets = makeBenchmarkFacets(facetCount);
+		char header[c_StlHeaderSize]{};
+		uint32_t headerFacetCount = (uint32_t)facetCount;
+		memcpy(&header[80], &headerFacetCount, sizeof(headerFacetCount));
+
+		FILE* file = fopen(stlPath.c_str(), "wb");
+		if (file == nullptr) return;
+		fwrite(header, 1, sizeof(header), file);
+		fwrite(facets.data(), 1, facets.size(), file);
+		fclose(file);
+	}
+
+	std::vector<Vertex>   vertices;
+	std::vector<uint32_t> indices;
+	bool isTextFormat;
+	double seconds = timeSeconds([&]() { openModel(stlPath.c_str(), &vertices, &indices, &isTextFormat); });
+	results->push_back({ "Binary STL", 1, seconds, true });
+
+	{
+		// The layout the PLY fast paths copy directly: float x y z nx ny nz, uchar count and int indices
+		FILE* file = fopen(plyPath.c_str(), "wb");
+		if (file == nullptr) { remove(stlPath.c_str()); return; }
+		fprintf(file, "ply\nformat binary_little_endian 1.0\nelement vertex %zu\n", vertices.size());
+		fprintf(file, "property float x\nproperty float y\nproperty float z\nproperty float nx\nproperty float ny\nproperty float nz\n");
+		fprintf(file, "element face %zu\nproperty list uchar int vertex_indices\nend_header\n", indices.size() / 3);
+		fwrite(vertices.data(), sizeof(Vertex), vertices.size(), file);
+		for (size_t i = 0; i < indices.size(); i += 3) {
+			const uint8_t indexCount = 3;
+			fwrite(&indexCount, 1, 1, file);
+			fwrite(&indices[i], sizeof(uint32_t), 3, file);
+		}
+		fclose(file);
+	}
+
+	vertices.clear();
+	indices.clear();
+	seconds = timeSeconds([&]() { openModel(plyPath.c_str(), &vertices, &indices, &isTextFormat); });
+	results->push_back({ "Binary PLY", 1, seconds, false });
+
+	remove(stlPath.c_str());
+	remove(plyPath.c_str());
+
+}
@@ -0,0 +1,27 @@
+#pragma once
+
+#include <vector>
+#include <cstdint>
+#include <cstddef>
+
+namespace mload {
+
+	struct BenchmarkResult {
+
+		const char* label;       // static string
+		uint32_t    threadCount;
+		double      seconds;
+		bool        baseline;    // the following results are compared against this one
+
+	};
+
+	/// Dedups a synthetic binary STL of facetCount facets with the sequential Map and with ConcurrentMap on 1, 2, 4 ... maxThreadCount threads. 
+	void benchmarkStlDedupScaling(size_t facetCount, uint32_t maxThreadCount, std::vector<BenchmarkResult>* results);
+	/// Zips a synthetic binary STL of facetCount facets into tempDir, then times extracting it to a file and opening that 
+	/// against opening the archive directly. tempDir ends in a path separator, the files are deleted afterwards. 
+	void benchmarkCompressedOpen(size_t facetCount, const char* tempDir, std::vector<BenchmarkResult>* results);
+	/// Writes the same synthetic mesh as a binary STL of facetCount facets and as an indexed little endian PLY into tempDir 
+	/// and times openModel on both. tempDir ends in a path separator, the files are deleted afterwards. 
+	void benchmarkPlyVsStl(size_t facetCount, const char* tempDir, std::vector<BenchmarkResult>* results);
+
+}
@@ -0,0 +1,51 @@
+#pragma once
+
+#include <atomic>
+#include <vector>
+#include <memory>
+#include <cstdint>
+
+namespace mload {
+
+	/// Fixed capacity open addressing map that many threads can insert-or-get into at once without locks. 
+	/// Every key remembers the smallest source index it was inserted with (e.g. the position of the vertex in the file),
+	/// so the final numbering can be made independent of which thread got to a key first. K must be trivially copyable. 
+	template<typename K>
+	class ConcurrentMap {
+	public:
+
+		/// @param maxKeyCount upper bound on the number of unique keys, inserting more keys is undefined
+		explicit ConcurrentMap(size_t maxKeyCount);
+		ConcurrentMap(const ConcurrentMap&) = delete; 
+		void operator=(const ConcurrentMap&) = delete;
+
+		/// Thread-safe. sourceIndex must be below c_Writing. 
+		/// @return slot of the key, stable for the life of the map
+		uint32_t insert(const K& key, uint32_t hash, uint32_t sourceIndex);
+
+		/// Fetches the first slot of hash into the cache ahead of insert. 
+		void prefetch(uint32_t hash) const;
+
+		/// Smallest source index the key of the slot was inserted with. Only valid once every insert has returned. 
+		uint32_t firstSource(uint32_t slot) const { return m_slots[slot].source.load(std::memory_order_relaxed); }
+		const K& key(uint32_t slot) const { return m_slots[slot].key; }
+		size_t   slotCount() const { return m_mask + 1; }
+
+	private:
+
+		static constexpr uint32_t c_Empty   = UINT32_MAX;
+		static constexpr uint32_t c_Writing = UINT32_MAX - 1; // claimed, the key isn't written yet
+
+		struct Slot {
+			std::atomic<uint32_t> source;
+			K                     key;
+		};
+
+		std::unique_ptr<Slot[]> m_slots;
+		size_t                  m_mask;
+
+	};
+
+}
+
+#include "ConcurrentMap.inl"
@@ -0,0 +1,60 @@
+#include <thread>
+
+#if defined(_MSC_VER)
+#include <xmmintrin.h>
+#endif
+
+template<typename K>
+mload::ConcurrentMap<K>::ConcurrentMap(size_t maxKeyCount) {
+
+	// Power of two at least 4/3 of the keys keeps the probe sequences short even if every key is unique
+	size_t slotCount = 16;
+	while (slotCount < maxKeyCount + maxKeyCount / 3) slotCount *= 2;
+
+	m_slots.reset(new Slot[slotCount]);
+	m_mask = slotCount - 1;
+	for (size_t i = 0; i < slotCount; i++) m_slots[i].source.store(c_Empty, std::memory_order_relaxed);
+
+}
+
+template<typename K>
+void mload::ConcurrentMap<K>::prefetch(uint32_t hash) const {
+
+#if defined(_MSC_VER)
+	_mm_prefetch((const char*)&m_slots[hash & m_mask], _MM_HINT_T0);
+#else
+	__builtin_prefetch(&m_slots[hash & m_mask]);
+#endif
+
+}
+
+template<typename K>
+uint32_t mload::ConcurrentMap<K>::insert(const K& key, uint32_t hash, uint32_t sourceIndex) {
+
+	for (size_t i = hash & m_mask;; i = (i + 1) & m_mask) {
+
+		Slot& slot = m_slots[i];
+		uint32_t source = slot.source.load(std::memory_order_acquire);
+
+		// Claim an empty slot, the key is published by the release store of the source
+		if (source == c_Empty) {
+			if (slot.source.compare_exchange_strong(source, c_Writing, std::memory_order_acquire)) {
+				slot.key = key;
+				slot.source.store(sourceIndex, std::memory_order_release);
+				return (uint32_t)i;
+			}
+		}
+		while (source == c_Writing) {
+			std::this_thread::yield();
+			source = slot.source.load(std::memory_order_acquire);
+		}
+
+		if (!(slot.key == key)) continue;
+
+		// Keep the smallest source index
+		while (sourceIndex < source && !slot.source.compare_exchange_weak(source, sourceIndex, std::memory_order_relaxed)) {}
+		return (uint32_t)i;
+
+	}
+
+}
@@ -0,0 +1,557 @@
+#include "GltfLoader.hpp"
+#include "Json.hpp"
+#include "Parallel.hpp"
+
+#include <cstdio>
+#include <cstring>
+#include <memory>
+#include <algorithm>
+
+#include <glm/glm.hpp>
+#include <glm/gtc/quaternion.hpp>
+
+constexpr uint32_t c_GlbMagic     = 0x46546C67; // "glTF"
+constexpr uint32_t c_GlbChunkJson = 0x4E4F534A; // "JSON"
+constexpr uint32_t c_GlbChunkBin  = 0x004E4942; // "BIN\0"
+
+constexpr uint32_t c_GltfByte          = 5120;
+constexpr uint32_t c_GltfUnsignedByte  = 5121;
+constexpr uint32_t c_GltfShort         = 5122;
+constexpr uint32_t c_GltfUnsignedShort = 5123;
+constexpr uint32_t c_GltfUnsignedInt   = 5125;
+constexpr uint32_t c_GltfFloat         = 5126;
+constexpr uint32_t c_GltfModeTriangles = 4;
+
+/// Vertices or indices baked by one task, so large primitives are split across threads and small ones don't start any.
+constexpr size_t c_GltfTaskSize = 1 << 14;
+
+/// A buffer of the file, in the GLB binary chunk, decoded from a data URI or read from a file next to the .gltf.
+struct GltfBuffer {
+
+	const char* data;
+	size_t      size;
+
+};
+
+/// Where the elements of an accessor are, after checking they are inside their buffer.
+struct GltfAccessor {
+
+	const char* data;      // first element
+	size_t      count;
+	size_t      stride;
+	uint32_t    componentType;
+	bool        normalized;
+
+};
+
+/// A mesh placed by a node, with the transforms of the node and its parents.
+struct GltfInstance {
+
+	uint32_t    mesh;
+	glm::mat4   transform;
+	bool        identity;
+	const char* name;
+
+};
+
+/// One primitive of one instance and where its vertices and indices go.
+struct GltfPrimitiveJob {
+
+	GltfAccessor positions;
+	GltfAccessor normals;
+	GltfAccessor indices;
+	bool         hasNormals;
+	bool         hasIndices;
+	const GltfInstance* instance;
+	glm::mat3    normalTransform;
+	bool         flipWinding;   // mirroring transform, the triangles are wound the other way round
+	uint32_t     positionAccessor;
+	uint32_t     normalAccessor;
+	bool         sharesVertices; // an earlier primitive of the instance has the same attributes and bakes the vertices
+	size_t       firstVertex;
+	size_t       firstIndex;
+	size_t       indexCount;
+
+};
+
+static uint32_t componentSize(uint32_t componentType) {
+	switch (componentType) {
+	case c_GltfByte:          case c_GltfUnsignedByte:  return 1;
+	case c_GltfShort:         case c_GltfUnsignedShort: return 2;
+	case c_GltfUnsignedInt:   case c_GltfFloat:         return 4;
+	default:                                            return 0;
+	}
+}
+static uint32_t componentCount(const std::string& type) {
+	if (type == "SCALAR") return 1;
+	if (type == "VEC2")   return 2;
+	if (type == "VEC3")   return 3;
+	if (type == "VEC4")   return 4;
+	return 0;
+}
+
+/// Splits a GLB file into its JSON and binary chunk. @return false if data isn't GLB
+static bool splitGlb(const char* data, size_t size, const char** json, size_t* jsonSize, GltfBuffer* bin) {
+
+	uint32_t header[5];
+	if (size < sizeof(header)) return false;
+	memcpy(header, data, sizeof(header));
+	if (header[0] != c_GlbMagic || header[4] != c_GlbChunkJson || header[3] > size - sizeof(header)) return false;
+
+	*json     = data + sizeof(header);
+	*jsonSize = header[3];
+	*bin      = { nullptr, 0 };
+
+	// The binary chunk is 4 byte aligned after the JSON
+	size_t binHeader = sizeof(header) + ((*jsonSize + 3) & ~(size_t)3);
+	uint32_t chunk[2];
+	if (binHeader <= size && size - binHeader >= sizeof(chunk)) {
+		memcpy(chunk, data + binHeader, sizeof(chunk));
+		if (chunk[1] == c_GlbChunkBin) *bin = { data + binHeader + sizeof(chunk), std::min((size_t)chunk[0], size - binHeader - sizeof(chunk)) };
+	}
+	return true;
+
+}
+
+static bool decodeBase64(const char* text, size_t length, std::vector<char>* bytes) {
+
+	auto value = [](char c) -> int {
+		if (c >= 'A' && c <= 'Z') return c - 'A';
+		if (c >= 'a' && c <= 'z') return c - 'a' + 26;
+		if (c >= '0' && c <= '9') return c - '0' + 52;
+		if (c == '+' || c == '-') return 62;
+		if (c == '/' || c == '_') return 63;
+		return -1;
+	};
+
+	bytes->clear();
+	bytes->reserve(length / 4 * 3);
+	uint32_t bits = 0;
+	int bitCount = 0;
+	for (size_t i = 0; i < length && text[i] != '='; i++) {
+		int v = value(text[i]);
+		if (v < 0) return false;
+		bits = (bits << 6) | (uint32_t)v;
+		bitCount += 6;
+		if (bitCount >= 8) {
+			bitCount -= 8;
+			bytes->push_back((char)(bits >> bitCount));
+		}
+	}
+	return true;
+
+}
+
+/// Turns %XX escapes of a relative URI back into bytes.
+static std::string decodeUri(const std::string& uri) {
+	std::string path;
+	for (size_t i = 0; i < uri.size(); i++) {
+		if (uri[i] == '%' && i + 2 < uri.size()) {
+			char hex[3] = { uri[i + 1], uri[i + 2], '\0' };
+			path.push_back((char)strtol(hex, nullptr, 16));
+			i += 2;
+		}
+		else path.push_back(uri[i]);
+	}
+	return path;
+}
+
+/// Byte offsets, lengths and counts of the JSON, clamped so hostile files can't overflow the bounds checks.
+static size_t jsonSize(const mload::JsonValue& value, size_t fallback = 0) {
+	if (value.type != mload::JSON_NUMBER) return fallback;
+	return (size_t)std::min(std::max(value.number, 0.0), (double)(1ull << 48));
+}
+
+static mload::Success loadBuffers(const mload::JsonValue& doc, const GltfBuffer& glbBin, const char* fileName, std::vector<std::vector<char>>* storage, std::vector<GltfBuffer>* buffers) {
+
+	const mload::JsonValue& bufferDescs = doc["buffers"];
+	storage->resize(bufferDescs.size());
+	buffers->resize(bufferDescs.size());
+	for (size_t i = 0; i < bufferDescs.size(); i++) {
+
+		const mload::JsonValue& desc = bufferDescs[i];
+		size_t byteLength = jsonSize(desc["byteLength"]);
+		const std::string& uri = desc["uri"].string;
+		std::vector<char>& bytes = (*storage)[i];
+
+		if (desc["uri"].isNull()) {
+			// Only the first buffer of a GLB file may leave out the uri
+			if (i != 0 || glbBin.data == nullptr) return mload::Success::CORRUPT_FILE;
+			(*buffers)[i] = glbBin;
+		}
+		else if (uri.compare(0, 5, "data:") == 0) {
+			size_t base64 = uri.find(";base64,");
+			if (base64 == std::string::npos || !decodeBase64(&uri[base64 + 8], uri.size() - base64 - 8, &bytes)) return mload::Success::CORRUPT_FILE;
+			(*buffers)[i] = { bytes.data(), bytes.size() };
+		}
+		else {
+			if (fileName == nullptr) return mload::Success::COULD_NOT_OPEN_FILE;
+			std::string path = fileName;
+			size_t dirEnd = path.find_last_of("/\\");
+			path = (dirEnd == std::string::npos ? std::string() : path.substr(0, dirEnd + 1)) + decodeUri(uri);
+
+			FILE* file = fopen(path.c_str(), "rb");
+			if (file == nullptr) return mload::Success::COULD_NOT_OPEN_FILE;
+			bytes.resize(byteLength);
+			size_t read = fread(bytes.data(), 1, byteLength, file);
+			fclose(file);
+			bytes.resize(read);
+			(*buffers)[i] = { bytes.data(), bytes.size() };
+		}
+		if ((*buffers)[i].size < byteLength) return mload::Success::TRUNCATED_FILE;
+
+	}
+	return mload::Success::SUCCESS;
+
+}
+
+/// @return false if the accessor doesn't exist, has the wrong type or reaches past its buffer view
+static bool getAccessor(const mload::JsonValue& doc, const std::vector<GltfBuffer>& buffers, uint32_t index, uint32_t components, GltfAccessor* accessor) {
+
+	const mload::JsonValue& desc = doc["accessors"][index];
+	const mload::JsonValue& view = doc["bufferViews"][desc["bufferView"].indexOr(UINT32_MAX)];
+	uint32_t buffer = view["buffer"].indexOr(UINT32_MAX);
+	if (desc.isNull() || view.isNull() || buffer >= buffers.size()) return false;
+	if (componentCount(desc["type"].string) != components) return false;
+
+	accessor->componentType = desc["componentType"].indexOr(0);
+	accessor->normalized    = desc["normalized"].boolean;
+	accessor->count         = jsonSize(desc["count"]);
+	size_t elementSize = (size_t)componentSize(accessor->componentType) * components;
+	if (elementSize == 0) return false;
+	accessor->stride = jsonSize(view["byteStride"], elementSize);
+	if (accessor->stride < elementSize) return false;
+
+	size_t viewOffset = jsonSize(view["byteOffset"]);
+	size_t viewLength = jsonSize(view["byteLength"]);
+	size_t offset     = jsonSize(desc["byteOffset"]);
+	if (viewOffset > buffers[buffer].size || viewLength > buffers[buffer].size - viewOffset) return false;
+	if (accessor->count > 0) {
+		if (offset > viewLength || viewLength - offset < elementSize) return false;
+		if (accessor->count - 1 > (viewLength - offset - elementSize) / accessor->stride) return false;
+	}
+
+	accessor->data = buffers[buffer].data + viewOffset + offset;
+	return true;
+
+}
+
+static float readComponent(const char* p, uint32_t componentType, bool normalized) {
+	switch (componentType) {
+	case c_GltfFloat:         { float    v; memcpy(&v, p, sizeof(v)); return v; }
+	case c_GltfByte:          { int8_t   v; memcpy(&v, p, sizeof(v)); return normalized ? std::max(v / 127.0f, -1.0f)   : (float)v; }
+	case c_GltfUnsignedByte:  { uint8_t  v; memcpy(&v, p, sizeof(v)); return normalized ? v / 255.0f                    : (float)v; }
+	case c_GltfShort:         { int16_t  v; memcpy(&v, p, sizeof(v)); return normalized ? std::max(v / 32767.0f, -1.0f) : (float)v; }
+	case c_GltfUnsignedShort: { uint16_t v; memcpy(&v, p, sizeof(v)); return normalized ? v / 65535.0f                  : (float)v; }
+	case c_GltfUnsignedInt:   { uint32_t v; memcpy(&v, p, sizeof(v)); return (float)v; }
+	default:                  return 0.0f;
+	}
+}
+static glm::vec3 readVec3(const GltfAccessor& accessor, size_t i) {
+	const char* p = accessor.data + i * accessor.stride;
+	glm::vec3 v;
+	if (accessor.componentType == c_GltfFloat) {
+		memcpy(&v, p, sizeof(v));
+	}
+	else {
+		size_t size = componentSize(accessor.componentType);
+		for (int c = 0; c < 3; c++) v[c] = readComponent(p + c * size, accessor.componentType, accessor.normalized);
+	}
+	return v;
+}
+static uint32_t readIndex(const GltfAccessor& accessor, size_t i) {
+	const char* p = accessor.data + i * accessor.stride;
+	switch (accessor.componentType) {
+	case c_GltfUnsignedByte:  return (uint8_t)*p;
+	case c_GltfUnsignedShort: { uint16_t v; memcpy(&v, p, sizeof(v)); return v; }
+	case c_GltfUnsignedInt:   { uint32_t v; memcpy(&v, p, sizeof(v)); return v; }
+	default:                  return UINT32_MAX;
+	}
+}
+
+static glm::mat4 nodeTransform(const mload::JsonValue& node) {
+
+	const mload::JsonValue& matrix = node["matrix"];
+	glm::mat4 transform(1.0f);
+	if (matrix.size() == 16) {
+		for (int i = 0; i < 16; i++) transform[i / 4][i % 4] = (float)matrix.items[i].number;
+		return transform;
+	}
+
+	const mload::JsonValue& t = node["translation"];
+	const mload::JsonValue& r = node["rotation"];
+	const mload::JsonValue& s = node["scale"];
+	if (r.size() == 4) transform = glm::mat4_cast(glm::quat((float)r.items[3].number, (float)r.items[0].number, (float)r.items[1].number, (float)r.items[2].number));
+	if (s.size() == 3) {
+		for (int i = 0; i < 3; i++) transform[i] *= (float)s.items[i].number;
+	}
+	if (t.size() == 3) transform[3] = glm::vec4((float)t.items[0].number, (float)t.items[1].number, (float)t.items[2].number, 1.0f);
+	return transform;
+
+}
+
+/// Flattens the node hierarchy of the default scene into the meshes it places.
+static void collectInstances(const mload::JsonValue& doc, std::vector<GltfInstance>* instances) {
+
+	const mload::JsonValue& nodes = doc["nodes"];
+	std::vector<uint32_t> roots;
+	const mload::JsonValue& scene = doc["scenes"][doc["scene"].indexOr(0)];
+	if (!scene.isNull()) {
+		for (const mload::JsonValue& root : scene["nodes"].items) roots.push_back(root.indexOr(UINT32_MAX));
+	}
+	else {
+		// No scenes, every node that isn't a child is a root
+		std::vector<bool> isChild(nodes.size(), false);
+		for (const mload::JsonValue& node : nodes.items) {
+			for (const mload::JsonValue& child : node["children"].items) {
+				if (child.indexOr(UINT32_MAX) < nodes.size()) isChild[child.indexOr(UINT32_MAX)] = true;
+			}
+		}
+		for (uint32_t i = 0; i < nodes.size(); i++) {
+			if (!isChild[i]) roots.push_back(i);
+		}
+	}
+
+	struct StackEntry {
+		uint32_t  node;
+		glm::mat4 parentTransform;
+		bool      parentIdentity;
+	};
+	std::vector<StackEntry> stack;
+	for (auto root = roots.rbegin(); root != roots.rend(); root++) stack.push_back({ *root, glm::mat4(1.0f), true });
+
+	// Nodes form a tree, a node visited twice means the file has a cycle
+	std::vector<bool> visited(nodes.size(), false);
+	while (!stack.empty()) {
+
+		StackEntry entry = stack.back();
+		stack.pop_back();
+		if (entry.node >= nodes.size() || visited[entry.node]) continue;
+		visited[entry.node] = true;
+
+		const mload::JsonValue& node = nodes[entry.node];
+		bool identity = node["matrix"].isNull() && node["translation"].isNull() && node["rotation"].isNull() && node["scale"].isNull();
+		glm::mat4 transform = identity ? entry.parentTransform : entry.parentTransform * nodeTransform(node);
+		identity = identity && entry.parentIdentity;
+
+		uint32_t mesh = node["mesh"].indexOr(UINT32_MAX);
+		if (mesh < doc["meshes"].size()) {
+			const char* name = !node["name"].isNull() ? node["name"].string.c_str() : doc["meshes"][mesh]["name"].string.c_str();
+			instances->push_back({ mesh, transform, identity, name });
+		}
+
+		const mload::JsonValue& children = node["children"];
+		for (size_t i = children.size(); i-- > 0;) stack.push_back({ children[i].indexOr(UINT32_MAX), transform, identity });
+
+	}
+
+}
+
+/// Parses the JSON of a .gltf file or the JSON chunk of a .glb file.
+static mload::Success parseGltfJson(const char* data, size_t size, mload::JsonValue* doc, GltfBuffer* glbBin) {
+
+	const char* json = data;
+	size_t jsonSize = size;
+	*glbBin = { nullptr, 0 };
+	bool glbMagic = size >= sizeof(c_GlbMagic) && memcmp(data, &c_GlbMagic, sizeof(c_GlbMagic)) == 0;
+	if (!splitGlb(data, size, &json, &jsonSize, glbBin) && glbMagic) return mload::Success::TRUNCATED_FILE;
+	if (!parseJson(json, jsonSize, doc) || doc->type != mload::JSON_OBJECT) return mload::Success::WRONG_FILE_FORMAT;
+	return mload::Success::SUCCESS;
+
+}
+
+static void bakeVertices(const GltfPrimitiveJob& job, size_t begin, size_t end, mload::Vertex* vertices) {
+
+	const GltfAccessor& pos    = job.positions;
+	const GltfAccessor& normal = job.normals;
+	mload::Vertex* dst = vertices + job.firstVertex;
+
+	// POSITION and NORMAL interleaved like Vertex, the whole range is one copy
+	bool vertexLayout = job.instance->identity && pos.componentType == c_GltfFloat && pos.stride == sizeof(mload::Vertex) &&
+	                    job.hasNormals && normal.componentType == c_GltfFloat && normal.stride == sizeof(mload::Vertex) && normal.data == pos.data + sizeof(mload::vec3);
+	if (vertexLayout) {
+		memcpy(dst + begin, pos.data + begin * pos.stride, (end - begin) * sizeof(mload::Vertex));
+		return;
+	}
+	if (job.instance->identity && pos.componentType == c_GltfFloat && (!job.hasNormals || normal.componentType == c_GltfFloat)) {
+		for (size_t i = begin; i < end; i++) {
+			memcpy(&dst[i].pos, pos.data + i * pos.stride, sizeof(mload::vec3));
+			if (job.hasNormals) memcpy(&dst[i].normal, normal.data + i * normal.stride, sizeof(mload::vec3));
+			else                dst[i].normal = { 0.0f, 0.0f, 0.0f };
+		}
+		return;
+	}
+
+	const glm::mat4& transform = job.instance->transform;
+	for (size_t i = begin; i < end; i++) {
+		glm::vec3 p = glm::vec3(transform * glm::vec4(readVec3(pos, i), 1.0f));
+		glm::vec3 n(0.0f);
+		if (job.hasNormals) {
+			n = job.normalTransform * readVec3(normal, i);
+			float length = glm::length(n);
+			if (length > 0.0f) n /= length;
+		}
+		dst[i] = mload::Vertex({ p.x, p.y, p.z }, { n.x, n.y, n.z });
+	}
+
+}
+static void bakeIndices(const GltfPrimitiveJob& job, size_t begin, size_t end, uint32_t* indices) {
+
+	// begin and end are multiples of 3
+	uint32_t* dst = indices + job.firstIndex;
+	const uint32_t firstVertex = (uint32_t)job.firstVertex;
+	const uint32_t vertexCount = (uint32_t)job.positions.count;
+
+	if (!job.hasIndices) {
+		for (size_t i = begin; i < end; i++) dst[i] = firstVertex + (uint32_t)i;
+	}
+	else if (job.indices.componentType == c_GltfUnsignedInt && job.indices.stride == sizeof(uint32_t)) {
+		memcpy(dst + begin, job.indices.data + begin * sizeof(uint32_t), (end - begin) * sizeof(uint32_t));
+		if (firstVertex != 0) {
+			for (size_t i = begin; i < end; i++) dst[i] += firstVertex;
+		}
+	}
+	else {
+		for (size_t i = begin; i < end; i++) dst[i] = firstVertex + readIndex(job.indices, i);
+	}
+
+	// Triangles with an index out of range collapse to a point instead of shifting every part behind them
+	for (size_t i = begin; i < end; i += 3) {
+		bool valid = true;
+		for (int c = 0; c < 3; c++) valid = valid && dst[i + c] - firstVertex < vertexCount;
+		if (!valid) dst[i] = dst[i + 1] = dst[i + 2] = firstVertex;
+		else if (job.flipWinding) std::swap(dst[i + 1], dst[i + 2]);
+	}
+
+}
+
+mload::Success mload::loadGltf(const char* data, size_t size, const char* fileName, std::vector<Vertex>* vertexBuff, std::vector<uint32_t>* indexBuff, std::vector<ModelPart>* parts, bool* hasNormals) {
+
+	JsonValue doc;
+	GltfBuffer glbBin;
+	Success result = parseGltfJson(data, size, &doc, &glbBin);
+	if (result != Success::SUCCESS) return result;
+
+	std::vector<std::vector<char>> bufferStorage;
+	std::vector<GltfBuffer> buffers;
+	result = loadBuffers(doc, glbBin, fileName, &bufferStorage, &buffers);
+	if (result != Success::SUCCESS) return result;
+
+	std::vector<GltfInstance> instances;
+	collectInstances(doc, &instances);
+
+	// Lay out every primitive instance in the shared buffers first, so they can be baked in any order
+	std::vector<GltfPrimitiveJob> jobs;
+	size_t vertexCount = vertexBuff->size(), indexCount = indexBuff->size();
+	*hasNormals = true;
+	for (const GltfInstance& instance : instances) {
+		const size_t instanceFirstJob = jobs.size();
+		for (const JsonValue& primitive : doc["meshes"][instance.mesh]["primitives"].items) {
+
+			if (primitive["mode"].indexOr(c_GltfModeTriangles) != c_GltfModeTriangles) continue;
+			const JsonValue& attributes = primitive["attributes"];
+
+			GltfPrimitiveJob job{};
+			job.instance         = &instance;
+			job.positionAccessor = attributes["POSITION"].indexOr(UINT32_MAX);
+			job.normalAccessor   = attributes["NORMAL"].indexOr(UINT32_MAX);
+			if (!getAccessor(doc, buffers, job.positionAccessor, 3, &job.positions) || job.positions.count == 0) continue;
+			job.hasNormals = getAccessor(doc, buffers, job.normalAccessor, 3, &job.normals) && job.normals.count >= job.positions.count;
+			job.hasIndices = !primitive["indices"].isNull();
+			if (job.hasIndices && !getAccessor(doc, buffers, primitive["indices"].indexOr(UINT32_MAX), 1, &job.indices)) continue;
+			*hasNormals = *hasNormals && job.hasNormals;
+
+			glm::mat3 linear(instance.transform);
+			job.normalTransform = glm::transpose(glm::inverse(linear));
+			job.flipWinding     = glm::determinant(linear) < 0.0f;
+			job.firstVertex     = vertexCount;
+			job.firstIndex      = indexCount;
+			job.indexCount      = (job.hasIndices ? job.indices.count : job.positions.count) / 3 * 3;
+
+			// Primitives of one mesh often index the same vertex arrays with different materials
+			for (size_t j = instanceFirstJob; j < jobs.size() && !job.sharesVertices; j++) {
+				if (jobs[j].positionAccessor == job.positionAccessor && jobs[j].normalAccessor == job.normalAccessor && !jobs[j].sharesVertices) {
+					job.sharesVertices = true;
+					job.firstVertex    = jobs[j].firstVertex;
+				}
+			}
+			if (!job.sharesVertices) vertexCount += job.positions.count;
+			indexCount  += job.indexCount;
+			if (vertexCount > UINT32_MAX || indexCount > UINT32_MAX) return Success::CORRUPT_FILE;
+
+			if (parts != nullptr) {
+				ModelPart part{};
+				part.firstIndex = (uint32_t)job.firstIndex;
+				part.indexCount = (uint32_t)job.indexCount;
+				part.name       = instance.name;
+				parts->push_back(std::move(part));
+			}
+			jobs.push_back(job);
+
+		}
+	}
+	if (indexCount == indexBuff->size()) return Success::NO_DATA_FROM_FILE;
+
+	vertexBuff->resize(vertexCount);
+	indexBuff->resize(indexCount);
+
+	// Every primitive is split into tasks of at most c_GltfTaskSize vertices or indices, spread over the worker pool
+	struct BakeTask {
+		uint32_t job;
+		bool     indices;
+		size_t   begin;
+		size_t   end;
+	};
+	std::vector<BakeTask> tasks;
+	for (uint32_t j = 0; j < jobs.size(); j++) {
+		for (size_t begin = 0; begin < jobs[j].positions.count && !jobs[j].sharesVertices; begin += c_GltfTaskSize) tasks.push_back({ j, false, begin, std::min(begin + c_GltfTaskSize, jobs[j].positions.count) });
+		for (size_t begin = 0; begin < jobs[j].indexCount;      begin += c_GltfTaskSize * 3) tasks.push_back({ j, true, begin, std::min(begin + c_GltfTaskSize * 3, jobs[j].indexCount) });
+	}
+	Vertex*   vertices = vertexBuff->data();
+	uint32_t* indices  = indexBuff->data();
+	parallelFor(tasks.size(), 1, [&](size_t begin, size_t end) {
+		for (size_t t = begin; t < end; t++) {
+			const BakeTask& task = tasks[t];
+			if (task.indices) bakeIndices (jobs[task.job], task.begin, task.end, indices);
+			else              bakeVertices(jobs[task.job], task.begin, task.end, vertices);
+		}
+	});
+
+	return Success::SUCCESS;
+
+}
+
+mload::Success mload::probeGltf(const char* data, size_t size, uint32_t* triangleCount, uint32_t* vertexCount) {
+
+	JsonValue doc;
+	GltfBuffer glbBin;
+	Success result = parseGltfJson(data, size, &doc, &glbBin);
+	if (result != Success::SUCCESS) return result;
+
+	std::vector<GltfInstance> instances;
+	collectInstances(doc, &instances);
+
+	uint64_t triangles = 0, vertices = 0;
+	for (const GltfInstance& instance : instances) {
+		// POSITION and NORMAL accessor pairs already counted for the instance, like loadGltf shares their vertices
+		std::vector<std::pair<uint32_t, uint32_t>> attributePairs;
+		for (const JsonValue& primitive : doc["meshes"][instance.mesh]["primitives"].items) {
+			if (primitive["mode"].indexOr(c_GltfModeTriangles) != c_GltfModeTriangles) continue;
+			const JsonValue& attributes = primitive["attributes"];
+			std::pair<uint32_t, uint32_t> attributePair(attributes["POSITION"].indexOr(UINT32_MAX), attributes["NORMAL"].indexOr(UINT32_MAX));
+			const JsonValue& positions = doc["accessors"][attributePair.first];
+			const JsonValue& indices   = doc["accessors"][primitive["indices"].indexOr(UINT32_MAX)];
+			uint64_t positionCount = jsonSize(positions["count"]);
+			if (std::find(attributePairs.begin(), attributePairs.end(), attributePair) == attributePairs.end()) {
+				attributePairs.push_back(attributePair);
+				vertices += positionCount;
+			}
+			triangles += (primitive["indices"].isNull() ? positionCount : jsonSize(indices["count"])) / 3;
+		}
+	}
+	*triangleCount = (uint32_t)std::min(triangles, (uint64_t)UINT32_MAX);
+	*vertexCount   = (uint32_t)std::min(vertices,  (uint64_t)UINT32_MAX);
+
+	return Success::SUCCESS;
+
+}
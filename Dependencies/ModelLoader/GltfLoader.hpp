@@ -0,0 +1,23 @@
+#pragma once
+
+#include "ModelLoader.hpp"
+
+namespace mload {
+
+	/// Reads the triangle primitives of the default scene of a .glb or .gltf file.
+	/// Node transforms are baked into the vertices, every primitive instance becomes one ModelPart of the shared buffers.
+	/// Float POSITION/NORMAL and uint32 indices are copied in bulk from the buffers, other accessor layouts are converted.
+	/// @param data       the whole file
+	/// @param fileName   external buffers of .gltf files are opened relative to it, nullptr allows only GLB and data URI buffers
+	/// @param parts      optional
+	/// @param hasNormals set to false if any primitive has no NORMAL, its normals are zero then
+	Success loadGltf(const char* data, size_t size, const char* fileName, std::vector<Vertex>* vertexBuff, std::vector<uint32_t>* indexBuff, std::vector<ModelPart>* parts, bool* hasNormals);
+
+	/// Counts the triangles and vertices loadGltf would return from the JSON alone.
+	/// @param data a .gltf file, or at least the header and JSON chunk of a .glb file
+	Success probeGltf(const char* data, size_t size, uint32_t* triangleCount, uint32_t* vertexCount);
+
+	/// Bytes of the GLB header and JSON chunk header, the JSON chunk length is at offset 12.
+	constexpr size_t c_GlbHeaderSize = 20;
+
+}
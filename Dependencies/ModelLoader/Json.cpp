@@ -0,0 +1,202 @@
+#include "Json.hpp"
+
+#include <cstring>
+#include <cstdlib>
+#include <algorithm>
+
+/// Deeper documents are rejected instead of recursing until the stack runs out.
+constexpr int c_JsonMaxDepth = 256;
+
+static const mload::JsonValue c_JsonNull;
+
+const mload::JsonValue& mload::JsonValue::operator[](const char* key) const {
+	if (type != JSON_OBJECT) return c_JsonNull;
+	for (size_t i = 0; i < keys.size(); i++) {
+		if (keys[i] == key) return items[i];
+	}
+	return c_JsonNull;
+}
+const mload::JsonValue& mload::JsonValue::operator[](size_t index) const {
+	return type == JSON_ARRAY && index < items.size() ? items[index] : c_JsonNull;
+}
+
+namespace {
+
+	class JsonParser {
+	public:
+
+		JsonParser(const char* data, size_t size) : m_c(data), m_end(data + size) {}
+
+		bool parseDocument(mload::JsonValue* root) {
+			if (!parseValue(root, 0)) return false;
+			skipWhitespace();
+			return m_c == m_end;
+		}
+
+	private:
+
+		const char* m_c;
+		const char* m_end;
+
+		void skipWhitespace() {
+			for (; m_c < m_end && (*m_c == ' ' || *m_c == '\t' || *m_c == '\n' || *m_c == '\r'); m_c++) {}
+		}
+		bool consume(const char* literal) {
+			size_t length = strlen(literal);
+			if ((size_t)(m_end - m_c) < length || memcmp(m_c, literal, length) != 0) return false;
+			m_c += length;
+			return true;
+		}
+
+		bool parseValue(mload::JsonValue* value, int depth) {
+
+			if (depth > c_JsonMaxDepth) return false;
+			skipWhitespace();
+			if (m_c == m_end) return false;
+
+			switch (*m_c) {
+			case '{': return parseObject(value, depth);
+			case '[': return parseArray(value, depth);
+			case '"': value->type = mload::JSON_STRING; return parseString(&value->string);
+			case 't': value->type = mload::JSON_BOOL; value->boolean = true;  return consume("true");
+			case 'f': value->type = mload::JSON_BOOL; value->boolean = false; return consume("false");
+			case 'n': value->type = mload::JSON_NULL; return consume("null");
+			default:  value->type = mload::JSON_NUMBER; return parseNumber(&value->number);
+			}
+
+		}
+		bool parseObject(mload::JsonValue* value, int depth) {
+
+			value->type = mload::JSON_OBJECT;
+			m_c++;
+			skipWhitespace();
+			if (m_c < m_end && *m_c == '}') { m_c++; return true; }
+			for (;;) {
+				skipWhitespace();
+				value->keys.emplace_back();
+				if (m_c == m_end || *m_c != '"' || !parseString(&value->keys.back())) return false;
+				skipWhitespace();
+				if (!consume(":")) return false;
+				value->items.emplace_back();
+				if (!parseValue(&value->items.back(), depth + 1)) return false;
+				skipWhitespace();
+				if (consume("}")) return true;
+				if (!consume(",")) return false;
+			}
+
+		}
+		bool parseArray(mload::JsonValue* value, int depth) {
+
+			value->type = mload::JSON_ARRAY;
+			m_c++;
+			skipWhitespace();
+			if (m_c < m_end && *m_c == ']') { m_c++; return true; }
+			for (;;) {
+				value->items.emplace_back();
+				if (!parseValue(&value->items.back(), depth + 1)) return false;
+				skipWhitespace();
+				if (consume("]")) return true;
+				if (!consume(",")) return false;
+			}
+
+		}
+		bool parseNumber(double* number) {
+
+			const char* numberEnd = m_c;
+			for (; numberEnd < m_end && ((*numberEnd >= '0' && *numberEnd <= '9') || *numberEnd == '-' || *numberEnd == '+' || *numberEnd == '.' || *numberEnd == 'e' || *numberEnd == 'E'); numberEnd++) {}
+			if (numberEnd == m_c || numberEnd - m_c >= 64) return false;
+
+			char text[64]{};
+			memcpy(text, m_c, numberEnd - m_c);
+			char* textEnd;
+			*number = strtod(text, &textEnd);
+			if (textEnd != text + (numberEnd - m_c)) return false;
+			m_c = numberEnd;
+			return true;
+
+		}
+		static void appendUtf8(uint32_t codePoint, std::string* str) {
+			if (codePoint < 0x80) {
+				str->push_back((char)codePoint);
+			}
+			else if (codePoint < 0x800) {
+				str->push_back((char)(0xC0 | (codePoint >> 6)));
+				str->push_back((char)(0x80 | (codePoint & 0x3F)));
+			}
+			else if (codePoint < 0x10000) {
+				str->push_back((char)(0xE0 | (codePoint >> 12)));
+				str->push_back((char)(0x80 | ((codePoint >> 6) & 0x3F)));
+				str->push_back((char)(0x80 | (codePoint & 0x3F)));
+			}
+			else {
+				str->push_back((char)(0xF0 | (codePoint >> 18)));
+				str->push_back((char)(0x80 | ((codePoint >> 12) & 0x3F)));
+				str->push_back((char)(0x80 | ((codePoint >> 6) & 0x3F)));
+				str->push_back((char)(0x80 | (codePoint & 0x3F)));
+			}
+		}
+		bool parseHex4(uint32_t* value) {
+			if (m_end - m_c < 4) return false;
+			*value = 0;
+			for (int i = 0; i < 4; i++, m_c++) {
+				char c = *m_c;
+				uint32_t digit;
+				if      (c >= '0' && c <= '9') digit = c - '0';
+				else if (c >= 'a' && c <= 'f') digit = c - 'a' + 10;
+				else if (c >= 'A' && c <= 'F') digit = c - 'A' + 10;
+				else return false;
+				*value = (*value << 4) | digit;
+			}
+			return true;
+		}
+		bool parseString(std::string* str) {
+
+			m_c++;
+			for (;;) {
+
+				// Copy everything up to the next quote or escape at once, data URIs in glTF files can be megabytes long
+				const char* run = m_c;
+				for (; m_c < m_end && *m_c != '"' && *m_c != '\\'; m_c++) {}
+				str->append(run, m_c);
+				if (m_c == m_end) return false;
+				if (*m_c++ == '"') return true;
+
+				if (m_c == m_end) return false;
+				char escape = *m_c++;
+				switch (escape) {
+				case '"':  str->push_back('"');  break;
+				case '\\': str->push_back('\\'); break;
+				case '/':  str->push_back('/');  break;
+				case 'b':  str->push_back('\b'); break;
+				case 'f':  str->push_back('\f'); break;
+				case 'n':  str->push_back('\n'); break;
+				case 'r':  str->push_back('\r'); break;
+				case 't':  str->push_back('\t'); break;
+				case 'u': {
+					uint32_t codePoint;
+					if (!parseHex4(&codePoint)) return false;
+					// Surrogate pair
+					if (codePoint >= 0xD800 && codePoint < 0xDC00 && consume("\\u")) {
+						uint32_t low;
+						if (!parseHex4(&low) || low < 0xDC00 || low >= 0xE000) return false;
+						codePoint = 0x10000 + ((codePoint - 0xD800) << 10) + (low - 0xDC00);
+					}
+					appendUtf8(codePoint, str);
+					break;
+				}
+				default: return false;
+				}
+
+			}
+
+		}
+
+	};
+
+}
+
+bool mload::parseJson(const char* data, size_t size, JsonValue* root) {
+	*root = {};
+	JsonParser parser(data, size);
+	return parser.parseDocument(root);
+}
@@ -0,0 +1,44 @@
+#pragma once
+
+#include <vector>
+#include <string>
+#include <cstdint>
+
+namespace mload {
+
+	enum JsonType : uint8_t {
+
+		JSON_NULL = 0,
+		JSON_BOOL,
+		JSON_NUMBER,
+		JSON_STRING,
+		JSON_ARRAY,
+		JSON_OBJECT,
+
+	};
+
+	/// A parsed JSON document, small enough for glTF scene descriptions.
+	/// Lookups of missing members or items return a null value, so chains like doc["meshes"][0]["name"] don't need checks.
+	struct JsonValue {
+
+		JsonType                 type    = JSON_NULL;
+		bool                     boolean = false;
+		double                   number  = 0.0;
+		std::string              string;
+		std::vector<JsonValue>   items;   // array items, or object member values
+		std::vector<std::string> keys;    // object member names, parallel to items
+
+		const JsonValue& operator[](const char* key) const;
+		const JsonValue& operator[](size_t index) const;
+		size_t size() const { return items.size(); }
+		bool   isNull() const { return type == JSON_NULL; }
+
+		double   numberOr(double fallback) const { return type == JSON_NUMBER ? number : fallback; }
+		uint32_t indexOr(uint32_t fallback) const { return type == JSON_NUMBER && number >= 0.0 ? (uint32_t)number : fallback; }
+
+	};
+
+	/// @return false if data isn't a single valid JSON value, nested at most 256 levels deep
+	bool parseJson(const char* data, size_t size, JsonValue* root);
+
+}
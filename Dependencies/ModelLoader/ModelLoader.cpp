@@ -1,8 +1,18 @@
 #include "ModelLoader.hpp"
+#include "StlDecode.hpp"
+#include "SpscQueue.hpp"
+#include "ModelSource.hpp"
+#include "PlyLoader.hpp"
+#include "GltfLoader.hpp"
+#include "ThreeMfLoader.hpp"
 
 #include <cstdio>
 #include <memory>
 #include <cassert> 
+#include <cfloat>
+#include <algorithm>
+#include <thread>
+#include <chrono>
 
 #include <glm/glm.hpp>
 
@@ -74,260 +84,983 @@ static void objGetIndexFromText(const char*& pC, const char* end, mload::ObjVert
 	v->normalIndex = getUint32FromText(pC - 1);
 
 }
-static void addVertex(const mload::Vertex& v, mload::Map<mload::Vertex, uint32_t>& uniqueVertices, std::vector<mload::Vertex>& vertexBuff, std::vector<uint32_t>& indexBuff) {
+/// STL exporters sometimes write zero or non unit facet normals. 
+inline bool normalIsValid(const mload::vec3& n) {
+	float lengthSquared = n.x * n.x + n.y * n.y + n.z * n.z;
+	return lengthSquared > 0.98f && lengthSquared < 1.02f; // false for NaN too
+}
+static mload::vec3 facetNormal(const mload::vec3& p1, const mload::vec3& p2, const mload::vec3& p3) {
+	glm::vec3 a(p1.x, p1.y, p1.z), b(p2.x, p2.y, p2.z), c(p3.x, p3.y, p3.z);
+	glm::vec3 n = glm::cross(b - a, c - a);
+	float length = glm::length(n);
+	if (length == 0.0f) return { 0.0f, 0.0f, 0.0f };
+	return { n.x / length, n.y / length, n.z / length };
+}
+/// Binary STLs with fewer facets are deduped on the loading thread. 
+constexpr size_t c_ParallelStlMinFacets = 1 << 17;
+
+/// Forwards parsing progress to LoadSettings::progressCallback, at most once per c_progressInterval bytes. 
+struct ProgressReporter {
+
+	static constexpr size_t c_progressInterval = 1 << 20;
+
+	const mload::LoadSettings* settings;
+	const char*                begin;
+	size_t                     size;
+	float                      rangeStart  = 0.0f;
+	float                      rangeLength = 0.0f;
+	size_t                     next        = 0;
+
+	/// Maps the bytes of the next pass over the file to [start, start + length] of the total progress. 
+	void setRange(float start, float length) { rangeStart = start; rangeLength = length; next = 0; }
+	void report(float progress) const { if (settings->progressCallback != nullptr) settings->progressCallback(settings->progressUserData, progress); }
+	void update(const char* c) { updateOffset((size_t)(c - begin)); }
+	void updateOffset(size_t offset) {
+		if (offset < next) return;
+		next = offset + c_progressInterval;
+		report(rangeStart + rangeLength * (float)offset / (float)size);
+	}
+
+};
+/// Collects triangles for a TriangleSink and hands them over c_TriangleBatchSize at a time. 
+class TriangleBatcher {
+public:
+
+	explicit TriangleBatcher(mload::TriangleSink* sink) : m_sink(sink) {}
+
+	void add(const mload::Vertex& v1, const mload::Vertex& v2, const mload::Vertex& v3) {
+		mload::Vertex* pCorner = &m_corners[3 * m_triangleCount];
+		pCorner[0] = v1;
+		pCorner[1] = v2;
+		pCorner[2] = v3;
+		m_addedCount++;
+		if (++m_triangleCount == mload::c_TriangleBatchSize) flush();
+	}
+	/// Triangles added so far, flushed or not. 
+	size_t added() const { return m_addedCount; }
+	void flush() {
+		if (m_triangleCount == 0) return;
+		m_sink->triangles(m_corners, m_triangleCount);
+		m_triangleCount = 0;
+	}
+
+private:
+
+	mload::TriangleSink* m_sink;
+	mload::Vertex        m_corners[3 * mload::c_TriangleBatchSize];
+	size_t               m_triangleCount = 0;
+	size_t               m_addedCount    = 0;
+
+};
 
-	bool keyExists;
-	uint32_t* pIndex = uniqueVertices.getKeyValue(v, &keyExists);
-	if (!keyExists) {
-		*pIndex = (uint32_t)vertexBuff.size();
-		vertexBuff.push_back(v);
+/// Cuts the index buffer into ModelParts at the groups of a file, "o"/"g" lines of .obj files and "solid" lines of ASCII STLs. 
+/// Every triangle adds 3 indices in file order, so a part is a range of triangles. 
+struct PartRecorder {
+
+	std::vector<mload::ModelPart> parts;
+
+	/// Starts a part at firstTriangle, which ends the previous one. A group without triangles is replaced by the next one. 
+	/// @param name the rest of the group line, [name, end) may run past the line break
+	void begin(size_t firstTriangle, const char* name, const char* end) {
+		if (parts.empty() && firstTriangle > 0) parts.push_back(mload::ModelPart{});
+		finish(firstTriangle);
+
+		const char* nameEnd = (const char*)memchr(name, '\n', (size_t)(end - name));
+		if (nameEnd == nullptr) nameEnd = end;
+		for (; name < nameEnd && (*name == ' ' || *name == '\t'); name++) {}
+		for (; nameEnd > name && (nameEnd[-1] == ' ' || nameEnd[-1] == '\t' || nameEnd[-1] == '\r'); nameEnd--) {}
+		mload::ModelPart part{};
+		part.firstIndex = 3 * (uint32_t)firstTriangle;
+		part.name.assign(name, nameEnd);
+		parts.push_back(std::move(part));
+	}
+	/// Ends the last part after triangleCount triangles. 
+	void finish(size_t triangleCount) {
+		if (parts.empty()) return;
+		parts.back().indexCount = 3 * (uint32_t)triangleCount - parts.back().firstIndex;
+		if (parts.back().indexCount == 0) parts.pop_back();
 	}
-	indexBuff.push_back(*pIndex);
+
+};
+
+/// A model file read into memory. 
+struct ModelFile {
+
+	std::unique_ptr<char[]> data;
+	uint32_t                size;
+	mload::ModelFormat      format;
+	bool                    isTextFormat;
+
+};
+static mload::Success readModelFile(const char* fileName, ModelFile* modelFile) {
+
+	mload::ModelSource source;
+	mload::Success result = source.open(fileName);
+	if (result != mload::Success::SUCCESS) return result;
+
+	modelFile->size = (uint32_t)source.size();
+	modelFile->data.reset(new char[modelFile->size]);
+	if (!source.readAll(modelFile->data.get())) return mload::Success::CORRUPT_FILE;
+
+	if (source.hasExtension(".glb") || source.hasExtension(".gltf")) {
+		modelFile->format       = mload::MODEL_FORMAT_GLTF;
+		modelFile->isTextFormat = source.hasExtension(".gltf");
+	}
+	else if (source.hasExtension(".obj")) {
+		modelFile->format       = mload::MODEL_FORMAT_OBJ;
+		modelFile->isTextFormat = true;
+	}
+	else if (source.hasExtension(".ply")) {
+		// loadPly reports the encoding
+		modelFile->format       = mload::MODEL_FORMAT_PLY;
+		modelFile->isTextFormat = false;
+	}
+	else {
+		modelFile->isTextFormat = !mload::stlIsBinary(modelFile->data.get(), modelFile->size, modelFile->size);
+		modelFile->format       = modelFile->isTextFormat ? mload::MODEL_FORMAT_STL_TEXT : mload::MODEL_FORMAT_STL_BINARY;
+		if (!modelFile->isTextFormat && modelFile->size < mload::c_StlHeaderSize) return mload::Success::NO_DATA_FROM_FILE;
+	}
+
+	return mload::Success::SUCCESS;
 
 }
 
-mload::Success mload::openModel(const char* fileName, std::vector<Vertex>* vertexBuff, std::vector<uint32_t>* indexBuff, bool* isTextFormat) {
-	
-	size_t fileNameLen = strlen(fileName); 
-	bool objFile = strcmp(&fileName[fileNameLen - 4], ".obj") == 0;
-	bool stlFile = strcmp(&fileName[fileNameLen - 4], ".stl") == 0; 
-	if (!(objFile || stlFile)) return Success::WRONG_FILE_FORMAT;
-
-	FILE* file = fopen(fileName, "rb");
-	if (file == nullptr) return Success::COULD_NOT_OPEN_FILE; 
-
-	fseek(file, 0, SEEK_END); 
-	uint32_t fileSize = (uint32_t)ftell(file);
-	fseek(file, 0, SEEK_SET);
-	std::unique_ptr<char[]> fData(new char[fileSize]);
-	fread(fData.get(), 1, fileSize, file);
-
-	uint32_t indexElementsCapacity  = 0; 
-	uint32_t vertexElementsCapacity = 0; // .obj use only
-	uint32_t normalsCapacity        = 0; // .obj use only
-	// Get file data counts to presize buffers
-	if (stlFile) {
-		uint32_t facetCount = 0; 
-		if (memcmp(fData.get(), "solid", 5) == 0) { // if ascii
-			facetCount = (fileSize / 258 + 1);
-			*isTextFormat = true;
+/// 3MF packages are zip archives with a fixed layout, load3mf reads them instead of a ModelSource. 
+static bool is3mfFile(const char* fileName) {
+	size_t fileNameLen = strlen(fileName);
+	return fileNameLen >= 4 && strcmp(&fileName[fileNameLen - 4], ".3mf") == 0;
+}
+
+/// Element counts of an .obj file, used to presize the buffers. 
+struct ObjCounts {
+
+	uint32_t positions;
+	uint32_t normals;
+	uint32_t indices;   // after triangulating the faces
+
+};
+static ObjCounts countObjElements(const char* data, uint32_t size, ProgressReporter& progress) {
+
+	ObjCounts counts{};
+	progress.setRange(0.0f, 0.2f);
+	for (const char* c = data, *end = data + size; c < end;) {
+		
+		progress.update(c);
+		if(*c == 'v') {
+			c++; 
+			if      (*c == ' ') counts.positions++;
+			else if (*c == 'n') counts.normals++;
+			c += 6; // 6 = minimum line length after 'v' so we jump it.
+			skipLine(c, end); 
 		}
-		else { // if binary
-			facetCount = *(uint32_t*)&fData[80];
-			*isTextFormat = false;
+		else if (*c == 'f') {  
+			c++; 
+			for (uint32_t indexCount = 0; *c != '\n' && c < end; c++) {
+				if (*c == ' ' && charIsDigit(c[1])) {
+					indexCount++;  
+					counts.indices += indexCount > 3 ? 3 : 1;
+				}
+			}
 		}
-		indexElementsCapacity = 3 * facetCount; 
+		else {
+			skipLine(c, end); 
+		}
+
 	}
-	// If (objFile)
-	else {
-		*isTextFormat = true; 
-		for (const char* c = &fData[0], *end = &fData[fileSize]; c < end;) {
-			
-			if(*c == 'v') {
-				c++; 
-				if      (*c == ' ') vertexElementsCapacity++;
-				else if (*c == 'n') normalsCapacity++;
-				c += 6; // 6 = minimum line length after 'v' so we jump it.
-				skipLine(c, end); 
+	return counts;
+
+}
+/// Reads the "v" and "vn" lines of an .obj file. 
+static void readObjVertices(const char* data, uint32_t size, const ObjCounts& counts, std::vector<mload::vec3>* positions, std::vector<mload::vec3>* normals, ProgressReporter& progress) {
+
+	positions->reserve(counts.positions);
+	normals->reserve(counts.normals);
+
+	progress.setRange(0.2f, 0.3f);
+	for (const char* c = data, *end = data + size; c < end;) {
+		progress.update(c);
+		if (*c != 'v') { skipLine(c, end); continue; }
+
+		c++;
+		if (*c == ' ') { 
+			c++; 
+			skipWhitespace(c); 
+			positions->emplace_back();
+			objGetVec3FromText(c, end, (float*)&positions->back());
+		}
+		else if (*c == 'n') {
+			c += 2; 
+			skipWhitespace(c); 
+			normals->emplace_back();
+			objGetVec3FromText(c, end, (float*)&normals->back());
+		}
+
+	}
+
+}
+
+/// Parse state of an ASCII STL, carried from one chunk of the file to the next. 
+struct StlTextState {
+
+	static constexpr size_t c_floatsPerFacet = 12;
+
+	float        facet[c_floatsPerFacet]; // normal and the 3 positions
+	uint32_t     floatIndex    = 0;
+	size_t       triangleCount = 0;
+	PartRecorder* parts        = nullptr; // optional, gets a part per solid
+
+};
+/// [data, data + size) must end on a line break unless it is the end of the file. 
+static void streamStlText(const char* data, size_t size, StlTextState& state, TriangleBatcher& batcher, ProgressReporter& progress) {
+
+	float*    facet      = state.facet;
+	uint32_t& floatIndex = state.floatIndex;
+	for (const char* c = data, *end = data + size; c < end; c++) {
+		if (*c != '.') {
+			// Only "solid" and "endsolid" lines have an 's', their names may contain dots
+			if (*c != 's') continue;
+			if (end - c >= 5 && memcmp(c, "solid", 5) == 0 && (c == data || c[-1] != 'd') && state.parts != nullptr) state.parts->begin(state.triangleCount, c + 5, end);
+			skipLine(c, end);
+			c--;
+			continue;
+		}
+		progress.update(c);
+
+		// first decimal place
+		float value = (float)(c[-1] - '0');
+		// handle negative
+		float negative = c[-2] == '-' ? -1.0f : 1.0f;
+		c++;
+		// Convert significand to float
+		for (float place = 0.1f; *c != 'e'; place *= 0.1f, c++) {
+			value += place * (*c - '0');
+		}
+		value *= negative;
+
+		// Apply exponent
+		c += 4;
+		for (; charIsDigit(*c); c++);
+		int exponent = 0;
+		uint32_t digitBase = 1;
+		const char* ex_c = &c[-1];
+		for (; *ex_c != '-' && *ex_c != '+'; --ex_c, digitBase *= 10) {
+			exponent += digitBase * (*ex_c - '0');
+		}
+		exponent *= *ex_c == '-' ? -1 : 1;
+		value *= powf(10.0f, (float)exponent);
+
+		facet[floatIndex] = value;
+		floatIndex++;
+		if (floatIndex < StlTextState::c_floatsPerFacet) continue;
+
+		floatIndex = 0;
+		state.triangleCount++;
+
+		const mload::vec3& p1 = *(mload::vec3*)&facet[3];
+		const mload::vec3& p2 = *(mload::vec3*)&facet[6];
+		const mload::vec3& p3 = *(mload::vec3*)&facet[9];
+		mload::vec3 normal = *(mload::vec3*)&facet[0];
+		if (!normalIsValid(normal)) normal = facetNormal(p1, p2, p3);
+		batcher.add(mload::Vertex(p1, normal), mload::Vertex(p2, normal), mload::Vertex(p3, normal));
+
+	}
+
+}
+static void streamStlBinary(const char* data, uint32_t size, TriangleBatcher& batcher, ProgressReporter& progress) {
+
+	size_t facetCount = (size - mload::c_StlHeaderSize) / mload::c_StlFacetSize;
+	const char* pFacets = data + mload::c_StlHeaderSize;
+	progress.setRange(0.0f, 0.9f);
+	mload::StlFacetBlock block;
+	for (size_t first = 0; first < facetCount; first += mload::c_StlDecodeBlock) {
+
+		const char* pBlock = pFacets + first * mload::c_StlFacetSize;
+		progress.update(pBlock);
+		size_t count = std::min(mload::c_StlDecodeBlock, facetCount - first);
+		mload::decodeStlFacets(pBlock, count, &block);
+		for (size_t facet = 0; facet < count; facet++) batcher.add(block.vertex(0, facet), block.vertex(1, facet), block.vertex(2, facet));
+
+	}
+
+}
+/// True for "o" and "g" lines, they start a part. 
+inline bool objLineIsGroup(const char* c, const char* end) {
+	return end - c >= 2 && (c[0] == 'o' || c[0] == 'g') && (c[1] == ' ' || c[1] == '\t');
+}
+/// Faces with more than 3 vertex references are split into a fan around the first one. 
+/// @param parts optional, gets a part per "o"/"g" line
+static void streamObjFaces(const char* data, uint32_t size, const std::vector<mload::vec3>& positions, const std::vector<mload::vec3>& normals, TriangleBatcher& batcher, ProgressReporter& progress, PartRecorder* parts) {
+
+	progress.setRange(0.5f, 0.4f);
+	for (const char* c = data, *end = data + size; c < end;) {
+		progress.update(c);
+		if (*c != 'f') { 
+			if (parts != nullptr && objLineIsGroup(c, end)) parts->begin(batcher.added(), c + 2, end);
+			skipLine(c, end); 
+			continue; 
+		}
+
+		c += 2;
+		mload::Vertex fanCenter, previous;
+		if (normals.size() > 0) {
+			skipWhitespace(c);
+			uint32_t vertexCountInFacet = 0;
+			for (; c < end && charIsDigit(*c); c++) {
+				mload::ObjVertexIndex vertexIndex;
+				objGetIndexFromText(c, end, &vertexIndex);
+				// index - 1 to convert to 0 based indexing (.obj format doesn't use 0 based indexing)
+				mload::Vertex v(positions[vertexIndex.posIndex - 1], normals[vertexIndex.normalIndex - 1]);
+				vertexCountInFacet++;
+				if      (vertexCountInFacet == 1) fanCenter = v;
+				else if (vertexCountInFacet >= 3) batcher.add(fanCenter, previous, v);
+				previous = v;
 			}
-			else if (*c == 'f') {  
-				c++; 
-				for (uint32_t indexCount = 0; *c != '\n' && c < end; c++) {
-					if (*c == ' ' && charIsDigit(c[1])) {
-						indexCount++;  
-      					indexElementsCapacity += indexCount > 3 ? 3 : 1;
-					}
-				}
+		}
+		else {
+			uint32_t facetIndices[3]; 
+			for (int facetIndex = 0; facetIndex < 3; facetIndex++) {
+				skipWhitespace(c);
+				facetIndices[facetIndex] = getVertexIndexFromVertexReference(c); 
 			}
-			else {
-				skipLine(c, end); 
+			const glm::vec3& p1 = *(glm::vec3*)&positions[facetIndices[0] - 1];
+			const glm::vec3& p2 = *(glm::vec3*)&positions[facetIndices[1] - 1];
+			const glm::vec3& p3 = *(glm::vec3*)&positions[facetIndices[2] - 1];
+			// The whole fan shares the normal of its first triangle. 
+			glm::vec3 n = glm::normalize(glm::cross(p2 - p1, p3 - p1)); 
+			mload::vec3 normal = *(mload::vec3*)&n;
+			fanCenter = mload::Vertex(*(mload::vec3*)&p1, normal);
+			previous  = mload::Vertex(*(mload::vec3*)&p3, normal);
+			batcher.add(fanCenter, mload::Vertex(*(mload::vec3*)&p2, normal), previous);
+
+			// if there are more than 3 vertex references in a facet
+			while (*c == ' ' && charIsDigit(c[1])) {
+				c++;
+				mload::Vertex v(positions[getVertexIndexFromVertexReference(c) - 1], normal);
+				batcher.add(fanCenter, previous, v);
+				previous = v;
 			}
+		}
+
+	}
 
+}
+
+/// Fills ModelPart::boundsMin/boundsMax from the vertices every part references. 
+static void computePartBounds(const std::vector<mload::Vertex>& vertexBuff, const std::vector<uint32_t>& indexBuff, std::vector<mload::ModelPart>* parts) {
+	for (mload::ModelPart& part : *parts) {
+		glm::vec3 boundsMin(FLT_MAX), boundsMax(-FLT_MAX);
+		const uint32_t* pIndex = &indexBuff[part.firstIndex];
+		for (uint32_t i = 0; i < part.indexCount; i++) {
+			const mload::vec3& pos = vertexBuff[pIndex[i]].pos;
+			boundsMin = glm::min(boundsMin, glm::vec3(pos.x, pos.y, pos.z));
+			boundsMax = glm::max(boundsMax, glm::vec3(pos.x, pos.y, pos.z));
 		}
+		part.boundsMin = { boundsMin.x, boundsMin.y, boundsMin.z };
+		part.boundsMax = { boundsMax.x, boundsMax.y, boundsMax.z };
 	}
+}
+/// Center and radius of the model drawn once per instance, from the bounding box of every part. 
+static void instancedBounds(const std::vector<mload::ModelPart>& parts, const std::vector<mload::ModelInstance>& instances, glm::vec3* center, float* radius) {
+
+	*center = glm::vec3(0.0f);
+	*radius = 0.0f;
+	float weight = 0.0f;
+	for (const mload::ModelInstance& instance : instances) {
+		const mload::ModelPart& part = parts[instance.part];
+		glm::vec3 boundsMin(part.boundsMin.x, part.boundsMin.y, part.boundsMin.z);
+		glm::vec3 boundsMax(part.boundsMax.x, part.boundsMax.y, part.boundsMax.z);
+		glm::vec3 partCenter = 0.5f * (boundsMin + boundsMax);
+		float     partRadius = glm::length(glm::max(glm::abs(boundsMin), glm::abs(boundsMax)));
+
+		glm::mat4 transform;
+		memcpy(&transform[0][0], instance.transform, sizeof(instance.transform));
+		float scale = std::max(glm::length(glm::vec3(transform[0])), std::max(glm::length(glm::vec3(transform[1])), glm::length(glm::vec3(transform[2]))));
+		float partWeight = (float)part.indexCount;
+		*center += partWeight * glm::vec3(transform * glm::vec4(partCenter, 1.0f));
+		*radius  = std::max(*radius, glm::length(glm::vec3(transform[3])) + scale * partRadius);
+		weight  += partWeight;
+	}
+	*center /= std::max(weight, 1.0f);
+
+}
+
+/// Generates the normals the settings ask for and fills info. 
+/// @param colors    optional, per vertex, moved into info
+/// @param parts     optional, moved into info
+/// @param instances optional, instances of the parts, moved into info
+static void finishModel(const mload::LoadSettings& settings, ProgressReporter& progress, std::vector<mload::Vertex>* vertexBuff, std::vector<uint32_t>* indexBuff, mload::ModelInfo* info, std::vector<uint32_t>* colors = nullptr, std::vector<mload::ModelPart>* parts = nullptr, std::vector<mload::ModelInstance>* instances = nullptr) {
+
+	uint32_t fileVertexCount = (uint32_t)vertexBuff->size();
+	bool normalsGenerated = settings.normalMode != mload::NORMAL_MODE_FILE;
+	if (normalsGenerated) {
+		progress.report(0.9f);
+		mload::generateNormals(settings.normalMode, settings.creaseAngle, vertexBuff, indexBuff, colors);
+	}
+
+	if (info != nullptr) {
+		glm::vec3 center(0.0f);
+		float radius = 0.0f;
+		if (parts != nullptr) computePartBounds(*vertexBuff, *indexBuff, parts);
+		if (instances != nullptr && !instances->empty()) {
+			instancedBounds(*parts, *instances, &center, &radius);
+		}
+		else {
+			for (const mload::Vertex& vertex : *vertexBuff) {
+				glm::vec3 pos(vertex.pos.x, vertex.pos.y, vertex.pos.z);
+				center += pos;
+				radius  = std::max(radius, glm::length(pos));
+			}
+			center /= (float)vertexBuff->size();
+		}
+
+		info->normalsGenerated = normalsGenerated;
+		info->fileVertexCount  = fileVertexCount;
+		info->center           = { center.x, center.y, center.z };
+		info->radius           = radius;
+		if (colors != nullptr) info->colors.swap(*colors);
+		else                   info->colors.clear();
+		if (parts != nullptr)  info->parts.swap(*parts);
+		else                   info->parts.clear();
+		if (instances != nullptr) info->instances.swap(*instances);
+		else                      info->instances.clear();
+	}
+	progress.report(1.0f);
+
+}
+
+mload::Success mload::streamModel(const char* fileName, TriangleSink* sink, bool* isTextFormat, const LoadSettings* settings) {
+
+	const LoadSettings defaultSettings;
+	if (settings == nullptr) settings = &defaultSettings;
+
+	if (is3mfFile(fileName)) {
+		std::vector<Vertex>        vertices;
+		std::vector<uint32_t>      indices;
+		std::vector<ModelPart>     parts;
+		std::vector<ModelInstance> instances;
+		Success result = load3mf(fileName, *settings, &vertices, &indices, &parts, &instances);
+		if (result != Success::SUCCESS) return result;
+		*isTextFormat = true;
+
+		// The sink has no instances, every instance is streamed as transformed copies of its part.
+		// 3MF has no normals, the corners get the normal of their transformed face.
+		TriangleBatcher batcher(sink);
+		if (instances.empty()) {
+			sink->begin(indices.size() / 3);
+			for (size_t i = 0; i < indices.size(); i += 3) {
+				const vec3& p1 = vertices[indices[i]].pos, & p2 = vertices[indices[i + 1]].pos, & p3 = vertices[indices[i + 2]].pos;
+				vec3 normal = facetNormal(p1, p2, p3);
+				batcher.add(Vertex(p1, normal), Vertex(p2, normal), Vertex(p3, normal));
+			}
+		}
+		else {
+			size_t triangleCount = 0;
+			for (const ModelInstance& instance : instances) triangleCount += parts[instance.part].indexCount / 3;
+			sink->begin(triangleCount);
+			for (const ModelInstance& instance : instances) {
+				glm::mat4 transform;
+				memcpy(&transform[0][0], instance.transform, sizeof(instance.transform));
+				// A mirroring transform turns the faces inside out, swapping two corners keeps them facing outward
+				bool flipWinding = glm::determinant(glm::mat3(transform)) < 0.0f;
+				const ModelPart& part = parts[instance.part];
+				vec3 corners[3];
+				for (uint32_t i = part.firstIndex; i < part.firstIndex + part.indexCount; i += 3) {
+					for (int corner = 0; corner < 3; corner++) {
+						const vec3& pos = vertices[indices[i + corner]].pos;
+						glm::vec4 p = transform * glm::vec4(pos.x, pos.y, pos.z, 1.0f);
+						corners[corner] = { p.x, p.y, p.z };
+					}
+					if (flipWinding) std::swap(corners[1], corners[2]);
+					vec3 normal = facetNormal(corners[0], corners[1], corners[2]);
+					batcher.add(Vertex(corners[0], normal), Vertex(corners[1], normal), Vertex(corners[2], normal));
+				}
+			}
+		}
+		batcher.flush();
+		sink->end();
+		return Success::SUCCESS;
+	}
+
+	ModelFile file;
+	Success result = readModelFile(fileName, &file);
+	if (result != Success::SUCCESS) return result;
+	*isTextFormat = file.isTextFormat;
+
+	ProgressReporter progress{ settings, file.data.get(), file.size };
+	progress.report(0.0f);
+
+	TriangleBatcher batcher(sink);
+	if (file.format == MODEL_FORMAT_PLY || file.format == MODEL_FORMAT_GLTF) {
+		std::vector<Vertex> vertices;
+		std::vector<uint32_t> indices;
+		bool hasNormals;
+		if (file.format == MODEL_FORMAT_PLY) result = loadPly(file.data.get(), file.size, &vertices, &indices, nullptr, &hasNormals, isTextFormat);
+		else                                 result = loadGltf(file.data.get(), file.size, fileName, &vertices, &indices, nullptr, &hasNormals);
+		if (result != Success::SUCCESS) return result;
+		sink->begin(indices.size() / 3);
+		for (size_t i = 0; i < indices.size(); i += 3) batcher.add(vertices[indices[i]], vertices[indices[i + 1]], vertices[indices[i + 2]]);
+	}
+	else if (file.format == MODEL_FORMAT_OBJ) {
+		ObjCounts counts = countObjElements(file.data.get(), file.size, progress);
+		if (counts.indices == 0) return Success::NO_DATA_FROM_FILE;
+		std::vector<vec3> positions, normals;
+		readObjVertices(file.data.get(), file.size, counts, &positions, &normals, progress);
+		sink->begin(counts.indices / 3);
+		streamObjFaces(file.data.get(), file.size, positions, normals, batcher, progress, nullptr);
+	}
+	else if (file.isTextFormat) {
+		sink->begin(file.size / 258 + 1);
+		StlTextState textState;
+		progress.setRange(0.0f, 0.9f);
+		streamStlText(file.data.get(), file.size, textState, batcher, progress);
+	}
+	else {
+		size_t facetCount = (file.size - c_StlHeaderSize) / c_StlFacetSize;
+		if (facetCount == 0) return Success::NO_DATA_FROM_FILE;
+		sink->begin(facetCount);
+		streamStlBinary(file.data.get(), file.size, batcher, progress);
+	}
+	batcher.flush();
+	sink->end();
+	progress.report(1.0f);
+
+	return Success::SUCCESS;
+
+}
+
+mload::Success mload::openModel(const char* fileName, std::vector<Vertex>* vertexBuff, std::vector<uint32_t>* indexBuff, bool* isTextFormat, const LoadSettings* settings, ModelInfo* info) {
+	
+	const LoadSettings defaultSettings;
+	if (settings == nullptr) settings = &defaultSettings;
+
+	// 3MF stores every object once, build items and components become instances of it
+	if (is3mfFile(fileName)) {
+		ProgressReporter progress{ settings, nullptr, 0 };
+		progress.report(0.0f);
+		std::vector<ModelPart>     parts;
+		std::vector<ModelInstance> instances;
+		Success result = load3mf(fileName, *settings, vertexBuff, indexBuff, &parts, &instances);
+		if (result != Success::SUCCESS) return result;
+		*isTextFormat = true;
+		// 3MF has no normals
+		LoadSettings indexedSettings = *settings;
+		if (indexedSettings.normalMode == NORMAL_MODE_FILE) indexedSettings.normalMode = NORMAL_MODE_SMOOTH;
+		finishModel(indexedSettings, progress, vertexBuff, indexBuff, info, nullptr, &parts, &instances);
+		return Success::SUCCESS;
+	}
+
+	ModelFile file;
+	Success result = readModelFile(fileName, &file);
+	if (result != Success::SUCCESS) return result;
+	*isTextFormat = file.isTextFormat;
+	const char* fData = file.data.get();
+
+	ProgressReporter progress{ settings, fData, file.size };
+	progress.report(0.0f);
+
+	// Indexed formats, their loaders build the mesh directly
+	if (file.format == MODEL_FORMAT_PLY || file.format == MODEL_FORMAT_GLTF) {
+		std::vector<uint32_t>  colors;
+		std::vector<ModelPart> parts;
+		bool hasNormals;
+		if (file.format == MODEL_FORMAT_PLY) result = loadPly(fData, file.size, vertexBuff, indexBuff, &colors, &hasNormals, isTextFormat);
+		else                                 result = loadGltf(fData, file.size, fileName, vertexBuff, indexBuff, &parts, &hasNormals);
+		if (result != Success::SUCCESS) return result;
+		// Without normals in the file smooth ones look closer to what the author saw than flat shading
+		LoadSettings indexedSettings = *settings;
+		if (!hasNormals && indexedSettings.normalMode == NORMAL_MODE_FILE) indexedSettings.normalMode = NORMAL_MODE_SMOOTH;
+		finishModel(indexedSettings, progress, vertexBuff, indexBuff, info, colors.empty() ? nullptr : &colors, &parts);
+		return Success::SUCCESS;
+	}
+
+	// Get file data counts to presize buffers
+	ObjCounts objCounts{};
+	uint32_t indexElementsCapacity = 0; 
+	uint32_t stlFacets = 0; // binary STL only, checked against the file size before anything is reserved for it
+	if (file.format == MODEL_FORMAT_STL_BINARY && !stlFacetCount(fData, file.size, &stlFacets)) return Success::TRUNCATED_FILE;
+	if (file.format == MODEL_FORMAT_OBJ)           indexElementsCapacity = (objCounts = countObjElements(fData, file.size, progress)).indices;
+	else if (file.format == MODEL_FORMAT_STL_TEXT) indexElementsCapacity = 3 * (file.size / 258 + 1);
+	else                                           indexElementsCapacity = 3 * stlFacets;
 
 	if (indexElementsCapacity == 0) return Success::NO_DATA_FROM_FILE; 
 
-	uint32_t predictedUniqueVertexCount = (uint32_t)(0.9f * indexElementsCapacity); 
+	uint32_t predictedUniqueVertexCount = (uint32_t)(c_PredictedUniqueVertexRatio * indexElementsCapacity); 
 	indexBuff->reserve(indexElementsCapacity); 
 	vertexBuff->reserve(predictedUniqueVertexCount);
 
 	// Parsing / reading
-	if (stlFile) {
-		Map<Vertex, uint32_t> uniqueVertices((size_t)(1.5 * indexElementsCapacity), predictedUniqueVertexCount);
-		if (*isTextFormat) {
-			constexpr size_t floatsPerFacet = 12;
-			float facet[floatsPerFacet];
-			uint32_t floatIndex = 0;
-			for (char* c = &fData[0], *end = &fData[fileSize]; c < end; c++) {
-				if (*c != '.') continue;
-
-				// first decimal place
-				float value = (float)(c[-1] - '0');
-				// handle negative
-				float negative = c[-2] == '-' ? -1.0f : 1.0f;
-				c++;
-				// Convert significand to float
-				for (float place = 0.1f; *c != 'e'; place *= 0.1f, c++) {
-					value += place * (*c - '0');
-				}
-				value *= negative;
-
-				// Apply exponent
-				c += 4;
-				for (; charIsDigit(*c); c++);
-				int exponent = 0;
-				uint32_t digitBase = 1;
-				char* ex_c = &c[-1];
-				for (; *ex_c != '-' && *ex_c != '+'; --ex_c, digitBase *= 10) {
-					exponent += digitBase * (*ex_c - '0');
-				}
-				exponent *= *ex_c == '-' ? -1 : 1;
-				value *= powf(10.0f, (float)exponent);
+	PartRecorder parts;
+	std::vector<uint32_t> colors;
+	// Binary STLs and .obj files with normals dedup on what the file indexes directly, everything else streams through a MeshBuilder. 
+	if (file.format == MODEL_FORMAT_STL_BINARY) {
+		size_t facetCount = stlFacets;
+		const char* pFacets = &fData[c_StlHeaderSize];
+		uint32_t defaultColor;
+		StlColorFormat colorFormat = stlColorFormat(fData, file.size, &defaultColor);
+		if (colorFormat != STL_COLOR_NONE) {
+			// The color is part of the vertex, so colored files keep the serial dedup
+			Map<ColoredVertex, uint32_t> uniqueVertices((size_t)(1.5 * indexElementsCapacity), predictedUniqueVertexCount);
+			colors.reserve(predictedUniqueVertexCount);
+			progress.setRange(0.0f, 0.9f);
+			StlFacetBlock block;
+			for (size_t first = 0; first < facetCount; first += c_StlDecodeBlock) {
+				const char* pBlock = pFacets + first * c_StlFacetSize;
+				progress.update(pBlock);
+				size_t count = std::min(c_StlDecodeBlock, facetCount - first);
+				decodeStlFacets(pBlock, count, &block);
+				dedupStlBlockColored(block, pBlock, count, colorFormat, defaultColor, uniqueVertices, vertexBuff, indexBuff, &colors);
+			}
+		}
+		else if (facetCount >= c_ParallelStlMinFacets && WorkerPool::shared().threadCount() > 1) {
+			dedupStlFacetsParallel(WorkerPool::shared(), pFacets, facetCount, vertexBuff, indexBuff);
+		}
+		else {
+			Map<Vertex, uint32_t> uniqueVertices((size_t)(1.5 * indexElementsCapacity), predictedUniqueVertexCount);
+			progress.setRange(0.0f, 0.9f);
+			StlFacetBlock block;
+			for (size_t first = 0; first < facetCount; first += c_StlDecodeBlock) {
 
-				facet[floatIndex] = value;
-				floatIndex++;
-				if (floatIndex < floatsPerFacet) continue;
+				const char* pBlock = pFacets + first * c_StlFacetSize;
+				progress.update(pBlock);
+				size_t count = std::min(c_StlDecodeBlock, facetCount - first);
+				decodeStlFacets(pBlock, count, &block);
+				dedupStlBlock(block, count, uniqueVertices, vertexBuff, indexBuff);
 
-				floatIndex = 0;
+			}
+		}
+	}
+	else if (file.format == MODEL_FORMAT_OBJ && objCounts.normals > 0) {
 
-				Vertex v(*(vec3*)&facet[3], *(vec3*)&facet[0]);
-				addVertex(v, uniqueVertices, *vertexBuff, *indexBuff);
+		std::vector<vec3> vertexPositions, vertexNormals;
+		readObjVertices(fData, file.size, objCounts, &vertexPositions, &vertexNormals, progress);
 
-				v.pos = *(vec3*)&facet[6];
-				addVertex(v, uniqueVertices, *vertexBuff, *indexBuff);
+		Map<ObjVertexIndex, uint32_t> uniqueVertices((size_t)(1.5 * indexElementsCapacity), predictedUniqueVertexCount);
 
-				v.pos = *(vec3*)&facet[9];
-				addVertex(v, uniqueVertices, *vertexBuff, *indexBuff);
+		progress.setRange(0.5f, 0.4f);
+		for (const char* c = fData, *end = &fData[file.size]; c < end;) {
+			progress.update(c);
+			if (*c != 'f') { 
+				if (objLineIsGroup(c, end)) parts.begin(indexBuff->size() / 3, c + 2, end);
+				skipLine(c, end); 
+				continue; 
+			}
+
+			c += 2;
+			skipWhitespace(c);
+			uint32_t vertexCountInFacet = 0;
+			for (; c < end && charIsDigit(*c); c++) {
+				mload::ObjVertexIndex vertexIndex;
+				objGetIndexFromText(c, end, &vertexIndex);
+				bool keyExists;
+				uint32_t* pIndex = uniqueVertices.getKeyValue(vertexIndex, &keyExists);
+				if (!keyExists) {
+					*pIndex = (uint32_t)vertexBuff->size();
+					// index - 1 to convert to 0 based indexing (.obj format doesn't use 0 based indexing)
+					vertexBuff->emplace_back(vertexPositions[vertexIndex.posIndex - 1], vertexNormals[vertexIndex.normalIndex - 1]);
+				}
+				vertexCountInFacet++;
+				if (vertexCountInFacet > 3) {
+					indexBuff->push_back((*indexBuff)[indexBuff->size() - 3 * (vertexCountInFacet - 3)]);
+					indexBuff->push_back((*indexBuff)[indexBuff->size() - 2]);
+				}
+				indexBuff->push_back(*pIndex);
 
 			}
-		} 
-		// binary STL
+		}
+
+	}
+	else {
+
+		MeshBuilder builder(vertexBuff, indexBuff, indexElementsCapacity / 3);
+		TriangleBatcher batcher(&builder);
+		if (file.format == MODEL_FORMAT_OBJ) {
+			std::vector<vec3> vertexPositions, vertexNormals;
+			readObjVertices(fData, file.size, objCounts, &vertexPositions, &vertexNormals, progress);
+			streamObjFaces(fData, file.size, vertexPositions, vertexNormals, batcher, progress, &parts);
+		}
 		else {
-			for (char* pFacet = &fData[84], *end = &fData[fileSize]; pFacet < end; pFacet += 50) {
+			StlTextState textState;
+			textState.parts = &parts;
+			progress.setRange(0.0f, 0.9f);
+			streamStlText(fData, file.size, textState, batcher, progress);
+		}
+		batcher.flush();
 
-				Vertex v(*(vec3*)&pFacet[12], *(vec3*)&pFacet[0]);
-				addVertex(v, uniqueVertices, *vertexBuff, *indexBuff);
+	}
+	parts.finish(indexBuff->size() / 3);
 
-				v.pos = *(vec3*)&pFacet[24];
-				addVertex(v, uniqueVertices, *vertexBuff, *indexBuff);
+	finishModel(*settings, progress, vertexBuff, indexBuff, info, colors.empty() ? nullptr : &colors, &parts.parts);
 
-				v.pos = *(vec3*)&pFacet[36];
-				addVertex(v, uniqueVertices, *vertexBuff, *indexBuff);
+	return Success::SUCCESS;
+}
+
+/// Bytes the pipeline reader hands to the parser at once. 
+constexpr size_t c_PipelineChunkSize = 1 << 20;
+/// Chunks or batches that can wait between two pipeline stages. 
+constexpr size_t c_PipelineDepth     = 4;
+
+/// A piece of the file. Ends on a line break for ASCII STLs and on a facet for binary ones. 
+struct PipelineChunk {
+
+	std::unique_ptr<char[]> data; // c_PipelineChunkSize bytes
+	size_t                  size;
+	size_t                  fileEnd; // offset of the end of the chunk in the file
+
+};
+/// Triangle corners parsed from one chunk with their hashVertex. 
+struct PipelineBatch {
+
+	std::vector<mload::Vertex> corners;
+	std::vector<uint32_t>      hashes;
+	size_t                     fileEnd;
+
+};
+/// Sink that appends every corner to a vector. 
+class CornerSink : public mload::TriangleSink {
+public:
+
+	explicit CornerSink(std::vector<mload::Vertex>* corners) : m_corners(corners) {}
+	void triangles(const mload::Vertex* corners, size_t triangleCount) override { m_corners->insert(m_corners->end(), corners, corners + 3 * triangleCount); }
+
+private:
+
+	std::vector<mload::Vertex>* m_corners;
+
+};
+/// Adds the time until it goes out of scope to a stage of PipelineStats. 
+struct StageTimer {
+
+	float*                                seconds;
+	std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+
+	~StageTimer() { *seconds += std::chrono::duration<float>(std::chrono::steady_clock::now() - start).count(); }
+
+};
+
+/// Cuts the bytes ModelSource::decode hands out into pipeline chunks, on the reader thread. 
+struct PipelineWriter {
 
+	bool                              binary;
+	size_t                            chunkCapacity; // whole facets for binary STLs, so no facet is split between two chunks
+	size_t                            skip;          // header bytes still to drop
+	uint64_t                          remaining;     // model bytes still passed on, a binary STL ends after the facets of its header
+	uint64_t                          ignored;       // bytes after the end
+	size_t                            fileOffset;    // of the end of the last full chunk in the model
+	mload::SpscQueue<PipelineChunk*>* freeChunks;
+	mload::SpscQueue<PipelineChunk*>* fullChunks;
+	PipelineChunk*                    chunk;
+	size_t                            used;
+	float                             waitSeconds;   // on the parser, not counted as busy
+
+	static bool write(void* userData, const char* data, size_t size) {
+		PipelineWriter* writer = (PipelineWriter*)userData;
+		size_t skipped = std::min(size, writer->skip);
+		writer->skip -= skipped;
+		data += skipped;
+		size -= skipped;
+		size_t passed = (size_t)std::min<uint64_t>(size, writer->remaining);
+		writer->remaining -= passed;
+		writer->ignored   += size - passed;
+		size = passed;
+		while (size > 0) {
+			size_t count = std::min(size, writer->chunkCapacity - writer->used);
+			memcpy(&writer->chunk->data[writer->used], data, count);
+			writer->used += count;
+			data += count;
+			size -= count;
+			if (writer->used == writer->chunkCapacity) writer->cut();
+		}
+		return true;
+	}
+	/// Sends the full chunk to the parser and moves the start of its last line to the next one. 
+	void cut() {
+		size_t end = used;
+		if (!binary) {
+			for (size_t i = used; i > 0; i--) {
+				if (chunk->data[i - 1] == '\n') { end = i; break; }
 			}
 		}
+		PipelineChunk* next = waitPop();
+		size_t carried = used - end;
+		memcpy(next->data.get(), &chunk->data[end], carried);
+		push(end);
+		chunk = next;
+		used  = carried;
 	}
-	// If (objFile)
-	else {
+	void finish() {
+		push(used);
+		fullChunks->push(nullptr);
+	}
+
+	PipelineChunk* waitPop() {
+		StageTimer timer{ &waitSeconds };
+		return freeChunks->pop();
+	}
+	void push(size_t size) {
+		fileOffset    += size;
+		chunk->size    = size;
+		chunk->fileEnd = fileOffset;
+		StageTimer timer{ &waitSeconds };
+		fullChunks->push(chunk);
+	}
+
+};
+static void pipelineRead(mload::ModelSource* source, PipelineWriter* writer, bool* corrupt, float* busySeconds) {
 
-		vec3* const vertexPositions           = (vec3*)malloc(sizeof(vec3) * vertexElementsCapacity); assert(vertexPositions != nullptr); 
-		vec3*       vertexPositionsNewElement = vertexPositions; 
-		vec3* const vertexNormals             = normalsCapacity > 0 ? (vec3*)malloc(sizeof(vec3) * normalsCapacity) : nullptr; 
-		vec3*       vertexNormalsNewElement   = vertexNormals; 
+	float seconds = 0.0f;
+	{
+		StageTimer timer{ &seconds };
+		writer->chunk = writer->waitPop();
+		*corrupt = !source->decode(PipelineWriter::write, writer);
+		writer->finish();
+		*corrupt |= writer->fileOffset + writer->ignored != source->size();
+	}
+	*busySeconds = seconds - writer->waitSeconds;
 
-		for (const char* c = &fData[0], *end = &fData[fileSize]; c < end;) {
-			if (*c != 'v') { skipLine(c, end); continue; }
+}
+/// @param parts gets the solids of ASCII STLs, read it after the thread joined
+static void pipelineParse(bool binary, mload::SpscQueue<PipelineChunk*>& fullChunks, mload::SpscQueue<PipelineChunk*>& freeChunks, mload::SpscQueue<PipelineBatch*>& freeBatches, mload::SpscQueue<PipelineBatch*>& fullBatches, PartRecorder* parts, float* busySeconds) {
 
-			c++;
-			if (*c == ' ') { 
-				c++; 
-				skipWhitespace(c); 
-				objGetVec3FromText(c, end, (float*)vertexPositionsNewElement);
-				vertexPositionsNewElement++; 
+	const mload::LoadSettings noProgress;
+	StlTextState textState;
+	textState.parts = parts;
+	mload::StlFacetBlock block;
+	for (PipelineChunk* chunk; (chunk = fullChunks.pop()) != nullptr;) {
+
+		PipelineBatch* batch = freeBatches.pop();
+		{
+			StageTimer timer{ busySeconds };
+			batch->corners.clear();
+			batch->hashes.clear();
+			batch->fileEnd = chunk->fileEnd;
+			if (binary) {
+				size_t facetCount = chunk->size / mload::c_StlFacetSize;
+				for (size_t first = 0; first < facetCount; first += mload::c_StlDecodeBlock) {
+					size_t count = std::min(mload::c_StlDecodeBlock, facetCount - first);
+					mload::decodeStlFacets(&chunk->data[first * mload::c_StlFacetSize], count, &block);
+					for (size_t facet = 0; facet < count; facet++) {
+						for (size_t vertex = 0; vertex < 3; vertex++) {
+							batch->corners.push_back(block.vertex(vertex, facet));
+							batch->hashes.push_back(block.hash[vertex][facet]);
+						}
+					}
+				}
 			}
-			else if (*c == 'n') {
-				c += 2; 
-				skipWhitespace(c); 
-				objGetVec3FromText(c, end, (float*)vertexNormalsNewElement);
-  				vertexNormalsNewElement++; 
+			else {
+				CornerSink sink(&batch->corners);
+				TriangleBatcher batcher(&sink);
+				ProgressReporter progress{ &noProgress, chunk->data.get(), chunk->size };
+				streamStlText(chunk->data.get(), chunk->size, textState, batcher, progress);
+				batcher.flush();
+				for (const mload::Vertex& corner : batch->corners) batch->hashes.push_back(mload::hashVertex(corner));
 			}
-
 		}
-		if (normalsCapacity > 0) {
+		freeChunks.push(chunk);
+		fullBatches.push(batch);
 
-			Map<ObjVertexIndex, uint32_t> uniqueVertices((size_t)(1.5 * indexElementsCapacity), predictedUniqueVertexCount);
+	}
+	parts->finish(textState.triangleCount);
+	fullBatches.push(nullptr);
 
-			for (const char* c = &fData[0], *end = &fData[fileSize]; c < end;) {
-				if (*c != 'f') { skipLine(c, end); continue; }
+}
 
-				c += 2;
-				skipWhitespace(c);
-				uint32_t vertexCountInFacet = 0;
-				for (; c < end && charIsDigit(*c); c++) {
-					mload::ObjVertexIndex vertexIndex;
-					objGetIndexFromText(c, end, &vertexIndex);
-					bool keyExists;
-					uint32_t* pIndex = uniqueVertices.getKeyValue(vertexIndex, &keyExists);
-					if (!keyExists) {
-						*pIndex = (uint32_t)vertexBuff->size();
-						// index - 1 to convert to 0 based indexing (.obj format doesn't use 0 based indexing)
-						vertexBuff->emplace_back(vertexPositions[vertexIndex.posIndex - 1], vertexNormals[vertexIndex.normalIndex - 1]);
-					}
-					vertexCountInFacet++;
-					if (vertexCountInFacet > 3) {
-						indexBuff->push_back((*indexBuff)[indexBuff->size() - 3 * (vertexCountInFacet - 3)]);
-						indexBuff->push_back((*indexBuff)[indexBuff->size() - 2]);
-					}
-					indexBuff->push_back(*pIndex);
+mload::Success mload::openModelPipelined(const char* fileName, std::vector<Vertex>* vertexBuff, std::vector<uint32_t>* indexBuff, bool* isTextFormat, const LoadSettings* settings, ModelInfo* info, PipelineStats* stats) {
 
-				}
-			}
+	const auto loadStart = std::chrono::steady_clock::now();
+	const LoadSettings defaultSettings;
+	if (settings == nullptr) settings = &defaultSettings;
+	PipelineStats localStats;
+	if (stats == nullptr) stats = &localStats;
+	*stats = {};
+
+	if (is3mfFile(fileName)) return openModel(fileName, vertexBuff, indexBuff, isTextFormat, settings, info);
+
+	ModelSource source;
+	Success result = source.open(fileName);
+	if (result != Success::SUCCESS) return result;
+	if (!source.hasExtension(".stl")) return openModel(fileName, vertexBuff, indexBuff, isTextFormat, settings, info);
+
+	size_t fileSize = (size_t)source.size();
+	char header[c_StlHeaderSize + c_StlFacetSize]; // the first facet tells if the attributes are colors
+	size_t headerSize = source.peek(header, sizeof(header));
+	bool binary = stlIsBinary(header, headerSize, fileSize);
 
+	size_t predictedTriangleCount;
+	if (binary) {
+		if (headerSize < c_StlHeaderSize) return Success::NO_DATA_FROM_FILE;
+		uint32_t facetCount, defaultColor;
+		if (!stlFacetCount(header, fileSize, &facetCount)) return Success::TRUNCATED_FILE;
+		// The pipeline has no color stream
+		bool parallel = facetCount >= c_ParallelStlMinFacets && WorkerPool::shared().threadCount() > 1;
+		if (parallel || stlColorFormat(header, headerSize, &defaultColor) != STL_COLOR_NONE) {
+			return openModel(fileName, vertexBuff, indexBuff, isTextFormat, settings, info);
 		}
-		else {
+		predictedTriangleCount = facetCount;
+	}
+	else {
+		predictedTriangleCount = fileSize / 258 + 1;
+	}
+	if (predictedTriangleCount == 0) return Success::NO_DATA_FROM_FILE;
+	*isTextFormat    = !binary;
+	stats->pipelined = true;
 
-			Map<Vertex, uint32_t> uniqueVertices((size_t)(1.5 * indexElementsCapacity), predictedUniqueVertexCount);
+	ProgressReporter progress{ settings, nullptr, fileSize };
+	progress.report(0.0f);
+	progress.setRange(0.0f, 0.9f);
 
-			for (const char* c = &fData[0], *end = &fData[fileSize]; c < end;) {
-				if (*c != 'f') { skipLine(c, end); continue; }
+	constexpr size_t chunkCount = c_PipelineDepth + 2; // the reader holds two while it carries a line over
+	PipelineChunk chunks[chunkCount];
+	PipelineBatch batches[c_PipelineDepth];
+	// One more slot in the full queues for the nullptr that ends the stream
+	SpscQueue<PipelineChunk*> freeChunks(chunkCount),      fullChunks(chunkCount + 1);
+	SpscQueue<PipelineBatch*> freeBatches(c_PipelineDepth), fullBatches(c_PipelineDepth + 1);
+	for (PipelineChunk& chunk : chunks) {
+		chunk.data.reset(new char[c_PipelineChunkSize]);
+		freeChunks.push(&chunk);
+	}
+	for (PipelineBatch& batch : batches) freeBatches.push(&batch);
 
-				c += 2;
-				uint32_t facetIndices[3]; 
-				for (int facetIndex = 0; facetIndex < 3; facetIndex++) {
-					skipWhitespace(c);
-					facetIndices[facetIndex] = getVertexIndexFromVertexReference(c); 
-				}
-				const glm::vec3& p1 = *(glm::vec3*)&vertexPositions[facetIndices[0] - 1];
-				const glm::vec3& p2 = *(glm::vec3*)&vertexPositions[facetIndices[1] - 1];
-				const glm::vec3& p3 = *(glm::vec3*)&vertexPositions[facetIndices[2] - 1];
-				Vertex v; 
-				v.pos    = *(vec3*)&p1;
-				v.normal = *(vec3*)&glm::normalize(glm::cross(p2 - p1, p3 - p1)); 
-				addVertex(v, uniqueVertices, *vertexBuff, *indexBuff); 
-
-				v.pos = *(vec3*)&p2;
-				addVertex(v, uniqueVertices, *vertexBuff, *indexBuff);
-
-				v.pos = *(vec3*)&p3;
-				addVertex(v, uniqueVertices, *vertexBuff, *indexBuff);
-				
-				// if there are more than 3 vertex references in a facet
-				for (int fanCenterIndexOffset = 3; *c == ' ' && charIsDigit(c[1]); fanCenterIndexOffset += 3) {
-					c++;
-					uint32_t vertexIndex = getVertexIndexFromVertexReference(c); 
-
-					v.pos = vertexPositions[vertexIndex - 1];
-					bool keyExists; 
-					uint32_t* pIndex = uniqueVertices.getKeyValue(v, &keyExists);
-					if (!keyExists) {
-						*pIndex = (uint32_t)vertexBuff->size();
-						vertexBuff->push_back(v);
-					}
-					indexBuff->push_back((*indexBuff)[indexBuff->size() - fanCenterIndexOffset]);
-					indexBuff->push_back((*indexBuff)[indexBuff->size() - 2]);
-					indexBuff->push_back(*pIndex);
-				
-				}
+	PipelineWriter writer{};
+	writer.binary        = binary;
+	writer.chunkCapacity = binary ? c_PipelineChunkSize / c_StlFacetSize * c_StlFacetSize : c_PipelineChunkSize;
+	writer.skip          = binary ? c_StlHeaderSize : 0;
+	writer.fileOffset    = writer.skip;
+	writer.remaining     = binary ? (uint64_t)c_StlFacetSize * predictedTriangleCount : UINT64_MAX;
+	writer.freeChunks    = &freeChunks;
+	writer.fullChunks    = &fullChunks;
+	bool corrupt;
 
-			}
+	std::thread reader(pipelineRead, &source, &writer, &corrupt, &stats->stageSeconds[PIPELINE_STAGE_READ]);
+	PartRecorder parts;
+	std::thread parser(pipelineParse, binary, std::ref(fullChunks), std::ref(freeChunks), std::ref(freeBatches), std::ref(fullBatches), &parts, &stats->stageSeconds[PIPELINE_STAGE_PARSE]);
+
+	MeshBuilder builder(vertexBuff, indexBuff, predictedTriangleCount);
+	for (PipelineBatch* batch; (batch = fullBatches.pop()) != nullptr;) {
 
+		{
+			StageTimer timer{ &stats->stageSeconds[PIPELINE_STAGE_DEDUP] };
+			size_t triangleCount = batch->corners.size() / 3;
+			for (size_t first = 0; first < triangleCount; first += c_TriangleBatchSize) {
+				size_t count = std::min(c_TriangleBatchSize, triangleCount - first);
+				builder.trianglesHashed(&batch->corners[3 * first], &batch->hashes[3 * first], count);
+			}
+			progress.updateOffset(batch->fileEnd);
 		}
+		freeBatches.push(batch);
 
-		free(vertexPositions); 
-		if (vertexNormals != nullptr) free(vertexNormals); 
+	}
+	reader.join();
+	parser.join();
 
+	if (corrupt)            return Success::CORRUPT_FILE;
+	if (indexBuff->empty()) return Success::NO_DATA_FROM_FILE;
+
+	{
+		StageTimer timer{ &stats->stageSeconds[PIPELINE_STAGE_FINISH] };
+		finishModel(*settings, progress, vertexBuff, indexBuff, info, nullptr, &parts.parts);
 	}
+	stats->seconds = std::chrono::duration<float>(std::chrono::steady_clock::now() - loadStart).count();
 
 	return Success::SUCCESS;
-}
\ No newline at end of file
+
+}
@@ -1,23 +1,134 @@
 #pragma once
 
 #include "VertexMap.hpp"
+#include "NormalGen.hpp"
+#include "TriangleSink.hpp"
+
+#include <string>
 
 namespace mload {
 
 	enum Success {
 
 		SUCCESS = 0, 
-		WRONG_FILE_FORMAT, // Must be obj or stl. 
+		WRONG_FILE_FORMAT, // Must be obj, stl, ply, glb, gltf or 3mf, all but 3mf optionally gzipped (.gz) or in a .zip archive. 
 		COULD_NOT_OPEN_FILE, // fopen from cstdio returned nullptr (failed) 
 		NO_DATA_FROM_FILE,
+		TRUNCATED_FILE,      // binary STL or PLY shorter than the element counts in its header, 3MF with an unclosed mesh
+		CORRUPT_FILE,        // .gz, .zip or .3mf data that doesn't inflate to the size it claims
+
+	};
+
+	struct LoadSettings {
+
+		NormalMode normalMode  = NORMAL_MODE_FILE;
+		float      creaseAngle = 30.0f; // degrees, used by NORMAL_MODE_SMOOTH
+
+		/// Called on the loading thread with the fraction (0 to 1) of the load completed so far. 
+		void     (*progressCallback)(void* userData, float progress) = nullptr;
+		void*      progressUserData = nullptr;
+
+	};
+
+	/// A range of the index buffer that came from one piece of the file, e.g. an .obj group or a glTF primitive. 
+	struct ModelPart {
+
+		uint32_t    firstIndex;
+		uint32_t    indexCount;
+		std::string name;      // empty for the triangles before the first group of an .obj file
+		vec3        boundsMin; // of the vertices the part references, filled when the load finishes
+		vec3        boundsMax;
 
 	};
 
+	/// A part drawn with a transform, e.g. a 3MF build item. 
+	struct ModelInstance {
+
+		uint32_t part;          // index into ModelInfo::parts
+		float    transform[16]; // column major 4x4 matrix from part to model space
+
+	};
+
+	/// Extra information about the loaded model. 
+	struct ModelInfo {
+
+		bool     normalsGenerated; 
+		uint32_t fileVertexCount;  // unique vertex count before the normals were generated
+		vec3     center;           // average vertex position
+		float    radius;           // distance of the farthest vertex from the origin
+		std::vector<uint32_t> colors; // RGBA8 (red in the low byte) per vertex for PLY files with vertex colors and binary STLs with facet colors, empty otherwise
+		std::vector<ModelPart> parts; // .obj "o"/"g" groups, ASCII STL solids, glTF primitives and 3MF objects, empty if the file has none
+		std::vector<ModelInstance> instances; // 3MF build items, empty if the index buffer is drawn once without a transform
+
+	};
+
+	enum ModelFormat {
+
+		MODEL_FORMAT_STL_BINARY = 0,
+		MODEL_FORMAT_STL_TEXT,
+		MODEL_FORMAT_OBJ,
+		MODEL_FORMAT_PLY,
+		MODEL_FORMAT_GLTF,    // .glb or .gltf
+		MODEL_FORMAT_3MF,
+
+	};
+
+	/// File metadata found by mload::probeModel without building the mesh. 
+	struct ModelProbe {
+
+		ModelFormat format;
+		uint64_t    fileSize;             // bytes of the model, uncompressed for .gz and .zip files
+		uint32_t    triangleCount;        // exact for binary STL, PLY face count, stored 3MF triangles, counted facets or triangulated faces for text files
+		uint32_t    estimatedVertexCount; // unique vertices openModel is expected to return, for presizing
+		bool        hasBounds;
+		vec3        boundsMin;
+		vec3        boundsMax;
+
+	};
+
+	/// Reads only the header of binary STLs and PLY files and the JSON of glTF files, and runs a count-only scan over text files and 3MF models. 
+	/// @param  computeBounds parses every vertex to fill ModelProbe::boundsMin/boundsMax, about as slow as streamModel
+	/// @return view mload::success enum for possible return values; 
+	Success probeModel(const char* fileName, ModelProbe* probe, bool computeBounds = false);
+
 	/// @param  fileName filePath to open
 	/// @param  vertexBuff
 	/// @param  indexBuff
 	/// @param  isAscii determines if the type of the file is encoded in text format
+	/// @param  settings optional, defaults are used if nullptr
+	/// @param  info optional
+	/// @return view mload::success enum for possible return values; 
+	Success openModel(const char* fileName, std::vector<Vertex>* vertexBuff, std::vector<uint32_t>* indexBuff, bool* isTextFormat, const LoadSettings* settings = nullptr, ModelInfo* info = nullptr);
+
+	/// Parses a model and hands its triangles to sink in batches instead of building an indexed mesh. 
+	/// LoadSettings::normalMode is ignored, the sink gets the normals from the file. 
+	/// @param  sink receives every triangle in file order, see mload::MeshBuilder for the sink openModel uses
 	/// @return view mload::success enum for possible return values; 
-	Success openModel(const char* fileName, std::vector<Vertex>* vertexBuff, std::vector<uint32_t>* indexBuff, bool* isTextFormat);
+	Success streamModel(const char* fileName, TriangleSink* sink, bool* isTextFormat, const LoadSettings* settings = nullptr);
+
+	enum PipelineStage {
+
+		PIPELINE_STAGE_READ = 0,
+		PIPELINE_STAGE_PARSE,
+		PIPELINE_STAGE_DEDUP,
+		PIPELINE_STAGE_FINISH,   // normal generation and ModelInfo, after the other stages drained
+		PIPELINE_STAGE_COUNT,
+
+	};
+
+	/// Where the time of mload::openModelPipelined went. 
+	struct PipelineStats {
+
+		bool  pipelined;                          // false if the file took the openModel path
+		float seconds;                            // wall time
+		float stageSeconds[PIPELINE_STAGE_COUNT]; // busy time of every stage, without the waits on its neighbours
+
+	};
+
+	/// Same result as openModel, but STLs are read, parsed and deduped on three threads connected by bounded queues of chunks, 
+	/// so the load takes about as long as the slowest stage instead of the sum of them. 
+	/// .obj, .ply and glTF files need every vertex before the first face and binary STLs large enough for the parallel dedup take the openModel path. 
+	/// @param  stats optional
+	Success openModelPipelined(const char* fileName, std::vector<Vertex>* vertexBuff, std::vector<uint32_t>* indexBuff, bool* isTextFormat, const LoadSettings* settings = nullptr, ModelInfo* info = nullptr, PipelineStats* stats = nullptr);
 
 }
\ No newline at end of file
@@ -0,0 +1,234 @@
+#include "ModelLoader.hpp"
+#include "StlDecode.hpp"
+#include "ModelSource.hpp"
+#include "PlyLoader.hpp"
+#include "GltfLoader.hpp"
+#include "ThreeMfLoader.hpp"
+
+#include <memory>
+#include <algorithm>
+#include <cmath>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define MODEL_PROBE_SSE2
+#include <emmintrin.h>
+#endif
+
+/// Text files are scanned in chunks of this size, so probing doesn't allocate the whole file. 
+constexpr size_t c_ProbeChunkSize = 1 << 20;
+/// Bytes peeked for a PLY header, far more than exporters write. 
+constexpr size_t c_PlyProbeHeaderSize = 1 << 16;
+
+inline uint32_t popCount(uint32_t v) {
+	v = v - ((v >> 1) & 0x55555555u);
+	v = (v & 0x33333333u) + ((v >> 2) & 0x33333333u);
+	return (((v + (v >> 4)) & 0x0F0F0F0Fu) * 0x01010101u) >> 24;
+}
+
+/// Counts the occurrences of a 4 character pattern in [c, end). 
+static size_t countPattern(const char* c, const char* end, const char pattern[4]) {
+
+	size_t count = 0;
+#ifdef MODEL_PROBE_SSE2
+	const __m128i p0 = _mm_set1_epi8(pattern[0]), p1 = _mm_set1_epi8(pattern[1]);
+	const __m128i p2 = _mm_set1_epi8(pattern[2]), p3 = _mm_set1_epi8(pattern[3]);
+	for (; end - c >= 16 + 3; c += 16) {
+		__m128i match =                   _mm_cmpeq_epi8(_mm_loadu_si128((const __m128i*)c),       p0);
+		match = _mm_and_si128(match, _mm_cmpeq_epi8(_mm_loadu_si128((const __m128i*)(c + 1)), p1));
+		match = _mm_and_si128(match, _mm_cmpeq_epi8(_mm_loadu_si128((const __m128i*)(c + 2)), p2));
+		match = _mm_and_si128(match, _mm_cmpeq_epi8(_mm_loadu_si128((const __m128i*)(c + 3)), p3));
+		count += popCount((uint32_t)_mm_movemask_epi8(match));
+	}
+#endif
+	for (; end - c >= 4; c++) count += memcmp(c, pattern, 4) == 0;
+	return count;
+
+}
+/// Counts the vertex references of an .obj face line, a space followed by a digit, in [c, end). 
+static uint32_t countFaceReferences(const char* c, const char* end) {
+
+	uint32_t count = 0;
+#ifdef MODEL_PROBE_SSE2
+	const __m128i space = _mm_set1_epi8(' '), belowDigits = _mm_set1_epi8('0' - 1), aboveDigits = _mm_set1_epi8('9' + 1);
+	for (; end - c >= 16 + 1; c += 16) {
+		__m128i next    = _mm_loadu_si128((const __m128i*)(c + 1));
+		__m128i isDigit = _mm_and_si128(_mm_cmpgt_epi8(next, belowDigits), _mm_cmplt_epi8(next, aboveDigits));
+		__m128i match   = _mm_and_si128(_mm_cmpeq_epi8(_mm_loadu_si128((const __m128i*)c), space), isDigit);
+		count += popCount((uint32_t)_mm_movemask_epi8(match));
+	}
+#endif
+	for (; end - c >= 2; c++) count += c[0] == ' ' && c[1] >= '0' && c[1] <= '9';
+	return count;
+
+}
+
+/// Calls scan(begin, end) for every chunk of the model. Chunks end after a line break unless a single line fills the chunk. 
+/// @return false if the model is corrupt
+template<class ScanFunc>
+static bool scanLines(mload::ModelSource& source, ScanFunc& scan) {
+
+	struct Lines {
+		std::unique_ptr<char[]> chunk;
+		size_t                  used;
+		ScanFunc&               scan;
+	} lines{ std::unique_ptr<char[]>(new char[c_ProbeChunkSize]), 0, scan };
+
+	bool decoded = source.decode([](void* userData, const char* data, size_t size) {
+		Lines* lines = (Lines*)userData;
+		char*  chunk = lines->chunk.get();
+		while (size > 0) {
+			size_t count = std::min(size, c_ProbeChunkSize - lines->used);
+			memcpy(&chunk[lines->used], data, count);
+			lines->used += count;
+			data += count;
+			size -= count;
+			if (lines->used < c_ProbeChunkSize) break;
+
+			size_t lineEnd = lines->used;
+			for (size_t i = lines->used; i > 0; i--) {
+				if (chunk[i - 1] == '\n') { lineEnd = i; break; }
+			}
+			lines->scan((const char*)chunk, (const char*)&chunk[lineEnd]);
+			lines->used -= lineEnd;
+			memmove(chunk, &chunk[lineEnd], lines->used);
+		}
+		return true;
+	}, &lines);
+	lines.scan((const char*)lines.chunk.get(), (const char*)&lines.chunk[lines.used]);
+	return decoded;
+
+}
+
+/// Grows the bounds around every triangle it gets. 
+class BoundsSink : public mload::TriangleSink {
+public:
+
+	mload::vec3 min = {  INFINITY,  INFINITY,  INFINITY };
+	mload::vec3 max = { -INFINITY, -INFINITY, -INFINITY };
+
+	void triangles(const mload::Vertex* corners, size_t triangleCount) override {
+		for (size_t i = 0; i < 3 * triangleCount; i++) {
+			const mload::vec3& p = corners[i].pos;
+			min = { std::min(min.x, p.x), std::min(min.y, p.y), std::min(min.z, p.z) };
+			max = { std::max(max.x, p.x), std::max(max.y, p.y), std::max(max.z, p.z) };
+		}
+	}
+
+};
+
+/// Rejects empty models and streams the model for its bounds if asked to. 
+static mload::Success finishProbe(const char* fileName, mload::ModelProbe* probe, bool computeBounds) {
+
+	if (probe->triangleCount == 0) return mload::Success::NO_DATA_FROM_FILE;
+
+	if (computeBounds) {
+		BoundsSink bounds;
+		bool isTextFormat;
+		mload::Success result = mload::streamModel(fileName, &bounds, &isTextFormat);
+		if (result != mload::Success::SUCCESS) return result;
+		probe->hasBounds = true;
+		probe->boundsMin = bounds.min;
+		probe->boundsMax = bounds.max;
+	}
+
+	return mload::Success::SUCCESS;
+
+}
+
+mload::Success mload::probeModel(const char* fileName, ModelProbe* probe, bool computeBounds) {
+
+	size_t fileNameLen = strlen(fileName);
+	if (fileNameLen >= 4 && strcmp(&fileName[fileNameLen - 4], ".3mf") == 0) {
+		// The model part is inflated and scanned in chunks, the package has no header with counts
+		probe->format    = MODEL_FORMAT_3MF;
+		probe->hasBounds = false;
+		Success result = probe3mf(fileName, &probe->fileSize, &probe->triangleCount, &probe->estimatedVertexCount);
+		if (result != Success::SUCCESS) return result;
+		return finishProbe(fileName, probe, computeBounds);
+	}
+
+	ModelSource source;
+	Success result = source.open(fileName);
+	if (result != Success::SUCCESS) return result;
+
+	bool objFile = source.hasExtension(".obj");
+	bool plyFile = source.hasExtension(".ply");
+	bool glbFile = source.hasExtension(".glb");
+	bool gltfFile = glbFile || source.hasExtension(".gltf");
+	probe->fileSize  = source.size();
+	probe->hasBounds = false;
+
+	char header[c_StlHeaderSize];
+	size_t headerSize = objFile || plyFile || gltfFile ? 0 : source.peek(header, sizeof(header));
+
+	bool decoded = true;
+	if (objFile) {
+		probe->format = MODEL_FORMAT_OBJ;
+		uint32_t positionCount = 0, normalCount = 0, indexCount = 0;
+		auto scan = [&](const char* c, const char* end) {
+			for (; c < end;) {
+				const char* lineEnd = (const char*)memchr(c, '\n', end - c);
+				lineEnd = lineEnd == nullptr ? end : lineEnd + 1;
+				if (c[0] == 'v' && end - c > 1) {
+					if      (c[1] == ' ') positionCount++;
+					else if (c[1] == 'n') normalCount++;
+				}
+				else if (c[0] == 'f') {
+					// Same triangulation as openModel, a fan of references - 2 triangles
+					uint32_t references = countFaceReferences(c, lineEnd);
+					if (references >= 3) indexCount += 3 * (references - 2);
+				}
+				c = lineEnd;
+			}
+		};
+		decoded = scanLines(source, scan);
+		probe->triangleCount = indexCount / 3;
+		// Faces that reference normals share vertices per position/normal pair, the rest get one normal per face. 
+		probe->estimatedVertexCount = normalCount > 0 ? std::min(indexCount, std::max(positionCount, normalCount)) : (uint32_t)(c_PredictedUniqueVertexRatio * indexCount);
+	}
+	else if (plyFile) {
+		probe->format = MODEL_FORMAT_PLY;
+		std::unique_ptr<char[]> plyHeaderData(new char[c_PlyProbeHeaderSize]);
+		size_t plyHeaderSize = source.peek(plyHeaderData.get(), c_PlyProbeHeaderSize);
+		PlyHeader plyHeader;
+		if (!parsePlyHeader(plyHeaderData.get(), plyHeaderSize, &plyHeader)) return plyHeaderSize < c_PlyProbeHeaderSize ? Success::TRUNCATED_FILE : Success::WRONG_FILE_FORMAT;
+		const PlyElement* vertices = plyHeader.element("vertex");
+		const PlyElement* faces    = plyHeader.element("face");
+		probe->triangleCount        = faces    != nullptr ? (uint32_t)faces->count    : 0;
+		probe->estimatedVertexCount = vertices != nullptr ? (uint32_t)vertices->count : 0;
+	}
+	else if (gltfFile) {
+		probe->format = MODEL_FORMAT_GLTF;
+		// Only the JSON is needed, the binary chunk of .glb files behind it isn't read
+		size_t jsonEnd = (size_t)probe->fileSize;
+		if (glbFile) {
+			char glbHeader[c_GlbHeaderSize];
+			if (source.peek(glbHeader, sizeof(glbHeader)) < sizeof(glbHeader)) return Success::TRUNCATED_FILE;
+			uint32_t jsonSize;
+			memcpy(&jsonSize, &glbHeader[12], sizeof(jsonSize));
+			jsonEnd = std::min(jsonEnd, c_GlbHeaderSize + (size_t)jsonSize);
+		}
+		std::unique_ptr<char[]> json(new char[jsonEnd]);
+		if (source.peek(json.get(), jsonEnd) < jsonEnd) return Success::CORRUPT_FILE;
+		Success result = probeGltf(json.get(), jsonEnd, &probe->triangleCount, &probe->estimatedVertexCount);
+		if (result != Success::SUCCESS) return result;
+	}
+	else if (stlIsBinary(header, headerSize, probe->fileSize)) {
+		probe->format = MODEL_FORMAT_STL_BINARY;
+		if (headerSize < c_StlHeaderSize) return Success::NO_DATA_FROM_FILE;
+		if (!stlFacetCount(header, probe->fileSize, &probe->triangleCount)) return Success::TRUNCATED_FILE;
+		probe->estimatedVertexCount = (uint32_t)(c_PredictedUniqueVertexRatio * 3 * probe->triangleCount);
+	}
+	else {
+		probe->format = MODEL_FORMAT_STL_TEXT;
+		size_t facetCount = 0;
+		auto scan = [&](const char* c, const char* end) { facetCount += countPattern(c, end, "endf"); };
+		decoded = scanLines(source, scan);
+		probe->triangleCount        = (uint32_t)facetCount;
+		probe->estimatedVertexCount = (uint32_t)(c_PredictedUniqueVertexRatio * 3 * facetCount);
+	}
+	if (!decoded) return Success::CORRUPT_FILE;
+
+	return finishProbe(fileName, probe, computeBounds);
+
+}
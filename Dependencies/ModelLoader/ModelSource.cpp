@@ -0,0 +1,236 @@
+#include "ModelSource.hpp"
+
+#include <zip.h>
+
+#include <cstring>
+#include <algorithm>
+
+// Implemented by the miniz copy that Dependencies/zip/zip.c compiles. miniz.h carries its implementation, so only zip.c may include it. 
+extern "C" int tinfl_decompress_mem_to_callback(const void* pIn_buf, size_t* pIn_buf_size, int (*pPut_buf_func)(const void* pBuf, int len, void* pUser), void* pPut_buf_user, int flags);
+
+/// Bytes read from an uncompressed file at once by ModelSource::decode. 
+constexpr size_t c_SourceReadSize = 1 << 20;
+
+// gzip member header, RFC 1952
+constexpr size_t  c_GzipHeaderSize  = 10;
+constexpr size_t  c_GzipTrailerSize = 8; // CRC32 and the uncompressed size mod 2^32
+constexpr uint8_t c_GzipFlagHeaderCrc = 1 << 1;
+constexpr uint8_t c_GzipFlagExtra     = 1 << 2;
+constexpr uint8_t c_GzipFlagName      = 1 << 3;
+constexpr uint8_t c_GzipFlagComment   = 1 << 4;
+
+/// Deflate can't compress better than about 1032:1, a gzip trailer claiming more is corrupt. 
+constexpr uint64_t c_MaxDeflateRatio = 1032;
+
+// long is 32 bits on Windows, models can be larger than 2 GB
+static int64_t tellFile(FILE* file) {
+#ifdef _WIN32
+	return _ftelli64(file);
+#else
+	return ftello(file);
+#endif
+}
+static int seekFile(FILE* file, int64_t offset, int origin) {
+#ifdef _WIN32
+	return _fseeki64(file, offset, origin);
+#else
+	return fseeko(file, offset, origin);
+#endif
+}
+
+static bool endsWith(const char* str, size_t strLen, const char* suffix) {
+	size_t suffixLen = strlen(suffix);
+	return strLen >= suffixLen && strcmp(&str[strLen - suffixLen], suffix) == 0;
+}
+static bool isModelName(const char* name) {
+	size_t nameLen = strlen(name);
+	return endsWith(name, nameLen, ".stl") || endsWith(name, nameLen, ".obj") || endsWith(name, nameLen, ".ply") ||
+	       endsWith(name, nameLen, ".glb") || endsWith(name, nameLen, ".gltf");
+}
+static void copyName(std::unique_ptr<char[]>* dst, const char* name, size_t nameLen) {
+	dst->reset(new char[nameLen + 1]);
+	memcpy(dst->get(), name, nameLen);
+	(*dst)[nameLen] = '\0';
+}
+
+mload::ModelSource::~ModelSource() {
+
+	if (m_file != nullptr) fclose(m_file);
+	if (m_zip  != nullptr) {
+		// The model's entry stays open for every decode, zip_close doesn't free its name
+		if (m_container == CONTAINER_ZIP) zip_entry_close(m_zip);
+		zip_close(m_zip);
+	}
+
+}
+
+mload::Success mload::ModelSource::open(const char* fileName) {
+
+	size_t fileNameLen = strlen(fileName);
+	if (endsWith(fileName, fileNameLen, ".zip")) {
+
+		m_zip = zip_open(fileName, 0, 'r');
+		if (m_zip == nullptr) return Success::COULD_NOT_OPEN_FILE;
+
+		// The first model in the archive, in directory order
+		ssize_t entryCount = zip_entries_total(m_zip);
+		for (ssize_t i = 0; i < entryCount; i++) {
+			if (zip_entry_openbyindex(m_zip, (size_t)i) != 0) continue;
+			const char* entryName = zip_entry_name(m_zip);
+			if (!zip_entry_isdir(m_zip) && isModelName(entryName)) {
+				copyName(&m_modelName, entryName, strlen(entryName));
+				m_size      = zip_entry_size(m_zip);
+				m_container = CONTAINER_ZIP;
+				return Success::SUCCESS;
+			}
+			zip_entry_close(m_zip);
+		}
+		return Success::WRONG_FILE_FORMAT;
+
+	}
+
+	bool gzip = endsWith(fileName, fileNameLen, ".gz");
+	size_t modelNameLen = gzip ? fileNameLen - 3 : fileNameLen;
+	copyName(&m_modelName, fileName, modelNameLen);
+	if (!isModelName(m_modelName.get())) return Success::WRONG_FILE_FORMAT;
+
+	m_file = fopen(fileName, "rb");
+	if (m_file == nullptr) return Success::COULD_NOT_OPEN_FILE; 
+
+	seekFile(m_file, 0, SEEK_END); 
+	uint64_t fileSize = (uint64_t)tellFile(m_file);
+	seekFile(m_file, 0, SEEK_SET);
+	if (!gzip) {
+		m_size = fileSize;
+		return Success::SUCCESS;
+	}
+
+	// Only the header and the trailer are read here, the deflate stream is read by the first decode
+	uint8_t header[c_GzipHeaderSize];
+	if (fread(header, 1, c_GzipHeaderSize, m_file) != c_GzipHeaderSize || header[0] != 0x1F || header[1] != 0x8B || header[2] != 8) return Success::WRONG_FILE_FORMAT;
+
+	uint8_t flags = header[3];
+	if (flags & c_GzipFlagExtra) {
+		uint8_t extraSize[2]{};
+		fread(extraSize, 1, 2, m_file);
+		seekFile(m_file, extraSize[0] | (extraSize[1] << 8), SEEK_CUR);
+	}
+	if (flags & c_GzipFlagName)      { for (int c = fgetc(m_file); c != '\0' && c != EOF; c = fgetc(m_file)) {} }
+	if (flags & c_GzipFlagComment)   { for (int c = fgetc(m_file); c != '\0' && c != EOF; c = fgetc(m_file)) {} }
+	if (flags & c_GzipFlagHeaderCrc) seekFile(m_file, 2, SEEK_CUR);
+
+	uint64_t deflateOffset = (uint64_t)tellFile(m_file);
+	if (deflateOffset + c_GzipTrailerSize > fileSize) return Success::NO_DATA_FROM_FILE;
+
+	uint8_t trailer[c_GzipTrailerSize]{};
+	seekFile(m_file, (int64_t)(fileSize - c_GzipTrailerSize), SEEK_SET);
+	fread(trailer, 1, c_GzipTrailerSize, m_file);
+	seekFile(m_file, (int64_t)deflateOffset, SEEK_SET);
+
+	m_size        = trailer[4] | (trailer[5] << 8) | (trailer[6] << 16) | ((uint32_t)trailer[7] << 24);
+	m_deflateSize = (size_t)(fileSize - c_GzipTrailerSize - deflateOffset);
+	m_container   = CONTAINER_GZIP;
+	// The size is allocated up front, don't trust it beyond what the stream can inflate to
+	if (m_size > c_MaxDeflateRatio * m_deflateSize) return Success::CORRUPT_FILE;
+
+	return Success::SUCCESS;
+
+}
+
+bool mload::ModelSource::hasExtension(const char* extension) const {
+
+	return m_modelName != nullptr && endsWith(m_modelName.get(), strlen(m_modelName.get()), extension);
+
+}
+
+bool mload::ModelSource::decode(WriteFunc write, void* userData) {
+
+	struct Writer {
+		WriteFunc write;
+		void*     userData;
+		bool      stopped;
+	} writer{ write, userData, false };
+
+	switch (m_container) {
+	case CONTAINER_NONE: {
+		std::unique_ptr<char[]> buffer(new char[c_SourceReadSize]);
+		seekFile(m_file, 0, SEEK_SET);
+		for (size_t size; (size = fread(buffer.get(), 1, c_SourceReadSize, m_file)) > 0;) {
+			if (!write(userData, buffer.get(), size)) return false;
+		}
+		return true;
+	}
+	case CONTAINER_GZIP: {
+		// tinfl inflates from memory, the compressed stream is a fraction of the model
+		if (m_deflate == nullptr) {
+			m_deflate.reset(new char[m_deflateSize]);
+			if (fread(m_deflate.get(), 1, m_deflateSize, m_file) != m_deflateSize) return false;
+		}
+		size_t inSize = m_deflateSize;
+		auto putBuf = [](const void* pBuf, int len, void* pUser) -> int {
+			Writer* writer = (Writer*)pUser;
+			writer->stopped = !writer->write(writer->userData, (const char*)pBuf, (size_t)len);
+			return !writer->stopped;
+		};
+		return tinfl_decompress_mem_to_callback(m_deflate.get(), &inSize, putBuf, &writer, 0) && !writer.stopped;
+	}
+	case CONTAINER_ZIP: {
+		auto onExtract = [](void* arg, uint64_t, const void* data, size_t size) -> size_t {
+			Writer* writer = (Writer*)arg;
+			writer->stopped = !writer->write(writer->userData, (const char*)data, size);
+			return writer->stopped ? 0 : size;
+		};
+		return zip_entry_extract(m_zip, onExtract, &writer) == 0 && !writer.stopped;
+	}
+	}
+	return false;
+
+}
+
+size_t mload::ModelSource::peek(char* data, size_t size) {
+
+	if (m_container == CONTAINER_NONE) {
+		seekFile(m_file, 0, SEEK_SET);
+		return fread(data, 1, size, m_file);
+	}
+
+	struct Peek {
+		char*  data;
+		size_t size;
+		size_t read;
+	} peek{ data, size, 0 };
+
+	decode([](void* userData, const char* data, size_t size) {
+		Peek* peek = (Peek*)userData;
+		size_t count = std::min(size, peek->size - peek->read);
+		memcpy(&peek->data[peek->read], data, count);
+		peek->read += count;
+		return peek->read < peek->size;
+	}, &peek);
+	return peek.read;
+
+}
+
+bool mload::ModelSource::readAll(char* data) {
+
+	if (m_container == CONTAINER_NONE) {
+		seekFile(m_file, 0, SEEK_SET);
+		return fread(data, 1, (size_t)m_size, m_file) == m_size;
+	}
+
+	struct Read {
+		char*  data;
+		size_t capacity;
+		size_t read;
+	} read{ data, (size_t)m_size, 0 };
+
+	bool decoded = decode([](void* userData, const char* data, size_t size) {
+		Read* read = (Read*)userData;
+		if (size > read->capacity - read->read) return false;
+		memcpy(&read->data[read->read], data, size);
+		read->read += size;
+		return true;
+	}, &read);
+	return decoded && read.read == read.capacity;
+
+}
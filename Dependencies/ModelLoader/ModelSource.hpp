@@ -0,0 +1,64 @@
+#pragma once
+
+#include "ModelLoader.hpp"
+
+#include <cstdio>
+#include <memory>
+
+struct zip_t;
+
+namespace mload {
+
+	/// The bytes of a model: the file itself, a gzipped model (.stl.gz, .obj.gz, .ply.gz, .glb.gz) or the first model in a .zip archive. 
+	/// Compressed models are inflated straight to the caller, without an intermediate file. 
+	class ModelSource {
+	public:
+
+		/// Called with consecutive pieces of the model. @return false to stop decoding
+		typedef bool (*WriteFunc)(void* userData, const char* data, size_t size);
+
+		ModelSource() = default;
+		~ModelSource();
+		ModelSource(const ModelSource&) = delete; 
+		void operator=(const ModelSource&) = delete;
+
+		/// @return view mload::success enum for possible return values; 
+		Success open(const char* fileName);
+
+		/// Name of the model without the container extension, e.g. "part.stl" for "part.stl.gz". 
+		const char* modelName() const { return m_modelName.get(); }
+		/// @return true if modelName ends with extension, e.g. ".stl"
+		bool        hasExtension(const char* extension) const;
+		/// Uncompressed bytes. 
+		uint64_t    size() const { return m_size; }
+		bool        compressed() const { return m_container != CONTAINER_NONE; }
+
+		/// Hands the model to write from the start, every call. 
+		/// @return false if the data is corrupt or write stopped early
+		bool   decode(WriteFunc write, void* userData);
+		/// Decodes only the first size bytes. @return bytes read
+		size_t peek(char* data, size_t size);
+		/// @return false if the data is corrupt
+		bool   readAll(char* data);
+
+	private:
+
+		enum Container {
+
+			CONTAINER_NONE = 0,
+			CONTAINER_GZIP,
+			CONTAINER_ZIP,
+
+		};
+
+		Container               m_container = CONTAINER_NONE;
+		FILE*                   m_file      = nullptr;
+		zip_t*                  m_zip       = nullptr;
+		std::unique_ptr<char[]> m_deflate;        // raw deflate stream of a .gz file, read by the first decode
+		size_t                  m_deflateSize = 0;
+		uint64_t                m_size        = 0;
+		std::unique_ptr<char[]> m_modelName;
+
+	};
+
+}
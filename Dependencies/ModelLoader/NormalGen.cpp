@@ -0,0 +1,146 @@
+#include "NormalGen.hpp"
+#include "Parallel.hpp"
+
+#include <cmath>
+#include <cassert>
+
+#include <glm/glm.hpp>
+
+// Ranges smaller than this aren't worth starting a thread for. 
+constexpr size_t c_minParallelRange = 1 << 14;
+
+void mload::generateNormals(NormalMode mode, float creaseAngle, std::vector<Vertex>* vertexBuff, std::vector<uint32_t>* indexBuff, std::vector<uint32_t>* colors) {
+
+	assert(mode == NORMAL_MODE_FLAT || mode == NORMAL_MODE_SMOOTH);
+
+	const size_t cornerCount = indexBuff->size();
+	const size_t faceCount   = cornerCount / 3;
+	if (faceCount == 0) return;
+
+	// Weld vertices by position
+	std::vector<glm::vec3> positions;
+	std::vector<uint32_t>  cornerPositions(cornerCount);
+	{
+
+		positions.reserve(vertexBuff->size());
+		std::vector<uint32_t> vertexPositions(vertexBuff->size());
+		Map<vec3, uint32_t> uniquePositions((size_t)(1.5 * vertexBuff->size()) + 1, vertexBuff->size() + 1);
+		for (size_t i = 0; i < vertexBuff->size(); i++) {
+			const vec3& pos = (*vertexBuff)[i].pos;
+			bool keyExists;
+			uint32_t* pIndex = uniquePositions.getKeyValue(pos, &keyExists);
+			if (!keyExists) {
+				*pIndex = (uint32_t)positions.size();
+				positions.emplace_back(pos.x, pos.y, pos.z);
+			}
+			vertexPositions[i] = *pIndex;
+		}
+
+		parallelFor(cornerCount, c_minParallelRange, [&](size_t begin, size_t end) {
+			for (size_t corner = begin; corner < end; corner++) 
+				cornerPositions[corner] = vertexPositions[(*indexBuff)[corner]];
+		});
+
+	}
+
+	// Unit face normals, and the weight each face contributes to its corners (face area * corner angle)
+	std::vector<glm::vec3> faceNormals(faceCount);
+	std::vector<float>     cornerWeights(cornerCount);
+	parallelFor(faceCount, c_minParallelRange, [&](size_t begin, size_t end) {
+		for (size_t face = begin; face < end; face++) {
+
+			const glm::vec3 p[3] = {
+				positions[cornerPositions[3 * face + 0]],
+				positions[cornerPositions[3 * face + 1]],
+				positions[cornerPositions[3 * face + 2]],
+			};
+			glm::vec3 normal     = glm::cross(p[1] - p[0], p[2] - p[0]);
+			float     doubleArea = glm::length(normal);
+			faceNormals[face] = doubleArea > 0.0f ? normal / doubleArea : glm::vec3(0.0f);
+
+			for (int i = 0; i < 3; i++) {
+				glm::vec3 edge1 = p[(i + 1) % 3] - p[i];
+				glm::vec3 edge2 = p[(i + 2) % 3] - p[i];
+				float lengths = glm::length(edge1) * glm::length(edge2);
+				float angle   = lengths > 0.0f ? acosf(glm::clamp(glm::dot(edge1, edge2) / lengths, -1.0f, 1.0f)) : 0.0f;
+				cornerWeights[3 * face + i] = doubleArea * angle;
+			}
+
+		}
+	});
+
+	std::vector<glm::vec3> cornerNormals(cornerCount);
+	if (mode == NORMAL_MODE_FLAT) {
+
+		parallelFor(cornerCount, c_minParallelRange, [&](size_t begin, size_t end) {
+			for (size_t corner = begin; corner < end; corner++) cornerNormals[corner] = faceNormals[corner / 3];
+		});
+
+	}
+	else {
+
+		// Corners that share each position, positionCorners[positionCornerOffsets[i]] to positionCorners[positionCornerOffsets[i + 1]] 
+		std::vector<uint32_t> positionCornerOffsets(positions.size() + 1, 0);
+		std::vector<uint32_t> positionCorners(cornerCount);
+		{
+
+			for (size_t corner = 0; corner < cornerCount; corner++) positionCornerOffsets[cornerPositions[corner] + 1]++;
+			for (size_t i = 1; i < positionCornerOffsets.size(); i++) positionCornerOffsets[i] += positionCornerOffsets[i - 1];
+
+			std::vector<uint32_t> insertPos(positionCornerOffsets.begin(), positionCornerOffsets.end() - 1);
+			for (size_t corner = 0; corner < cornerCount; corner++) positionCorners[insertPos[cornerPositions[corner]]++] = (uint32_t)corner;
+
+		}
+
+		const float cosCreaseAngle = cosf(creaseAngle * 0.01745329252f);
+		parallelFor(cornerCount, c_minParallelRange, [&](size_t begin, size_t end) {
+			for (size_t corner = begin; corner < end; corner++) {
+
+				const glm::vec3& faceNormal = faceNormals[corner / 3];
+				// Degenerate faces take the normal of everything around them 
+				bool degenerate = glm::dot(faceNormal, faceNormal) == 0.0f;
+
+				// Summing in the same order for every corner makes corners in the same smoothing group produce bit identical normals, so they get merged below. 
+				glm::vec3 sum(0.0f);
+				uint32_t position = cornerPositions[corner];
+				for (uint32_t i = positionCornerOffsets[position]; i < positionCornerOffsets[position + 1]; i++) {
+					uint32_t otherCorner = positionCorners[i];
+					const glm::vec3& otherNormal = faceNormals[otherCorner / 3];
+					if (degenerate || glm::dot(faceNormal, otherNormal) >= cosCreaseAngle) sum += cornerWeights[otherCorner] * otherNormal;
+				}
+
+				float length = glm::length(sum);
+				cornerNormals[corner] = length > 0.0f ? sum / length : faceNormal;
+
+			}
+		});
+
+	}
+
+	// Re-index
+	std::vector<Vertex> newVertexBuff;
+	newVertexBuff.reserve(positions.size());
+	std::vector<uint32_t> newColors;
+	if (colors != nullptr) newColors.reserve(positions.size());
+	Map<Vertex, uint32_t> uniqueVertices((size_t)(1.5 * cornerCount), positions.size() + 1);
+	for (size_t corner = 0; corner < cornerCount; corner++) {
+
+		const glm::vec3& pos    = positions[cornerPositions[corner]];
+		const glm::vec3& normal = cornerNormals[corner];
+		Vertex v({ pos.x, pos.y, pos.z }, { normal.x, normal.y, normal.z });
+
+		bool keyExists;
+		uint32_t* pIndex = uniqueVertices.getKeyValue(v, &keyExists);
+		if (!keyExists) {
+			*pIndex = (uint32_t)newVertexBuff.size();
+			newVertexBuff.push_back(v);
+			if (colors != nullptr) newColors.push_back((*colors)[(*indexBuff)[corner]]);
+		}
+		(*indexBuff)[corner] = *pIndex;
+
+	}
+
+	vertexBuff->swap(newVertexBuff);
+	if (colors != nullptr) colors->swap(newColors);
+
+}
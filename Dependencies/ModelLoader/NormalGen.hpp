@@ -0,0 +1,22 @@
+#pragma once
+
+#include "VertexMap.hpp"
+
+namespace mload {
+
+	enum NormalMode {
+
+		NORMAL_MODE_FILE = 0, // Normals from the file. Zero or invalid STL facet normals are replaced with the face normal.
+		NORMAL_MODE_FLAT,     // One normal per face.
+		NORMAL_MODE_SMOOTH,   // Area and angle weighted vertex normals, split where faces meet at more than the crease angle.
+
+	};
+
+	/// Replaces the normals of an indexed triangle mesh and re-indexes it. 
+	/// Vertices are welded by position first, so vertices that were only split because of their old normals are merged. 
+	/// @param mode        NORMAL_MODE_FLAT or NORMAL_MODE_SMOOTH
+	/// @param creaseAngle degrees, faces meeting at a larger angle don't share a normal (NORMAL_MODE_SMOOTH only)
+	/// @param colors      optional, one per vertex, re-indexed along with the vertices. Vertices that only differ in color get merged. 
+	void generateNormals(NormalMode mode, float creaseAngle, std::vector<Vertex>* vertexBuff, std::vector<uint32_t>* indexBuff, std::vector<uint32_t>* colors = nullptr);
+
+}
@@ -0,0 +1,40 @@
+#pragma once
+
+#include "WorkerPool.hpp"
+
+#include <atomic>
+#include <algorithm>
+
+namespace mload {
+
+	/// Splits [0, count) into contiguous ranges and calls func(begin, end) for each range on the pool. 
+	/// The calling thread takes the first range and then helps with queued work until every range is done,
+	/// so calling this from a pool thread can't deadlock. Runs on the calling thread if count is smaller than minRangeSize. 
+	template<typename F>
+	void parallelFor(WorkerPool& pool, size_t count, size_t minRangeSize, F&& func) {
+
+		size_t rangeCount = std::min((size_t)pool.threadCount() + 1, count / std::max(minRangeSize, (size_t)1));
+		if (rangeCount <= 1) { func((size_t)0, count); return; }
+
+		size_t rangeSize = (count + rangeCount - 1) / rangeCount;
+		std::atomic<size_t> rangesLeft(0);
+		for (size_t begin = rangeSize; begin < count; begin += rangeSize) {
+			size_t end = std::min(begin + rangeSize, count);
+			rangesLeft++;
+			pool.submit([&func, &rangesLeft, begin, end]() { func(begin, end); rangesLeft--; });
+		}
+		func((size_t)0, rangeSize);
+
+		while (rangesLeft > 0) {
+			if (!pool.runPendingTask()) std::this_thread::yield();
+		}
+
+	}
+
+	/// parallelFor on the shared worker pool
+	template<typename F>
+	void parallelFor(size_t count, size_t minRangeSize, F&& func) {
+		parallelFor(WorkerPool::shared(), count, minRangeSize, std::forward<F>(func));
+	}
+
+}
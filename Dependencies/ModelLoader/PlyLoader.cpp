@@ -0,0 +1,468 @@
+#include "PlyLoader.hpp"
+
+#include <cstring>
+#include <cstdlib>
+#include <algorithm>
+
+namespace {
+
+	struct PlyTypeName {
+		const char*    name;
+		mload::PlyType type;
+	};
+	const PlyTypeName c_PlyTypeNames[] = {
+		{ "char",  mload::PLY_TYPE_INT8    }, { "int8",    mload::PLY_TYPE_INT8    },
+		{ "uchar", mload::PLY_TYPE_UINT8   }, { "uint8",   mload::PLY_TYPE_UINT8   },
+		{ "short", mload::PLY_TYPE_INT16   }, { "int16",   mload::PLY_TYPE_INT16   },
+		{ "ushort",mload::PLY_TYPE_UINT16  }, { "uint16",  mload::PLY_TYPE_UINT16  },
+		{ "int",   mload::PLY_TYPE_INT32   }, { "int32",   mload::PLY_TYPE_INT32   },
+		{ "uint",  mload::PLY_TYPE_UINT32  }, { "uint32",  mload::PLY_TYPE_UINT32  },
+		{ "float", mload::PLY_TYPE_FLOAT32 }, { "float32", mload::PLY_TYPE_FLOAT32 },
+		{ "double",mload::PLY_TYPE_FLOAT64 }, { "float64", mload::PLY_TYPE_FLOAT64 },
+	};
+	const uint32_t c_PlyTypeSizes[] = { 0, 1, 1, 2, 2, 4, 4, 4, 8 }; // indexed by PlyType
+
+	const char* const c_PlyRoleNames[mload::PLY_ROLE_COUNT] = { "", "x", "y", "z", "nx", "ny", "nz", "red", "green", "blue", "alpha", "vertex_indices" };
+
+	/// Words of a header line, not null terminated.
+	struct HeaderLine {
+
+		static constexpr int c_maxWords = 6;
+
+		const char* words[c_maxWords];
+		size_t      lengths[c_maxWords];
+		int         wordCount;
+
+		bool is(int i, const char* str) const { return i < wordCount && strlen(str) == lengths[i] && memcmp(words[i], str, lengths[i]) == 0; }
+		uint64_t number(int i) const {
+			char digits[32]{};
+			if (i < wordCount) memcpy(digits, words[i], std::min(lengths[i], sizeof(digits) - 1));
+			return strtoull(digits, nullptr, 10);
+		}
+
+	};
+
+	/// Converts a binary value of any PlyType to double, swapping the bytes of big endian files.
+	typedef double (*PlyReadFunc)(const char* p);
+
+	template<typename T, bool swapBytes>
+	double readValue(const char* p) {
+		char bytes[sizeof(T)];
+		memcpy(bytes, p, sizeof(T));
+		if (swapBytes) std::reverse(bytes, bytes + sizeof(T));
+		T value;
+		memcpy(&value, bytes, sizeof(T));
+		return (double)value;
+	}
+	template<bool swapBytes>
+	PlyReadFunc readFunc(mload::PlyType type) {
+		static const PlyReadFunc funcs[] = {
+			nullptr,
+			readValue<int8_t,   swapBytes>, readValue<uint8_t,  swapBytes>,
+			readValue<int16_t,  swapBytes>, readValue<uint16_t, swapBytes>,
+			readValue<int32_t,  swapBytes>, readValue<uint32_t, swapBytes>,
+			readValue<float,    swapBytes>, readValue<double,   swapBytes>,
+		};
+		return funcs[type];
+	}
+	PlyReadFunc readFunc(mload::PlyType type, bool swapBytes) { return swapBytes ? readFunc<true>(type) : readFunc<false>(type); }
+
+}
+
+static bool readHeaderLine(const char*& c, const char* end, HeaderLine* line) {
+
+	const char* lineEnd = (const char*)memchr(c, '\n', end - c);
+	if (lineEnd == nullptr) return false;
+
+	line->wordCount = 0;
+	for (const char* word = c; word < lineEnd;) {
+		for (; word < lineEnd && (*word == ' ' || *word == '\t' || *word == '\r'); word++) {}
+		const char* wordEnd = word;
+		for (; wordEnd < lineEnd && *wordEnd != ' ' && *wordEnd != '\t' && *wordEnd != '\r'; wordEnd++) {}
+		if (wordEnd > word && line->wordCount < HeaderLine::c_maxWords) {
+			line->words[line->wordCount]   = word;
+			line->lengths[line->wordCount] = (size_t)(wordEnd - word);
+			line->wordCount++;
+		}
+		word = wordEnd;
+	}
+	c = lineEnd + 1;
+	return true;
+
+}
+static mload::PlyType plyType(const HeaderLine& line, int word) {
+	for (const PlyTypeName& typeName : c_PlyTypeNames) {
+		if (line.is(word, typeName.name)) return typeName.type;
+	}
+	return mload::PLY_TYPE_INVALID;
+}
+static mload::PlyRole plyRole(const HeaderLine& line, int word) {
+	if (line.is(word, "vertex_index")) return mload::PLY_ROLE_VERTEX_INDICES;
+	for (int role = 1; role < mload::PLY_ROLE_COUNT; role++) {
+		if (line.is(word, c_PlyRoleNames[role])) return (mload::PlyRole)role;
+	}
+	return mload::PLY_ROLE_NONE;
+}
+
+const mload::PlyElement* mload::PlyHeader::element(const char* name) const {
+	for (const PlyElement& element : elements) {
+		if (element.name == name) return &element;
+	}
+	return nullptr;
+}
+
+bool mload::parsePlyHeader(const char* data, size_t size, PlyHeader* header) {
+
+	const char* c = data, *end = data + size;
+	HeaderLine line;
+	if (!readHeaderLine(c, end, &line) || !line.is(0, "ply")) return false;
+
+	header->elements.clear();
+	bool hasFormat = false;
+	for (;;) {
+
+		if (!readHeaderLine(c, end, &line)) return false;
+		if (line.is(0, "end_header")) break;
+
+		if (line.is(0, "format")) {
+			if      (line.is(1, "ascii"))                header->format = PLY_FORMAT_ASCII;
+			else if (line.is(1, "binary_little_endian")) header->format = PLY_FORMAT_BINARY_LITTLE_ENDIAN;
+			else if (line.is(1, "binary_big_endian"))    header->format = PLY_FORMAT_BINARY_BIG_ENDIAN;
+			else return false;
+			hasFormat = true;
+		}
+		else if (line.is(0, "element") && line.wordCount >= 3) {
+			PlyElement element{};
+			element.name  = std::string(line.words[1], line.lengths[1]);
+			element.count = line.number(2);
+			header->elements.push_back(std::move(element));
+		}
+		else if (line.is(0, "property") && !header->elements.empty()) {
+			PlyProperty property{};
+			if (line.is(1, "list") && line.wordCount >= 5) {
+				property.countType = plyType(line, 2);
+				property.type      = plyType(line, 3);
+				property.role      = plyRole(line, 4);
+				if (property.countType == PLY_TYPE_INVALID) return false;
+			}
+			else if (line.wordCount >= 3) {
+				property.type = plyType(line, 1);
+				property.role = plyRole(line, 2);
+			}
+			if (property.type == PLY_TYPE_INVALID) return false;
+			header->elements.back().properties.push_back(property);
+		}
+		// comment, obj_info and unknown keywords are skipped
+
+	}
+	header->size = (size_t)(c - data);
+
+	for (PlyElement& element : header->elements) {
+		element.stride = 0;
+		for (PlyProperty& property : element.properties) {
+			if (property.countType != PLY_TYPE_INVALID) { element.stride = 0; break; }
+			property.offset = element.stride;
+			element.stride += c_PlyTypeSizes[property.type];
+		}
+	}
+	return hasFormat;
+
+}
+
+/// Adds the face as a fan around its first vertex, faces with an index out of range are dropped.
+static void addFace(const uint32_t* indices, size_t indexCount, uint32_t vertexCount, std::vector<uint32_t>* indexBuff) {
+
+	for (size_t i = 0; i < indexCount; i++) {
+		if (indices[i] >= vertexCount) return;
+	}
+	for (size_t i = 2; i < indexCount; i++) {
+		indexBuff->push_back(indices[0]);
+		indexBuff->push_back(indices[i - 1]);
+		indexBuff->push_back(indices[i]);
+	}
+
+}
+static uint32_t packColor(const double rgba[4], bool floatColor) {
+
+	uint32_t color = 0;
+	for (int i = 0; i < 4; i++) {
+		double value = floatColor ? 255.0 * rgba[i] : rgba[i];
+		color |= (uint32_t)std::min(std::max(value, 0.0), 255.0) << (8 * i);
+	}
+	return color;
+
+}
+
+// Binary
+
+/// @return end of the record, nullptr if it runs past end
+static const char* skipRecord(const mload::PlyElement& element, bool swapBytes, const char* c, const char* end) {
+
+	if (element.stride > 0) return (size_t)(end - c) >= element.stride ? c + element.stride : nullptr;
+	for (const mload::PlyProperty& property : element.properties) {
+		size_t size = c_PlyTypeSizes[property.type];
+		if (property.countType != mload::PLY_TYPE_INVALID) {
+			size_t countSize = c_PlyTypeSizes[property.countType];
+			if ((size_t)(end - c) < countSize) return nullptr;
+			size *= (size_t)readFunc(property.countType, swapBytes)(c);
+			c    += countSize;
+		}
+		if ((size_t)(end - c) < size) return nullptr;
+		c += size;
+	}
+	return c;
+
+}
+
+/// Finds the vertex properties the loader uses.
+struct PlyVertexLayout {
+
+	const mload::PlyProperty* roles[mload::PLY_ROLE_COUNT] = {};
+
+	explicit PlyVertexLayout(const mload::PlyElement& element) {
+		for (const mload::PlyProperty& property : element.properties) {
+			if (property.role != mload::PLY_ROLE_NONE && property.countType == mload::PLY_TYPE_INVALID) roles[property.role] = &property;
+		}
+	}
+	bool has(mload::PlyRole first, mload::PlyRole last) const {
+		for (int role = first; role <= last; role++) {
+			if (roles[role] == nullptr) return false;
+		}
+		return true;
+	}
+	/// The properties first to last are floats stored one after another in a little endian record.
+	bool packedFloats(mload::PlyRole first, mload::PlyRole last, bool swapBytes) const {
+		if (swapBytes || !has(first, last)) return false;
+		for (int role = first; role <= last; role++) {
+			if (roles[role]->type != mload::PLY_TYPE_FLOAT32 || roles[role]->offset != roles[first]->offset + 4 * (role - first)) return false;
+		}
+		return true;
+	}
+
+};
+
+/// Positions and normals of little endian float32 vertices, at any offset and stride.
+template<bool hasNormals>
+static void decodeFloatVertices(const char* records, size_t count, uint32_t stride, uint32_t posOffset, uint32_t normalOffset, mload::Vertex* vertices) {
+	for (size_t i = 0; i < count; i++) {
+		const char* record = records + i * stride;
+		memcpy(&vertices[i].pos, record + posOffset, sizeof(mload::vec3));
+		if (hasNormals) memcpy(&vertices[i].normal, record + normalOffset, sizeof(mload::vec3));
+		else            vertices[i].normal = { 0.0f, 0.0f, 0.0f };
+	}
+}
+/// Any other layout, one converter per property.
+static void decodeVertices(const PlyVertexLayout& layout, const char* records, size_t count, uint32_t stride, bool swapBytes, bool hasNormals, mload::Vertex* vertices) {
+
+	PlyReadFunc read[mload::PLY_ROLE_NZ + 1];
+	uint32_t    offset[mload::PLY_ROLE_NZ + 1];
+	int lastRole = hasNormals ? mload::PLY_ROLE_NZ : mload::PLY_ROLE_Z;
+	for (int role = mload::PLY_ROLE_X; role <= lastRole; role++) {
+		read[role]   = readFunc(layout.roles[role]->type, swapBytes);
+		offset[role] = layout.roles[role]->offset;
+	}
+
+	for (size_t i = 0; i < count; i++) {
+		const char* record = records + i * stride;
+		float v[6] = {};
+		for (int role = mload::PLY_ROLE_X; role <= lastRole; role++) v[role - mload::PLY_ROLE_X] = (float)read[role](record + offset[role]);
+		vertices[i] = mload::Vertex({ v[0], v[1], v[2] }, { v[3], v[4], v[5] });
+	}
+
+}
+static const char* readVerticesBinary(const mload::PlyElement& element, bool swapBytes, const char* c, const char* end, std::vector<mload::Vertex>* vertexBuff, std::vector<uint32_t>* colors, bool* hasNormals) {
+
+	PlyVertexLayout layout(element);
+	// Vertices with list properties aren't supported
+	if (element.stride == 0 || !layout.has(mload::PLY_ROLE_X, mload::PLY_ROLE_Z)) return nullptr;
+	if ((uint64_t)(end - c) < element.count * element.stride) return nullptr;
+
+	const size_t count  = (size_t)element.count;
+	const uint32_t stride = element.stride;
+	*hasNormals = layout.has(mload::PLY_ROLE_NX, mload::PLY_ROLE_NZ);
+
+	size_t first = vertexBuff->size();
+	vertexBuff->resize(first + count);
+	mload::Vertex* vertices = &(*vertexBuff)[first];
+
+	bool packedPos    = layout.packedFloats(mload::PLY_ROLE_X,  mload::PLY_ROLE_Z,  swapBytes);
+	bool packedNormal = layout.packedFloats(mload::PLY_ROLE_NX, mload::PLY_ROLE_NZ, swapBytes);
+	if (packedPos && packedNormal && stride == sizeof(mload::Vertex) && layout.roles[mload::PLY_ROLE_X]->offset == 0 && layout.roles[mload::PLY_ROLE_NX]->offset == sizeof(mload::vec3)) {
+		// The records are Vertex already
+		memcpy(vertices, c, count * sizeof(mload::Vertex));
+	}
+	else if (packedPos && packedNormal) {
+		decodeFloatVertices<true>(c, count, stride, layout.roles[mload::PLY_ROLE_X]->offset, layout.roles[mload::PLY_ROLE_NX]->offset, vertices);
+	}
+	else if (packedPos && !*hasNormals) {
+		decodeFloatVertices<false>(c, count, stride, layout.roles[mload::PLY_ROLE_X]->offset, 0, vertices);
+	}
+	else {
+		decodeVertices(layout, c, count, stride, swapBytes, *hasNormals, vertices);
+	}
+
+	if (colors != nullptr && layout.has(mload::PLY_ROLE_RED, mload::PLY_ROLE_BLUE)) {
+		PlyReadFunc read[4];
+		for (int i = 0; i < 4; i++) {
+			const mload::PlyProperty* property = layout.roles[mload::PLY_ROLE_RED + i];
+			read[i] = property != nullptr ? readFunc(property->type, swapBytes) : nullptr;
+		}
+		bool floatColor = layout.roles[mload::PLY_ROLE_RED]->type >= mload::PLY_TYPE_FLOAT32;
+		colors->resize(first);
+		colors->reserve(first + count);
+		for (size_t i = 0; i < count; i++) {
+			const char* record = c + i * stride;
+			double rgba[4] = { 0.0, 0.0, 0.0, floatColor ? 1.0 : 255.0 };
+			for (int j = 0; j < 4; j++) {
+				if (read[j] != nullptr) rgba[j] = read[j](record + layout.roles[mload::PLY_ROLE_RED + j]->offset);
+			}
+			colors->push_back(packColor(rgba, floatColor));
+		}
+	}
+
+	return c + count * stride;
+
+}
+static const char* readFacesBinary(const mload::PlyElement& element, bool swapBytes, const char* c, const char* end, uint32_t vertexCount, std::vector<uint32_t>* indexBuff) {
+
+	const mload::PlyProperty* indexList = nullptr;
+	for (const mload::PlyProperty& property : element.properties) {
+		if (property.role == mload::PLY_ROLE_VERTEX_INDICES && property.countType != mload::PLY_TYPE_INVALID) indexList = &property;
+	}
+	if (indexList == nullptr) {
+		for (uint64_t i = 0; i < element.count && c != nullptr; i++) c = skipRecord(element, swapBytes, c, end);
+		return c;
+	}
+
+	indexBuff->reserve(indexBuff->size() + 3 * (size_t)element.count);
+	std::vector<uint32_t> indices;
+
+	// The layout almost every exporter writes: only the list, a uchar count and 32 bit indices
+	bool commonLayout = !swapBytes && element.properties.size() == 1 && indexList->countType == mload::PLY_TYPE_UINT8 &&
+	                    (indexList->type == mload::PLY_TYPE_INT32 || indexList->type == mload::PLY_TYPE_UINT32);
+	if (commonLayout) {
+		for (uint64_t face = 0; face < element.count; face++) {
+			if (c >= end) return nullptr;
+			size_t indexCount = (uint8_t)*c++;
+			if ((size_t)(end - c) < 4 * indexCount) return nullptr;
+			indices.resize(indexCount);
+			memcpy(indices.data(), c, 4 * indexCount);
+			addFace(indices.data(), indexCount, vertexCount, indexBuff);
+			c += 4 * indexCount;
+		}
+		return c;
+	}
+
+	PlyReadFunc readCount = readFunc(indexList->countType, swapBytes);
+	PlyReadFunc readIndex = readFunc(indexList->type, swapBytes);
+	size_t countSize = c_PlyTypeSizes[indexList->countType], indexSize = c_PlyTypeSizes[indexList->type];
+	for (uint64_t face = 0; face < element.count; face++) {
+		for (const mload::PlyProperty& property : element.properties) {
+			if (&property != indexList) {
+				mload::PlyElement single{ "", 1, { property }, property.countType == mload::PLY_TYPE_INVALID ? c_PlyTypeSizes[property.type] : 0 };
+				if ((c = skipRecord(single, swapBytes, c, end)) == nullptr) return nullptr;
+				continue;
+			}
+			if ((size_t)(end - c) < countSize) return nullptr;
+			size_t indexCount = (size_t)readCount(c);
+			c += countSize;
+			if ((size_t)(end - c) < indexCount * indexSize) return nullptr;
+			indices.resize(indexCount);
+			for (size_t i = 0; i < indexCount; i++) indices[i] = (uint32_t)readIndex(c + i * indexSize);
+			addFace(indices.data(), indexCount, vertexCount, indexBuff);
+			c += indexCount * indexSize;
+		}
+	}
+	return c;
+
+}
+
+// ASCII
+
+/// @return false at the end of the data
+static bool readTextValue(const char*& c, const char* end, double* value) {
+
+	for (; c < end && (*c == ' ' || *c == '\t' || *c == '\r' || *c == '\n'); c++) {}
+	const char* valueEnd = c;
+	for (; valueEnd < end && *valueEnd != ' ' && *valueEnd != '\t' && *valueEnd != '\r' && *valueEnd != '\n'; valueEnd++) {}
+	if (valueEnd == c) return false;
+
+	char text[64]{};
+	memcpy(text, c, std::min((size_t)(valueEnd - c), sizeof(text) - 1));
+	*value = strtod(text, nullptr);
+	c = valueEnd;
+	return true;
+
+}
+static const char* readElementText(const mload::PlyElement& element, bool isVertex, bool isFace, const char* c, const char* end, std::vector<mload::Vertex>* vertexBuff, std::vector<uint32_t>* indexBuff, std::vector<uint32_t>* colors, bool* hasNormals) {
+
+	PlyVertexLayout layout(element);
+	bool hasColors = false, floatColor = false;
+	if (isVertex) {
+		if (!layout.has(mload::PLY_ROLE_X, mload::PLY_ROLE_Z)) return nullptr;
+		*hasNormals = layout.has(mload::PLY_ROLE_NX, mload::PLY_ROLE_NZ);
+		hasColors   = colors != nullptr && layout.has(mload::PLY_ROLE_RED, mload::PLY_ROLE_BLUE);
+		floatColor  = hasColors && layout.roles[mload::PLY_ROLE_RED]->type >= mload::PLY_TYPE_FLOAT32;
+		vertexBuff->reserve(vertexBuff->size() + (size_t)element.count);
+		if (hasColors) colors->resize(vertexBuff->size());
+	}
+	uint32_t vertexCount = (uint32_t)vertexBuff->size();
+
+	std::vector<uint32_t> indices;
+	for (uint64_t record = 0; record < element.count; record++) {
+
+		double values[mload::PLY_ROLE_COUNT] = {};
+		values[mload::PLY_ROLE_ALPHA] = floatColor ? 1.0 : 255.0;
+		for (const mload::PlyProperty& property : element.properties) {
+			double value;
+			if (!readTextValue(c, end, &value)) return nullptr;
+			if (property.countType == mload::PLY_TYPE_INVALID) {
+				values[property.role] = value;
+				continue;
+			}
+			indices.resize((size_t)value);
+			for (uint32_t& index : indices) {
+				if (!readTextValue(c, end, &value)) return nullptr;
+				index = (uint32_t)value;
+			}
+			if (isFace && property.role == mload::PLY_ROLE_VERTEX_INDICES) addFace(indices.data(), indices.size(), vertexCount, indexBuff);
+		}
+
+		if (isVertex) {
+			const double* v = &values[mload::PLY_ROLE_X];
+			vertexBuff->emplace_back(mload::vec3{ (float)v[0], (float)v[1], (float)v[2] }, mload::vec3{ (float)v[3], (float)v[4], (float)v[5] });
+			if (hasColors) colors->push_back(packColor(&values[mload::PLY_ROLE_RED], floatColor));
+		}
+
+	}
+	return c;
+
+}
+
+mload::Success mload::loadPly(const char* data, size_t size, std::vector<Vertex>* vertexBuff, std::vector<uint32_t>* indexBuff, std::vector<uint32_t>* colors, bool* hasNormals, bool* isTextFormat) {
+
+	PlyHeader header;
+	if (!parsePlyHeader(data, size, &header)) return Success::WRONG_FILE_FORMAT;
+	*isTextFormat = header.format == PLY_FORMAT_ASCII;
+	*hasNormals   = false;
+
+	const bool swapBytes = header.format == PLY_FORMAT_BINARY_BIG_ENDIAN;
+	const char* c = data + header.size, *end = data + size;
+	for (const PlyElement& element : header.elements) {
+
+		bool isVertex = element.name == "vertex";
+		bool isFace   = element.name == "face";
+		if (*isTextFormat)  c = readElementText(element, isVertex, isFace, c, end, vertexBuff, indexBuff, colors, hasNormals);
+		else if (isVertex)  c = readVerticesBinary(element, swapBytes, c, end, vertexBuff, colors, hasNormals);
+		else if (isFace)    c = readFacesBinary(element, swapBytes, c, end, (uint32_t)vertexBuff->size(), indexBuff);
+		else {
+			for (uint64_t i = 0; i < element.count && c != nullptr; i++) c = skipRecord(element, swapBytes, c, end);
+		}
+		if (c == nullptr) return isVertex && element.stride == 0 ? Success::WRONG_FILE_FORMAT : Success::TRUNCATED_FILE;
+
+	}
+	if (indexBuff->empty()) return Success::NO_DATA_FROM_FILE;
+
+	return Success::SUCCESS;
+
+}
@@ -0,0 +1,79 @@
+#pragma once
+
+#include "ModelLoader.hpp"
+
+#include <string>
+
+namespace mload {
+
+	enum PlyFormat {
+
+		PLY_FORMAT_ASCII = 0,
+		PLY_FORMAT_BINARY_LITTLE_ENDIAN,
+		PLY_FORMAT_BINARY_BIG_ENDIAN,
+
+	};
+
+	enum PlyType : uint8_t {
+
+		PLY_TYPE_INVALID = 0,
+		PLY_TYPE_INT8,
+		PLY_TYPE_UINT8,
+		PLY_TYPE_INT16,
+		PLY_TYPE_UINT16,
+		PLY_TYPE_INT32,
+		PLY_TYPE_UINT32,
+		PLY_TYPE_FLOAT32,
+		PLY_TYPE_FLOAT64,
+
+	};
+
+	/// What the loader uses a property for.
+	enum PlyRole : uint8_t {
+
+		PLY_ROLE_NONE = 0,
+		PLY_ROLE_X, PLY_ROLE_Y, PLY_ROLE_Z,
+		PLY_ROLE_NX, PLY_ROLE_NY, PLY_ROLE_NZ,
+		PLY_ROLE_RED, PLY_ROLE_GREEN, PLY_ROLE_BLUE, PLY_ROLE_ALPHA,
+		PLY_ROLE_VERTEX_INDICES,
+		PLY_ROLE_COUNT,
+
+	};
+
+	struct PlyProperty {
+
+		PlyType  type;      // of the list items for lists
+		PlyType  countType; // PLY_TYPE_INVALID if the property isn't a list
+		PlyRole  role;
+		uint32_t offset;    // bytes from the start of a binary record, only valid if PlyElement::stride isn't 0
+
+	};
+
+	struct PlyElement {
+
+		std::string              name;
+		uint64_t                 count;
+		std::vector<PlyProperty> properties;
+		uint32_t                 stride; // bytes of a binary record, 0 if the element has list properties
+
+	};
+
+	struct PlyHeader {
+
+		PlyFormat               format;
+		std::vector<PlyElement> elements;
+		size_t                  size;     // bytes up to and including the "end_header" line
+
+		const PlyElement* element(const char* name) const;
+
+	};
+
+	/// @return false if data doesn't start with a complete PLY header
+	bool parsePlyHeader(const char* data, size_t size, PlyHeader* header);
+
+	/// Reads the "vertex" and "face" elements of a PLY file, faces with more than 3 vertices are split into fans.
+	/// @param colors     optional, RGBA8 per vertex if the vertices have red, green and blue properties
+	/// @param hasNormals set to false if the vertices have no nx, ny and nz, their normals are zero then
+	Success loadPly(const char* data, size_t size, std::vector<Vertex>* vertexBuff, std::vector<uint32_t>* indexBuff, std::vector<uint32_t>* colors, bool* hasNormals, bool* isTextFormat);
+
+}
@@ -0,0 +1,42 @@
+#pragma once
+
+#include <atomic>
+#include <memory>
+#include <cstdint>
+
+namespace mload {
+
+	/// Bounded lock-free queue between exactly one producer thread and one consumer thread. T must be trivially copyable. 
+	template<typename T>
+	class SpscQueue {
+	public:
+
+		/// @param capacity rounded up to a power of two
+		explicit SpscQueue(size_t capacity);
+		SpscQueue(const SpscQueue&) = delete; 
+		void operator=(const SpscQueue&) = delete;
+
+		/// Producer only. @return false if the queue is full
+		bool tryPush(const T& item);
+		/// Consumer only. @return false if the queue is empty
+		bool tryPop(T* item);
+
+		/// Producer only, spins and then yields until there is room. 
+		void push(const T& item);
+		/// Consumer only, spins and then yields until there is an item. 
+		T    pop();
+
+	private:
+
+		std::unique_ptr<T[]> m_items;
+		size_t               m_mask;
+
+		// On separate cache lines so the two threads don't invalidate each other's index on every operation
+		alignas(64) std::atomic<size_t> m_head; // next item to pop, written by the consumer
+		alignas(64) std::atomic<size_t> m_tail; // next slot to push to, written by the producer
+
+	};
+
+}
+
+#include "SpscQueue.inl"
@@ -0,0 +1,56 @@
+#include <thread>
+
+/// Failed tries before the waiting side of a queue gives up its time slice. 
+constexpr uint32_t c_SpscSpinCount = 64;
+
+template<typename T>
+mload::SpscQueue<T>::SpscQueue(size_t capacity) : m_head(0), m_tail(0) {
+
+	size_t slotCount = 2;
+	while (slotCount < capacity) slotCount *= 2;
+	m_items.reset(new T[slotCount]);
+	m_mask = slotCount - 1;
+
+}
+
+template<typename T>
+bool mload::SpscQueue<T>::tryPush(const T& item) {
+
+	size_t tail = m_tail.load(std::memory_order_relaxed);
+	if (tail - m_head.load(std::memory_order_acquire) > m_mask) return false;
+	m_items[tail & m_mask] = item;
+	m_tail.store(tail + 1, std::memory_order_release);
+	return true;
+
+}
+
+template<typename T>
+bool mload::SpscQueue<T>::tryPop(T* item) {
+
+	size_t head = m_head.load(std::memory_order_relaxed);
+	if (head == m_tail.load(std::memory_order_acquire)) return false;
+	*item = m_items[head & m_mask];
+	m_head.store(head + 1, std::memory_order_release);
+	return true;
+
+}
+
+template<typename T>
+void mload::SpscQueue<T>::push(const T& item) {
+
+	for (uint32_t tries = 1; !tryPush(item); tries++) {
+		if (tries >= c_SpscSpinCount) std::this_thread::yield();
+	}
+
+}
+
+template<typename T>
+T mload::SpscQueue<T>::pop() {
+
+	T item;
+	for (uint32_t tries = 1; !tryPop(&item); tries++) {
+		if (tries >= c_SpscSpinCount) std::this_thread::yield();
+	}
+	return item;
+
+}
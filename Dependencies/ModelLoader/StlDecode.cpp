@@ -0,0 +1,547 @@
+#include "StlDecode.hpp"
+#include "ConcurrentMap.hpp"
+#include "Parallel.hpp"
+
+#include <cstring>
+#include <cmath>
+#include <cassert>
+#include <algorithm>
+
+#if defined(__AVX2__)
+#define STL_DECODE_AVX2
+#include <immintrin.h>
+#elif defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define STL_DECODE_SSE2
+#include <emmintrin.h>
+#elif defined(__aarch64__) || defined(_M_ARM64)
+#define STL_DECODE_NEON
+#include <arm_neon.h>
+#endif
+
+// Lane wrappers so the kernel below is written once for every instruction set.
+namespace {
+
+#if defined(STL_DECODE_AVX2)
+
+	constexpr size_t c_Lanes = 8;
+	typedef __m256  F;
+	typedef __m256i U;
+	typedef __m256  M;
+
+	inline F    loadF     (const float* p)      { return _mm256_loadu_ps(p); }
+	inline void storeF    (float* p, F v)       { _mm256_storeu_ps(p, v); }
+	inline void storeU    (uint32_t* p, U v)    { _mm256_storeu_si256((__m256i*)p, v); }
+	inline F    setF      (float v)             { return _mm256_set1_ps(v); }
+	inline U    setU      (uint32_t v)          { return _mm256_set1_epi32((int)v); }
+	inline F    add       (F a, F b)            { return _mm256_add_ps(a, b); }
+	inline F    sub       (F a, F b)            { return _mm256_sub_ps(a, b); }
+	inline F    mul       (F a, F b)            { return _mm256_mul_ps(a, b); }
+	inline F    divide    (F a, F b)            { return _mm256_div_ps(a, b); }
+	inline F    squareRoot(F a)                 { return _mm256_sqrt_ps(a); }
+	inline M    cmpGt     (F a, F b)            { return _mm256_cmp_ps(a, b, _CMP_GT_OQ); }
+	inline M    cmpLt     (F a, F b)            { return _mm256_cmp_ps(a, b, _CMP_LT_OQ); }
+	inline M    cmpEq     (F a, F b)            { return _mm256_cmp_ps(a, b, _CMP_EQ_OQ); }
+	inline M    maskAnd   (M a, M b)            { return _mm256_and_ps(a, b); }
+	inline F    select    (M mask, F a, F b)    { return _mm256_blendv_ps(b, a, mask); }
+	inline U    bits      (F a)                 { return _mm256_castps_si256(a); }
+	inline U    xorU      (U a, U b)            { return _mm256_xor_si256(a, b); }
+	inline U    orU       (U a, U b)            { return _mm256_or_si256(a, b); }
+	inline U    mulU      (U a, U b)            { return _mm256_mullo_epi32(a, b); }
+	template<int n> inline U shl(U a)           { return _mm256_slli_epi32(a, n); }
+	template<int n> inline U shr(U a)           { return _mm256_srli_epi32(a, n); }
+	/// Zeroes lanes equal to b
+	inline U    clearEq   (U a, U b)            { return _mm256_andnot_si256(_mm256_cmpeq_epi32(a, b), a); }
+
+#elif defined(STL_DECODE_SSE2)
+
+	constexpr size_t c_Lanes = 4;
+	typedef __m128  F;
+	typedef __m128i U;
+	typedef __m128  M;
+
+	inline F    loadF     (const float* p)      { return _mm_loadu_ps(p); }
+	inline void storeF    (float* p, F v)       { _mm_storeu_ps(p, v); }
+	inline void storeU    (uint32_t* p, U v)    { _mm_storeu_si128((__m128i*)p, v); }
+	inline F    setF      (float v)             { return _mm_set1_ps(v); }
+	inline U    setU      (uint32_t v)          { return _mm_set1_epi32((int)v); }
+	inline F    add       (F a, F b)            { return _mm_add_ps(a, b); }
+	inline F    sub       (F a, F b)            { return _mm_sub_ps(a, b); }
+	inline F    mul       (F a, F b)            { return _mm_mul_ps(a, b); }
+	inline F    divide    (F a, F b)            { return _mm_div_ps(a, b); }
+	inline F    squareRoot(F a)                 { return _mm_sqrt_ps(a); }
+	inline M    cmpGt     (F a, F b)            { return _mm_cmpgt_ps(a, b); }
+	inline M    cmpLt     (F a, F b)            { return _mm_cmplt_ps(a, b); }
+	inline M    cmpEq     (F a, F b)            { return _mm_cmpeq_ps(a, b); }
+	inline M    maskAnd   (M a, M b)            { return _mm_and_ps(a, b); }
+	inline F    select    (M mask, F a, F b)    { return _mm_or_ps(_mm_and_ps(mask, a), _mm_andnot_ps(mask, b)); }
+	inline U    bits      (F a)                 { return _mm_castps_si128(a); }
+	inline U    xorU      (U a, U b)            { return _mm_xor_si128(a, b); }
+	inline U    orU       (U a, U b)            { return _mm_or_si128(a, b); }
+	// SSE2 has no 32 bit multiply, multiply the even and odd lanes as 64 bit and interleave the low halves
+	inline U    mulU      (U a, U b) {
+		U even = _mm_mul_epu32(a, b);
+		U odd  = _mm_mul_epu32(_mm_srli_epi64(a, 32), _mm_srli_epi64(b, 32));
+		return _mm_unpacklo_epi32(_mm_shuffle_epi32(even, _MM_SHUFFLE(0, 0, 2, 0)), _mm_shuffle_epi32(odd, _MM_SHUFFLE(0, 0, 2, 0)));
+	}
+	template<int n> inline U shl(U a)           { return _mm_slli_epi32(a, n); }
+	template<int n> inline U shr(U a)           { return _mm_srli_epi32(a, n); }
+	inline U    clearEq   (U a, U b)            { return _mm_andnot_si128(_mm_cmpeq_epi32(a, b), a); }
+
+#elif defined(STL_DECODE_NEON)
+
+	constexpr size_t c_Lanes = 4;
+	typedef float32x4_t F;
+	typedef uint32x4_t  U;
+	typedef uint32x4_t  M;
+
+	inline F    loadF     (const float* p)      { return vld1q_f32(p); }
+	inline void storeF    (float* p, F v)       { vst1q_f32(p, v); }
+	inline void storeU    (uint32_t* p, U v)    { vst1q_u32(p, v); }
+	inline F    setF      (float v)             { return vdupq_n_f32(v); }
+	inline U    setU      (uint32_t v)          { return vdupq_n_u32(v); }
+	inline F    add       (F a, F b)            { return vaddq_f32(a, b); }
+	inline F    sub       (F a, F b)            { return vsubq_f32(a, b); }
+	inline F    mul       (F a, F b)            { return vmulq_f32(a, b); }
+	inline F    divide    (F a, F b)            { return vdivq_f32(a, b); }
+	inline F    squareRoot(F a)                 { return vsqrtq_f32(a); }
+	inline M    cmpGt     (F a, F b)            { return vcgtq_f32(a, b); }
+	inline M    cmpLt     (F a, F b)            { return vcltq_f32(a, b); }
+	inline M    cmpEq     (F a, F b)            { return vceqq_f32(a, b); }
+	inline M    maskAnd   (M a, M b)            { return vandq_u32(a, b); }
+	inline F    select    (M mask, F a, F b)    { return vbslq_f32(mask, a, b); }
+	inline U    bits      (F a)                 { return vreinterpretq_u32_f32(a); }
+	inline U    xorU      (U a, U b)            { return veorq_u32(a, b); }
+	inline U    orU       (U a, U b)            { return vorrq_u32(a, b); }
+	inline U    mulU      (U a, U b)            { return vmulq_u32(a, b); }
+	template<int n> inline U shl(U a)           { return vshlq_n_u32(a, n); }
+	template<int n> inline U shr(U a)           { return vshrq_n_u32(a, n); }
+	inline U    clearEq   (U a, U b)            { return vbicq_u32(a, vceqq_u32(a, b)); }
+
+#else
+
+	constexpr size_t c_Lanes = 1;
+	typedef float    F;
+	typedef uint32_t U;
+	typedef bool     M;
+
+	inline F    loadF     (const float* p)      { return *p; }
+	inline void storeF    (float* p, F v)       { *p = v; }
+	inline void storeU    (uint32_t* p, U v)    { *p = v; }
+	inline F    setF      (float v)             { return v; }
+	inline U    setU      (uint32_t v)          { return v; }
+	inline F    add       (F a, F b)            { return a + b; }
+	inline F    sub       (F a, F b)            { return a - b; }
+	inline F    mul       (F a, F b)            { return a * b; }
+	inline F    divide    (F a, F b)            { return a / b; }
+	inline F    squareRoot(F a)                 { return std::sqrt(a); }
+	inline M    cmpGt     (F a, F b)            { return a > b; }
+	inline M    cmpLt     (F a, F b)            { return a < b; }
+	inline M    cmpEq     (F a, F b)            { return a == b; }
+	inline M    maskAnd   (M a, M b)            { return a && b; }
+	inline F    select    (M mask, F a, F b)    { return mask ? a : b; }
+	inline U    bits      (F a)                 { U u; memcpy(&u, &a, sizeof(u)); return u; }
+	inline U    xorU      (U a, U b)            { return a ^ b; }
+	inline U    orU       (U a, U b)            { return a | b; }
+	inline U    mulU      (U a, U b)            { return a * b; }
+	template<int n> inline U shl(U a)           { return a << n; }
+	template<int n> inline U shr(U a)           { return a >> n; }
+	inline U    clearEq   (U a, U b)            { return a == b ? 0 : a; }
+
+#endif
+
+	static_assert(mload::c_StlDecodeBlock % c_Lanes == 0, "A decode block must be a whole number of SIMD registers");
+
+	/// Lane wise mload::hashVertex
+	inline U hashLanes(const F components[6]) {
+
+		U h = setU(mload::c_HashSeed);
+		for (int i = 0; i < 6; i++) {
+			U u = clearEq(bits(components[i]), setU(0x80000000u));
+			h = xorU(orU(shl<5>(h), shr<27>(h)), u);
+			h = mulU(h, setU(mload::c_HashMultiplier));
+		}
+		h = xorU(h, shr<16>(h));
+		h = mulU(h, setU(mload::c_HashFinalMultiplier));
+		h = xorU(h, shr<13>(h));
+		return h;
+
+	}
+
+	/// Facets as they are laid out in the file (array of structures) to one float array per component (structure of arrays).
+	/// Every facet of the block is read, so pFacets must hold c_StlDecodeBlock facets.
+	void transposeFacets(const char* pFacets, mload::StlFacetBlock* block) {
+
+		// Destination of each of the 12 floats of a facet
+		float* dst[12] = {
+			block->normal[0],    block->normal[1],    block->normal[2],
+			block->pos[0][0],    block->pos[0][1],    block->pos[0][2],
+			block->pos[1][0],    block->pos[1][1],    block->pos[1][2],
+			block->pos[2][0],    block->pos[2][1],    block->pos[2][2],
+		};
+
+#if defined(STL_DECODE_AVX2) || defined(STL_DECODE_SSE2)
+
+		// Transposes 4x4 floats at a time: 4 facets by 4 consecutive floats of each
+		for (size_t facet = 0; facet < mload::c_StlDecodeBlock; facet += 4) {
+			const char* p = pFacets + facet * mload::c_StlFacetSize;
+			for (size_t chunk = 0; chunk < 3; chunk++) {
+				__m128 r0 = _mm_loadu_ps((const float*)(p + 0 * mload::c_StlFacetSize + 16 * chunk));
+				__m128 r1 = _mm_loadu_ps((const float*)(p + 1 * mload::c_StlFacetSize + 16 * chunk));
+				__m128 r2 = _mm_loadu_ps((const float*)(p + 2 * mload::c_StlFacetSize + 16 * chunk));
+				__m128 r3 = _mm_loadu_ps((const float*)(p + 3 * mload::c_StlFacetSize + 16 * chunk));
+				_MM_TRANSPOSE4_PS(r0, r1, r2, r3);
+				_mm_storeu_ps(dst[4 * chunk + 0] + facet, r0);
+				_mm_storeu_ps(dst[4 * chunk + 1] + facet, r1);
+				_mm_storeu_ps(dst[4 * chunk + 2] + facet, r2);
+				_mm_storeu_ps(dst[4 * chunk + 3] + facet, r3);
+			}
+		}
+
+#elif defined(STL_DECODE_NEON)
+
+		for (size_t facet = 0; facet < mload::c_StlDecodeBlock; facet += 4) {
+			const char* p = pFacets + facet * mload::c_StlFacetSize;
+			for (size_t chunk = 0; chunk < 3; chunk++) {
+				float32x4_t r0 = vld1q_f32((const float*)(p + 0 * mload::c_StlFacetSize + 16 * chunk));
+				float32x4_t r1 = vld1q_f32((const float*)(p + 1 * mload::c_StlFacetSize + 16 * chunk));
+				float32x4_t r2 = vld1q_f32((const float*)(p + 2 * mload::c_StlFacetSize + 16 * chunk));
+				float32x4_t r3 = vld1q_f32((const float*)(p + 3 * mload::c_StlFacetSize + 16 * chunk));
+				float32x4x2_t t01 = vtrnq_f32(r0, r1);
+				float32x4x2_t t23 = vtrnq_f32(r2, r3);
+				vst1q_f32(dst[4 * chunk + 0] + facet, vcombine_f32(vget_low_f32 (t01.val[0]), vget_low_f32 (t23.val[0])));
+				vst1q_f32(dst[4 * chunk + 1] + facet, vcombine_f32(vget_low_f32 (t01.val[1]), vget_low_f32 (t23.val[1])));
+				vst1q_f32(dst[4 * chunk + 2] + facet, vcombine_f32(vget_high_f32(t01.val[0]), vget_high_f32(t23.val[0])));
+				vst1q_f32(dst[4 * chunk + 3] + facet, vcombine_f32(vget_high_f32(t01.val[1]), vget_high_f32(t23.val[1])));
+			}
+		}
+
+#else
+
+		for (size_t facet = 0; facet < mload::c_StlDecodeBlock; facet++) {
+			const char* p = pFacets + facet * mload::c_StlFacetSize;
+			for (size_t i = 0; i < 12; i++) memcpy(dst[i] + facet, p + 4 * i, sizeof(float));
+		}
+
+#endif
+
+	}
+
+}
+
+void mload::decodeStlFacets(const char* pFacets, size_t count, StlFacetBlock* block) {
+
+	// Partial blocks are decoded from zero padded facets so the kernel never branches on count
+	char padded[c_StlDecodeBlock * c_StlFacetSize];
+	if (count < c_StlDecodeBlock) {
+		memset(padded, 0, sizeof(padded));
+		memcpy(padded, pFacets, count * c_StlFacetSize);
+		pFacets = padded;
+	}
+
+	transposeFacets(pFacets, block);
+
+	for (size_t lane = 0; lane < c_StlDecodeBlock; lane += c_Lanes) {
+
+		F nx = loadF(&block->normal[0][lane]);
+		F ny = loadF(&block->normal[1][lane]);
+		F nz = loadF(&block->normal[2][lane]);
+
+		F p[3][3];
+		for (int v = 0; v < 3; v++)
+			for (int c = 0; c < 3; c++) p[v][c] = loadF(&block->pos[v][c][lane]);
+
+		// Repair normals that aren't unit length with the facet normal, same as normalIsValid and facetNormal in ModelLoader.cpp
+		F lengthSquared = add(add(mul(nx, nx), mul(ny, ny)), mul(nz, nz));
+		M valid = maskAnd(cmpGt(lengthSquared, setF(0.98f)), cmpLt(lengthSquared, setF(1.02f)));
+
+		F ax = sub(p[1][0], p[0][0]), ay = sub(p[1][1], p[0][1]), az = sub(p[1][2], p[0][2]);
+		F bx = sub(p[2][0], p[0][0]), by = sub(p[2][1], p[0][1]), bz = sub(p[2][2], p[0][2]);
+		F cx = sub(mul(ay, bz), mul(by, az));
+		F cy = sub(mul(az, bx), mul(bz, ax));
+		F cz = sub(mul(ax, by), mul(bx, ay));
+		F length = squareRoot(add(add(mul(cx, cx), mul(cy, cy)), mul(cz, cz)));
+		M degenerate = cmpEq(length, setF(0.0f));
+		cx = select(degenerate, setF(0.0f), divide(cx, length));
+		cy = select(degenerate, setF(0.0f), divide(cy, length));
+		cz = select(degenerate, setF(0.0f), divide(cz, length));
+
+		nx = select(valid, nx, cx);
+		ny = select(valid, ny, cy);
+		nz = select(valid, nz, cz);
+		storeF(&block->normal[0][lane], nx);
+		storeF(&block->normal[1][lane], ny);
+		storeF(&block->normal[2][lane], nz);
+
+		for (int v = 0; v < 3; v++) {
+			F components[6] = { p[v][0], p[v][1], p[v][2], nx, ny, nz };
+			storeU(&block->hash[v][lane], hashLanes(components));
+		}
+
+	}
+
+}
+
+void mload::decodeStlFacetsScalar(const char* pFacets, size_t count, StlFacetBlock* block) {
+
+	for (size_t facet = 0; facet < c_StlDecodeBlock; facet++) {
+
+		float f[12]{};
+		if (facet < count) memcpy(f, pFacets + facet * c_StlFacetSize, sizeof(f));
+
+		vec3 n  = { f[0], f[1], f[2] };
+		vec3 p0 = { f[3], f[4], f[5] };
+		vec3 p1 = { f[6], f[7], f[8] };
+		vec3 p2 = { f[9], f[10], f[11] };
+
+		float lengthSquared = n.x * n.x + n.y * n.y + n.z * n.z;
+		if (!(lengthSquared > 0.98f && lengthSquared < 1.02f)) {
+			vec3 a = { p1.x - p0.x, p1.y - p0.y, p1.z - p0.z };
+			vec3 b = { p2.x - p0.x, p2.y - p0.y, p2.z - p0.z };
+			vec3 c = { a.y * b.z - b.y * a.z, a.z * b.x - b.z * a.x, a.x * b.y - b.x * a.y };
+			float length = std::sqrt(c.x * c.x + c.y * c.y + c.z * c.z);
+			n = length == 0.0f ? vec3{ 0.0f, 0.0f, 0.0f } : vec3{ c.x / length, c.y / length, c.z / length };
+		}
+
+		block->normal[0][facet] = n.x;
+		block->normal[1][facet] = n.y;
+		block->normal[2][facet] = n.z;
+		const vec3* positions[3] = { &p0, &p1, &p2 };
+		for (int v = 0; v < 3; v++) {
+			block->pos[v][0][facet] = positions[v]->x;
+			block->pos[v][1][facet] = positions[v]->y;
+			block->pos[v][2][facet] = positions[v]->z;
+			block->hash[v][facet]   = hashVertex(Vertex(*positions[v], n));
+		}
+
+	}
+
+}
+
+void mload::dedupStlBlock(const StlFacetBlock& block, size_t count, Map<Vertex, uint32_t>& uniqueVertices, std::vector<Vertex>* vertexBuff, std::vector<uint32_t>* indexBuff) {
+
+	// Start fetching every bucket of the block before the first lookup waits on one
+	for (size_t facet = 0; facet < count; facet++) {
+		for (size_t vertex = 0; vertex < 3; vertex++) uniqueVertices.prefetch(block.hash[vertex][facet]);
+	}
+
+	for (size_t facet = 0; facet < count; facet++) {
+		for (size_t vertex = 0; vertex < 3; vertex++) {
+			Vertex v = block.vertex(vertex, facet);
+			bool keyExists;
+			uint32_t* pIndex = uniqueVertices.getKeyValueHashed(v, block.hash[vertex][facet], &keyExists);
+			if (!keyExists) {
+				*pIndex = (uint32_t)vertexBuff->size();
+				vertexBuff->push_back(v);
+			}
+			indexBuff->push_back(*pIndex);
+		}
+	}
+
+}
+
+mload::StlColorFormat mload::stlColorFormat(const char* data, size_t size, uint32_t* defaultColor) {
+
+	*defaultColor = 0xFFFFFFFFu;
+	if (size < c_StlHeaderSize) return STL_COLOR_NONE;
+
+	// Magics names the default color in the comment, its facets are colored unless they set bit 15
+	const char c_ColorMarker[] = "COLOR=";
+	const size_t markerSize = sizeof(c_ColorMarker) - 1;
+	for (size_t i = 0; i + markerSize + 4 <= 80; i++) {
+		if (memcmp(&data[i], c_ColorMarker, markerSize) == 0) {
+			memcpy(defaultColor, &data[i + markerSize], sizeof(*defaultColor));
+			return STL_COLOR_MATERIALISE;
+		}
+	}
+
+	// Without the marker, exporters that don't write colors leave the attribute zero
+	if (size < c_StlHeaderSize + c_StlFacetSize) return STL_COLOR_NONE;
+	uint16_t attribute;
+	memcpy(&attribute, &data[c_StlHeaderSize + c_StlFacetSize - sizeof(attribute)], sizeof(attribute));
+	return (attribute & 0x8000) != 0 ? STL_COLOR_VISCAM : STL_COLOR_NONE;
+
+}
+
+void mload::dedupStlBlockColored(const StlFacetBlock& block, const char* pFacets, size_t count, StlColorFormat format, uint32_t defaultColor, Map<ColoredVertex, uint32_t>& uniqueVertices, std::vector<Vertex>* vertexBuff, std::vector<uint32_t>* indexBuff, std::vector<uint32_t>* colors) {
+
+	for (size_t facet = 0; facet < count; facet++) {
+		uint16_t attribute;
+		memcpy(&attribute, pFacets + (facet + 1) * c_StlFacetSize - sizeof(attribute), sizeof(attribute));
+		uint32_t color = stlFacetColor(attribute, format, defaultColor);
+		for (size_t vertex = 0; vertex < 3; vertex++) {
+			ColoredVertex v{ block.vertex(vertex, facet), color };
+			bool keyExists;
+			uint32_t* pIndex = uniqueVertices.getKeyValueHashed(v, block.hash[vertex][facet] ^ (color * c_HashMultiplier), &keyExists);
+			if (!keyExists) {
+				*pIndex = (uint32_t)vertexBuff->size();
+				vertexBuff->push_back(v.vertex);
+				colors->push_back(color);
+			}
+			indexBuff->push_back(*pIndex);
+		}
+	}
+
+}
+
+void mload::dedupStlFacetsParallel(WorkerPool& pool, const char* pFacets, size_t facetCount, std::vector<Vertex>* vertexBuff, std::vector<uint32_t>* indexBuff) {
+
+	const size_t cornerCount = 3 * facetCount;
+	assert(cornerCount < UINT32_MAX - 1 && "Corner indices are the source indices of the map");
+
+	// Every phase walks the same ranges of whole decode blocks
+	const size_t blockCount     = (facetCount + c_StlDecodeBlock - 1) / c_StlDecodeBlock;
+	const size_t rangeCount     = std::min(blockCount, (size_t)8 * (pool.threadCount() + 1));
+	const size_t blocksPerRange = (blockCount + rangeCount - 1) / rangeCount;
+	auto forEachBlock = [&](size_t range, auto&& func) {
+		size_t endBlock = std::min(blockCount, (range + 1) * blocksPerRange);
+		for (size_t b = range * blocksPerRange; b < endBlock; b++) {
+			size_t firstFacet = b * c_StlDecodeBlock;
+			func(firstFacet, std::min(c_StlDecodeBlock, facetCount - firstFacet));
+		}
+	};
+
+	ConcurrentMap<Vertex> uniqueVertices(cornerCount);
+	indexBuff->resize(cornerCount);
+	uint32_t* cornerSlots = indexBuff->data();
+
+	// Insert every corner with its position in the file as the source index
+	parallelFor(pool, rangeCount, 1, [&](size_t begin, size_t end) {
+		StlFacetBlock block;
+		for (size_t range = begin; range < end; range++) {
+			forEachBlock(range, [&](size_t firstFacet, size_t count) {
+				decodeStlFacets(pFacets + firstFacet * c_StlFacetSize, count, &block);
+				for (size_t facet = 0; facet < count; facet++) {
+					for (size_t vertex = 0; vertex < 3; vertex++) uniqueVertices.prefetch(block.hash[vertex][facet]);
+				}
+				for (size_t facet = 0; facet < count; facet++) {
+					for (size_t vertex = 0; vertex < 3; vertex++) {
+						uint32_t corner = (uint32_t)(3 * (firstFacet + facet) + vertex);
+						cornerSlots[corner] = uniqueVertices.insert(block.vertex(vertex, facet), block.hash[vertex][facet], corner);
+					}
+				}
+			});
+		}
+	});
+
+	// A corner holding the smallest source index of its vertex is where the sequential loader would have added the vertex. 
+	// Those corners are flagged in the top bit of their slot, and counting them per range gives every range the index its first new vertex gets. 
+	constexpr uint32_t c_FirstCornerBit = 1u << 31;
+	assert(uniqueVertices.slotCount() <= c_FirstCornerBit);
+	std::vector<size_t> rangeBase(rangeCount + 1, 0);
+	parallelFor(pool, rangeCount, 1, [&](size_t begin, size_t end) {
+		for (size_t range = begin; range < end; range++) {
+			size_t firstCount = 0;
+			forEachBlock(range, [&](size_t firstFacet, size_t count) {
+				for (size_t corner = 3 * firstFacet; corner < 3 * (firstFacet + count); corner++) {
+					if (uniqueVertices.firstSource(cornerSlots[corner]) != corner) continue;
+					cornerSlots[corner] |= c_FirstCornerBit;
+					firstCount++;
+				}
+			});
+			rangeBase[range + 1] = firstCount;
+		}
+	});
+	for (size_t range = 0; range < rangeCount; range++) rangeBase[range + 1] += rangeBase[range];
+
+	// Number the vertices in order of first occurrence. The vertex is decoded again from its first corner
+	// so it has the exact bits the sequential loader would have kept (0.0f and -0.0f are the same key). 
+	vertexBuff->resize(rangeBase[rangeCount]);
+	std::unique_ptr<uint32_t[]> slotIndices(new uint32_t[uniqueVertices.slotCount()]);
+	parallelFor(pool, rangeCount, 1, [&](size_t begin, size_t end) {
+		StlFacetBlock block;
+		for (size_t range = begin; range < end; range++) {
+			size_t index = rangeBase[range];
+			forEachBlock(range, [&](size_t firstFacet, size_t count) {
+				bool decoded = false;
+				for (size_t corner = 3 * firstFacet; corner < 3 * (firstFacet + count); corner++) {
+					if (!(cornerSlots[corner] & c_FirstCornerBit)) continue;
+					if (!decoded) decodeStlFacets(pFacets + firstFacet * c_StlFacetSize, count, &block);
+					decoded = true;
+					uint32_t slot = cornerSlots[corner] & ~c_FirstCornerBit;
+					size_t   facet = corner / 3 - firstFacet;
+					slotIndices[slot] = (uint32_t)index;
+					(*vertexBuff)[index] = block.vertex(corner % 3, facet);
+					cornerSlots[corner] = slot;
+					index++;
+				}
+			});
+		}
+	});
+
+	parallelFor(pool, cornerCount, 1 << 16, [&](size_t begin, size_t end) {
+		for (size_t corner = begin; corner < end; corner++) cornerSlots[corner] = slotIndices[cornerSlots[corner]];
+	});
+
+}
+
+/// Tested on the bits, f != f may be folded to false with floatingpoint "Fast". 
+static bool isNan(float f) {
+	uint32_t bits;
+	memcpy(&bits, &f, sizeof(bits));
+	return (bits & 0x7FFFFFFF) > 0x7F800000; // all exponent bits and a nonzero mantissa
+}
+/// Compares a block of both kernels, see decodeStlFacetsScalar for what has to match. 
+static bool blocksMatch(const mload::StlFacetBlock& a, const mload::StlFacetBlock& b) {
+
+	if (memcmp(a.pos, b.pos, sizeof(a.pos)) != 0) return false;
+
+	for (size_t facet = 0; facet < mload::c_StlDecodeBlock; facet++) {
+
+		bool normalBitsEqual = true, hasNan = false;
+		for (int c = 0; c < 3; c++) {
+			float na = a.normal[c][facet], nb = b.normal[c][facet];
+			if (isNan(na) || isNan(nb)) {
+				if (isNan(na) != isNan(nb)) return false;
+				hasNan = true;
+				continue;
+			}
+			if (std::fabs(na - nb) > 1e-5f) return false;
+			normalBitsEqual &= memcmp(&na, &nb, sizeof(float)) == 0;
+		}
+
+		// NaN vertices never compare equal, so their hash doesn't matter to the dedup
+		for (int v = 0; v < 3; v++) {
+			for (int c = 0; c < 3; c++) hasNan |= isNan(a.pos[v][c][facet]);
+			if (normalBitsEqual && !hasNan && a.hash[v][facet] != b.hash[v][facet]) return false;
+		}
+
+	}
+	return true;
+
+}
+size_t mload::fuzzStlDecode(uint32_t seed, size_t facetCount) {
+
+	// xorshift32, deterministic for a seed on every platform
+	uint32_t state = seed != 0 ? seed : 1;
+	auto next = [&state]() { state ^= state << 13; state ^= state >> 17; state ^= state << 5; return state; };
+
+	const float edgeCases[] = { 0.0f, -0.0f, 1.0f, -1.0f, NAN, INFINITY, -INFINITY, 1e-40f, -1e-40f, 3.4e38f, 0.57735026f, 0.99f };
+
+	std::vector<char> facets((facetCount + c_StlDecodeBlock) * c_StlFacetSize);
+	for (size_t i = 0; i < facets.size() / sizeof(float); i++) {
+		float value;
+		switch (next() % 4) {
+		case 0:  value = edgeCases[next() % (sizeof(edgeCases) / sizeof(edgeCases[0]))]; break;
+		case 1:  { uint32_t u = next(); memcpy(&value, &u, sizeof(value)); } break; // any bit pattern
+		default: value = (float)(int32_t)next() / (float)INT32_MAX * 100.0f; break;
+		}
+		memcpy(&facets[i * sizeof(float)], &value, sizeof(value));
+	}
+	// Some facets with a valid normal and shared vertices so both branches of the normal repair run
+	for (size_t facet = 0; facet + 1 < facetCount; facet += 3) {
+		float* f = (float*)&facets[facet * c_StlFacetSize];
+		f[0] = 0.0f; f[1] = 0.0f; f[2] = 1.0f;
+		memcpy(&facets[(facet + 1) * c_StlFacetSize + 12], &f[3], 3 * sizeof(float));
+	}
+
+	size_t mismatches = 0;
+	for (size_t first = 0; first < facetCount; first += c_StlDecodeBlock) {
+		size_t count = facetCount - first < c_StlDecodeBlock ? facetCount - first : c_StlDecodeBlock;
+		StlFacetBlock simdBlock, scalarBlock;
+		decodeStlFacets      (&facets[first * c_StlFacetSize], count, &simdBlock);
+		decodeStlFacetsScalar(&facets[first * c_StlFacetSize], count, &scalarBlock);
+		if (!blocksMatch(simdBlock, scalarBlock)) mismatches++;
+	}
+	return mismatches;
+
+}
@@ -0,0 +1,91 @@
+#pragma once
+
+#include "VertexMap.hpp"
+#include "WorkerPool.hpp"
+
+#include <cstring>
+
+namespace mload {
+
+	constexpr size_t c_StlHeaderSize  = 84; // 80 byte comment + uint32_t facet count
+	constexpr size_t c_StlFacetSize   = 50; // normal, 3 positions and a uint16_t attribute
+	/// ASCII STLs start with "solid", but so do the comments of some binary ones. A file whose size matches its facet count is binary either way. 
+	inline bool stlIsBinary(const char* header, size_t headerSize, uint64_t fileSize) {
+		if (headerSize < c_StlHeaderSize) return headerSize < 5 || memcmp(header, "solid", 5) != 0;
+		uint32_t facetCount;
+		memcpy(&facetCount, &header[80], sizeof(facetCount));
+		return memcmp(header, "solid", 5) != 0 || fileSize == c_StlHeaderSize + (uint64_t)c_StlFacetSize * facetCount;
+	}
+
+	/// Facet count in the header of a binary STL. @return false if the file is shorter than the facets it claims
+	inline bool stlFacetCount(const char* header, uint64_t fileSize, uint32_t* facetCount) {
+		memcpy(facetCount, &header[80], sizeof(*facetCount));
+		return fileSize >= c_StlHeaderSize + (uint64_t)c_StlFacetSize * *facetCount;
+	}
+
+	/// Facets decoded by one decodeStlFacets call.
+	constexpr size_t c_StlDecodeBlock = 8;
+
+	/// A block of binary STL facets transposed to one lane per facet.
+	struct StlFacetBlock {
+
+		float    normal[3][c_StlDecodeBlock];      // [component][facet], repaired if the file normal isn't unit length
+		float    pos[3][3][c_StlDecodeBlock];      // [vertex][component][facet]
+		uint32_t hash[3][c_StlDecodeBlock];        // [vertex][facet], hashVertex of the vertex with the facet normal
+
+		Vertex vertex(size_t vertexIndex, size_t facet) const {
+			return Vertex(
+				{ pos[vertexIndex][0][facet], pos[vertexIndex][1][facet], pos[vertexIndex][2][facet] },
+				{ normal[0][facet], normal[1][facet], normal[2][facet] }
+			);
+		}
+
+	};
+
+	/// Decodes count (at most c_StlDecodeBlock) facets starting at pFacets with the widest SIMD the build targets. Lanes past count are zero facets.
+	void decodeStlFacets(const char* pFacets, size_t count, StlFacetBlock* block);
+	/// Reference implementation of decodeStlFacets. Positions and hashes must match it exactly, repaired normals within rounding
+	/// since the app builds with fast floating point math.
+	void decodeStlFacetsScalar(const char* pFacets, size_t count, StlFacetBlock* block);
+
+	/// Adds the first count vertices of a decoded block to the map and the buffers, in file order. 
+	void dedupStlBlock(const StlFacetBlock& block, size_t count, Map<Vertex, uint32_t>& uniqueVertices, std::vector<Vertex>* vertexBuff, std::vector<uint32_t>* indexBuff);
+	/// Decodes and dedups facetCount facets on the threads of pool. The buffers are identical to calling dedupStlBlock on every block in order. 
+	void dedupStlFacetsParallel(WorkerPool& pool, const char* pFacets, size_t facetCount, std::vector<Vertex>* vertexBuff, std::vector<uint32_t>* indexBuff);
+
+	/// Which convention the uint16_t facet attributes follow. Files of neither keep it zero and have no colors. 
+	enum StlColorFormat {
+		STL_COLOR_NONE = 0,
+		STL_COLOR_VISCAM,      // VisCAM/SolidView: bit 15 set on colored facets, red in bits 10-14, green 5-9, blue 0-4
+		STL_COLOR_MATERIALISE, // Materialise Magics: "COLOR=" and a default RGBA in the header, bit 15 clear on colored facets, blue in bits 10-14, green 5-9, red 0-4
+	};
+	/// Decides once per file whether the facet attributes are colors. 
+	/// @param data         the header followed by the first facet if the file has one
+	/// @param defaultColor RGBA8 of facets without a color of their own
+	StlColorFormat stlColorFormat(const char* data, size_t size, uint32_t* defaultColor);
+	/// RGBA8 (red in the low byte) of a facet attribute, 5 bit channels are widened by repeating their top bits. 
+	inline uint32_t stlFacetColor(uint16_t attribute, StlColorFormat format, uint32_t defaultColor) {
+		bool hasColor = format == STL_COLOR_VISCAM ? (attribute & 0x8000) != 0 : (attribute & 0x8000) == 0;
+		if (!hasColor) return defaultColor;
+		uint32_t low = attribute & 0x1F, mid = (attribute >> 5) & 0x1F, high = (attribute >> 10) & 0x1F;
+		uint32_t r = format == STL_COLOR_VISCAM ? high : low;
+		uint32_t b = format == STL_COLOR_VISCAM ? low : high;
+		auto widen = [](uint32_t c) { return (c << 3) | (c >> 2); };
+		return widen(r) | widen(mid) << 8 | widen(b) << 16 | 0xFF000000u;
+	}
+
+	/// Vertex of a colored mesh. Faces of different colors don't share vertices. 
+	struct ColoredVertex {
+		Vertex   vertex;
+		uint32_t color;
+		bool operator==(const ColoredVertex& other) const { return vertex == other.vertex && color == other.color; }
+	};
+	/// dedupStlBlock for files with colors, the attributes of the block's facets are read from pFacets. 
+	/// @param colors gets one RGBA8 per vertex
+	void dedupStlBlockColored(const StlFacetBlock& block, const char* pFacets, size_t count, StlColorFormat format, uint32_t defaultColor, Map<ColoredVertex, uint32_t>& uniqueVertices, std::vector<Vertex>* vertexBuff, std::vector<uint32_t>* indexBuff, std::vector<uint32_t>* colors);
+
+	/// Runs both kernels on facetCount random facets mixed with edge cases (-0, NaN, inf, denormals, zero and non unit normals).
+	/// Run by SimpleViewer3Dtests, not by the loaders. @return number of blocks where the kernels disagree
+	size_t fuzzStlDecode(uint32_t seed, size_t facetCount);
+
+}
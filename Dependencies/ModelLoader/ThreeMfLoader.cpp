@@ -0,0 +1,581 @@
+#include "ThreeMfLoader.hpp"
+
+#include <zip.h>
+
+#include <cstring>
+#include <cstdlib>
+#include <memory>
+#include <string>
+#include <algorithm>
+#include <unordered_map>
+
+#include <glm/glm.hpp>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define XML_SCAN_SSE2
+#include <emmintrin.h>
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+#endif
+
+/// Longest tag carried over a chunk boundary, longer ones are skipped. Mesh tags are well under 200 bytes.
+constexpr size_t c_XmlMaxTagSize = 4096;
+/// Attributes read from one tag, later ones are ignored.
+constexpr size_t c_XmlMaxAttributes = 16;
+/// Quotes located per tag, with room for apostrophes inside values.
+constexpr size_t c_XmlMaxQuotes = 4 * c_XmlMaxAttributes;
+
+/// Component nesting followed from a build item.
+constexpr int    c_ThreeMfMaxComponentDepth = 32;
+/// Bounds what a package of objects that each reference the next one several times can expand to.
+constexpr size_t c_ThreeMfMaxInstances = 1 << 20;
+/// Inflated bytes between progress reports.
+constexpr uint64_t c_ThreeMfProgressInterval = 1 << 20;
+/// Longest model part path read from the relationships.
+constexpr size_t c_ThreeMfMaxPathSize = 512;
+
+constexpr char c_ThreeMfRelationships[] = "_rels/.rels";
+constexpr char c_ThreeMfDefaultModel[]  = "3D/3dmodel.model";
+constexpr char c_ThreeMfModelType[]     = "/3dmodel"; // suffix of the relationship type of the model part
+
+/// Powers of ten that are exact in a double, for the fast path of parseFloat.
+static const double c_ExactPow10[] = {
+	1e0,  1e1,  1e2,  1e3,  1e4,  1e5,  1e6,  1e7,  1e8,  1e9,  1e10, 1e11,
+	1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22,
+};
+
+inline bool charIsDigit(char c) { return c >= '0' && c <= '9'; }
+inline bool charIsSpace(char c) { return c == ' ' || c == '\t' || c == '\n' || c == '\r'; }
+
+static void trimSpaces(const char** begin, const char** end) {
+	for (; *begin < *end && charIsSpace(**begin); (*begin)++) {}
+	for (; *end > *begin && charIsSpace((*end)[-1]); (*end)--) {}
+}
+
+/// Parses a decimal number. Up to 19 digits with an exponent within the exact powers of ten take the Clinger fast path
+/// (one exactly rounded multiply or divide), which covers everything slicers write, the rest goes through strtod.
+static bool parseFloat(const char* c, const char* end, float* value) {
+
+	trimSpaces(&c, &end);
+	const char* start = c;
+
+	bool negative = false;
+	if (c < end && (*c == '-' || *c == '+')) negative = *c++ == '-';
+
+	uint64_t mantissa = 0;
+	int      digits   = 0;
+	int      exponent = 0;
+	for (; c < end && charIsDigit(*c); c++, digits++) {
+		if (digits < 19) mantissa = 10 * mantissa + (uint64_t)(*c - '0');
+	}
+	if (c < end && *c == '.') {
+		for (c++; c < end && charIsDigit(*c); c++, digits++) {
+			if (digits < 19) mantissa = 10 * mantissa + (uint64_t)(*c - '0');
+			exponent--;
+		}
+	}
+	if (digits == 0) return false;
+	if (c < end && (*c == 'e' || *c == 'E')) {
+		c++;
+		bool negativeExponent = false;
+		if (c < end && (*c == '-' || *c == '+')) negativeExponent = *c++ == '-';
+		if (c == end || !charIsDigit(*c)) return false;
+		int fileExponent = 0;
+		for (; c < end && charIsDigit(*c); c++) fileExponent = std::min(10 * fileExponent + (*c - '0'), 9999);
+		exponent += negativeExponent ? -fileExponent : fileExponent;
+	}
+	if (c != end) return false;
+
+	if (digits <= 19 && mantissa <= (1ull << 53) && exponent >= -22 && exponent <= 22) {
+		double result = (double)mantissa;
+		result = exponent < 0 ? result / c_ExactPow10[-exponent] : result * c_ExactPow10[exponent];
+		*value = (float)(negative ? -result : result);
+		return true;
+	}
+
+	char text[64];
+	size_t length = (size_t)(end - start);
+	if (length >= sizeof(text)) return false;
+	memcpy(text, start, length);
+	text[length] = '\0';
+	char* textEnd;
+	*value = (float)strtod(text, &textEnd);
+	return textEnd == text + length;
+
+}
+static bool parseUint(const char* c, const char* end, uint32_t* value) {
+	trimSpaces(&c, &end);
+	if (c == end) return false;
+	uint64_t result = 0;
+	for (; c < end; c++) {
+		if (!charIsDigit(*c)) return false;
+		result = 10 * result + (uint64_t)(*c - '0');
+		if (result > UINT32_MAX) return false;
+	}
+	*value = (uint32_t)result;
+	return true;
+}
+/// Reads the 12 numbers of a 3MF transform, rows of a 4x3 matrix applied to row vectors, translation last.
+static bool parseTransform(const char* c, const char* end, glm::mat4* transform) {
+	float values[12];
+	for (int i = 0; i < 12; i++) {
+		for (; c < end && charIsSpace(*c); c++) {}
+		const char* number = c;
+		for (; c < end && !charIsSpace(*c); c++) {}
+		if (!parseFloat(number, c, &values[i])) return false;
+	}
+	// Row i of the 3MF matrix is column i of the column vector matrix
+	*transform = glm::mat4(1.0f);
+	for (int column = 0; column < 4; column++) {
+		for (int row = 0; row < 3; row++) (*transform)[column][row] = values[3 * column + row];
+	}
+	return true;
+}
+
+namespace {
+
+	struct XmlAttribute {
+
+		const char* name;        // local name, without a namespace prefix
+		size_t      nameLength;
+		const char* value;       // between the quotes, entities are not decoded
+		const char* valueEnd;
+
+	};
+
+	/// A tag found by XmlTagScanner, valid during the callback only.
+	struct XmlTag {
+
+		const char*  name;       // local name, without a namespace prefix
+		size_t       nameLength;
+		bool         isEnd;      // </name>
+		bool         isEmpty;    // <name/>
+		XmlAttribute attributes[c_XmlMaxAttributes];
+		size_t       attributeCount;
+
+		bool is(const char* localName) const { return strlen(localName) == nameLength && memcmp(name, localName, nameLength) == 0; }
+		const XmlAttribute* attribute(const char* localName) const {
+			size_t length = strlen(localName);
+			for (size_t i = 0; i < attributeCount; i++) {
+				if (attributes[i].nameLength == length && memcmp(attributes[i].name, localName, length) == 0) return &attributes[i];
+			}
+			return nullptr;
+		}
+		bool readFloat(const char* localName, float* value) const {
+			const XmlAttribute* attr = attribute(localName);
+			return attr != nullptr && parseFloat(attr->value, attr->valueEnd, value);
+		}
+		bool readUint(const char* localName, uint32_t* value) const {
+			const XmlAttribute* attr = attribute(localName);
+			return attr != nullptr && parseUint(attr->value, attr->valueEnd, value);
+		}
+
+	};
+
+	static void skipPrefix(const char** name, size_t* length) {
+		const char* colon = (const char*)memchr(*name, ':', *length);
+		if (colon == nullptr) return;
+		*length -= (size_t)(colon + 1 - *name);
+		*name    = colon + 1;
+	}
+
+	/// Offsets of the quote characters in [begin, end), 16 bytes per compare.
+	static size_t findQuotes(const char* begin, const char* end, uint32_t* offsets) {
+		size_t count = 0;
+		const char* c = begin;
+#ifdef XML_SCAN_SSE2
+		const __m128i doubleQuote = _mm_set1_epi8('"');
+		const __m128i singleQuote = _mm_set1_epi8('\'');
+		for (; end - c >= 16; c += 16) {
+			__m128i bytes = _mm_loadu_si128((const __m128i*)c);
+			uint32_t mask = (uint32_t)_mm_movemask_epi8(_mm_or_si128(_mm_cmpeq_epi8(bytes, doubleQuote), _mm_cmpeq_epi8(bytes, singleQuote)));
+			for (; mask != 0; mask &= mask - 1) {
+				if (count == c_XmlMaxQuotes) return count;
+#ifdef _MSC_VER
+				unsigned long bit;
+				_BitScanForward(&bit, mask);
+#else
+				uint32_t bit = (uint32_t)__builtin_ctz(mask);
+#endif
+				offsets[count++] = (uint32_t)(c - begin) + (uint32_t)bit;
+			}
+		}
+#endif
+		for (; c < end && count < c_XmlMaxQuotes; c++) {
+			if (*c == '"' || *c == '\'') offsets[count++] = (uint32_t)(c - begin);
+		}
+		return count;
+	}
+	/// Splits name="value" pairs at the quotes, a value ends at the next quote of the kind that opened it.
+	static void readAttributes(const char* begin, const char* end, XmlTag* tag) {
+
+		uint32_t quotes[c_XmlMaxQuotes];
+		size_t quoteCount = findQuotes(begin, end, quotes);
+
+		const char* previousEnd = begin;
+		for (size_t open = 0; open < quoteCount && tag->attributeCount < c_XmlMaxAttributes;) {
+
+			char quote = begin[quotes[open]];
+			size_t close = open + 1;
+			for (; close < quoteCount && begin[quotes[close]] != quote; close++) {}
+			if (close == quoteCount) return;
+
+			const char* nameEnd = &begin[quotes[open]];
+			for (; nameEnd > previousEnd && (charIsSpace(nameEnd[-1]) || nameEnd[-1] == '='); nameEnd--) {}
+			const char* name = nameEnd;
+			for (; name > previousEnd && !charIsSpace(name[-1]); name--) {}
+
+			XmlAttribute& attribute = tag->attributes[tag->attributeCount++];
+			attribute.name       = name;
+			attribute.nameLength = (size_t)(nameEnd - name);
+			attribute.value      = &begin[quotes[open] + 1];
+			attribute.valueEnd   = &begin[quotes[close]];
+			skipPrefix(&attribute.name, &attribute.nameLength);
+
+			previousEnd = attribute.valueEnd + 1;
+			open = close + 1;
+
+		}
+
+	}
+
+	/// Finds the tags in XML handed over in arbitrary chunks, without allocating. Text between tags is skipped.
+	/// A tag split between two chunks is carried over in a fixed buffer, declarations, comments and overlong tags are dropped.
+	template<typename Handler>
+	class XmlTagScanner {
+	public:
+
+		explicit XmlTagScanner(Handler* handler) : m_handler(handler) {}
+
+		void feed(const char* data, size_t size) {
+
+			const char* c   = data;
+			const char* end = data + size;
+
+			if (m_inTag) {
+				const char* close = (const char*)memchr(c, '>', (size_t)(end - c));
+				carry(c, close != nullptr ? close : end);
+				if (close == nullptr) return;
+				if (m_carrySize <= c_XmlMaxTagSize) tag(m_carry, m_carry + m_carrySize);
+				m_inTag     = false;
+				m_carrySize = 0;
+				c = close + 1;
+			}
+
+			for (;;) {
+				const char* open = (const char*)memchr(c, '<', (size_t)(end - c));
+				if (open == nullptr) return;
+				const char* close = (const char*)memchr(open + 1, '>', (size_t)(end - open - 1));
+				if (close == nullptr) {
+					m_inTag = true;
+					carry(open + 1, end);
+					return;
+				}
+				tag(open + 1, close);
+				c = close + 1;
+			}
+
+		}
+		/// True if the data ended inside a tag.
+		bool inTag() const { return m_inTag; }
+
+	private:
+
+		Handler* m_handler;
+		bool     m_inTag     = false;
+		size_t   m_carrySize = 0;   // over c_XmlMaxTagSize once the tag is too long to keep
+		char     m_carry[c_XmlMaxTagSize];
+
+		void carry(const char* begin, const char* end) {
+			size_t size = (size_t)(end - begin);
+			if (m_carrySize + size <= c_XmlMaxTagSize) memcpy(&m_carry[m_carrySize], begin, size);
+			m_carrySize = std::min(m_carrySize + size, c_XmlMaxTagSize + 1);
+		}
+		/// @param begin after the '<'
+		/// @param end   at the '>'
+		void tag(const char* begin, const char* end) {
+
+			if (begin == end || *begin == '?' || *begin == '!') return;
+
+			XmlTag tag;
+			tag.isEnd = *begin == '/';
+			if (tag.isEnd) begin++;
+			tag.isEmpty = end > begin && end[-1] == '/';
+			if (tag.isEmpty) end--;
+
+			const char* nameEnd = begin;
+			for (; nameEnd < end && !charIsSpace(*nameEnd); nameEnd++) {}
+			tag.name       = begin;
+			tag.nameLength = (size_t)(nameEnd - begin);
+			skipPrefix(&tag.name, &tag.nameLength);
+
+			tag.attributeCount = 0;
+			if (!tag.isEnd) readAttributes(nameEnd, end, &tag);
+			m_handler->tag(tag);
+
+		}
+
+	};
+
+	/// Finds the model part in _rels/.rels.
+	struct ThreeMfRelationships {
+
+		char modelPath[c_ThreeMfMaxPathSize] = {};
+
+		void tag(const XmlTag& tag) {
+			if (tag.isEnd || modelPath[0] != '\0' || !tag.is("Relationship")) return;
+			const XmlAttribute* type   = tag.attribute("Type");
+			const XmlAttribute* target = tag.attribute("Target");
+			if (type == nullptr || target == nullptr) return;
+			size_t typeLength = (size_t)(type->valueEnd - type->value);
+			size_t suffixLength = sizeof(c_ThreeMfModelType) - 1;
+			if (typeLength < suffixLength || memcmp(type->valueEnd - suffixLength, c_ThreeMfModelType, suffixLength) != 0) return;
+
+			// Targets are absolute part names, zip entries have no leading slash
+			const char* path = target->value;
+			if (path < target->valueEnd && *path == '/') path++;
+			size_t pathLength = (size_t)(target->valueEnd - path);
+			if (pathLength == 0 || pathLength >= c_ThreeMfMaxPathSize) return;
+			memcpy(modelPath, path, pathLength);
+			modelPath[pathLength] = '\0';
+		}
+
+	};
+
+	/// Builds the buffers from the tags of the model part, or only counts the vertices and triangles if the buffers are nullptr.
+	class ThreeMfModelReader {
+	public:
+
+		uint64_t vertexCount   = 0;
+		uint64_t triangleCount = 0;
+
+		ThreeMfModelReader(std::vector<mload::Vertex>* vertexBuff, std::vector<uint32_t>* indexBuff, std::vector<mload::ModelPart>* parts)
+			: m_vertexBuff(vertexBuff), m_indexBuff(indexBuff), m_parts(parts) {}
+
+		bool inMesh() const { return m_inMesh; }
+
+		void tag(const XmlTag& tag) {
+
+			if (tag.is("vertex")) {
+				if (!m_inMesh || tag.isEnd) return;
+				vertexCount++;
+				if (m_vertexBuff == nullptr) return;
+				mload::vec3 pos{};
+				tag.readFloat("x", &pos.x);
+				tag.readFloat("y", &pos.y);
+				tag.readFloat("z", &pos.z);
+				m_vertexBuff->emplace_back(pos, mload::vec3{});
+			}
+			else if (tag.is("triangle")) {
+				if (!m_inMesh || tag.isEnd) return;
+				triangleCount++;
+				if (m_indexBuff == nullptr) return;
+				uint32_t v[3];
+				uint32_t meshVertexCount = (uint32_t)m_vertexBuff->size() - m_firstVertex;
+				if (!tag.readUint("v1", &v[0]) || !tag.readUint("v2", &v[1]) || !tag.readUint("v3", &v[2])) return;
+				if (v[0] >= meshVertexCount || v[1] >= meshVertexCount || v[2] >= meshVertexCount) return;
+				for (uint32_t index : v) m_indexBuff->push_back(m_firstVertex + index);
+			}
+			else if (tag.is("object")) {
+				if (tag.isEnd) { m_object = nullptr; return; }
+				uint32_t id;
+				if (!tag.readUint("id", &id) || tag.isEmpty) return;
+				m_object = &m_objects[id];
+				const XmlAttribute* name = tag.attribute("name");
+				if (name != nullptr) m_objectName.assign(name->value, name->valueEnd);
+				else                 m_objectName = "object " + std::to_string(id);
+			}
+			else if (tag.is("mesh")) {
+				if (m_object == nullptr) return;
+				if (!tag.isEnd) {
+					m_inMesh = !tag.isEmpty;
+					if (m_vertexBuff != nullptr) {
+						m_firstVertex = (uint32_t)m_vertexBuff->size();
+						m_firstIndex  = (uint32_t)m_indexBuff->size();
+					}
+					return;
+				}
+				m_inMesh = false;
+				if (m_parts == nullptr || m_indexBuff->size() == m_firstIndex) return;
+				m_object->part = (int32_t)m_parts->size();
+				mload::ModelPart part{};
+				part.firstIndex = m_firstIndex;
+				part.indexCount = (uint32_t)m_indexBuff->size() - m_firstIndex;
+				part.name       = m_objectName;
+				m_parts->push_back(std::move(part));
+			}
+			else if (tag.is("component")) {
+				// Components in other model parts (production extension) are not followed
+				if (m_object == nullptr || tag.isEnd || tag.attribute("path") != nullptr) return;
+				Reference component;
+				if (readReference(tag, &component)) m_object->components.push_back(component);
+			}
+			else if (tag.is("build")) {
+				m_inBuild = !tag.isEnd && !tag.isEmpty;
+			}
+			else if (tag.is("item")) {
+				if (!m_inBuild || tag.isEnd || tag.attribute("path") != nullptr) return;
+				Reference item;
+				if (readReference(tag, &item)) m_buildItems.push_back(item);
+			}
+
+		}
+
+		/// Resolves the build items to instances of the mesh objects, through their components.
+		void buildInstances(std::vector<mload::ModelInstance>* instances) {
+			instances->clear();
+			for (const Reference& item : m_buildItems) addInstances(item.objectId, item.transform, 0, instances);
+		}
+
+	private:
+
+		/// A build item or component, an object placed with a transform.
+		struct Reference {
+
+			uint32_t  objectId;
+			glm::mat4 transform;
+
+		};
+		struct Object {
+
+			int32_t                part      = -1; // index into the parts, -1 without a mesh
+			bool                   expanding = false;
+			std::vector<Reference> components;
+
+		};
+
+		std::vector<mload::Vertex>*    m_vertexBuff;
+		std::vector<uint32_t>*         m_indexBuff;
+		std::vector<mload::ModelPart>* m_parts;
+
+		std::unordered_map<uint32_t, Object> m_objects;
+		std::vector<Reference>               m_buildItems;
+		Object*                              m_object = nullptr; // between <object> and </object>
+		std::string                          m_objectName;
+		bool                                 m_inMesh  = false;
+		bool                                 m_inBuild = false;
+		uint32_t                             m_firstVertex = 0;
+		uint32_t                             m_firstIndex  = 0;
+
+		static bool readReference(const XmlTag& tag, Reference* reference) {
+			if (!tag.readUint("objectid", &reference->objectId)) return false;
+			const XmlAttribute* transform = tag.attribute("transform");
+			if (transform == nullptr) reference->transform = glm::mat4(1.0f);
+			else if (!parseTransform(transform->value, transform->valueEnd, &reference->transform)) return false;
+			return true;
+		}
+		void addInstances(uint32_t objectId, const glm::mat4& transform, int depth, std::vector<mload::ModelInstance>* instances) {
+			auto object = m_objects.find(objectId);
+			if (object == m_objects.end() || object->second.expanding || depth > c_ThreeMfMaxComponentDepth) return;
+			if (object->second.part >= 0 && instances->size() < c_ThreeMfMaxInstances) {
+				mload::ModelInstance instance;
+				instance.part = (uint32_t)object->second.part;
+				memcpy(instance.transform, &transform[0][0], sizeof(instance.transform));
+				instances->push_back(instance);
+			}
+			object->second.expanding = true;
+			for (const Reference& component : object->second.components) addInstances(component.objectId, transform * component.transform, depth + 1, instances);
+			object->second.expanding = false;
+		}
+
+	};
+
+	/// Inflates the current zip entry chunk by chunk into a scanner.
+	template<typename Handler>
+	struct ThreeMfEntryStream {
+
+		XmlTagScanner<Handler>*     scanner;
+		const mload::LoadSettings*  settings; // progress is reported to 0.9 if not nullptr
+		uint64_t                    size;
+		uint64_t                    nextReport;
+
+		static size_t write(void* arg, uint64_t offset, const void* data, size_t size) {
+			ThreeMfEntryStream* stream = (ThreeMfEntryStream*)arg;
+			stream->scanner->feed((const char*)data, size);
+			if (stream->settings != nullptr && stream->settings->progressCallback != nullptr && offset >= stream->nextReport && stream->size != 0) {
+				stream->nextReport = offset + c_ThreeMfProgressInterval;
+				stream->settings->progressCallback(stream->settings->progressUserData, 0.9f * (float)offset / (float)stream->size);
+			}
+			return size;
+		}
+
+	};
+
+}
+
+/// @param settings optional, for progress reports
+template<typename Handler>
+static bool scanEntry(zip_t* zip, XmlTagScanner<Handler>* scanner, const mload::LoadSettings* settings) {
+	ThreeMfEntryStream<Handler> stream{ scanner, settings, zip_entry_size(zip), 0 };
+	return zip_entry_extract(zip, ThreeMfEntryStream<Handler>::write, &stream) == 0;
+}
+
+/// Opens the model part of the package, named by the relationships or at its usual path.
+/// @return the zip to close, nullptr if the model part is missing
+static mload::Success openModelEntry(const char* fileName, zip_t** zip) {
+
+	*zip = zip_open(fileName, 0, 'r');
+	if (*zip == nullptr) return mload::Success::COULD_NOT_OPEN_FILE;
+
+	ThreeMfRelationships relationships;
+	if (zip_entry_open(*zip, c_ThreeMfRelationships) == 0) {
+		XmlTagScanner<ThreeMfRelationships> scanner(&relationships);
+		scanEntry(*zip, &scanner, nullptr);
+		zip_entry_close(*zip);
+	}
+	if (relationships.modelPath[0] != '\0' && zip_entry_open(*zip, relationships.modelPath) == 0) return mload::Success::SUCCESS;
+	if (zip_entry_open(*zip, c_ThreeMfDefaultModel) == 0) return mload::Success::SUCCESS;
+
+	zip_close(*zip);
+	*zip = nullptr;
+	return mload::Success::WRONG_FILE_FORMAT;
+
+}
+
+mload::Success mload::load3mf(const char* fileName, const LoadSettings& settings, std::vector<Vertex>* vertexBuff, std::vector<uint32_t>* indexBuff, std::vector<ModelPart>* parts, std::vector<ModelInstance>* instances) {
+
+	vertexBuff->clear();
+	indexBuff->clear();
+	parts->clear();
+	instances->clear();
+
+	zip_t* zip;
+	Success result = openModelEntry(fileName, &zip);
+	if (result != Success::SUCCESS) return result;
+
+	ThreeMfModelReader reader(vertexBuff, indexBuff, parts);
+	// The scanner carries a whole tag, keep it off the loading thread's stack
+	std::unique_ptr<XmlTagScanner<ThreeMfModelReader>> scanner(new XmlTagScanner<ThreeMfModelReader>(&reader));
+	bool inflated = scanEntry(zip, scanner.get(), &settings);
+	zip_entry_close(zip);
+	zip_close(zip);
+
+	if (!inflated)                           return Success::CORRUPT_FILE;
+	if (reader.inMesh() || scanner->inTag()) return Success::TRUNCATED_FILE;
+	if (indexBuff->empty())                  return Success::NO_DATA_FROM_FILE;
+
+	reader.buildInstances(instances);
+	return Success::SUCCESS;
+
+}
+
+mload::Success mload::probe3mf(const char* fileName, uint64_t* modelSize, uint32_t* triangleCount, uint32_t* vertexCount) {
+
+	zip_t* zip;
+	Success result = openModelEntry(fileName, &zip);
+	if (result != Success::SUCCESS) return result;
+	*modelSize = zip_entry_size(zip);
+
+	ThreeMfModelReader counter(nullptr, nullptr, nullptr);
+	std::unique_ptr<XmlTagScanner<ThreeMfModelReader>> scanner(new XmlTagScanner<ThreeMfModelReader>(&counter));
+	bool inflated = scanEntry(zip, scanner.get(), nullptr);
+	zip_entry_close(zip);
+	zip_close(zip);
+	if (!inflated) return Success::CORRUPT_FILE;
+
+	*triangleCount = (uint32_t)std::min<uint64_t>(counter.triangleCount, UINT32_MAX);
+	*vertexCount   = (uint32_t)std::min<uint64_t>(counter.vertexCount, UINT32_MAX);
+	return Success::SUCCESS;
+
+}
@@ -0,0 +1,18 @@
+#pragma once
+
+#include "ModelLoader.hpp"
+
+namespace mload {
+
+	/// Reads the mesh objects of a 3MF package. The model part is inflated and scanned in chunks, it is never held in memory as a whole.
+	/// Every mesh object is stored once as a ModelPart, build items and the components they reference become ModelInstances.
+	/// Normals are zero, 3MF doesn't store any.
+	/// @param settings   only the progress callback is used
+	/// @param instances  empty if the package has no build items, the parts are drawn once then
+	Success load3mf(const char* fileName, const LoadSettings& settings, std::vector<Vertex>* vertexBuff, std::vector<uint32_t>* indexBuff, std::vector<ModelPart>* parts, std::vector<ModelInstance>* instances);
+
+	/// Counts the stored vertices and triangles of a 3MF package with the same chunked scan, without storing them.
+	/// @param modelSize inflated bytes of the model part
+	Success probe3mf(const char* fileName, uint64_t* modelSize, uint32_t* triangleCount, uint32_t* vertexCount);
+
+}
@@ -0,0 +1,53 @@
+#include "TriangleSink.hpp"
+
+#include <algorithm>
+
+mload::MeshBuilder::MeshBuilder(std::vector<Vertex>* vertexBuff, std::vector<uint32_t>* indexBuff, size_t predictedTriangleCount, bool dedup)
+: m_vertexBuff(vertexBuff), m_indexBuff(indexBuff)
+{
+
+	size_t indexCapacity              = std::max((size_t)1, 3 * predictedTriangleCount);
+	size_t predictedUniqueVertexCount = dedup ? std::max((size_t)1, (size_t)(c_PredictedUniqueVertexRatio * indexCapacity)) : indexCapacity;
+	m_indexBuff->reserve(m_indexBuff->size() + indexCapacity);
+	m_vertexBuff->reserve(m_vertexBuff->size() + predictedUniqueVertexCount);
+	if (dedup) m_uniqueVertices.reset(new Map<Vertex, uint32_t>((size_t)(1.5 * indexCapacity), predictedUniqueVertexCount));
+
+}
+
+void mload::MeshBuilder::triangles(const Vertex* corners, size_t triangleCount) {
+
+	if (m_uniqueVertices == nullptr) { trianglesHashed(corners, nullptr, triangleCount); return; }
+
+	uint32_t hashes[3 * c_TriangleBatchSize];
+	for (size_t first = 0; first < triangleCount; first += c_TriangleBatchSize) {
+		size_t count = std::min(c_TriangleBatchSize, triangleCount - first);
+		for (size_t i = 0; i < 3 * count; i++) hashes[i] = hashVertex(corners[3 * first + i]);
+		trianglesHashed(&corners[3 * first], hashes, count);
+	}
+
+}
+
+void mload::MeshBuilder::trianglesHashed(const Vertex* corners, const uint32_t* hashes, size_t triangleCount) {
+
+	const size_t cornerCount = 3 * triangleCount;
+
+	if (m_uniqueVertices == nullptr) {
+		for (size_t i = 0; i < cornerCount; i++) m_indexBuff->push_back((uint32_t)(m_vertexBuff->size() + i));
+		m_vertexBuff->insert(m_vertexBuff->end(), corners, corners + cornerCount);
+		return;
+	}
+
+	// Start fetching the buckets of the whole batch before the first lookup waits on one
+	for (size_t i = 0; i < cornerCount; i++) m_uniqueVertices->prefetch(hashes[i]);
+
+	for (size_t i = 0; i < cornerCount; i++) {
+		bool keyExists;
+		uint32_t* pIndex = m_uniqueVertices->getKeyValueHashed(corners[i], hashes[i], &keyExists);
+		if (!keyExists) {
+			*pIndex = (uint32_t)m_vertexBuff->size();
+			m_vertexBuff->push_back(corners[i]);
+		}
+		m_indexBuff->push_back(*pIndex);
+	}
+
+}
@@ -0,0 +1,49 @@
+#pragma once
+
+#include "VertexMap.hpp"
+
+#include <memory>
+
+namespace mload {
+
+	/// Triangles handed to TriangleSink::triangles at most at once. 
+	constexpr size_t c_TriangleBatchSize = 256;
+	/// Unique vertices per index the loaders presize for. 
+	constexpr float  c_PredictedUniqueVertexRatio = 0.9f;
+
+	/// Receives the triangles of a file while it is parsed, see mload::streamModel. 
+	class TriangleSink {
+	public:
+
+		virtual ~TriangleSink() = default;
+
+		/// Called before the first batch with the triangle count from the header or the file size, not exact. 
+		virtual void begin(size_t) {}
+		/// Triangles in file order, 3 corners each. corners is only valid during the call. 
+		virtual void triangles(const Vertex* corners, size_t triangleCount) = 0;
+		/// Called after the last batch. 
+		virtual void end() {}
+
+	};
+
+	/// Sink that builds the indexed mesh mload::openModel returns. 
+	class MeshBuilder : public TriangleSink {
+	public:
+
+		/// @param predictedTriangleCount sizes the dedup map and the buffers
+		/// @param dedup                  false gives every corner its own vertex
+		MeshBuilder(std::vector<Vertex>* vertexBuff, std::vector<uint32_t>* indexBuff, size_t predictedTriangleCount, bool dedup = true);
+
+		void triangles(const Vertex* corners, size_t triangleCount) override;
+		/// Same as triangles with the hashVertex of every corner already computed, e.g. by another thread. 
+		void trianglesHashed(const Vertex* corners, const uint32_t* hashes, size_t triangleCount);
+
+	private:
+
+		std::vector<Vertex>*                   m_vertexBuff;
+		std::vector<uint32_t>*                 m_indexBuff;
+		std::unique_ptr<Map<Vertex, uint32_t>> m_uniqueVertices; // nullptr without dedup
+
+	};
+
+}
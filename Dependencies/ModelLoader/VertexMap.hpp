@@ -2,6 +2,7 @@
 
 #include <vector>
 #include <cstdint>
+#include <cstddef>
 
 namespace mload {
 
@@ -33,6 +34,14 @@ namespace mload {
 
 	};
 
+	constexpr uint32_t c_HashSeed            = 0x811C9DC5u;
+	constexpr uint32_t c_HashMultiplier      = 0x9E3779B1u;
+	constexpr uint32_t c_HashFinalMultiplier = 0x85EBCA6Bu;
+
+	/// 32 bit hash of the vertex' six floats. Only uses rotates, xors and 32 bit multiplies so it can be computed for
+	/// several vertices at once in SIMD lanes (see StlDecode.cpp). -0.0f hashes like 0.0f because they compare equal. 
+	uint32_t hashVertex(const Vertex& v);
+
 	template<typename K, typename V> 
 	class Map {
 	private: 
@@ -51,6 +60,10 @@ namespace mload {
 		void operator=(const Map&) = delete;
 
 		V* getKeyValue(const K& key, bool* itemAlreadyExists);
+		/// getKeyValue with a precomputed hashFunc(key). 
+		V* getKeyValueHashed(const K& key, size_t hash, bool* itemAlreadyExists);
+		/// Fetches the bucket of hash into the cache ahead of getKeyValueHashed. 
+		void prefetch(size_t hash) const;
 
 		~Map();
 
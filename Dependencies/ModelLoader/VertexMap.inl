@@ -1,4 +1,9 @@
 #include <cassert>
+#include <cstring>
+
+#if defined(_MSC_VER)
+#include <xmmintrin.h>
+#endif
 
 template<typename K, typename V>
 mload::Map<K, V>::Map(size_t _bucketCount, size_t predictedElementCount)
@@ -15,22 +20,36 @@ mload::Map<K, V>::Map(size_t _bucketCount, size_t predictedElementCount)
 
 }
 
+inline uint32_t mload::hashVertex(const Vertex& v) {
+
+	uint32_t components[6];
+	memcpy(components, &v, sizeof(components));
+
+	uint32_t h = c_HashSeed;
+	for (uint32_t u : components) {
+		if (u == 0x80000000u) u = 0; // -0.0f
+		h = ((h << 5) | (h >> 27)) ^ u;
+		h *= c_HashMultiplier;
+	}
+	h ^= h >> 16;
+	h *= c_HashFinalMultiplier;
+	h ^= h >> 13;
+	return h;
+
+}
 inline size_t hashFunc(const mload::Vertex& v) {
-	size_t h1 = std::hash<float>{}(v.pos.x);
-	size_t h2 = std::hash<float>{}(v.pos.y);
-	size_t h3 = std::hash<float>{}(v.pos.z);
-	size_t h4 = std::hash<float>{}(v.normal.x);
-	size_t h5 = std::hash<float>{}(v.normal.y);
-	size_t h6 = std::hash<float>{}(v.normal.z);
+	return mload::hashVertex(v);
+}
+inline size_t hashFunc(const mload::vec3& v) {
+	size_t h1 = std::hash<float>{}(v.x);
+	size_t h2 = std::hash<float>{}(v.y);
+	size_t h3 = std::hash<float>{}(v.z);
 
 	size_t result = h1;
 	result ^= h2 + 0x9e3779b9 + (result << 6) + (result >> 2);
 	result ^= h3 + 0x9e3779b9 + (result << 6) + (result >> 2);
-	result ^= h4 + 0x9e3779b9 + (result << 6) + (result >> 2);
-	result ^= h5 + 0x9e3779b9 + (result << 6) + (result >> 2);
-	result ^= h6 + 0x9e3779b9 + (result << 6) + (result >> 2);
 
- 	return result;
+	return result;
 }
 inline size_t hashFunc(const mload::ObjVertexIndex& vertexIndex) {
 	
@@ -47,7 +66,25 @@ inline size_t hashFunc(const mload::ObjVertexIndex& vertexIndex) {
 template<typename K, typename V> 
 V* mload::Map<K, V>::getKeyValue(const K& key, bool *itemAlreadyExists) {
 
-	size_t bucketIndex = hashFunc(key) % m_bucketCount; 
+	return getKeyValueHashed(key, hashFunc(key), itemAlreadyExists);
+
+}
+
+template<typename K, typename V> 
+void mload::Map<K, V>::prefetch(size_t hash) const {
+
+#if defined(_MSC_VER)
+	_mm_prefetch((const char*)&m_buckets[hash % m_bucketCount], _MM_HINT_T0);
+#else
+	__builtin_prefetch(&m_buckets[hash % m_bucketCount]);
+#endif
+
+}
+
+template<typename K, typename V> 
+V* mload::Map<K, V>::getKeyValueHashed(const K& key, size_t hash, bool *itemAlreadyExists) {
+
+	size_t bucketIndex = hash % m_bucketCount; 
 
 	LinkedListItem**  item = &m_buckets[bucketIndex];
 	// Find element
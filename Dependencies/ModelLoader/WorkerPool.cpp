@@ -0,0 +1,70 @@
+#include "WorkerPool.hpp"
+
+#include <algorithm>
+
+mload::WorkerPool::WorkerPool(uint32_t threadCount) {
+
+	m_threads.reserve(threadCount);
+	for (uint32_t i = 0; i < threadCount; i++) m_threads.emplace_back(&WorkerPool::workerLoop, this);
+
+}
+
+void mload::WorkerPool::submit(std::function<void()> task) {
+
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		m_tasks.push_back(std::move(task));
+	}
+	m_taskAdded.notify_one();
+
+}
+
+bool mload::WorkerPool::runPendingTask() {
+
+	std::function<void()> task;
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		if (m_tasks.empty()) return false;
+		task = std::move(m_tasks.front());
+		m_tasks.pop_front();
+	}
+	task();
+	return true;
+
+}
+
+mload::WorkerPool& mload::WorkerPool::shared() {
+
+	static WorkerPool pool(std::max(1u, std::thread::hardware_concurrency()));
+	return pool;
+
+}
+
+void mload::WorkerPool::workerLoop() {
+
+	for (;;) {
+
+		std::function<void()> task;
+		{
+			std::unique_lock<std::mutex> lock(m_mutex);
+			m_taskAdded.wait(lock, [this]() { return m_stopping || !m_tasks.empty(); });
+			if (m_tasks.empty()) return; // stopping
+			task = std::move(m_tasks.front());
+			m_tasks.pop_front();
+		}
+		task();
+
+	}
+
+}
+
+mload::WorkerPool::~WorkerPool() {
+
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		m_stopping = true;
+	}
+	m_taskAdded.notify_all();
+	for (std::thread& thread : m_threads) thread.join();
+
+}
@@ -0,0 +1,44 @@
+#pragma once
+
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <functional>
+#include <deque>
+#include <vector>
+
+namespace mload {
+
+	class WorkerPool {
+	public:
+
+		/// A pool without threads only runs tasks through runPendingTask. 
+		explicit WorkerPool(uint32_t threadCount);
+		WorkerPool(const WorkerPool&) = delete;
+		void operator=(const WorkerPool&) = delete;
+
+		void submit(std::function<void()> task);
+		/// Runs one queued task on the calling thread. Lets a thread that waits on pool work help instead of blocking.
+		/// @return false if there was nothing queued
+		bool runPendingTask();
+
+		uint32_t threadCount() const { return (uint32_t)m_threads.size(); }
+
+		/// Pool shared by the loaders and the app, one thread per hardware thread. 
+		static WorkerPool& shared();
+
+		~WorkerPool();
+
+	private:
+
+		void workerLoop();
+
+		std::vector<std::thread>          m_threads;
+		std::deque<std::function<void()>> m_tasks;
+		std::mutex                        m_mutex;
+		std::condition_variable           m_taskAdded;
+		bool                              m_stopping = false;
+
+	};
+
+}
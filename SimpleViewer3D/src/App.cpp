@@ -6,12 +6,10 @@
 
 #include <VulkanHelpers.hpp>
 
-#include "FileArrays/shader_vert_spv.h"
-#include "FileArrays/shader_frag_spv.h"
-#include "FileArrays/MeshOutlineShader_vert_spv.h"
-#include "FileArrays/MeshOutlineShader_frag_spv.h"
 
 #include <ModelLoader.hpp>
+#include <Benchmarks.hpp>
+#include <WorkerPool.hpp>
 
 #include <glm/glm.hpp>
 #include <glm/gtc/matrix_transform.hpp>
@@ -25,10 +23,6 @@
 
 #include <shlobj.h>
 
-struct PushConstants {
-    glm::mat4 view, proj; 
-};
-
 void App::init(Core::Instance* inst, const InstanceInfo& initInfo) {
 
     scopedTimer(t1, inst->gui.stats.perfTimes.getTimer("appLaunch"));
@@ -74,7 +68,7 @@ void App::init(Core::Instance* inst, const InstanceInfo& initInfo) {
         int startPosX; 
         int startPosY; 
         
-        // Get imgui.ini path
+        // Get imgui.ini and pipeline cache paths
         {
 
             SHGetFolderPathA(NULL, CSIDL_LOCAL_APPDATA, NULL, 0, iniPath);
@@ -82,6 +76,12 @@ void App::init(Core::Instance* inst, const InstanceInfo& initInfo) {
             for (; *endC != '\0'; endC++) {}
             strcpy(endC, "\\Simple Viewer 3D");
             CreateDirectoryA(iniPath, NULL); 
+
+            const char* pipelineCacheName = "\\pipeline.cache";
+            inst->rend.pipelineCachePath.reset(new char[strlen(iniPath) + strlen(pipelineCacheName) + 1]);
+            strcpy(inst->rend.pipelineCachePath.get(), iniPath);
+            strcat(inst->rend.pipelineCachePath.get(), pipelineCacheName);
+
             endC = iniPath;
             for (; *endC != '\0'; endC++) {}
             strcpy(endC, "\\imgui.ini"); 
@@ -89,11 +89,18 @@ void App::init(Core::Instance* inst, const InstanceInfo& initInfo) {
         }
 
         CustomIniData iniData{};
+        iniData.creaseAngle   = 30;
         inst->gui.sensitivity = 50; 
+        inst->gui.normalMode  = 0; 
+        inst->gui.creaseAngle = 30.0f;
         bool dataExists = getCustomIniData(&iniData, iniPath);
         if (dataExists && (iniData.windowWidth != 0 && iniData.windowHeight != 0)) {
 
             inst->gui.sensitivity = (float)iniData.sensitivity;
+            // The ini may be hand edited, normalMode indexes tables
+            bool knownNormalMode  = iniData.normalMode >= mload::NORMAL_MODE_FILE && iniData.normalMode <= mload::NORMAL_MODE_SMOOTH;
+            inst->gui.normalMode  = knownNormalMode ? iniData.normalMode : mload::NORMAL_MODE_FILE;
+            inst->gui.creaseAngle = glm::clamp((float)iniData.creaseAngle, 0.0f, 180.0f);
             startPosX             = iniData.windowPosX;
             startPosY             = iniData.windowPosY;
             inst->wind.m_size.x   = iniData.windowWidth; 
@@ -147,6 +154,7 @@ void App::init(Core::Instance* inst, const InstanceInfo& initInfo) {
         BOOL err = EnumDisplaySettings(NULL, ENUM_CURRENT_SETTINGS, &devMode);
         assertExit(err, "EnumDisplaySettings failed");
         inst->wind.refreshInterval = 1.0f / devMode.dmDisplayFrequency;
+        inst->pacer.init(inst->wind.refreshInterval);
 
     }
 
@@ -309,6 +317,18 @@ void App::init(Core::Instance* inst, const InstanceInfo& initInfo) {
             }
             if (!formatsAdequate) continue;
 
+            // Uploads are tracked with a timeline semaphore
+            VkPhysicalDeviceProperties deviceProperties;
+            vkGetPhysicalDeviceProperties(queriedDevice, &deviceProperties);
+            if (deviceProperties.apiVersion < VK_API_VERSION_1_2) continue;
+            VkPhysicalDeviceTimelineSemaphoreFeatures timelineFeatures{};
+            timelineFeatures.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_TIMELINE_SEMAPHORE_FEATURES;
+            VkPhysicalDeviceFeatures2 features{};
+            features.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_FEATURES_2;
+            features.pNext = &timelineFeatures;
+            vkGetPhysicalDeviceFeatures2(queriedDevice, &features);
+            if (!timelineFeatures.timelineSemaphore) continue;
+
             uint32_t presentModeCount;
             vkGetPhysicalDeviceSurfacePresentModesKHR(queriedDevice, inst->rend.surface, &presentModeCount, nullptr);
             std::vector<VkPresentModeKHR> presentModes(presentModeCount);
@@ -345,31 +365,83 @@ void App::init(Core::Instance* inst, const InstanceInfo& initInfo) {
         vlknh::getQueueFamilyFlagsIndex(inst->rend.physicalDevice, VK_QUEUE_GRAPHICS_BIT, &inst->rend.graphicsQueueIndex);
         vlknh::getQueueFamilyPresentIndex(inst->rend.physicalDevice, inst->rend.surface, &inst->rend.presentQueueIndex);
 
-        VkDeviceQueueCreateInfo queueCreateInfos[2]{};
+        // Uploads go to a transfer only family when there is one, it usually maps to the copy engine of the GPU
+        uint32_t queueFamilyCount;
+        vkGetPhysicalDeviceQueueFamilyProperties(inst->rend.physicalDevice, &queueFamilyCount, nullptr);
+        std::vector<VkQueueFamilyProperties> queueFamilies(queueFamilyCount);
+        vkGetPhysicalDeviceQueueFamilyProperties(inst->rend.physicalDevice, &queueFamilyCount, queueFamilies.data());
+        inst->rend.transferQueueIndex = inst->rend.graphicsQueueIndex;
+        for (uint32_t i = 0; i < queueFamilyCount; i++) {
+            VkQueueFlags flags = queueFamilies[i].queueFlags;
+            if (!(flags & VK_QUEUE_TRANSFER_BIT) || (flags & VK_QUEUE_GRAPHICS_BIT)) continue;
+            inst->rend.transferQueueIndex = i;
+            if (!(flags & VK_QUEUE_COMPUTE_BIT)) break;
+        }
 
-        float queuePriority = 1.0;
-        queueCreateInfos[0].sType = VK_STRUCTURE_TYPE_DEVICE_QUEUE_CREATE_INFO;
-        queueCreateInfos[0].queueFamilyIndex = inst->rend.graphicsQueueIndex;
-        queueCreateInfos[0].queueCount = 1;
-        queueCreateInfos[0].pQueuePriorities = &queuePriority;
+        VkDeviceQueueCreateInfo queueCreateInfos[3]{};
+        uint32_t queueFamilyIndices[] = { inst->rend.graphicsQueueIndex, inst->rend.presentQueueIndex, inst->rend.transferQueueIndex };
+        uint32_t queueCreateInfoCount = 0;
 
-        queueCreateInfos[1].sType = VK_STRUCTURE_TYPE_DEVICE_QUEUE_CREATE_INFO;
-        queueCreateInfos[1].queueFamilyIndex = inst->rend.presentQueueIndex;
-        queueCreateInfos[1].queueCount = 1;
-        queueCreateInfos[1].pQueuePriorities = &queuePriority;
+        float queuePriority = 1.0;
+        for (uint32_t familyIndex : queueFamilyIndices) {
+            bool duplicate = false;
+            for (uint32_t i = 0; i < queueCreateInfoCount; i++) duplicate |= queueCreateInfos[i].queueFamilyIndex == familyIndex;
+            if (duplicate) continue;
+
+            VkDeviceQueueCreateInfo& queueCreateInfo = queueCreateInfos[queueCreateInfoCount++];
+            queueCreateInfo.sType = VK_STRUCTURE_TYPE_DEVICE_QUEUE_CREATE_INFO;
+            queueCreateInfo.queueFamilyIndex = familyIndex;
+            queueCreateInfo.queueCount = 1;
+            queueCreateInfo.pQueuePriorities = &queuePriority;
+        }
 
         VkDeviceCreateInfo createInfo{};
         createInfo.sType = VK_STRUCTURE_TYPE_DEVICE_CREATE_INFO;
         createInfo.pQueueCreateInfos = queueCreateInfos;
-        createInfo.queueCreateInfoCount = arraySize(queueCreateInfos);
-        if (inst->rend.graphicsQueueIndex == inst->rend.presentQueueIndex) createInfo.queueCreateInfoCount -= 1;
+        createInfo.queueCreateInfoCount = queueCreateInfoCount;
 
         VkPhysicalDeviceFeatures deviceFeatures{};
         deviceFeatures.fillModeNonSolid = VK_TRUE; 
         createInfo.pEnabledFeatures = &deviceFeatures;
-        const char* extensionNames[] = { VK_KHR_SWAPCHAIN_EXTENSION_NAME };
+        uint32_t extensionCount;
+        vkEnumerateDeviceExtensionProperties(inst->rend.physicalDevice, nullptr, &extensionCount, nullptr);
+        std::vector<VkExtensionProperties> availableExtensions(extensionCount);
+        vkEnumerateDeviceExtensionProperties(inst->rend.physicalDevice, nullptr, &extensionCount, availableExtensions.data());
+        bool hasPresentIdExt = false, hasPresentWaitExt = false;
+        for (const VkExtensionProperties& extension : availableExtensions) {
+            if (strcmp(extension.extensionName, VK_EXT_MEMORY_BUDGET_EXTENSION_NAME) == 0) inst->rend.hasMemoryBudgetExt = true;
+            if (strcmp(extension.extensionName, VK_KHR_PRESENT_ID_EXTENSION_NAME)    == 0) hasPresentIdExt = true;
+            if (strcmp(extension.extensionName, VK_KHR_PRESENT_WAIT_EXTENSION_NAME)  == 0) hasPresentWaitExt = true;
+        }
+
+        // Present times for the frame pacer
+        VkPhysicalDevicePresentWaitFeaturesKHR presentWaitFeatures{};
+        presentWaitFeatures.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_PRESENT_WAIT_FEATURES_KHR;
+        VkPhysicalDevicePresentIdFeaturesKHR presentIdFeatures{};
+        presentIdFeatures.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_PRESENT_ID_FEATURES_KHR;
+        presentIdFeatures.pNext = &presentWaitFeatures;
+        if (hasPresentIdExt && hasPresentWaitExt) {
+            VkPhysicalDeviceFeatures2 features{};
+            features.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_FEATURES_2;
+            features.pNext = &presentIdFeatures;
+            vkGetPhysicalDeviceFeatures2(inst->rend.physicalDevice, &features);
+            inst->rend.hasPresentWait = presentIdFeatures.presentId && presentWaitFeatures.presentWait;
+        }
+        VkPhysicalDeviceTimelineSemaphoreFeatures timelineFeatures{};
+        timelineFeatures.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_TIMELINE_SEMAPHORE_FEATURES;
+        timelineFeatures.timelineSemaphore = VK_TRUE;
+        timelineFeatures.pNext = inst->rend.hasPresentWait ? &presentIdFeatures : nullptr;
+        createInfo.pNext = &timelineFeatures;
+
+        const char* extensionNames[4] = { VK_KHR_SWAPCHAIN_EXTENSION_NAME };
+        uint32_t enabledExtensionCount = 1;
+        if (inst->rend.hasMemoryBudgetExt) extensionNames[enabledExtensionCount++] = VK_EXT_MEMORY_BUDGET_EXTENSION_NAME;
+        if (inst->rend.hasPresentWait) {
+            extensionNames[enabledExtensionCount++] = VK_KHR_PRESENT_ID_EXTENSION_NAME;
+            extensionNames[enabledExtensionCount++] = VK_KHR_PRESENT_WAIT_EXTENSION_NAME;
+        }
         createInfo.ppEnabledExtensionNames = extensionNames;
-        createInfo.enabledExtensionCount = arraySize(extensionNames);
+        createInfo.enabledExtensionCount   = enabledExtensionCount;
 
 #ifdef ENABLE_VK_VALIDATION_LAYERS
         createInfo.enabledLayerCount = arraySize(desiredLayers);
@@ -381,6 +453,8 @@ void App::init(Core::Instance* inst, const InstanceInfo& initInfo) {
         VkResult err = vkCreateDevice(inst->rend.physicalDevice, &createInfo, nullptr, &inst->rend.device);
         assertExit(err == VK_SUCCESS, "Logical device creation failed");
 
+        if (inst->rend.hasPresentWait) inst->rend.waitForPresentKHR = (PFN_vkWaitForPresentKHR)vkGetDeviceProcAddr(inst->rend.device, "vkWaitForPresentKHR");
+
 
     }
 
@@ -389,10 +463,11 @@ void App::init(Core::Instance* inst, const InstanceInfo& initInfo) {
 
         vkGetDeviceQueue(inst->rend.device, inst->rend.graphicsQueueIndex, 0, &inst->rend.graphicsQueue);
         vkGetDeviceQueue(inst->rend.device, inst->rend.presentQueueIndex, 0, &inst->rend.presentQueue);
+        vkGetDeviceQueue(inst->rend.device, inst->rend.transferQueueIndex, 0, &inst->rend.transferQueue);
 
     }
 
-    Core::createSwapchain(inst);
+    Core::createSwapchain(inst, VK_NULL_HANDLE);
 
     // Render pass creation 
     {
@@ -467,22 +542,33 @@ void App::init(Core::Instance* inst, const InstanceInfo& initInfo) {
         allocInfo.level              = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
         allocInfo.commandBufferCount = 1;
 
-        VkResult err = vkAllocateCommandBuffers(inst->rend.device, &allocInfo, &inst->rend.commandBuff);
-        assertExit(err == VK_SUCCESS, "Command buffer allocation failed");
+        for (uint32_t i = 0; i < c_vlkn::framesInFlight; i++) {
+
+            VkResult err = vkAllocateCommandBuffers(inst->rend.device, &allocInfo, &inst->rend.frames[i].commandBuff);
+            assertExit(err == VK_SUCCESS, "Command buffer allocation failed");
+
+        }
 
     }
 
+#ifdef DEVINFO
+    Core::createFrameTimestamps(&inst->rend);
+#endif
+    Core::initDeviceAllocator(&inst->rend);
+    Core::createStagingRing(&inst->rend);
+
     // Descriptor pool creation 
     {
 
         VkDescriptorPoolSize poolSizeInfo{};
         poolSizeInfo.type            = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
-        poolSizeInfo.descriptorCount = c_vlkn::maxSets; 
+        poolSizeInfo.descriptorCount = c_vlkn::maxSets * (c_vlkn::framesInFlight + 1); 
 
         VkDescriptorPoolCreateInfo poolInfo{};
         poolInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
         poolInfo.flags         = VK_DESCRIPTOR_POOL_CREATE_FREE_DESCRIPTOR_SET_BIT;
-        poolInfo.maxSets       = c_vlkn::maxSets; // TODO: prevent the user from creating too many tabs and overflowing the descriptor pool
+        // Resized viewports get new descriptor sets while the old ones wait for the frames in flight
+        poolInfo.maxSets       = c_vlkn::maxSets * (c_vlkn::framesInFlight + 1); // TODO: prevent the user from creating too many tabs and overflowing the descriptor pool
         poolInfo.poolSizeCount = 1;
         poolInfo.pPoolSizes    = &poolSizeInfo;
 
@@ -504,278 +590,42 @@ void App::init(Core::Instance* inst, const InstanceInfo& initInfo) {
 
         }
 
-        VkResult err = vkCreateSemaphore(inst->rend.device, &semaphoreInfo, nullptr, &inst->rend.imageReadySemaphore);
-        assertExit(err == VK_SUCCESS, "Semaphore creation failed");
-
         VkFenceCreateInfo fenceInfo{};
         fenceInfo.sType = VK_STRUCTURE_TYPE_FENCE_CREATE_INFO;
         fenceInfo.flags = VK_FENCE_CREATE_SIGNALED_BIT;
 
-        err = vkCreateFence(inst->rend.device, &fenceInfo, nullptr, &inst->rend.frameFinishedFence);
-        assertExit(err == VK_SUCCESS, "Fence Creation failed");
+        for (uint32_t i = 0; i < c_vlkn::framesInFlight; i++) {
+
+            VkResult err = vkCreateSemaphore(inst->rend.device, &semaphoreInfo, nullptr, &inst->rend.frames[i].imageReadySemaphore);
+            assertExit(err == VK_SUCCESS, "Semaphore creation failed");
+
+            err = vkCreateFence(inst->rend.device, &fenceInfo, nullptr, &inst->rend.frames[i].frameFinishedFence);
+            assertExit(err == VK_SUCCESS, "Fence Creation failed");
+
+        }
+
+        Core::startFrameWatcher(&inst->rend);
 
     }
 
-    // Viewports Renderer creation
+    bool pipelineCacheLoaded;
     {
 
-        // Render Pass Creation
-        {
+        scopedTimer(t2, inst->gui.stats.perfTimes.getTimer("pipelineCacheLoad"));
+        pipelineCacheLoaded = Core::createPipelineCache(&inst->rend);
 
-            VkAttachmentDescription colorAttachment{};
-            colorAttachment.flags          = 0;
-            colorAttachment.format         = c_vlkn::format;
-            colorAttachment.samples        = c_vlkn::sampleCount;
-            colorAttachment.loadOp         = VK_ATTACHMENT_LOAD_OP_CLEAR;
-            colorAttachment.storeOp        = VK_ATTACHMENT_STORE_OP_STORE;
-            colorAttachment.stencilLoadOp  = VK_ATTACHMENT_LOAD_OP_DONT_CARE;
-            colorAttachment.stencilStoreOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
-            colorAttachment.initialLayout  = VK_IMAGE_LAYOUT_UNDEFINED;
-            colorAttachment.finalLayout    = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL;
-
-            VkAttachmentReference colorAttachmentRef{};
-            colorAttachmentRef.attachment = 0;
-            colorAttachmentRef.layout     = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL;
-
-            VkAttachmentDescription depthAttachment{};
-            depthAttachment.format         = c_vlkn::depthFormat; 
-            depthAttachment.samples        = c_vlkn::sampleCount;
-            depthAttachment.loadOp         = VK_ATTACHMENT_LOAD_OP_CLEAR;
-            depthAttachment.storeOp        = VK_ATTACHMENT_STORE_OP_DONT_CARE;
-            depthAttachment.stencilLoadOp  = VK_ATTACHMENT_LOAD_OP_DONT_CARE;
-            depthAttachment.stencilStoreOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
-            depthAttachment.initialLayout  = VK_IMAGE_LAYOUT_UNDEFINED;
-            depthAttachment.finalLayout    = VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL; 
-
-            VkAttachmentReference depthAttachmentRef{};
-            depthAttachmentRef.attachment = 1;
-            depthAttachmentRef.layout     = VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL;
-
-            VkAttachmentDescription colorAttachmentResolve{}; 
-            colorAttachmentResolve.format         = c_vlkn::format;
-            colorAttachmentResolve.samples        = VK_SAMPLE_COUNT_1_BIT; 
-            colorAttachmentResolve.loadOp         = VK_ATTACHMENT_LOAD_OP_DONT_CARE;
-            colorAttachmentResolve.storeOp        = VK_ATTACHMENT_STORE_OP_STORE;
-            colorAttachmentResolve.stencilLoadOp  = VK_ATTACHMENT_LOAD_OP_DONT_CARE; 
-            colorAttachmentResolve.stencilStoreOp = VK_ATTACHMENT_STORE_OP_DONT_CARE; 
-            colorAttachmentResolve.initialLayout  = VK_IMAGE_LAYOUT_UNDEFINED;
-            colorAttachmentResolve.finalLayout    = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL; 
-
-            VkAttachmentReference colorAttachmentResolveRef{}; 
-            colorAttachmentResolveRef.attachment = 2; 
-            colorAttachmentResolveRef.layout = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL; 
-
-            VkSubpassDescription subpass{};
-            subpass.pipelineBindPoint = VK_PIPELINE_BIND_POINT_GRAPHICS;
-            subpass.colorAttachmentCount     = 1;
-            subpass.pColorAttachments        = &colorAttachmentRef;
-            subpass.pDepthStencilAttachment  = &depthAttachmentRef;
-            subpass.pResolveAttachments      = &colorAttachmentResolveRef;
-
-            VkSubpassDependency dependency{};
-            dependency.srcSubpass    = VK_SUBPASS_EXTERNAL;
-            dependency.dstSubpass    = 0;
-            dependency.srcStageMask  = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT | VK_PIPELINE_STAGE_EARLY_FRAGMENT_TESTS_BIT;
-            dependency.srcAccessMask = 0;
-            dependency.dstStageMask  = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT | VK_PIPELINE_STAGE_EARLY_FRAGMENT_TESTS_BIT;
-            dependency.dstAccessMask = VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT          | VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT;
-
-            VkAttachmentDescription attachments[] = { colorAttachment, depthAttachment, colorAttachmentResolve, };
-            VkRenderPassCreateInfo renderPassInfo{};
-            renderPassInfo.sType = VK_STRUCTURE_TYPE_RENDER_PASS_CREATE_INFO;
-            renderPassInfo.flags           = 0;
-            renderPassInfo.attachmentCount = arraySize(attachments);
-            renderPassInfo.pAttachments    = attachments;
-            renderPassInfo.subpassCount    = 1;
-            renderPassInfo.pSubpasses      = &subpass;
-            renderPassInfo.dependencyCount = 1;
-            renderPassInfo.pDependencies   = &dependency;
-
-            VkResult err = vkCreateRenderPass(inst->rend.device, &renderPassInfo, nullptr, &inst->vpRend.renderPass);
-            assertExit(err == VK_SUCCESS, "Render pass creation failed");
+    }
 
-        }
+    // Viewports Renderer creation
+    {
 
-        // Graphics Pipeline Creation
+        // Render pass and pipeline creation, cold without a pipeline cache from an earlier run
         {
 
-            scopedTimer(t3, inst->gui.stats.perfTimes.getTimer("graphicsPipelineCreation"));
-
-            VkPipelineShaderStageCreateInfo shaderStages[2]{};
-
-            VkShaderModuleCreateInfo vertModuleCreateInfo{};
-            vertModuleCreateInfo.sType = VK_STRUCTURE_TYPE_SHADER_MODULE_CREATE_INFO;
-            vertModuleCreateInfo.codeSize = sizeof(shader_vert_spv);
-            vertModuleCreateInfo.pCode    = (uint32_t*)shader_vert_spv;
-
-            VkShaderModule vertModule;
-            VkResult err = vkCreateShaderModule(inst->rend.device, &vertModuleCreateInfo, nullptr, &vertModule);
-            assertExit(err == VK_SUCCESS, "Vertex Module Creation failed");
-
-            shaderStages[0].sType  = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
-            shaderStages[0].flags  = 0;
-            shaderStages[0].stage  = VK_SHADER_STAGE_VERTEX_BIT;
-            shaderStages[0].module = vertModule;
-            shaderStages[0].pName  = "main";
-
-            VkShaderModuleCreateInfo fragModuleCreateInfo{};
-            fragModuleCreateInfo.sType = VK_STRUCTURE_TYPE_SHADER_MODULE_CREATE_INFO;
-            fragModuleCreateInfo.codeSize = sizeof(shader_frag_spv);
-            fragModuleCreateInfo.pCode = (uint32_t*)shader_frag_spv;
-
-            VkShaderModule fragModule;
-            err = vkCreateShaderModule(inst->rend.device, &fragModuleCreateInfo, nullptr, &fragModule);
-            assertExit(err == VK_SUCCESS, "Vertex Module Creation failed");
-
-            shaderStages[1].sType  = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
-            shaderStages[1].flags  = 0;
-            shaderStages[1].stage  = VK_SHADER_STAGE_FRAGMENT_BIT;
-            shaderStages[1].module = fragModule;
-            shaderStages[1].pName  = "main";
-
-            VkVertexInputBindingDescription bindingDescription{};
-            bindingDescription.binding   = 0;
-            bindingDescription.stride    = sizeof(mload::Vertex);
-            bindingDescription.inputRate = VK_VERTEX_INPUT_RATE_VERTEX;
-
-            VkVertexInputAttributeDescription attribDescriptions[2]{};
-            attribDescriptions[0].binding  = 0;
-            attribDescriptions[0].location = 0;
-            attribDescriptions[0].format   = VK_FORMAT_R32G32B32_SFLOAT;
-            attribDescriptions[0].offset   = offsetof(mload::Vertex, pos);
-
-            attribDescriptions[1].binding  = 0;
-            attribDescriptions[1].location = 1;
-            attribDescriptions[1].format   = VK_FORMAT_R32G32B32_SFLOAT;
-            attribDescriptions[1].offset   = offsetof(mload::Vertex, normal);
-
-            VkPipelineVertexInputStateCreateInfo vertexInputInfo{};
-            vertexInputInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_VERTEX_INPUT_STATE_CREATE_INFO;
-            vertexInputInfo.vertexBindingDescriptionCount = 1;
-            vertexInputInfo.pVertexBindingDescriptions = &bindingDescription;
-            vertexInputInfo.vertexAttributeDescriptionCount = arraySize(attribDescriptions);
-            vertexInputInfo.pVertexAttributeDescriptions = attribDescriptions;
-
-            VkPipelineInputAssemblyStateCreateInfo inputAssembly{};
-            inputAssembly.sType = VK_STRUCTURE_TYPE_PIPELINE_INPUT_ASSEMBLY_STATE_CREATE_INFO;
-            inputAssembly.topology               = VK_PRIMITIVE_TOPOLOGY_TRIANGLE_LIST;
-            inputAssembly.primitiveRestartEnable = VK_FALSE;
-
-            VkPipelineViewportStateCreateInfo viewportState{};
-            viewportState.sType = VK_STRUCTURE_TYPE_PIPELINE_VIEWPORT_STATE_CREATE_INFO;
-            viewportState.viewportCount = 1;
-            viewportState.scissorCount  = 1;
-
-            VkPipelineRasterizationStateCreateInfo rasterizer{};
-            rasterizer.sType = VK_STRUCTURE_TYPE_PIPELINE_RASTERIZATION_STATE_CREATE_INFO;
-            rasterizer.depthClampEnable        = VK_FALSE;
-            rasterizer.rasterizerDiscardEnable = VK_FALSE;
-            rasterizer.polygonMode             = VK_POLYGON_MODE_FILL;
-            rasterizer.lineWidth               = 1.0f;
-            rasterizer.cullMode                = VK_CULL_MODE_FRONT_BIT;
-            rasterizer.frontFace               = VK_FRONT_FACE_COUNTER_CLOCKWISE;
-            rasterizer.depthBiasEnable         = VK_FALSE;
-
-            VkPipelineMultisampleStateCreateInfo multisampling{};
-            multisampling.sType = VK_STRUCTURE_TYPE_PIPELINE_MULTISAMPLE_STATE_CREATE_INFO;
-            multisampling.sampleShadingEnable = VK_FALSE;
-            multisampling.rasterizationSamples = c_vlkn::sampleCount;
-
-            VkPipelineDepthStencilStateCreateInfo depthStencil{};
-            depthStencil.sType = VK_STRUCTURE_TYPE_PIPELINE_DEPTH_STENCIL_STATE_CREATE_INFO; 
-            depthStencil.depthTestEnable       = VK_TRUE;
-            depthStencil.depthWriteEnable      = VK_TRUE;
-            depthStencil.depthCompareOp        = VK_COMPARE_OP_LESS;
-            depthStencil.depthBoundsTestEnable = VK_FALSE;
-            depthStencil.minDepthBounds        = 0.0f;
-            depthStencil.maxDepthBounds        = 1.0f;
-            depthStencil.stencilTestEnable     = VK_FALSE;
-
-            VkPipelineColorBlendAttachmentState colorBlendAttachment{};
-            colorBlendAttachment.colorWriteMask = VK_COLOR_COMPONENT_R_BIT | VK_COLOR_COMPONENT_G_BIT | VK_COLOR_COMPONENT_B_BIT | VK_COLOR_COMPONENT_A_BIT;
-            colorBlendAttachment.blendEnable    = VK_FALSE;
-
-            VkPipelineColorBlendStateCreateInfo colorBlending{};
-            colorBlending.sType = VK_STRUCTURE_TYPE_PIPELINE_COLOR_BLEND_STATE_CREATE_INFO;
-            colorBlending.logicOpEnable   = VK_FALSE;
-            colorBlending.logicOp         = VK_LOGIC_OP_COPY;
-            colorBlending.attachmentCount = 1;
-            colorBlending.pAttachments    = &colorBlendAttachment;
-
-            VkDynamicState dynamicStates[] = { VK_DYNAMIC_STATE_VIEWPORT, VK_DYNAMIC_STATE_SCISSOR }; 
-
-            VkPipelineDynamicStateCreateInfo dynamicState{};
-            dynamicState.sType = VK_STRUCTURE_TYPE_PIPELINE_DYNAMIC_STATE_CREATE_INFO;
-            dynamicState.dynamicStateCount = arraySize(dynamicStates);
-            dynamicState.pDynamicStates    = dynamicStates;
-
-            VkPushConstantRange pcRange{};
-            pcRange.stageFlags = VK_SHADER_STAGE_VERTEX_BIT;
-            pcRange.offset     = 0;
-            pcRange.size       = sizeof(PushConstants); 
-
-            VkPipelineLayoutCreateInfo pipelineLayoutInfo{};
-            pipelineLayoutInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
-            pipelineLayoutInfo.flags                  = 0; 
-            pipelineLayoutInfo.setLayoutCount         = 0;
-            pipelineLayoutInfo.pushConstantRangeCount = 1;
-            pipelineLayoutInfo.pPushConstantRanges    = &pcRange;
-
-            err = vkCreatePipelineLayout(inst->rend.device, &pipelineLayoutInfo, nullptr, &inst->vpRend.pipelineLayout);
-            assertExit(err == VK_SUCCESS, "Failed to create pipeline layout");
-
-            VkGraphicsPipelineCreateInfo pipelineInfo{};
-            pipelineInfo.sType = VK_STRUCTURE_TYPE_GRAPHICS_PIPELINE_CREATE_INFO;
-            pipelineInfo.flags               = 0;
-            pipelineInfo.stageCount          = arraySize(shaderStages);
-            pipelineInfo.pStages             = shaderStages;
-            pipelineInfo.pVertexInputState   = &vertexInputInfo;
-            pipelineInfo.pInputAssemblyState = &inputAssembly;
-            pipelineInfo.pTessellationState  = nullptr;
-            pipelineInfo.pViewportState      = &viewportState;
-            pipelineInfo.pRasterizationState = &rasterizer;
-            pipelineInfo.pMultisampleState   = &multisampling;
-            pipelineInfo.pDepthStencilState  = &depthStencil;
-            pipelineInfo.pColorBlendState    = &colorBlending;
-            pipelineInfo.pDynamicState       = &dynamicState;
-            pipelineInfo.layout              = inst->vpRend.pipelineLayout;
-            pipelineInfo.renderPass          = inst->vpRend.renderPass;
-            pipelineInfo.subpass             = 0;
-            pipelineInfo.basePipelineHandle  = VK_NULL_HANDLE;
-
-            err = vkCreateGraphicsPipelines(inst->rend.device, nullptr, 1, &pipelineInfo, nullptr, &inst->vpRend.graphicsPipeline);
-            assertExit(err == VK_SUCCESS, "Failed to create graphics pipeline");
-
-            vkDestroyShaderModule(inst->rend.device, vertModule, nullptr);
-            vkDestroyShaderModule(inst->rend.device, fragModule, nullptr);
-
-            // Mesh outline pipeline
-            vertModuleCreateInfo.codeSize = sizeof(MeshOutlineShader_vert_spv);
-            vertModuleCreateInfo.pCode    = (uint32_t*)MeshOutlineShader_vert_spv;
-
-            err = vkCreateShaderModule(inst->rend.device, &vertModuleCreateInfo, nullptr, &vertModule);
-            assertExit(err == VK_SUCCESS, "Vertex module vertex creation failed");
-
-            shaderStages[0].module = vertModule;
-
-            fragModuleCreateInfo.codeSize = sizeof(MeshOutlineShader_frag_spv);
-            fragModuleCreateInfo.pCode    = (uint32_t*)MeshOutlineShader_frag_spv;
-
-            err = vkCreateShaderModule(inst->rend.device, &fragModuleCreateInfo, nullptr, &fragModule);
-            assertExit(err == VK_SUCCESS, "Mesh outline frag module creation failed");
-
-            shaderStages[1].module = fragModule;
-            
-            vertexInputInfo.vertexAttributeDescriptionCount = 1;
-            vertexInputInfo.pVertexAttributeDescriptions    = attribDescriptions;
-
-            rasterizer.polygonMode = VK_POLYGON_MODE_LINE;   
-
-            err = vkCreateGraphicsPipelines(inst->rend.device, nullptr, 1, &pipelineInfo, nullptr, &inst->vpRend.meshOutlinePipeline); 
-            assertExit(err == VK_SUCCESS, "Mesh outline graphics pipeline creation failed");
-
-            vkDestroyShaderModule(inst->rend.device, vertModule, nullptr);
-            vkDestroyShaderModule(inst->rend.device, fragModule, nullptr);
+            scopedTimer(t3, inst->gui.stats.perfTimes.getTimer(pipelineCacheLoaded ? "viewportPipelineCreationWarm" : "viewportPipelineCreationCold"));
+
+            VkResult err = Core::createViewportPipelines(inst->rend.device, inst->rend.pipelineCache, c_vlkn::format, c_vlkn::depthFormat, c_vlkn::sampleCount, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL, &inst->vpRend.pipelines);
+            assertExit(err == VK_SUCCESS, "Viewport pipeline creation failed");
 
         }
 
@@ -840,10 +690,13 @@ void App::init(Core::Instance* inst, const InstanceInfo& initInfo) {
         guiInitInfo.graphicsQueueIndex = inst->rend.graphicsQueueIndex;
         guiInitInfo.graphicsQueue      = inst->rend.graphicsQueue;
         guiInitInfo.descriptorPool     = inst->rend.descriptorPool;
+        guiInitInfo.pipelineCache      = inst->rend.pipelineCache;
         guiInitInfo.renderPass         = inst->rend.renderPass;
         guiInitInfo.subpass            = 0;
         guiInitInfo.imageCount         = inst->rend.imageCount;
         guiInitInfo.iniPath            = iniPath;
+        // ImGui's pipeline goes through the same cache, timed apart from the viewport pipelines
+        guiInitInfo.pipelineTimer      = inst->gui.stats.perfTimes.getTimer(pipelineCacheLoaded ? "guiPipelineCreationWarm" : "guiPipelineCreationCold");
 
         Gui::init(&guiInitInfo, &inst->gui.styleEx, inst->wind.dpi); 
  
@@ -982,10 +835,65 @@ void App::init(Core::Instance* inst, const InstanceInfo& initInfo) {
      
 }
 
+#ifdef DEVINFO
+/// Benchmarks running on the worker pool, the cycle after they finish turns the results into the report. 
+struct BenchmarkRun {
+
+    std::vector<mload::BenchmarkResult> results;
+    HWND                                notifyHwnd;
+    std::atomic<bool>                   done;
+
+};
+static std::unique_ptr<BenchmarkRun> benchmarkRun;
+
+static void startBenchmarks(Core::Instance* inst) {
+
+    if (benchmarkRun != nullptr) return;
+    benchmarkRun.reset(new BenchmarkRun);
+    benchmarkRun->notifyHwnd = inst->wind.hwnd;
+    benchmarkRun->done       = false;
+    inst->gui.stats.benchmarkReport = "Running...";
+
+    BenchmarkRun* run = benchmarkRun.get();
+    mload::WorkerPool::shared().submit([run]() {
+        mload::benchmarkStlDedupScaling(1 << 21, 64, &run->results);
+        char tempDir[MAX_PATH];
+        if (GetTempPathA(MAX_PATH, tempDir) > 0) {
+            mload::benchmarkCompressedOpen(1 << 20, tempDir, &run->results);
+            mload::benchmarkPlyVsStl(1 << 20, tempDir, &run->results);
+        }
+        run->done = true;
+        PostMessage(run->notifyHwnd, WM_NULL, 0, 0);
+    });
+
+}
+static void finishBenchmarks(Core::Instance* inst) {
+
+    if (benchmarkRun == nullptr || !benchmarkRun->done) return;
+
+    std::string& report = inst->gui.stats.benchmarkReport;
+    report.clear();
+    double baselineSeconds = 0.0;
+    for (const mload::BenchmarkResult& result : benchmarkRun->results) {
+        if (result.baseline) baselineSeconds = result.seconds;
+        char line[128];
+        snprintf(line, sizeof(line), "%-14s %2u threads %8.1fms %5.2fx\n", result.label, result.threadCount, 1000.0 * result.seconds, baselineSeconds / result.seconds);
+        report += line;
+    }
+    benchmarkRun.reset();
+
+}
+#endif
+
 static uint32_t frameIndex = 0; 
-void App::runCycle(Core::Instance* inst) {
+bool App::runCycle(Core::Instance* inst) {
+
+    Core::updateLoads(inst);
+#ifdef DEVINFO
+    finishBenchmarks(inst);
+#endif
     
-    if (IsIconic(inst->wind.hwnd)) { sleepFor(0.005); return; }
+    if (IsIconic(inst->wind.hwnd)) return false;
 
     Gui::Commands commands = 0;
     Gui::draw(inst->wind.hwnd, &commands, &inst->gui);
@@ -993,25 +901,31 @@ void App::runCycle(Core::Instance* inst) {
     // Gui::draw will request certain commands and this executes them
     if (commands & Gui::cmd_minimizeWindowBit) {
         ShowWindow(inst->wind.hwnd, SW_MINIMIZE);
-        return;
+        return true;
     }
     if (commands & Gui::cmd_maximizeWindowBit) {
         ShowWindow(inst->wind.hwnd, SW_MAXIMIZE);
-        return;
+        return true;
     }
     if (commands & Gui::cmd_restoreWindowBit) {
         ShowWindow(inst->wind.hwnd, SW_RESTORE);
-        return;
+        return true;
     }
     if (commands & Gui::cmd_closeWindowBit) {
         PostQuitMessage(0);
-        return;
+        return true;
+    }
+#ifdef DEVINFO
+    if (commands & Gui::cmd_runBenchmarksBit) {
+        startBenchmarks(inst);
+        return true;
     }
+#endif
     if (commands & Gui::cmd_openDialogBit) {
 
         // TODO: the following if is wrong, we are using more descriptor sets already than 1. 
         // -1 because we still need one descriptor set for the frame buffer
-        if (inst->vpRend.vpInstances.size() >= c_vlkn::maxSets - 1) return;
+        if (inst->vpRend.vpInstances.size() + inst->loadQueue.loads.size() >= c_vlkn::maxSets - 1) return true;
 
         char fileName[MAX_PATH]{};
 
@@ -1021,14 +935,14 @@ void App::runCycle(Core::Instance* inst) {
         ofn.lpstrFile = fileName;
         ofn.lpstrFile[0] = '\0';
         ofn.nMaxFile = sizeof(fileName);
-        ofn.lpstrFilter = ".obj or .stl\0*.stl;*.obj\0";
+        ofn.lpstrFilter = ".obj, .stl, .ply, .glb, .gltf or .3mf, optionally in .gz or .zip\0*.stl;*.obj;*.ply;*.glb;*.gltf;*.3mf;*.stl.gz;*.obj.gz;*.ply.gz;*.glb.gz;*.zip\0";
         ofn.nFilterIndex = 1;
         ofn.Flags = OFN_PATHMUSTEXIST | OFN_FILEMUSTEXIST | OFN_EXPLORER;
 
-        if (GetOpenFileNameA(&ofn) != TRUE) return;
+        if (GetOpenFileNameA(&ofn) != TRUE) return true;
 
         Core::openMeshFile(inst, fileName);
-        return;
+        return true;
 
     }
 
@@ -1045,21 +959,20 @@ void App::runCycle(Core::Instance* inst) {
 
             scopedTimer(t1, inst->gui.stats.perfTimes.getTimer("fileClose"));
 
-            vkDeviceWaitIdle(inst->rend.device);
-
-            vkFreeDescriptorSets          (inst->rend.device, inst->rend.descriptorPool, 1, &vpInstance.descriptorSet);
-            Core::destroyGeometryData     (inst->rend.device, &vpInstance); 
-            Core::destroyVpImageResources (inst->rend.device, &vpInstance); 
+            Core::destroyGeometryData     (&inst->rend, &vpInstance); 
+            Core::destroyVpImageResources (&inst->rend, &vpInstance); 
 
             // Remove the window
             inst->vpRend.vpInstances.erase(inst->vpRend.vpInstances.begin() + i);
+            Core::discardViewportTimestamps(&inst->rend);
             inst->gui.vpDatas.erase(inst->gui.vpDatas.begin() + i);
             inst->gui.lastFocusedVp =  inst->gui.vpDatas.size() > 0 ? &inst->gui.vpDatas.back() : nullptr;
 
-            return;
+            return true;
 
         }
-        else if (vpData.resize) {
+        // Render targets released by Core::enforceMemoryBudget are recreated once the viewport is visible again
+        else if (vpData.resize || (vpData.visible && vpInstance.framebuffer == VK_NULL_HANDLE)) {
 
             vpData.resize = false;
 
@@ -1069,40 +982,82 @@ void App::runCycle(Core::Instance* inst) {
             ++inst->gui.stats.resizeCount;
 #endif
 
-            vkDeviceWaitIdle(inst->rend.device);
-
             // Don't run if this is the first time creating the viewport resources
-            if (vpInstance.framebuffer != VK_NULL_HANDLE) Core::destroyVpImageResources(inst->rend.device, &vpInstance); 
+            if (vpInstance.framebuffer != VK_NULL_HANDLE) Core::destroyVpImageResources(&inst->rend, &vpInstance); 
 
             VkExtent2D viewportSize = { (uint32_t)vpData.size.x, (uint32_t)vpData.size.y };
             Core::createVpImageResources(inst, &vpInstance, viewportSize); 
+            vpData.framebufferTexID = (ImTextureID)vpInstance.descriptorSet;
 
         }
 
+        if (vpData.visible) {
+            vpInstance.lastVisibleFrame = inst->rend.frameNumber;
+            if (vpInstance.vertBuff == VK_NULL_HANDLE && !vpInstance.reloadQueued && !vpInstance.reloadFailed) Core::reloadGeometryData(inst, &vpInstance);
+        }
+
     }
 
+    Core::enforceMemoryBudget(inst);
+
+    bool viewportsRendered = false;
+
     // Rendering
     {
 
         scopedTimer(t1, inst->gui.stats.perfTimes.getTimer("renderingCommands"));
      
-        vkWaitForFences(inst->rend.device, 1, &inst->rend.frameFinishedFence, VK_TRUE, UINT64_MAX);
-        vkResetFences  (inst->rend.device, 1, &inst->rend.frameFinishedFence);
+        Core::collectFrameTimings(&inst->rend, &inst->pacer);
+#ifdef DEVINFO
+        Core::LatencyStats latency = inst->pacer.latency();
+        inst->gui.stats.inputLatencyMedian = latency.median;
+        inst->gui.stats.inputLatencyP99    = latency.p99;
+        inst->gui.stats.latencyToPresent   = latency.toPresent;
+        inst->gui.stats.pacingMargin       = (float)inst->pacer.margin;
+        inst->gui.stats.missedDeadlines    = inst->pacer.missedDeadlines;
+#endif
+
+        // Only the frame that used this context last has to be done, the others keep the GPU busy meanwhile
+        Core::FrameContext& frame = inst->rend.frames[frameIndex];
+        {
+            scopedTimer(t2, inst->gui.stats.perfTimes.getTimer("frameFenceWait"));
+            vkWaitForFences(inst->rend.device, 1, &frame.frameFinishedFence, VK_TRUE, UINT64_MAX);
+            Core::waitForFenceWatched(&inst->rend);
+        }
+        Core::readFrameTimestamps(inst, &frame.timestamps);
+        vkResetFences(inst->rend.device, 1, &frame.frameFinishedFence);
+        Core::destroyRetiredObjects(&inst->rend, false);
 
         uint32_t imageIndex;
-        VkResult err = vkAcquireNextImageKHR(inst->rend.device, inst->rend.swapchain, UINT64_MAX, inst->rend.imageReadySemaphore, VK_NULL_HANDLE, &imageIndex);
+        VkResult err;
+        {
+            std::lock_guard<std::mutex> lock(inst->rend.swapchainMutex);
+            err = vkAcquireNextImageKHR(inst->rend.device, inst->rend.swapchain, UINT64_MAX, frame.imageReadySemaphore, VK_NULL_HANDLE, &imageIndex);
+        }
         CORE_ASSERT(err == VK_SUCCESS && "Failed to get next swapchain image.");
 
+        inst->rend.commandBuff = frame.commandBuff;
         vkResetCommandBuffer(inst->rend.commandBuff, 0);
         VkCommandBufferBeginInfo beginInfo{};
         beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
         err = vkBeginCommandBuffer(inst->rend.commandBuff, &beginInfo);
         CORE_ASSERT(err == VK_SUCCESS && "Command Buffer begin failed");
 
+        Core::beginFrameTimestamps(&inst->rend, &frame.timestamps);
+
+        // Geometry whose upload finished is drawn from this frame on
+        uint64_t uploadWaitValue = Core::acquireUploadedGeometry(inst);
+
         VkRenderPassBeginInfo renderPassInfo{};
         VkClearValue clearValues[2]{};
 
         // Viewport render pass
+#ifdef DEVINFO
+        inst->gui.stats.partDraws              = 0;
+        inst->gui.stats.partsCulled            = 0;
+        inst->gui.stats.viewportRenders        = 0;
+        inst->gui.stats.viewportRendersSkipped = 0;
+#endif
         for (int i = 0; i < inst->gui.vpDatas.size(); ++i) {
 
             Gui::ViewportGuiData& vpData = inst->gui.vpDatas[i];
@@ -1110,22 +1065,54 @@ void App::runCycle(Core::Instance* inst) {
 
             Core::ViewportInstance& vpInstance = inst->vpRend.vpInstances[i]; 
 
+            // Unchanged viewports keep the image of their last render for the composite
+            const Core::ViewportRenderState renderState = { vpData.model, vpData.zoomDistance, vpData.farPlaneClip, vpData.showEdges, vpData.partsVersion, vpInstance.resourceVersion };
+            if (renderState == vpInstance.renderedState) {
+#ifdef DEVINFO
+                inst->gui.stats.viewportRendersSkipped++;
+#endif
+                continue;
+            }
+            vpInstance.renderedState = renderState;
+            viewportsRendered = true;
+#ifdef DEVINFO
+            inst->gui.stats.viewportRenders++;
+#endif
+
             VkExtent2D viewportExtent = { (uint32_t)vpData.size.x, (uint32_t)vpData.size.y };
             renderPassInfo.sType = VK_STRUCTURE_TYPE_RENDER_PASS_BEGIN_INFO;
-            renderPassInfo.renderPass        = inst->vpRend.renderPass;
+            renderPassInfo.renderPass        = inst->vpRend.pipelines.renderPass;
             renderPassInfo.framebuffer       = vpInstance.framebuffer;
             renderPassInfo.renderArea.offset = { 0, 0 };
             renderPassInfo.renderArea.extent = viewportExtent;
 
-            clearValues[0].color = { {18 / 255.0, 18 / 255.0, 18 / 255.0, 1.0f} };
+            clearValues[0].color = Core::c_ViewportClearColor;
             clearValues[1].depthStencil = { 1.0f, 0 };
 
             renderPassInfo.clearValueCount = arraySize(clearValues);
             renderPassInfo.pClearValues = clearValues;
 
+            // GPU time of the pass, the edges are drawn last in it
+            const bool profiled = frame.timestamps.viewports.size() < Core::c_MaxProfiledViewports;
+            Core::ViewportTimestamps vpTimestamps = { (uint32_t)i, Core::c_NoTimestamp, Core::c_NoTimestamp, Core::c_NoTimestamp };
+            if (profiled) vpTimestamps.begin = Core::writeTimestamp(&inst->rend, &frame.timestamps, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT);
+
             vkCmdBeginRenderPass(inst->rend.commandBuff, &renderPassInfo, VK_SUBPASS_CONTENTS_INLINE);
 
-            vkCmdBindPipeline(inst->rend.commandBuff, VK_PIPELINE_BIND_POINT_GRAPHICS, inst->vpRend.graphicsPipeline);
+            // Geometry evicted by Core::enforceMemoryBudget is still being reloaded or the upload isn't done, only clear
+            if (vpInstance.vertBuff == VK_NULL_HANDLE || vpInstance.geometryPending) {
+                vkCmdEndRenderPass(inst->rend.commandBuff);
+                if (profiled) {
+                    vpTimestamps.end = Core::writeTimestamp(&inst->rend, &frame.timestamps, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT);
+                    frame.timestamps.viewports.push_back(vpTimestamps);
+                }
+                continue;
+            }
+
+            // Files with colors draw their faces with the color stream bound next to the vertices
+            const bool vertexColors = vpInstance.colorBuff != VK_NULL_HANDLE;
+            const VkPipeline facePipeline = vertexColors ? inst->vpRend.pipelines.vertexColorPipeline : inst->vpRend.pipelines.graphicsPipeline;
+            vkCmdBindPipeline(inst->rend.commandBuff, VK_PIPELINE_BIND_POINT_GRAPHICS, facePipeline);
 
             VkViewport viewport{};
             viewport.x        = 0.0f;
@@ -1143,23 +1130,60 @@ void App::runCycle(Core::Instance* inst) {
 
             VkDeviceSize offsets[] = { 0 };
             vkCmdBindVertexBuffers(inst->rend.commandBuff, 0, 1, &vpInstance.vertBuff, offsets);
+            if (vertexColors) vkCmdBindVertexBuffers(inst->rend.commandBuff, 1, 1, &vpInstance.colorBuff, offsets);
             vkCmdBindIndexBuffer  (inst->rend.commandBuff, vpInstance.indexBuff, 0, VK_INDEX_TYPE_UINT32);
 
-            PushConstants pushConstants; 
-            pushConstants.view = vpData.model * glm::translate(glm::mat4(1.0f), -vpData.modelCenter);
-            pushConstants.view = glm::translate(glm::mat4(1.0f), glm::vec3(0.0f, 0.0f, vpData.zoomDistance))  * pushConstants.view;
-            pushConstants.proj = glm::perspective(glm::radians(45.0f), vpData.size.x / vpData.size.y, 0.01f, vpData.farPlaneClip);
+            Core::PushConstants pushConstants = Core::viewportPushConstants(vpData.model, vpData.modelCenter, vpData.zoomDistance, vpData.size.x / vpData.size.y, vpData.farPlaneClip);
 
 
-            vkCmdPushConstants(inst->rend.commandBuff, inst->vpRend.pipelineLayout, VK_SHADER_STAGE_VERTEX_BIT, 0, sizeof pushConstants, &pushConstants);
+            if (vpInstance.meshParts.empty()) {
+                vkCmdPushConstants(inst->rend.commandBuff, inst->vpRend.pipelines.pipelineLayout, VK_SHADER_STAGE_VERTEX_BIT, 0, sizeof pushConstants, &pushConstants);
 
-            vkCmdDrawIndexed(inst->rend.commandBuff, vpData.indexCount, 1, 0, 0, 0);
-            if (vpData.showEdges) {
-                vkCmdBindPipeline(inst->rend.commandBuff, VK_PIPELINE_BIND_POINT_GRAPHICS, inst->vpRend.meshOutlinePipeline); 
                 vkCmdDrawIndexed(inst->rend.commandBuff, vpData.indexCount, 1, 0, 0, 0);
+                if (vpData.showEdges) {
+                    if (profiled) vpTimestamps.edges = Core::writeTimestamp(&inst->rend, &frame.timestamps, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT);
+                    vkCmdBindPipeline(inst->rend.commandBuff, VK_PIPELINE_BIND_POINT_GRAPHICS, inst->vpRend.pipelines.meshOutlinePipeline); 
+                    vkCmdDrawIndexed(inst->rend.commandBuff, vpData.indexCount, 1, 0, 0, 0);
+                }
+            }
+            else {
+                // One draw per visible part, or per instance of a visible part, with its transform folded into the view. 
+                // Hidden parts and parts outside the frustum don't record anything. 
+                const glm::mat4 view = pushConstants.view;
+                const bool instanced = !vpInstance.meshInstances.empty();
+                size_t drawCount = instanced ? vpInstance.meshInstances.size() : vpInstance.meshParts.size();
+                VkPipeline pipelines[] = { facePipeline, inst->vpRend.pipelines.meshOutlinePipeline };
+                for (uint32_t pass = 0; pass < (vpData.showEdges ? 2u : 1u); pass++) {
+                    if (pass > 0) {
+                        if (profiled) vpTimestamps.edges = Core::writeTimestamp(&inst->rend, &frame.timestamps, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT);
+                        vkCmdBindPipeline(inst->rend.commandBuff, VK_PIPELINE_BIND_POINT_GRAPHICS, pipelines[pass]);
+                    }
+                    for (size_t draw = 0; draw < drawCount; draw++) {
+                        uint32_t partIndex = instanced ? vpInstance.meshInstances[draw].part : (uint32_t)draw;
+                        if (!vpData.parts[partIndex].visible) continue;
+
+                        const Core::MeshPart& part = vpInstance.meshParts[partIndex];
+                        pushConstants.view = instanced ? view * vpInstance.meshInstances[draw].transform : view;
+                        if (Core::boxOutsideFrustum(pushConstants.proj * pushConstants.view, part.boundsMin, part.boundsMax)) {
+#ifdef DEVINFO
+                            if (pass == 0) inst->gui.stats.partsCulled++;
+#endif
+                            continue;
+                        }
+                        vkCmdPushConstants(inst->rend.commandBuff, inst->vpRend.pipelines.pipelineLayout, VK_SHADER_STAGE_VERTEX_BIT, 0, sizeof pushConstants, &pushConstants);
+                        vkCmdDrawIndexed(inst->rend.commandBuff, part.indexCount, 1, part.firstIndex, 0, 0);
+#ifdef DEVINFO
+                        inst->gui.stats.partDraws++;
+#endif
+                    }
+                }
             }
 
             vkCmdEndRenderPass(inst->rend.commandBuff);
+            if (profiled) {
+                vpTimestamps.end = Core::writeTimestamp(&inst->rend, &frame.timestamps, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT);
+                frame.timestamps.viewports.push_back(vpTimestamps);
+            }
 
         }
 
@@ -1176,12 +1200,14 @@ void App::runCycle(Core::Instance* inst) {
             renderPassInfo.pClearValues    = clearValues;
 
 
+            frame.timestamps.mainPassBegin = Core::writeTimestamp(&inst->rend, &frame.timestamps, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT);
             vkCmdBeginRenderPass(inst->rend.commandBuff, &renderPassInfo, VK_SUBPASS_CONTENTS_INLINE);
 
             ImGui::Render();
             ImGui_ImplVulkan_RenderDrawData(ImGui::GetDrawData(), inst->rend.commandBuff);
 
             vkCmdEndRenderPass(inst->rend.commandBuff);
+            frame.timestamps.mainPassEnd = Core::writeTimestamp(&inst->rend, &frame.timestamps, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT);
 
             err = vkEndCommandBuffer(inst->rend.commandBuff);
             CORE_ASSERT(err == VK_SUCCESS && "Command buffer end failed");
@@ -1189,45 +1215,78 @@ void App::runCycle(Core::Instance* inst) {
             VkSubmitInfo submitInfo{};
             submitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
 
-            VkPipelineStageFlags waitStages[] = { VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT };
-            submitInfo.waitSemaphoreCount   = 1;
-            submitInfo.pWaitSemaphores      = &inst->rend.imageReadySemaphore;
+            // The upload timeline is only waited on when geometry was acquired, its value is ignored for the binary semaphore
+            VkSemaphore          waitSemaphores[] = { frame.imageReadySemaphore, inst->rend.stagingRing.timeline };
+            VkPipelineStageFlags waitStages[]     = { VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT, VK_PIPELINE_STAGE_VERTEX_INPUT_BIT };
+            uint64_t             waitValues[]     = { 0, uploadWaitValue };
+            VkTimelineSemaphoreSubmitInfo timelineInfo{};
+            timelineInfo.sType = VK_STRUCTURE_TYPE_TIMELINE_SEMAPHORE_SUBMIT_INFO;
+            timelineInfo.waitSemaphoreValueCount = uploadWaitValue > 0 ? 2 : 1;
+            timelineInfo.pWaitSemaphoreValues    = waitValues;
+
+            submitInfo.pNext                = &timelineInfo;
+            submitInfo.waitSemaphoreCount   = uploadWaitValue > 0 ? 2 : 1;
+            submitInfo.pWaitSemaphores      = waitSemaphores;
             submitInfo.pWaitDstStageMask    = waitStages;
             submitInfo.commandBufferCount   = 1;
             submitInfo.pCommandBuffers      = &inst->rend.commandBuff;
             submitInfo.signalSemaphoreCount = 1;
             submitInfo.pSignalSemaphores    = &inst->rend.swapchainImageObjects[imageIndex].renderDoneSemaphore;
 
-            err = vkQueueSubmit(inst->rend.graphicsQueue, 1, &submitInfo, inst->rend.frameFinishedFence);
+            err = vkQueueSubmit(inst->rend.graphicsQueue, 1, &submitInfo, frame.frameFinishedFence);
             CORE_ASSERT(err == VK_SUCCESS && "Queue submit failed");
 
+            inst->pacer.frameSubmitted(inst->rend.frameNumber, Core::secondsNow());
+            Core::watchFrame(&inst->rend);
+
+            // The id lets the frame watcher stamp when the frame reaches the display
+            uint64_t presentId = inst->rend.frameNumber + 1;
+            VkPresentIdKHR presentIdInfo{};
+            presentIdInfo.sType = VK_STRUCTURE_TYPE_PRESENT_ID_KHR;
+            presentIdInfo.swapchainCount = 1;
+            presentIdInfo.pPresentIds    = &presentId;
+
             VkPresentInfoKHR presentInfo{};
             presentInfo.sType = VK_STRUCTURE_TYPE_PRESENT_INFO_KHR;
+            presentInfo.pNext              = inst->rend.hasPresentWait ? &presentIdInfo : nullptr;
             presentInfo.waitSemaphoreCount = 1;
             presentInfo.pWaitSemaphores    = &inst->rend.swapchainImageObjects[imageIndex].renderDoneSemaphore;
             presentInfo.swapchainCount     = 1;
             presentInfo.pSwapchains        = &inst->rend.swapchain;
             presentInfo.pImageIndices      = &imageIndex;
 
-            err = vkQueuePresentKHR(inst->rend.presentQueue, &presentInfo);
+            {
+                std::lock_guard<std::mutex> lock(inst->rend.swapchainMutex);
+                err = vkQueuePresentKHR(inst->rend.presentQueue, &presentInfo);
+            }
             CORE_ASSERT(err == VK_SUCCESS && "Presenting failed");
 
-            frameIndex = (frameIndex + 1) % inst->rend.imageCount; 
+            frameIndex = (frameIndex + 1) % c_vlkn::framesInFlight; 
+            inst->rend.frameNumber++;
 
         }
          
     }
 
-    float timeError = inst->wind.refreshInterval - ImGui::GetIO().DeltaTime;
-
-    inst->rend.frameWaitTime += timeError;
-    if (inst->rend.frameWaitTime < 0.0f ) inst->rend.frameWaitTime = 0.0f; 
-    sleepFor(inst->rend.frameWaitTime); // This is needed because I want to have low input lag without rendering unnecessary frames. Serisouly, comment out this line and change present mode to VK_PRESENT_MODE_FIFO_KHR and see the difference. 
+    // A changed viewport may keep changing, e.g. while the camera is dragged, loads report their progress and uploads have to be picked up
+    bool uploadsPending = false;
+    for (const Core::ViewportInstance& vpInstance : inst->vpRend.vpInstances) uploadsPending |= vpInstance.geometryPending;
+    return viewportsRendered || !inst->loadQueue.loads.empty() || uploadsPending;
 
 }
 
 void App::close(Core::Instance* inst) {
 
+    // Workers write into the pending loads, so they have to finish before the instance goes away. 
+    Core::waitForLoads(inst);
+#ifdef DEVINFO
+    while (benchmarkRun != nullptr && !benchmarkRun->done) {
+        if (!mload::WorkerPool::shared().runPendingTask()) sleepFor(0.001);
+    }
+    benchmarkRun.reset();
+#endif
+    Core::stopFrameWatcher(&inst->rend);
+
     // IMPORTANT: All vulkan clean up must happen after this line.
     vkDeviceWaitIdle(inst->rend.device);
     // IMPORTANT: All vulkan clean up must happen after this line. Leave extra space below.
@@ -1238,17 +1297,15 @@ void App::close(Core::Instance* inst) {
 
         vkDestroyDescriptorSetLayout (inst->rend.device, inst->vpRend.descriptorSetLayout,    nullptr);
         vkDestroySampler             (inst->rend.device, inst->vpRend.frameSampler,           nullptr);
-        vkDestroyPipeline            (inst->rend.device, inst->vpRend.graphicsPipeline,       nullptr);
-        vkDestroyPipeline            (inst->rend.device, inst->vpRend.meshOutlinePipeline,    nullptr);
-        vkDestroyPipelineLayout      (inst->rend.device, inst->vpRend.pipelineLayout,         nullptr);
-        vkDestroyRenderPass          (inst->rend.device, inst->vpRend.renderPass,             nullptr);
+        Core::destroyViewportPipelines(inst->rend.device, &inst->vpRend.pipelines);
 
         for (Core::ViewportInstance& vpInstance : inst->vpRend.vpInstances) {
 
-            Core::destroyGeometryData     (inst->rend.device, &vpInstance); 
-            Core::destroyVpImageResources (inst->rend.device, &vpInstance); 
+            Core::destroyGeometryData     (&inst->rend, &vpInstance); 
+            Core::destroyVpImageResources (&inst->rend, &vpInstance); 
 
         }
+        Core::destroyRetiredObjects(&inst->rend, true);
 
     }
 
@@ -1261,6 +1318,8 @@ void App::close(Core::Instance* inst) {
         CustomIniData dataOut; 
 
         dataOut.sensitivity     = (int)inst->gui.sensitivity;
+        dataOut.normalMode      = inst->gui.normalMode;
+        dataOut.creaseAngle     = (int)inst->gui.creaseAngle;
         dataOut.windowMaximized = !!IsZoomed(inst->wind.hwnd);
 
         WINDOWPLACEMENT wp;
@@ -1279,6 +1338,8 @@ void App::close(Core::Instance* inst) {
 
     free((void*)iniPath); 
 
+    Core::destroyPipelineCache(&inst->rend);
+
     vkDestroyImageView      (inst->rend.device, inst->vpRend.icoImgView,           nullptr);
     vkDestroyImage          (inst->rend.device, inst->vpRend.icoImg,               nullptr);
     vkFreeMemory            (inst->rend.device, inst->vpRend.icoImgMem,            nullptr);
@@ -1293,8 +1354,14 @@ void App::close(Core::Instance* inst) {
 
         vkDestroySemaphore(inst->rend.device, swapchainObjs.renderDoneSemaphore, nullptr);
     }
-    vkDestroySemaphore(inst->rend.device, inst->rend.imageReadySemaphore, nullptr);
-    vkDestroyFence(inst->rend.device, inst->rend.frameFinishedFence, nullptr);
+    for (uint32_t i = 0; i < c_vlkn::framesInFlight; i++) {
+        vkDestroySemaphore(inst->rend.device, inst->rend.frames[i].imageReadySemaphore, nullptr);
+        vkDestroyFence(inst->rend.device, inst->rend.frames[i].frameFinishedFence, nullptr);
+    }
+
+    Core::destroyStagingRing(&inst->rend);
+    Core::destroyFrameTimestamps(&inst->rend);
+    Core::destroyDeviceAllocator(&inst->rend);
 
     vkDestroyDescriptorPool (inst->rend.device, inst->rend.descriptorPool,         nullptr);
     vkDestroyCommandPool    (inst->rend.device, inst->rend.commandPool,            nullptr);
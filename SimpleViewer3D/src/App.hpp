@@ -15,7 +15,8 @@ struct InstanceInfo {
 };
 
 void init     (Core::Instance* inst, const InstanceInfo& initInfo);
-void runCycle (Core::Instance* inst);
+/// Returns true while there is more to show without new input, see Core::runFrameLoop. 
+bool runCycle (Core::Instance* inst);
 void close    (Core::Instance* inst);
                 
 }
\ No newline at end of file
@@ -0,0 +1,72 @@
+#include "BuddyAllocator.hpp"
+
+#include <algorithm>
+
+void Core::BuddyAllocator::init(uint64_t block, uint64_t min) {
+
+    blockSize       = block;
+    minSize         = min;
+    orderCount      = 1;
+    while ((minSize << (orderCount - 1)) < blockSize) orderCount++;
+    freeOffsets.assign(orderCount, {});
+    freeOffsets[orderCount - 1].push_back(0);
+    allocatedBytes  = 0;
+    requestedBytes  = 0;
+    allocationCount = 0;
+
+}
+bool Core::BuddyAllocator::allocate(uint64_t size, uint64_t alignment, uint64_t* offset, uint32_t* order) {
+
+    uint64_t rangeSize = std::max(size, alignment);
+    uint32_t wanted = 0;
+    while (wanted < orderCount && (minSize << wanted) < rangeSize) wanted++;
+    if (wanted == orderCount) return false;
+
+    // Smallest free range that fits, split in halves down to the wanted order
+    uint32_t found = wanted;
+    while (found < orderCount && freeOffsets[found].empty()) found++;
+    if (found == orderCount) return false;
+
+    uint64_t rangeOffset = freeOffsets[found].back();
+    freeOffsets[found].pop_back();
+    while (found > wanted) {
+        found--;
+        freeOffsets[found].push_back(rangeOffset + (minSize << found));
+    }
+
+    *offset = rangeOffset;
+    *order  = wanted;
+    allocatedBytes += minSize << wanted;
+    requestedBytes += size;
+    allocationCount++;
+    return true;
+
+}
+void Core::BuddyAllocator::free(uint64_t offset, uint32_t order, uint64_t size) {
+
+    allocatedBytes -= minSize << order;
+    requestedBytes -= size;
+    allocationCount--;
+
+    // Merge with the buddy while it is free
+    while (order < orderCount - 1) {
+        uint64_t buddy = offset ^ (minSize << order);
+        std::vector<uint64_t>& offsets = freeOffsets[order];
+        auto it = std::find(offsets.begin(), offsets.end(), buddy);
+        if (it == offsets.end()) break;
+        *it = offsets.back();
+        offsets.pop_back();
+        offset = std::min(offset, buddy);
+        order++;
+    }
+    freeOffsets[order].push_back(offset);
+
+}
+uint64_t Core::BuddyAllocator::largestFree() const {
+
+    for (uint32_t order = orderCount; order-- > 0;) {
+        if (!freeOffsets[order].empty()) return minSize << order;
+    }
+    return 0;
+
+}
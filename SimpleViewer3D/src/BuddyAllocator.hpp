@@ -0,0 +1,32 @@
+#pragma once
+
+// Offsets inside one block of memory. Doesn't depend on Vulkan, the device memory sub-allocator in Core builds on it.
+
+#include <stdint.h>
+#include <vector>
+
+namespace Core {
+
+/// Power of two sub-allocation of a block. Each range is a multiple of its own size from the start of the block, 
+/// so any alignment up to the range size holds, and freed ranges merge with their free buddy. 
+struct BuddyAllocator {
+
+    uint64_t                           blockSize;
+    uint64_t                           minSize;         // size of order 0, a power of two
+    uint32_t                           orderCount;      // the whole block is order orderCount - 1
+    std::vector<std::vector<uint64_t>> freeOffsets;     // per order
+    uint64_t                           allocatedBytes;  // rounded up to the orders
+    uint64_t                           requestedBytes;  // what the allocations asked for, the rest is rounding waste
+    uint32_t                           allocationCount;
+
+    /// blockSize and minSize must be powers of two. 
+    void     init        (uint64_t blockSize, uint64_t minSize);
+    /// Returns false if there is no free range large enough. 
+    bool     allocate    (uint64_t size, uint64_t alignment, uint64_t* offset, uint32_t* order);
+    void     free        (uint64_t offset, uint32_t order, uint64_t size);
+    /// Size of the largest free range, less than the free bytes when they are fragmented. 
+    uint64_t largestFree () const;
+
+};
+
+}
@@ -2,12 +2,15 @@
 #include "CoreConstants.hpp"
 
 #include <ModelLoader.hpp>
+#include <WorkerPool.hpp>
 
 #include <VulkanHelpers.hpp>
 
 #include <algorithm>
+#include <cstdio>
+#include <deque>
 
-void Core::createSwapchain(Instance* inst) {
+void Core::createSwapchain(Instance* inst, VkSwapchainKHR oldSwapchain) {
 
     // Swapchain creation 
     {
@@ -56,7 +59,7 @@ void Core::createSwapchain(Instance* inst) {
         createInfo.compositeAlpha = VK_COMPOSITE_ALPHA_OPAQUE_BIT_KHR;
         createInfo.presentMode = inst->rend.presentMode;
         createInfo.clipped = VK_TRUE;
-        createInfo.oldSwapchain = VK_NULL_HANDLE;
+        createInfo.oldSwapchain = oldSwapchain;
 
         VkResult err = vkCreateSwapchainKHR(inst->rend.device, &createInfo, nullptr, &inst->rend.swapchain);
         CORE_ASSERT(err == VK_SUCCESS && "Swapchain creation failed");
@@ -138,73 +141,842 @@ void Core::cleanupSwapchainResources(VlknRenderInstance* rend) {
 }
 void Core::recreateSwapchain(Instance* inst) {
 
-    vkDeviceWaitIdle(inst->rend.device);
+    VlknRenderInstance* rend = &inst->rend;
 
-    cleanupSwapchainResources(&inst->rend);
+    // The frames in flight may still render to and present the old images
+    for (unsigned i = 0; i < rend->imageCount; ++i) {
+        SwapchainImageObjects& swapchainObjs = rend->swapchainImageObjects[i]; 
+
+        retireObject(rend, VK_OBJECT_TYPE_FRAMEBUFFER, (uint64_t)swapchainObjs.framebuffer);
+        retireObject(rend, VK_OBJECT_TYPE_IMAGE_VIEW,  (uint64_t)swapchainObjs.imageView);
+    }
+    VkSwapchainKHR oldSwapchain = rend->swapchain;
+
+    {
+        std::lock_guard<std::mutex> lock(rend->swapchainMutex);
+        createSwapchain(inst, oldSwapchain);
+        rend->firstPresentId = rend->frameNumber + 1;
+    }
+    createFramebuffers(rend);
 
-    createSwapchain(inst);
-    createFramebuffers(&inst->rend);
+    retireObject(rend, VK_OBJECT_TYPE_SWAPCHAIN_KHR, (uint64_t)oldSwapchain);
 
 }
+void Core::retireObject(VlknRenderInstance* rend, VkObjectType type, uint64_t handle) {
 
-void Core::createGeometryData(Instance* inst, ViewportInstance* vpInst, VertexIndexBuffersInfo* buffsInfo) {
+    if (handle == 0) return;
+    rend->retiredObjects.push_back({ rend->frameNumber, type, handle, {} });
 
-    VkBuffer       vertStageBuff, indexStageBuff;
-    VkDeviceMemory vertStageMem,  indexStageMem;
+}
+void Core::retireMemory(VlknRenderInstance* rend, MemoryAllocation* allocation) {
 
-    // Vertex buffer
+    if (allocation->memory == VK_NULL_HANDLE) return;
+    rend->retiredObjects.push_back({ rend->frameNumber, VK_OBJECT_TYPE_DEVICE_MEMORY, 0, *allocation });
+    *allocation = {};
+
+}
+void Core::destroyRetiredObjects(VlknRenderInstance* rend, bool deviceIdle) {
+
+    // Frames finish in submission order, so once the fence of the current frame context is signaled 
+    // every frame up to frameNumber - framesInFlight is done. Objects are destroyed in the order they were retired.
+    size_t keptCount = 0;
+    for (RetiredObject& obj : rend->retiredObjects) {
+
+        if (!deviceIdle && obj.frameNumber + c_vlkn::framesInFlight > rend->frameNumber) {
+            rend->retiredObjects[keptCount++] = obj;
+            continue;
+        }
+
+        switch (obj.type) {
+        case VK_OBJECT_TYPE_BUFFER:         vkDestroyBuffer      (rend->device, (VkBuffer)obj.handle,       nullptr); break;
+        case VK_OBJECT_TYPE_DEVICE_MEMORY:  freeMemory           (rend, &obj.allocation);                   break;
+        case VK_OBJECT_TYPE_IMAGE:          vkDestroyImage       (rend->device, (VkImage)obj.handle,        nullptr); break;
+        case VK_OBJECT_TYPE_IMAGE_VIEW:     vkDestroyImageView   (rend->device, (VkImageView)obj.handle,    nullptr); break;
+        case VK_OBJECT_TYPE_FRAMEBUFFER:    vkDestroyFramebuffer (rend->device, (VkFramebuffer)obj.handle,  nullptr); break;
+        case VK_OBJECT_TYPE_SWAPCHAIN_KHR: {
+            // The frame watcher may still be in a present wait on it, it gives up within a slice once the swapchain is replaced
+            std::unique_lock<std::mutex> lock(rend->swapchainMutex);
+            if (!deviceIdle && rend->presentWaitSwapchain == (VkSwapchainKHR)obj.handle) {
+                rend->retiredObjects[keptCount++] = obj;
+                continue;
+            }
+            lock.unlock();
+            vkDestroySwapchainKHR(rend->device, (VkSwapchainKHR)obj.handle, nullptr);
+            break;
+        }
+        case VK_OBJECT_TYPE_DESCRIPTOR_SET: {
+            VkDescriptorSet descriptorSet = (VkDescriptorSet)obj.handle;
+            vkFreeDescriptorSets(rend->device, rend->descriptorPool, 1, &descriptorSet);
+            break;
+        }
+        default: CORE_ASSERT(!"Retired object type is not handled");
+        }
+
+    }
+    rend->retiredObjects.resize(keptCount);
+
+}
+
+void Core::initDeviceAllocator(VlknRenderInstance* rend) {
+
+    DeviceAllocator& allocator = rend->allocator;
+    vkGetPhysicalDeviceMemoryProperties(rend->physicalDevice, &allocator.memProps);
+    allocator.blocks.clear();
+    allocator.dedicatedCount = 0;
+    allocator.dedicatedBytes = 0;
+
+}
+void Core::destroyDeviceAllocator(VlknRenderInstance* rend) {
+
+    for (MemoryBlock& block : rend->allocator.blocks) {
+        if (block.memory == VK_NULL_HANDLE) continue;
+        CORE_ASSERT(block.ranges.allocationCount == 0 && "Memory block still has allocations");
+        if (block.pMapped) vkUnmapMemory(rend->device, block.memory);
+        vkFreeMemory(rend->device, block.memory, nullptr);
+    }
+    rend->allocator.blocks.clear();
+    CORE_ASSERT(rend->allocator.dedicatedCount == 0 && "Dedicated allocations were not freed");
+
+}
+static VkDeviceMemory allocateDeviceMemory(Core::VlknRenderInstance* rend, VkDeviceSize size, uint32_t memoryTypeIndex, char** pMapped) {
+
+    VkMemoryAllocateInfo allocInfo{};
+    allocInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
+    allocInfo.allocationSize  = size;
+    allocInfo.memoryTypeIndex = memoryTypeIndex;
+
+    VkDeviceMemory memory;
+    VkResult err = vkAllocateMemory(rend->device, &allocInfo, nullptr, &memory);
+    assertExit(err == VK_SUCCESS, "Device memory allocation failed");
+
+    // Host visible memory stays mapped for as long as it lives
+    *pMapped = nullptr;
+    if (rend->allocator.memProps.memoryTypes[memoryTypeIndex].propertyFlags & VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT) {
+        err = vkMapMemory(rend->device, memory, 0, VK_WHOLE_SIZE, 0, (void**)pMapped);
+        assertExit(err == VK_SUCCESS, "Device memory mapping failed");
+    }
+    return memory;
+
+}
+Core::MemoryAllocation Core::allocateMemory(VlknRenderInstance* rend, const VkMemoryRequirements& requirements, VkMemoryPropertyFlags properties, bool linear) {
+
+    DeviceAllocator& allocator = rend->allocator;
+
+    uint32_t memoryTypeIndex = 0;
+    for (; memoryTypeIndex < allocator.memProps.memoryTypeCount; memoryTypeIndex++) {
+        if ((requirements.memoryTypeBits & (1 << memoryTypeIndex)) && 
+            (allocator.memProps.memoryTypes[memoryTypeIndex].propertyFlags & properties) == properties) break;
+    }
+    assertExit(memoryTypeIndex < allocator.memProps.memoryTypeCount, "No memory type with the required properties");
+
+    MemoryAllocation allocation{};
+    allocation.size = requirements.size;
+
+    if (requirements.size >= c_vlkn::dedicatedAllocationSize || requirements.alignment > c_vlkn::memoryBlockSize) {
+        allocation.memory = allocateDeviceMemory(rend, requirements.size, memoryTypeIndex, &allocation.pMapped);
+        allocation.block  = c_DedicatedAllocation;
+        allocator.dedicatedCount++;
+        allocator.dedicatedBytes += requirements.size;
+        return allocation;
+    }
+
+    // First block of the kind with a large enough free range, a new one if there is none
+    uint32_t freeSlot = (uint32_t)allocator.blocks.size();
+    for (uint32_t i = 0; i < allocator.blocks.size(); i++) {
+
+        MemoryBlock& block = allocator.blocks[i];
+        if (block.memory == VK_NULL_HANDLE) { freeSlot = std::min(freeSlot, i); continue; }
+        if (block.memoryTypeIndex != memoryTypeIndex || block.linear != linear) continue;
+
+        uint64_t offset;
+        if (block.ranges.allocate(requirements.size, requirements.alignment, &offset, &allocation.order)) {
+            allocation.memory  = block.memory;
+            allocation.offset  = offset;
+            allocation.block   = i;
+            allocation.pMapped = block.pMapped ? block.pMapped + offset : nullptr;
+            return allocation;
+        }
+
+    }
+
+    if (freeSlot == allocator.blocks.size()) allocator.blocks.emplace_back();
+    MemoryBlock& block = allocator.blocks[freeSlot];
+    block.memory          = allocateDeviceMemory(rend, c_vlkn::memoryBlockSize, memoryTypeIndex, &block.pMapped);
+    block.memoryTypeIndex = memoryTypeIndex;
+    block.linear          = linear;
+    block.ranges.init(c_vlkn::memoryBlockSize, c_vlkn::minAllocationSize);
+
+    uint64_t offset;
+    bool fits = block.ranges.allocate(requirements.size, requirements.alignment, &offset, &allocation.order);
+    CORE_ASSERT(fits && "Allocation does not fit in an empty block");
+    allocation.memory  = block.memory;
+    allocation.offset  = offset;
+    allocation.block   = freeSlot;
+    allocation.pMapped = block.pMapped ? block.pMapped + offset : nullptr;
+    return allocation;
+
+}
+void Core::freeMemory(VlknRenderInstance* rend, MemoryAllocation* allocation) {
+
+    DeviceAllocator& allocator = rend->allocator;
+    if (allocation->memory == VK_NULL_HANDLE) return;
+
+    if (allocation->block == c_DedicatedAllocation) {
+        if (allocation->pMapped) vkUnmapMemory(rend->device, allocation->memory);
+        vkFreeMemory(rend->device, allocation->memory, nullptr);
+        allocator.dedicatedCount--;
+        allocator.dedicatedBytes -= allocation->size;
+        *allocation = {};
+        return;
+    }
+
+    MemoryBlock& block = allocator.blocks[allocation->block];
+    block.ranges.free(allocation->offset, allocation->order, allocation->size);
+    uint32_t blockIndex = allocation->block;
+    *allocation = {};
+    if (block.ranges.allocationCount > 0) return;
+
+    // One empty block of each kind is kept so that a viewport being reopened or resized doesn't allocate again
+    for (uint32_t i = 0; i < allocator.blocks.size(); i++) {
+
+        const MemoryBlock& other = allocator.blocks[i];
+        if (i == blockIndex || other.memory == VK_NULL_HANDLE || other.ranges.allocationCount > 0) continue;
+        if (other.memoryTypeIndex != block.memoryTypeIndex || other.linear != block.linear) continue;
+
+        if (block.pMapped) vkUnmapMemory(rend->device, block.memory);
+        vkFreeMemory(rend->device, block.memory, nullptr);
+        block.memory  = VK_NULL_HANDLE;
+        block.pMapped = nullptr;
+        return;
+
+    }
+
+}
+void Core::createBuffer(VlknRenderInstance* rend, VkDeviceSize size, VkBufferUsageFlags usage, VkMemoryPropertyFlags properties, VkBuffer* buff, MemoryAllocation* allocation) {
+
+    VkBufferCreateInfo buffInfo{};
+    buffInfo.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
+    buffInfo.size        = size;
+    buffInfo.usage       = usage;
+    buffInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+
+    VkResult err = vkCreateBuffer(rend->device, &buffInfo, nullptr, buff);
+    assertExit(err == VK_SUCCESS, "Buffer creation failed");
+
+    VkMemoryRequirements memRequirements;
+    vkGetBufferMemoryRequirements(rend->device, *buff, &memRequirements);
+    *allocation = allocateMemory(rend, memRequirements, properties, true);
+
+    err = vkBindBufferMemory(rend->device, *buff, allocation->memory, allocation->offset);
+    assertExit(err == VK_SUCCESS, "Buffer memory binding failed");
+
+}
+void Core::allocateImageMemory(VlknRenderInstance* rend, VkImage image, MemoryAllocation* allocation) {
+
+    VkMemoryRequirements memRequirements;
+    vkGetImageMemoryRequirements(rend->device, image, &memRequirements);
+    *allocation = allocateMemory(rend, memRequirements, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, false);
+
+    VkResult err = vkBindImageMemory(rend->device, image, allocation->memory, allocation->offset);
+    assertExit(err == VK_SUCCESS, "Image memory binding failed");
+
+}
+
+/// Prefix of the pipeline cache file. The header of the cache data has no driver version, so it is kept here next to the size. 
+struct PipelineCacheFileHeader {
+
+    uint32_t magic;
+    uint32_t driverVersion;
+    uint64_t dataSize;
+
+};
+constexpr uint32_t c_PipelineCacheMagic = 0x43505653; // "SVPC"
+/// The app's few pipelines take kilobytes, a larger size comes from a damaged file. 
+constexpr uint64_t c_MaxPipelineCacheSize = 64ull << 20;
+
+bool Core::createPipelineCache(VlknRenderInstance* rend) {
+
+    VkPhysicalDeviceProperties deviceProperties;
+    vkGetPhysicalDeviceProperties(rend->physicalDevice, &deviceProperties);
+
+    // Data of a cache written by another device or driver would be ignored at best, it is dropped here
+    std::vector<char> data;
+    FILE* file = fopen(rend->pipelineCachePath.get(), "rb");
+    if (file != nullptr) {
+
+        PipelineCacheFileHeader fileHeader{};
+        bool valid = fread(&fileHeader, sizeof fileHeader, 1, file) == 1 && fileHeader.magic == c_PipelineCacheMagic && 
+            fileHeader.driverVersion == deviceProperties.driverVersion && fileHeader.dataSize >= sizeof(VkPipelineCacheHeaderVersionOne);
+        if (valid) {
+            // The size is only trusted if the file holds that much
+            long dataStart = ftell(file);
+            fseek(file, 0, SEEK_END);
+            long fileSize = ftell(file);
+            fseek(file, dataStart, SEEK_SET);
+            valid = dataStart >= 0 && fileSize >= dataStart && fileHeader.dataSize <= (uint64_t)(fileSize - dataStart) && 
+                fileHeader.dataSize <= c_MaxPipelineCacheSize;
+        }
+        if (valid) {
+            data.resize((size_t)fileHeader.dataSize);
+            valid = fread(data.data(), 1, data.size(), file) == data.size();
+        }
+        if (valid) {
+            VkPipelineCacheHeaderVersionOne cacheHeader;
+            memcpy(&cacheHeader, data.data(), sizeof cacheHeader);
+            valid = cacheHeader.headerVersion == VK_PIPELINE_CACHE_HEADER_VERSION_ONE && 
+                cacheHeader.vendorID == deviceProperties.vendorID && cacheHeader.deviceID == deviceProperties.deviceID && 
+                memcmp(cacheHeader.pipelineCacheUUID, deviceProperties.pipelineCacheUUID, VK_UUID_SIZE) == 0;
+        }
+        if (!valid) data.clear();
+        fclose(file);
+
+    }
+
+    VkPipelineCacheCreateInfo createInfo{};
+    createInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_CACHE_CREATE_INFO;
+    createInfo.initialDataSize = data.size();
+    createInfo.pInitialData    = data.empty() ? nullptr : data.data();
+
+    VkResult err = vkCreatePipelineCache(rend->device, &createInfo, nullptr, &rend->pipelineCache);
+    if (err != VK_SUCCESS && !data.empty()) {
+        createInfo.initialDataSize = 0;
+        createInfo.pInitialData    = nullptr;
+        data.clear();
+        err = vkCreatePipelineCache(rend->device, &createInfo, nullptr, &rend->pipelineCache);
+    }
+    assertExit(err == VK_SUCCESS, "Pipeline cache creation failed");
+
+    return !data.empty();
+
+}
+void Core::destroyPipelineCache(VlknRenderInstance* rend) {
+
+    VkPhysicalDeviceProperties deviceProperties;
+    vkGetPhysicalDeviceProperties(rend->physicalDevice, &deviceProperties);
+
+    size_t dataSize = 0;
+    std::vector<char> data;
+    VkResult err = vkGetPipelineCacheData(rend->device, rend->pipelineCache, &dataSize, nullptr);
+    if (err == VK_SUCCESS && dataSize > 0) {
+        data.resize(dataSize);
+        err = vkGetPipelineCacheData(rend->device, rend->pipelineCache, &dataSize, data.data());
+    }
+    vkDestroyPipelineCache(rend->device, rend->pipelineCache, nullptr);
+    if (err != VK_SUCCESS || dataSize == 0) return;
+
+    // Written next to the old file and moved over it, so a crash while writing can't leave a truncated cache behind
+    const char* path = rend->pipelineCachePath.get();
+    std::unique_ptr<char[]> tempPath(new char[strlen(path) + 5]);
+    strcpy(tempPath.get(), path);
+    strcat(tempPath.get(), ".tmp");
+
+    FILE* file = fopen(tempPath.get(), "wb");
+    if (file == nullptr) return;
+    PipelineCacheFileHeader fileHeader{ c_PipelineCacheMagic, deviceProperties.driverVersion, dataSize };
+    bool written = fwrite(&fileHeader, sizeof fileHeader, 1, file) == 1 && fwrite(data.data(), 1, dataSize, file) == dataSize;
+    written &= fclose(file) == 0;
+
+    if (written) MoveFileExA(tempPath.get(), path, MOVEFILE_REPLACE_EXISTING);
+    else         DeleteFileA(tempPath.get());
+
+}
+
+void Core::createStagingRing(VlknRenderInstance* rend) {
+
+    StagingRing& ring = rend->stagingRing;
+    ring.segmentSize  = c_vlkn::stagingSegmentSize;
+
+    // Ring buffer, the allocator keeps host visible memory mapped for the lifetime of the app
+    createBuffer(rend, c_StagingSegmentCount * ring.segmentSize, VK_BUFFER_USAGE_TRANSFER_SRC_BIT, 
+        VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, &ring.buff, &ring.mem);
+    ring.pMappedData = ring.mem.pMapped;
+
+    // Transfer command pool
     {
 
-        vlknh::BufferCreateInfo buffInfo{};
-        buffInfo.physicalDevice = inst->rend.physicalDevice;
-        buffInfo.size           = buffsInfo->vertexDataSize;
-        buffInfo.usage          = VK_BUFFER_USAGE_TRANSFER_SRC_BIT;
-        buffInfo.properties     = VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT;
+        VkCommandPoolCreateInfo createInfo{};
+        createInfo.sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO;
+        createInfo.flags = VK_COMMAND_POOL_CREATE_RESET_COMMAND_BUFFER_BIT;
+        createInfo.queueFamilyIndex = rend->transferQueueIndex;
+
+        VkResult err = vkCreateCommandPool(rend->device, &createInfo, nullptr, &ring.commandPool);
+        assertExit(err == VK_SUCCESS, "Staging ring command pool creation failed");
+
+    }
+
+    // Segment command buffers
+    {
 
-        vlknh::createBuffer(inst->rend.device, buffInfo, &vertStageBuff, &vertStageMem);
-        vlknh::loadBuffer(inst->rend.device, vertStageMem, buffsInfo->vertexData, buffsInfo->vertexDataSize);
+        VkCommandBufferAllocateInfo allocInfo{};
+        allocInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+        allocInfo.commandPool        = ring.commandPool;
+        allocInfo.level              = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
+        allocInfo.commandBufferCount = c_StagingSegmentCount;
 
-        buffInfo.usage = VK_BUFFER_USAGE_TRANSFER_DST_BIT | VK_BUFFER_USAGE_VERTEX_BUFFER_BIT;
-        buffInfo.properties = VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT;
-        vlknh::createBuffer(inst->rend.device, buffInfo, &vpInst->vertBuff, &vpInst->vertBuffMem);
+        VkResult err = vkAllocateCommandBuffers(rend->device, &allocInfo, ring.commandBuffs);
+        assertExit(err == VK_SUCCESS, "Staging ring command buffer allocation failed");
 
     }
 
-    // Indexbuffer
+    // Timeline semaphore
+    {
+
+        VkSemaphoreTypeCreateInfo typeInfo{};
+        typeInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_TYPE_CREATE_INFO;
+        typeInfo.semaphoreType = VK_SEMAPHORE_TYPE_TIMELINE;
+        typeInfo.initialValue  = 0;
+
+        VkSemaphoreCreateInfo semaphoreInfo{};
+        semaphoreInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO;
+        semaphoreInfo.pNext = &typeInfo;
+
+        VkResult err = vkCreateSemaphore(rend->device, &semaphoreInfo, nullptr, &ring.timeline);
+        assertExit(err == VK_SUCCESS, "Staging ring timeline semaphore creation failed");
+
+    }
+
+    for (uint32_t i = 0; i < c_StagingSegmentCount; i++) ring.segmentValues[i] = 0;
+    ring.submittedValue = 0;
+    ring.segmentIndex   = 0;
+    ring.segmentOffset  = 0;
+    ring.recording      = false;
+
+}
+void Core::destroyStagingRing(VlknRenderInstance* rend) {
+
+    StagingRing& ring = rend->stagingRing;
+
+    vkDestroySemaphore   (rend->device, ring.timeline, nullptr);
+    vkFreeCommandBuffers (rend->device, ring.commandPool, c_StagingSegmentCount, ring.commandBuffs);
+    vkDestroyCommandPool (rend->device, ring.commandPool, nullptr);
+    vkDestroyBuffer      (rend->device, ring.buff, nullptr);
+    freeMemory           (rend, &ring.mem);
+
+}
+static void submitStagingSegment(Core::VlknRenderInstance* rend) {
+
+    Core::StagingRing& ring = rend->stagingRing;
+    VkCommandBuffer commandBuff = ring.commandBuffs[ring.segmentIndex];
+
+    VkResult err = vkEndCommandBuffer(commandBuff);
+    CORE_ASSERT(err == VK_SUCCESS && "Staging command buffer end failed");
+
+    ring.submittedValue++;
+    ring.segmentValues[ring.segmentIndex] = ring.submittedValue;
+
+    VkTimelineSemaphoreSubmitInfo timelineInfo{};
+    timelineInfo.sType = VK_STRUCTURE_TYPE_TIMELINE_SEMAPHORE_SUBMIT_INFO;
+    timelineInfo.signalSemaphoreValueCount = 1;
+    timelineInfo.pSignalSemaphoreValues    = &ring.submittedValue;
+
+    VkSubmitInfo submitInfo{};
+    submitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+    submitInfo.pNext                = &timelineInfo;
+    submitInfo.commandBufferCount   = 1;
+    submitInfo.pCommandBuffers      = &commandBuff;
+    submitInfo.signalSemaphoreCount = 1;
+    submitInfo.pSignalSemaphores    = &ring.timeline;
+
+    err = vkQueueSubmit(rend->transferQueue, 1, &submitInfo, VK_NULL_HANDLE);
+    CORE_ASSERT(err == VK_SUCCESS && "Staging queue submit failed");
+
+    ring.segmentIndex  = (ring.segmentIndex + 1) % c_StagingSegmentCount;
+    ring.segmentOffset = 0;
+    ring.recording     = false;
+
+}
+/// Barrier that hands the buffer from the transfer family to the graphics family, recorded on both sides of the transfer. 
+static VkBufferMemoryBarrier ownershipBarrier(Core::VlknRenderInstance* rend, VkBuffer buff) {
+
+    VkBufferMemoryBarrier barrier{};
+    barrier.sType = VK_STRUCTURE_TYPE_BUFFER_MEMORY_BARRIER;
+    barrier.srcQueueFamilyIndex = rend->transferQueueIndex;
+    barrier.dstQueueFamilyIndex = rend->graphicsQueueIndex;
+    barrier.buffer              = buff;
+    barrier.offset              = 0;
+    barrier.size                = VK_WHOLE_SIZE;
+    return barrier;
+
+}
+void Core::stageBufferUpload(VlknRenderInstance* rend, VkBuffer dstBuff, const void* data, VkDeviceSize size) {
+
+    StagingRing& ring = rend->stagingRing;
+    const char* src = (const char*)data;
+    VkDeviceSize dstOffset = 0;
+
+    while (size > 0) {
+
+        VkCommandBuffer commandBuff = ring.commandBuffs[ring.segmentIndex];
+
+        if (!ring.recording) {
+
+            // The GPU has to be done copying out of this segment before it gets overwritten.
+            waitForUpload(rend, ring.segmentValues[ring.segmentIndex]);
+
+            vkResetCommandBuffer(commandBuff, 0);
+            VkCommandBufferBeginInfo beginInfo{};
+            beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+            beginInfo.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+            VkResult err = vkBeginCommandBuffer(commandBuff, &beginInfo);
+            CORE_ASSERT(err == VK_SUCCESS && "Staging command buffer begin failed");
+
+            ring.recording = true;
+
+        }
+
+        VkDeviceSize chunkSize = std::min(size, ring.segmentSize - ring.segmentOffset);
+        VkDeviceSize ringOffset = ring.segmentIndex * ring.segmentSize + ring.segmentOffset;
+        memcpy(&ring.pMappedData[ringOffset], src, chunkSize);
+
+        VkBufferCopy copyRegion{};
+        copyRegion.srcOffset = ringOffset;
+        copyRegion.dstOffset = dstOffset;
+        copyRegion.size      = chunkSize;
+        vkCmdCopyBuffer(commandBuff, ring.buff, dstBuff, 1, &copyRegion);
+
+        ring.segmentOffset += chunkSize;
+        dstOffset          += chunkSize;
+        src                += chunkSize;
+        size               -= chunkSize;
+
+        // Release after the last copy, it covers the copies of the earlier segments too since they were submitted before
+        if (size == 0 && rend->transferQueueIndex != rend->graphicsQueueIndex) {
+            VkBufferMemoryBarrier barrier = ownershipBarrier(rend, dstBuff);
+            barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+            vkCmdPipelineBarrier(commandBuff, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, 0, 0, nullptr, 1, &barrier, 0, nullptr);
+        }
+
+        if (ring.segmentOffset == ring.segmentSize) submitStagingSegment(rend);
+
+    }
+
+}
+uint64_t Core::stagedUploadValue(VlknRenderInstance* rend) {
+
+    return rend->stagingRing.recording ? rend->stagingRing.submittedValue + 1 : rend->stagingRing.submittedValue;
+
+}
+void Core::submitStagingRing(VlknRenderInstance* rend) {
+
+    if (rend->stagingRing.recording) submitStagingSegment(rend);
+
+}
+bool Core::uploadDone(VlknRenderInstance* rend, uint64_t uploadValue) {
+
+    uint64_t value;
+    vkGetSemaphoreCounterValue(rend->device, rend->stagingRing.timeline, &value);
+    return value >= uploadValue;
+
+}
+void Core::waitForUpload(VlknRenderInstance* rend, uint64_t uploadValue) {
+
+    CORE_ASSERT(uploadValue <= rend->stagingRing.submittedValue && "Waiting for an upload that was not submitted");
+
+    VkSemaphoreWaitInfo waitInfo{};
+    waitInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_WAIT_INFO;
+    waitInfo.semaphoreCount = 1;
+    waitInfo.pSemaphores    = &rend->stagingRing.timeline;
+    waitInfo.pValues        = &uploadValue;
+    vkWaitSemaphores(rend->device, &waitInfo, UINT64_MAX);
+
+}
+uint64_t Core::acquireUploadedGeometry(Instance* inst) {
+
+    uint64_t waitValue = 0;
+    std::vector<VkBufferMemoryBarrier> barriers;
+
+    for (ViewportInstance& vpInstance : inst->vpRend.vpInstances) {
+
+        if (!vpInstance.geometryPending || !uploadDone(&inst->rend, vpInstance.uploadValue)) continue;
+
+        // The semaphore wait of the frame makes the copies visible, the barriers complete the ownership transfer
+        if (inst->rend.transferQueueIndex != inst->rend.graphicsQueueIndex) {
+            for (VkBuffer buff : { vpInstance.vertBuff, vpInstance.indexBuff, vpInstance.colorBuff }) {
+                if (buff == VK_NULL_HANDLE) continue;
+                VkBufferMemoryBarrier barrier = ownershipBarrier(&inst->rend, buff);
+                barrier.dstAccessMask = VK_ACCESS_VERTEX_ATTRIBUTE_READ_BIT | VK_ACCESS_INDEX_READ_BIT;
+                barriers.push_back(barrier);
+            }
+        }
+
+        waitValue = std::max(waitValue, vpInstance.uploadValue);
+        vpInstance.geometryPending = false;
+        vpInstance.resourceVersion++;
+
+    }
+
+    // The frame waits on the timeline at vertex input, the acquire has to be ordered after that wait
+    if (!barriers.empty()) {
+        vkCmdPipelineBarrier(inst->rend.commandBuff, VK_PIPELINE_STAGE_VERTEX_INPUT_BIT, VK_PIPELINE_STAGE_VERTEX_INPUT_BIT, 0, 
+            0, nullptr, (uint32_t)barriers.size(), barriers.data(), 0, nullptr);
+    }
+    return waitValue;
+
+}
+
+double Core::secondsNow() {
+
+    return std::chrono::duration<double>(std::chrono::steady_clock::now().time_since_epoch()).count();
+
+}
+/// Waits one slice for the frame to reach the display. @return false while it is still on its way
+static bool waitForPresent(Core::VlknRenderInstance* rend, Core::WatchedFrame* frame) {
+
+    uint64_t presentId = frame->frameNumber + 1;
+    VkSwapchainKHR swapchain;
+    {
+        // Only the handle is read under the lock, acquire and present on the main thread don't wait for the display
+        std::lock_guard<std::mutex> lock(rend->swapchainMutex);
+        if (presentId < rend->firstPresentId) return true; // the swapchain it went to was replaced
+        swapchain = rend->swapchain;
+        rend->presentWaitSwapchain = swapchain;
+    }
+    VkResult err = rend->waitForPresentKHR(rend->device, swapchain, presentId, c_vlkn::presentWaitSlice);
     {
+        std::lock_guard<std::mutex> lock(rend->swapchainMutex);
+        rend->presentWaitSwapchain = VK_NULL_HANDLE;
+    }
+
+    if (err == VK_SUCCESS) frame->presentTime = Core::secondsNow();
+    return err != VK_TIMEOUT || Core::secondsNow() - frame->gpuDoneTime >= c_vlkn::presentWaitLimit;
+
+}
+static void watchFrames(Core::VlknRenderInstance* rend) {
+
+    Core::FrameWatcher& watcher = rend->frameWatcher;
+    std::deque<Core::WatchedFrame> presenting; // done on the GPU, not yet on the display
+    std::unique_lock<std::mutex> lock(watcher.mutex);
+
+    while (true) {
 
-        vlknh::BufferCreateInfo buffInfo{};
-        buffInfo.physicalDevice = inst->rend.physicalDevice;
-        buffInfo.size           = buffsInfo->indexDataSize;
-        buffInfo.usage          = VK_BUFFER_USAGE_TRANSFER_SRC_BIT;
-        buffInfo.properties     = VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT;
+        if (presenting.empty()) watcher.changed.wait(lock, [&watcher]() { return watcher.quit || watcher.submitted > watcher.watched; });
+        if (watcher.quit && watcher.submitted == watcher.watched) return;
 
-        vlknh::createBuffer(inst->rend.device, buffInfo, &indexStageBuff, &indexStageMem);
-        vlknh::loadBuffer(inst->rend.device, indexStageMem, buffsInfo->indexData, buffsInfo->indexDataSize);
+        bool     hasFrame    = watcher.submitted > watcher.watched;
+        uint64_t frameNumber = watcher.watched;
+        VkFence  fence       = rend->frames[frameNumber % c_vlkn::framesInFlight].frameFinishedFence;
+        lock.unlock();
 
-        buffInfo.usage = VK_BUFFER_USAGE_TRANSFER_DST_BIT | VK_BUFFER_USAGE_INDEX_BUFFER_BIT;
-        buffInfo.properties = VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT;
-        vlknh::createBuffer(inst->rend.device, buffInfo, &vpInst->indexBuff, &vpInst->indexBuffMem);
+        // Fences are only polled while a present is waited for, so a slow present doesn't hold back the next frames
+        uint64_t fenceTimeout = presenting.empty() ? UINT64_MAX : 0;
+        if (hasFrame && vkWaitForFences(rend->device, 1, &fence, VK_TRUE, fenceTimeout) == VK_SUCCESS) {
+
+            Core::WatchedFrame frame{ frameNumber, Core::secondsNow(), 0.0 };
+
+            // The main thread may reset the fence from here on
+            lock.lock();
+            watcher.watched++;
+            if (rend->hasPresentWait) presenting.push_back(frame);
+            else                      watcher.timings.push_back(frame);
+            lock.unlock();
+            watcher.changed.notify_all();
+
+        }
+        else if (!presenting.empty() && waitForPresent(rend, &presenting.front())) {
+
+            lock.lock();
+            watcher.timings.push_back(presenting.front());
+            lock.unlock();
+            presenting.pop_front();
+
+        }
+
+        lock.lock();
 
     }
 
-    VkCommandBuffer singleTimeBuff; 
-    vlknh::SingleTimeCommandBuffer::begin  (inst->rend.device, inst->rend.commandPool, &singleTimeBuff);
-    vlknh::SingleTimeCommandBuffer::copy   (singleTimeBuff, buffsInfo->vertexDataSize, vertStageBuff, vpInst->vertBuff);
-    vlknh::SingleTimeCommandBuffer::copy   (singleTimeBuff, buffsInfo->indexDataSize, indexStageBuff, vpInst->indexBuff);
-    vlknh::SingleTimeCommandBuffer::submit (inst->rend.device, singleTimeBuff, inst->rend.commandPool, inst->rend.graphicsQueue);
+}
+void Core::startFrameWatcher(VlknRenderInstance* rend) {
+
+    rend->frameWatcher.thread = std::thread(watchFrames, rend);
 
-    vkQueueWaitIdle(inst->rend.graphicsQueue);
+}
+void Core::stopFrameWatcher(VlknRenderInstance* rend) {
 
-    vkFreeCommandBuffers(inst->rend.device, inst->rend.commandPool, 1, &singleTimeBuff);
-    vkFreeMemory        (inst->rend.device, vertStageMem,   nullptr);
-    vkDestroyBuffer     (inst->rend.device, vertStageBuff,  nullptr);
-    vkFreeMemory        (inst->rend.device, indexStageMem,  nullptr);
-    vkDestroyBuffer     (inst->rend.device, indexStageBuff, nullptr);
+    {
+        std::lock_guard<std::mutex> lock(rend->frameWatcher.mutex);
+        rend->frameWatcher.quit = true;
+    }
+    rend->frameWatcher.changed.notify_all();
+    rend->frameWatcher.thread.join();
+
+}
+void Core::watchFrame(VlknRenderInstance* rend) {
+
+    {
+        std::lock_guard<std::mutex> lock(rend->frameWatcher.mutex);
+        rend->frameWatcher.submitted = rend->frameNumber + 1;
+    }
+    rend->frameWatcher.changed.notify_all();
+
+}
+void Core::waitForFenceWatched(VlknRenderInstance* rend) {
+
+    FrameWatcher& watcher = rend->frameWatcher;
+    std::unique_lock<std::mutex> lock(watcher.mutex);
+    watcher.changed.wait(lock, [rend, &watcher]() { return watcher.watched + c_vlkn::framesInFlight > rend->frameNumber; });
+
+}
+void Core::collectFrameTimings(VlknRenderInstance* rend, FramePacer* pacer) {
+
+    std::vector<WatchedFrame> timings;
+    {
+        std::lock_guard<std::mutex> lock(rend->frameWatcher.mutex);
+        timings.swap(rend->frameWatcher.timings);
+    }
+    for (const WatchedFrame& timing : timings) {
+        pacer->frameGpuDone(timing.frameNumber, timing.gpuDoneTime);
+        if (timing.presentTime != 0.0) pacer->framePresented(timing.frameNumber, timing.presentTime);
+    }
+
+}
+
+void Core::createFrameTimestamps(VlknRenderInstance* rend) {
+
+    VkPhysicalDeviceProperties deviceProperties;
+    vkGetPhysicalDeviceProperties(rend->physicalDevice, &deviceProperties);
+    uint32_t queueFamilyCount;
+    vkGetPhysicalDeviceQueueFamilyProperties(rend->physicalDevice, &queueFamilyCount, nullptr);
+    std::vector<VkQueueFamilyProperties> queueFamilies(queueFamilyCount);
+    vkGetPhysicalDeviceQueueFamilyProperties(rend->physicalDevice, &queueFamilyCount, queueFamilies.data());
+
+    uint32_t validBits    = queueFamilies[rend->graphicsQueueIndex].timestampValidBits;
+    rend->timestampPeriod = validBits > 0 ? deviceProperties.limits.timestampPeriod : 0.0f;
+    rend->timestampMask   = validBits >= 64 ? UINT64_MAX : (1ull << validBits) - 1;
+
+    for (uint32_t i = 0; i < c_vlkn::framesInFlight; i++) {
+
+        FrameTimestamps& timestamps = rend->frames[i].timestamps;
+        timestamps.queryPool     = VK_NULL_HANDLE;
+        timestamps.queryCount    = 0;
+        timestamps.mainPassBegin = c_NoTimestamp;
+        timestamps.mainPassEnd   = c_NoTimestamp;
+        if (rend->timestampPeriod == 0.0f) continue;
+
+        VkQueryPoolCreateInfo createInfo{};
+        createInfo.sType = VK_STRUCTURE_TYPE_QUERY_POOL_CREATE_INFO;
+        createInfo.queryType  = VK_QUERY_TYPE_TIMESTAMP;
+        createInfo.queryCount = c_TimestampsPerFrame;
+
+        VkResult err = vkCreateQueryPool(rend->device, &createInfo, nullptr, &timestamps.queryPool);
+        assertExit(err == VK_SUCCESS, "Timestamp query pool creation failed");
+
+    }
+
+}
+void Core::destroyFrameTimestamps(VlknRenderInstance* rend) {
+
+    for (uint32_t i = 0; i < c_vlkn::framesInFlight; i++) {
+        if (rend->frames[i].timestamps.queryPool != VK_NULL_HANDLE) vkDestroyQueryPool(rend->device, rend->frames[i].timestamps.queryPool, nullptr);
+    }
+
+}
+void Core::beginFrameTimestamps(VlknRenderInstance* rend, FrameTimestamps* timestamps) {
+
+    timestamps->queryCount    = 0;
+    timestamps->mainPassBegin = c_NoTimestamp;
+    timestamps->mainPassEnd   = c_NoTimestamp;
+    timestamps->viewports.clear();
+    if (timestamps->queryPool != VK_NULL_HANDLE) vkCmdResetQueryPool(rend->commandBuff, timestamps->queryPool, 0, c_TimestampsPerFrame);
+
+}
+uint32_t Core::writeTimestamp(VlknRenderInstance* rend, FrameTimestamps* timestamps, VkPipelineStageFlagBits stage) {
+
+    if (timestamps->queryPool == VK_NULL_HANDLE || timestamps->queryCount == c_TimestampsPerFrame) return c_NoTimestamp;
+    vkCmdWriteTimestamp(rend->commandBuff, stage, timestamps->queryPool, timestamps->queryCount);
+    return timestamps->queryCount++;
+
+}
+void Core::readFrameTimestamps(Instance* inst, FrameTimestamps* timestamps) {
+
+#ifdef DEVINFO
+    inst->gui.stats.gpuTimestamps = timestamps->queryPool != VK_NULL_HANDLE;
+    if (timestamps->queryCount == 0) return;
+
+    // The fence of the frame is signaled, so every query it wrote is available without waiting
+    uint64_t ticks[c_TimestampsPerFrame];
+    VkResult err = vkGetQueryPoolResults(inst->rend.device, timestamps->queryPool, 0, timestamps->queryCount, sizeof ticks, ticks, sizeof(uint64_t), VK_QUERY_RESULT_64_BIT);
+    if (err != VK_SUCCESS) return;
+
+    const uint64_t mask = inst->rend.timestampMask;
+    const float msPerTick = inst->rend.timestampPeriod / 1e6f;
+    auto elapsedMs = [&](uint32_t begin, uint32_t end) { return ((ticks[end] - ticks[begin]) & mask) * msPerTick; };
+    auto average   = [](float* avg, float sample) { *avg += c_vlkn::gpuTimeSmoothing * (sample - *avg); };
+
+    if (timestamps->mainPassBegin != c_NoTimestamp && timestamps->mainPassEnd != c_NoTimestamp) {
+        inst->gui.stats.gpuMainPassMs = elapsedMs(timestamps->mainPassBegin, timestamps->mainPassEnd);
+        average(&inst->gui.stats.gpuMainPassAvgMs, inst->gui.stats.gpuMainPassMs);
+    }
+
+    // Skipped viewports keep their averages, frames without viewport passes count as 0
+    float viewportPassesMs = 0.0f;
+    for (const ViewportTimestamps& vpTimestamps : timestamps->viewports) {
+        if (vpTimestamps.begin == c_NoTimestamp || vpTimestamps.end == c_NoTimestamp || vpTimestamps.viewport >= inst->gui.vpDatas.size()) continue;
+        Gui::ViewportGuiData& vpData = inst->gui.vpDatas[vpTimestamps.viewport];
+        float passMs  = elapsedMs(vpTimestamps.begin, vpTimestamps.end);
+        float edgesMs = vpTimestamps.edges != c_NoTimestamp ? elapsedMs(vpTimestamps.edges, vpTimestamps.end) : 0.0f;
+        average(&vpData.gpuPassAvgMs,  passMs);
+        average(&vpData.gpuEdgesAvgMs, edgesMs);
+        viewportPassesMs += passMs;
+    }
+    inst->gui.stats.gpuViewportPassesMs = viewportPassesMs;
+    average(&inst->gui.stats.gpuViewportPassesAvgMs, viewportPassesMs);
+#endif
+
+}
+void Core::discardViewportTimestamps(VlknRenderInstance* rend) {
+
+    for (uint32_t i = 0; i < c_vlkn::framesInFlight; i++) rend->frames[i].timestamps.viewports.clear();
+
+}
+
+void Core::createGeometryData(Instance* inst, ViewportInstance* vpInst, VertexIndexBuffersInfo* buffsInfo) {
+
+    vpInst->resourceVersion++;
+
+    // Vertex buffer
+    {
+
+        createBuffer(&inst->rend, buffsInfo->vertexDataSize, VK_BUFFER_USAGE_TRANSFER_DST_BIT | VK_BUFFER_USAGE_VERTEX_BUFFER_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, 
+            &vpInst->vertBuff, &vpInst->vertBuffMem);
+
+    }
+
+    // Indexbuffer
+    {
+
+        createBuffer(&inst->rend, buffsInfo->indexDataSize, VK_BUFFER_USAGE_TRANSFER_DST_BIT | VK_BUFFER_USAGE_INDEX_BUFFER_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, 
+            &vpInst->indexBuff, &vpInst->indexBuffMem);
+
+    }
+
+    // Color buffer, only for files with colors so the others draw exactly as before
+    vpInst->colorBuff    = VK_NULL_HANDLE;
+    vpInst->colorBuffMem = {};
+    if (buffsInfo->colorDataSize > 0) {
+
+        createBuffer(&inst->rend, buffsInfo->colorDataSize, VK_BUFFER_USAGE_TRANSFER_DST_BIT | VK_BUFFER_USAGE_VERTEX_BUFFER_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, 
+            &vpInst->colorBuff, &vpInst->colorBuffMem);
+
+    }
+
+    vpInst->geometryBytes = vpInst->vertBuffMem.size + vpInst->indexBuffMem.size + vpInst->colorBuffMem.size;
+
+    // Streams through the fixed size staging ring instead of allocating staging buffers the size of the mesh.
+    // Only finished loads get here, the vertex and index buffers of a load are final once it is done.
+    stageBufferUpload(&inst->rend, vpInst->vertBuff,  buffsInfo->vertexData, buffsInfo->vertexDataSize);
+    stageBufferUpload(&inst->rend, vpInst->indexBuff, buffsInfo->indexData,  buffsInfo->indexDataSize);
+    if (vpInst->colorBuff != VK_NULL_HANDLE) stageBufferUpload(&inst->rend, vpInst->colorBuff, buffsInfo->colorData, buffsInfo->colorDataSize);
+    vpInst->uploadValue     = stagedUploadValue(&inst->rend);
+    vpInst->geometryPending = true;
 
 }
 void Core::createVpImageResources(Instance *inst, ViewportInstance* vpInst, const VkExtent2D size) {
 
+    vpInst->resourceVersion++;
+
+    vpInst->imageBytes = 0;
+
     // Image creation
     {
 
@@ -229,32 +1001,9 @@ void Core::createVpImageResources(Instance *inst, ViewportInstance* vpInst, cons
 
     }
 
-    // Image memory creation
-    {
-
-        VkMemoryRequirements memRequirements;
-        vkGetImageMemoryRequirements(inst->rend.device, vpInst->image, &memRequirements);
-        VkPhysicalDeviceMemoryProperties memProps;
-        vkGetPhysicalDeviceMemoryProperties(inst->rend.physicalDevice, &memProps);
-
-        VkMemoryAllocateInfo allocInfo{};
-        allocInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
-        allocInfo.allocationSize = memRequirements.size;
-
-        uint32_t i = 0;
-        for (; i < memProps.memoryTypeCount; i++) {
-            if (memRequirements.memoryTypeBits & (1 << i) && memProps.memoryTypes[i].propertyFlags & VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT) {
-                break;
-            }
-        }
-
-        allocInfo.memoryTypeIndex = i;
-        VkResult err = vkAllocateMemory(inst->rend.device, &allocInfo, nullptr, &vpInst->imageMem);
-        CORE_ASSERT(err == VK_SUCCESS && "Buffer allocation failed");
-
-        vkBindImageMemory(inst->rend.device, vpInst->image, vpInst->imageMem, 0);
-
-    }
+    // Image memory
+    allocateImageMemory(&inst->rend, vpInst->image, &vpInst->imageMem);
+    vpInst->imageBytes += vpInst->imageMem.size;
 
     // Image view creation
     {
@@ -304,32 +1053,9 @@ void Core::createVpImageResources(Instance *inst, ViewportInstance* vpInst, cons
 
     }
 
-    // Color image memory creation
-    {
-
-        VkMemoryRequirements memRequirements;
-        vkGetImageMemoryRequirements(inst->rend.device, vpInst->colorImage, &memRequirements);
-        VkPhysicalDeviceMemoryProperties memProps;
-        vkGetPhysicalDeviceMemoryProperties(inst->rend.physicalDevice, &memProps);
-
-        VkMemoryAllocateInfo allocInfo{};
-        allocInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
-        allocInfo.allocationSize = memRequirements.size;
-
-        uint32_t i = 0;
-        for (; i < memProps.memoryTypeCount; i++) {
-            if (memRequirements.memoryTypeBits & (1 << i) && memProps.memoryTypes[i].propertyFlags & VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT) {
-                break;
-            }
-        }
-
-        allocInfo.memoryTypeIndex = i;
-        VkResult err = vkAllocateMemory(inst->rend.device, &allocInfo, nullptr, &vpInst->colorImageMem);
-        CORE_ASSERT(err == VK_SUCCESS && "Buffer allocation failed");
-
-        vkBindImageMemory(inst->rend.device, vpInst->colorImage, vpInst->colorImageMem, 0);
-
-    }
+    // Color image memory
+    allocateImageMemory(&inst->rend, vpInst->colorImage, &vpInst->colorImageMem);
+    vpInst->imageBytes += vpInst->colorImageMem.size;
 
     // Color image view creation
     {
@@ -379,32 +1105,9 @@ void Core::createVpImageResources(Instance *inst, ViewportInstance* vpInst, cons
 
     }
 
-    // Image memory creation
-    {
-
-        VkMemoryRequirements memRequirements;
-        vkGetImageMemoryRequirements(inst->rend.device, vpInst->depthImage, &memRequirements);
-        VkPhysicalDeviceMemoryProperties memProps;
-        vkGetPhysicalDeviceMemoryProperties(inst->rend.physicalDevice, &memProps);
-
-        VkMemoryAllocateInfo allocInfo{};
-        allocInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
-        allocInfo.allocationSize = memRequirements.size;
-
-        uint32_t i = 0;
-        for (; i < memProps.memoryTypeCount; i++) {
-            if (memRequirements.memoryTypeBits & (1 << i) && memProps.memoryTypes[i].propertyFlags & VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT) {
-                break;
-            }
-        }
-
-        allocInfo.memoryTypeIndex = i;
-        VkResult err = vkAllocateMemory(inst->rend.device, &allocInfo, nullptr, &vpInst->depthImageMem);
-        CORE_ASSERT(err == VK_SUCCESS && "Buffer allocation failed");
-
-        vkBindImageMemory(inst->rend.device, vpInst->depthImage, vpInst->depthImageMem, 0);
-
-    }
+    // Depth image memory
+    allocateImageMemory(&inst->rend, vpInst->depthImage, &vpInst->depthImageMem);
+    vpInst->imageBytes += vpInst->depthImageMem.size;
 
     // Depth image view creation
     {
@@ -430,9 +1133,18 @@ void Core::createVpImageResources(Instance *inst, ViewportInstance* vpInst, cons
 
     }
 
-    // Update Descriptor Set
+    // Descriptor set, a new one each time because the frames in flight may still sample the old one
     {
 
+        VkDescriptorSetAllocateInfo allocInfo{};
+        allocInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
+        allocInfo.descriptorPool     = inst->rend.descriptorPool;
+        allocInfo.descriptorSetCount = 1;
+        allocInfo.pSetLayouts        = &inst->vpRend.descriptorSetLayout;
+
+        VkResult err = vkAllocateDescriptorSets(inst->rend.device, &allocInfo, &vpInst->descriptorSet);
+        CORE_ASSERT(err == VK_SUCCESS && "Descriptor set creation failed");
+
         VkDescriptorImageInfo imageInfo{};
         imageInfo.sampler     = inst->vpRend.frameSampler;
         imageInfo.imageView   = vpInst->imageView;
@@ -458,7 +1170,7 @@ void Core::createVpImageResources(Instance *inst, ViewportInstance* vpInst, cons
 
         VkFramebufferCreateInfo framebufferInfo{};
         framebufferInfo.sType = VK_STRUCTURE_TYPE_FRAMEBUFFER_CREATE_INFO;
-        framebufferInfo.renderPass      = inst->vpRend.renderPass;
+        framebufferInfo.renderPass      = inst->vpRend.pipelines.renderPass;
         framebufferInfo.attachmentCount = arraySize(attachments);
         framebufferInfo.pAttachments    = attachments;
         framebufferInfo.width           = size.width;
@@ -470,10 +1182,102 @@ void Core::createVpImageResources(Instance *inst, ViewportInstance* vpInst, cons
 
     }
 
+}
+static void loadProgressCallback(void* userData, float progress) {
+
+    Core::PendingLoad* load = (Core::PendingLoad*)userData;
+    if (progress - load->progress < 0.01f && progress < 1.0f) return;
+    load->progress = progress;
+    PostMessage(load->notifyHwnd, WM_NULL, 0, 0);
+
+}
+static void parseMeshFile(Core::PendingLoad* load) {
+
+    load->result = mload::openModelPipelined(load->filePath.get(), &load->vertices, &load->indices, &load->isTextFormat, &load->settings, &load->modelInfo, &load->pipelineStats);
+    load->done   = true;
+    PostMessage(load->notifyHwnd, WM_NULL, 0, 0);
+
+}
+/// Lists a file that couldn't be opened or reloaded in the GUI. 
+static void reportLoadError(Core::Instance* inst, const char* file, mload::Success result) {
+
+    const char* fileTitle = file;
+    for (const char* i = file; *i != '\0'; ++i)
+        if (*i == '/' || *i == '\\') fileTitle = i + 1;
+
+    Gui::LoadErrorGuiData error;
+    error.fileTitle = fileTitle;
+    switch (result) {
+    case mload::WRONG_FILE_FORMAT:   error.reason = "Not a supported model format"; break;
+    case mload::COULD_NOT_OPEN_FILE: error.reason = "The file couldn't be opened";  break;
+    case mload::NO_DATA_FROM_FILE:   error.reason = "The file is empty";            break;
+    case mload::TRUNCATED_FILE:      error.reason = "The file is truncated";        break;
+    case mload::CORRUPT_FILE:        error.reason = "The file is corrupt";          break;
+    default:                         error.reason = "Unknown error";                break;
+    }
+    inst->gui.loadErrors.push_back(std::move(error));
+
+}
+static bool queueLoad(Core::Instance* inst, const char* file, const mload::LoadSettings& settings, bool reload) {
+
+    WIN32_FILE_ATTRIBUTE_DATA fileAttributes;
+    if (!GetFileAttributesExA(file, GetFileExInfoStandard, &fileAttributes)) return false;
+
+    Core::LoadQueue& queue = inst->loadQueue;
+    if (queue.loads.empty()) {
+
+        MEMORYSTATUSEX memoryStatus{};
+        memoryStatus.dwLength = sizeof(memoryStatus);
+        GlobalMemoryStatusEx(&memoryStatus);
+
+        queue.budget         = (size_t)(c_LoadMemoryBudgetFraction * memoryStatus.ullAvailPhys);
+        queue.budgetInUse    = 0;
+        queue.batchStart     = std::chrono::steady_clock::now();
+        queue.batchFileCount = 0;
+        queue.batchBytes     = 0;
+        inst->gui.loadsFinished   = 0;
+        inst->gui.loadFilesPerSec = 0.0f;
+        inst->gui.loadMBPerSec    = 0.0f;
+
+    }
+
+    queue.loads.emplace_back(new Core::PendingLoad);
+    Core::PendingLoad& load = *queue.loads.back();
+
+    const char* fileTitle = file;
+    const char* i = file;
+    for (; *i != '\0'; ++i)
+        if (*i == '/' || *i == '\\') fileTitle = i + 1;
+
+    size_t filePathSize = (size_t)(i - file) + 1;
+    load.filePath.reset(new char[filePathSize]);
+    memcpy(load.filePath.get(), file, filePathSize);
+    load.fileTitle   = load.filePath.get() + (fileTitle - file);
+    load.notifyHwnd  = inst->wind.hwnd;
+    load.fileSize    = ((size_t)fileAttributes.nFileSizeHigh << 32) | fileAttributes.nFileSizeLow;
+    // Compressed models are budgeted by their inflated size, the containers store it up front
+    mload::ModelSource source;
+    size_t fileNameLen = strlen(file);
+    bool compressed = (fileNameLen > 3 && strcmp(&file[fileNameLen - 3], ".gz") == 0) || (fileNameLen > 4 && strcmp(&file[fileNameLen - 4], ".zip") == 0);
+    if (compressed && source.open(file) == mload::SUCCESS) load.fileSize = (size_t)source.size();
+    load.budgetBytes = c_LoadBytesPerFileByte * load.fileSize;
+    load.reload      = reload;
+    load.started     = false;
+    load.progress    = 0.0f;
+    load.done        = false;
+
+    load.settings                  = settings;
+    load.settings.progressCallback = loadProgressCallback;
+    load.settings.progressUserData = &load;
+
+    // Started by updateLoads on the next cycle
+    PostMessage(inst->wind.hwnd, WM_NULL, 0, 0);
+
+    return true;
+
 }
 bool Core::openMeshFile(Instance* inst, const char* file) {
 
-    scopedTimer(t1, inst->gui.stats.perfTimes.getTimer("openFile"));
     if (file == nullptr) return false;
     if (file[0] == '\0') return false;
     const char* fileTitle = file;
@@ -488,82 +1292,346 @@ bool Core::openMeshFile(Instance* inst, const char* file) {
             return false;
         }
     }
+    for (std::unique_ptr<PendingLoad>& load : inst->loadQueue.loads) {
+        if (strcmp(load->fileTitle, fileTitle) == 0) return false;
+    }
 
-    vkQueueWaitIdle(inst->rend.graphicsQueue);
+    mload::LoadSettings loadSettings;
+    loadSettings.normalMode  = (mload::NormalMode)inst->gui.normalMode;
+    loadSettings.creaseAngle = inst->gui.creaseAngle;
 
-    std::vector<mload::Vertex> vertices;
-    std::vector<uint32_t>      indices;
+    if (!queueLoad(inst, file, loadSettings, false)) {
+        reportLoadError(inst, file, mload::COULD_NOT_OPEN_FILE);
+        return false;
+    }
+    return true;
 
-    bool isTextFormat;
-    if (mload::openModel(file, &vertices, &indices, &isTextFormat)) return false;
+}
+static void addViewport(Core::Instance* inst, Core::PendingLoad& load) {
+
+    scopedTimer(t1, inst->gui.stats.perfTimes.getTimer("openFile"));
 
     Core::VertexIndexBuffersInfo buffsInfo{};
-    buffsInfo.vertexData = vertices.data();
-    buffsInfo.vertexDataSize = vertices.size() * sizeof mload::Vertex;
-    buffsInfo.indexData = indices.data();
-    buffsInfo.indexDataSize = indices.size() * sizeof uint32_t;
+    buffsInfo.vertexData     = load.vertices.data();
+    buffsInfo.vertexDataSize = load.vertices.size() * sizeof mload::Vertex;
+    buffsInfo.indexData      = load.indices.data();
+    buffsInfo.indexDataSize  = load.indices.size() * sizeof uint32_t;
+    buffsInfo.colorData      = load.modelInfo.colors.data();
+    buffsInfo.colorDataSize  = load.modelInfo.colors.size() * sizeof uint32_t;
 
     inst->vpRend.vpInstances.push_back({});
     Core::ViewportInstance& newVpInstance = inst->vpRend.vpInstances.back();
     Core::createGeometryData(inst, &newVpInstance, &buffsInfo);
 
-    VkDescriptorSetAllocateInfo allocInfo{};
-    allocInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
-    allocInfo.descriptorPool = inst->rend.descriptorPool;
-    allocInfo.descriptorSetCount = 1;
-    allocInfo.pSetLayouts = &inst->vpRend.descriptorSetLayout;
-
-    VkResult err = vkAllocateDescriptorSets(inst->rend.device, &allocInfo, &newVpInstance.descriptorSet);
-    CORE_ASSERT(err == VK_SUCCESS && "Descriptor set creation failed");
-
     inst->gui.vpDatas.push_back({});
     Gui::ViewportGuiData& newVpData = inst->gui.vpDatas.back();
     newVpData.open = true;
     newVpData.model = glm::mat4(1.0f);
-    newVpData.framebufferTexID = (ImTextureID)newVpInstance.descriptorSet;
-
-    float farthestReachingVertex = 0.0f;
-    for (mload::Vertex& vertex : vertices) {
-        glm::vec3 pos(vertex.pos.x, vertex.pos.y, vertex.pos.z);
-        newVpData.modelCenter += pos;
-        float magnitude = glm::length(pos);
-        if (magnitude > farthestReachingVertex) farthestReachingVertex = magnitude;
+    newVpData.framebufferTexID = nullptr; // set once the render targets exist
 
-    }
-    newVpData.modelCenter /= (float)vertices.size();
-    newVpData.zoomDistance = -2.5f * farthestReachingVertex;
+    // The bounds were computed on the loading thread
+    newVpData.modelCenter  = glm::vec3(load.modelInfo.center.x, load.modelInfo.center.y, load.modelInfo.center.z);
+    newVpData.zoomDistance = -2.5f * load.modelInfo.radius;
     newVpData.farPlaneClip = -30.0f * newVpData.zoomDistance;
     newVpData.zoomMin = -newVpData.farPlaneClip / 3;
 
-    newVpData.objectName.reset(new char[(int)(i - fileTitle) + 1]);
-    strcpy(newVpData.objectName.get(), fileTitle);
-    newVpData.indexCount = (uint32_t)indices.size();
-    newVpData.uniqueVertexCount = (uint32_t)vertices.size();
-    newVpData.isTextFormat = isTextFormat;
+    newVpData.objectName.reset(new char[strlen(load.fileTitle) + 1]);
+    strcpy(newVpData.objectName.get(), load.fileTitle);
+    newVpData.indexCount = (uint32_t)load.indices.size();
+    newVpData.uniqueVertexCount = (uint32_t)load.vertices.size();
+    newVpData.isTextFormat = load.isTextFormat;
+    newVpData.normalMode = load.settings.normalMode;
+    newVpData.fileVertexCount = load.modelInfo.fileVertexCount;
+    newVpData.hasVertexColors = !load.modelInfo.colors.empty();
+
+    newVpInstance.lastVisibleFrame = inst->rend.frameNumber;
+    newVpInstance.filePath         = std::move(load.filePath);
+    newVpInstance.loadSettings     = load.settings;
+    newVpInstance.loadSettings.progressCallback = nullptr;
+    newVpInstance.loadSettings.progressUserData = nullptr;
+
+    // Parts and instances are kept across reloads, the file is the same
+    for (const mload::ModelPart& part : load.modelInfo.parts) {
+        Core::MeshPart meshPart;
+        meshPart.firstIndex = part.firstIndex;
+        meshPart.indexCount = part.indexCount;
+        meshPart.boundsMin  = glm::vec3(part.boundsMin.x, part.boundsMin.y, part.boundsMin.z);
+        meshPart.boundsMax  = glm::vec3(part.boundsMax.x, part.boundsMax.y, part.boundsMax.z);
+        newVpInstance.meshParts.push_back(meshPart);
+
+        Gui::PartGuiData partData;
+        partData.name          = part.name.empty() ? "(ungrouped)" : part.name;
+        partData.triangleCount = part.indexCount / 3;
+        partData.visible       = true;
+        newVpData.parts.push_back(std::move(partData));
+    }
+    for (const mload::ModelInstance& instance : load.modelInfo.instances) {
+        Core::MeshInstance meshInstance;
+        meshInstance.part = instance.part;
+        memcpy(&meshInstance.transform[0][0], instance.transform, sizeof(instance.transform));
+        newVpInstance.meshInstances.push_back(meshInstance);
+    }
 
-    return true;
+}
+void Core::updateLoads(Instance* inst) {
+
+    LoadQueue& queue = inst->loadQueue;
+    if (queue.loads.empty()) return;
+
+    // Open finished loads. All of their uploads share the staging ring and are submitted once, the viewports draw them when they are done. 
+    bool uploadsStaged = false;
+    for (size_t i = 0; i < queue.loads.size();) {
+
+        PendingLoad& load = *queue.loads[i];
+        if (!load.done) { ++i; continue; }
+
+        queue.budgetInUse -= load.budgetBytes;
+        if (load.reload) {
+            for (ViewportInstance& vpInstance : inst->vpRend.vpInstances) {
+                if (!vpInstance.reloadQueued || strcmp(vpInstance.filePath.get(), load.filePath.get()) != 0) continue;
+
+                vpInstance.reloadQueued = false;
+                if (load.result != mload::SUCCESS) {
+                    vpInstance.reloadFailed = true;
+                    reportLoadError(inst, load.filePath.get(), load.result);
+                    break;
+                }
+
+                VertexIndexBuffersInfo buffsInfo{};
+                buffsInfo.vertexData     = load.vertices.data();
+                buffsInfo.vertexDataSize = load.vertices.size() * sizeof mload::Vertex;
+                buffsInfo.indexData      = load.indices.data();
+                buffsInfo.indexDataSize  = load.indices.size() * sizeof uint32_t;
+                buffsInfo.colorData      = load.modelInfo.colors.data();
+                buffsInfo.colorDataSize  = load.modelInfo.colors.size() * sizeof uint32_t;
+                createGeometryData(inst, &vpInstance, &buffsInfo);
+
+                uploadsStaged = true;
+                break;
+            }
+        }
+        else if (load.result == mload::SUCCESS) {
+            addViewport(inst, load);
+            uploadsStaged = true;
+        }
+        else {
+            reportLoadError(inst, load.filePath.get(), load.result);
+        }
+#ifdef DEVINFO
+        static_assert(mload::PIPELINE_STAGE_COUNT == arraySize(inst->gui.stats.lastPipelineStageSeconds));
+        if (load.pipelineStats.pipelined) {
+            inst->gui.stats.lastPipelineSeconds = load.pipelineStats.seconds;
+            for (int stage = 0; stage < mload::PIPELINE_STAGE_COUNT; stage++) inst->gui.stats.lastPipelineStageSeconds[stage] = load.pipelineStats.stageSeconds[stage];
+        }
+#endif
+        queue.batchFileCount++;
+        queue.batchBytes += load.fileSize;
+        inst->gui.loadsFinished++;
+        queue.loads.erase(queue.loads.begin() + i);
+
+    }
+    if (uploadsStaged) submitStagingRing(&inst->rend);
+
+    // Start queued loads in order while they fit in the budget. One load always runs, even if it is larger than the budget on its own. 
+    for (std::unique_ptr<PendingLoad>& load : queue.loads) {
+
+        if (load->started) continue;
+        if (queue.budgetInUse > 0 && queue.budgetInUse + load->budgetBytes > queue.budget) break;
+
+        queue.budgetInUse += load->budgetBytes;
+        load->started = true;
+        PendingLoad* pLoad = load.get();
+        mload::WorkerPool::shared().submit([pLoad]() { parseMeshFile(pLoad); });
+
+    }
+
+    float batchTime = std::chrono::duration<float>(std::chrono::steady_clock::now() - queue.batchStart).count();
+    if (batchTime > 0.0f) {
+        inst->gui.loadFilesPerSec = queue.batchFileCount / batchTime;
+        inst->gui.loadMBPerSec    = queue.batchBytes / (1e6f * batchTime);
+    }
+
+    inst->gui.loads.resize(queue.loads.size());
+    for (size_t i = 0; i < queue.loads.size(); i++) {
+        inst->gui.loads[i].fileTitle = queue.loads[i]->fileTitle;
+        inst->gui.loads[i].progress  = queue.loads[i]->progress;
+        inst->gui.loads[i].started   = queue.loads[i]->started;
+    }
+
+#ifdef DEVINFO
+    if (queue.loads.empty()) {
+        inst->gui.stats.lastLoadFileCount   = queue.batchFileCount;
+        inst->gui.stats.lastLoadFilesPerSec = inst->gui.loadFilesPerSec;
+        inst->gui.stats.lastLoadMBPerSec    = inst->gui.loadMBPerSec;
+    }
+#endif
 
 }
-void Core::destroyGeometryData(VkDevice device, ViewportInstance* vpInst) {
+void Core::waitForLoads(Instance* inst) {
 
-    vkFreeMemory         (device, vpInst->indexBuffMem,   nullptr);
-    vkDestroyBuffer      (device, vpInst->indexBuff,      nullptr);
-    vkFreeMemory         (device, vpInst->vertBuffMem,    nullptr);
-    vkDestroyBuffer      (device, vpInst->vertBuff,       nullptr);
+    for (std::unique_ptr<PendingLoad>& load : inst->loadQueue.loads) {
+        while (load->started && !load->done) {
+            if (!mload::WorkerPool::shared().runPendingTask()) sleepFor(0.001);
+        }
+    }
 
 }
-void Core::destroyVpImageResources(VkDevice device, ViewportInstance* vpInst) {
+void Core::reloadGeometryData(Instance* inst, ViewportInstance* vpInst) {
+
+    // The file is still there unless it was moved or deleted, in that case the viewport stays empty. 
+    vpInst->reloadQueued = queueLoad(inst, vpInst->filePath.get(), vpInst->loadSettings, true);
+    if (!vpInst->reloadQueued) {
+        vpInst->reloadFailed = true;
+        reportLoadError(inst, vpInst->filePath.get(), mload::COULD_NOT_OPEN_FILE);
+    }
+
+}
+/// Budget for the memory the viewports hold in the largest device local heap. 
+static VkDeviceSize getDeviceMemoryBudget(Core::VlknRenderInstance* rend, VkDeviceSize viewportBytes) {
+
+    VkPhysicalDeviceMemoryBudgetPropertiesEXT budgetProps{};
+    budgetProps.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_MEMORY_BUDGET_PROPERTIES_EXT;
+
+    VkPhysicalDeviceMemoryProperties2 memProps{};
+    memProps.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_MEMORY_PROPERTIES_2;
+    memProps.pNext = rend->hasMemoryBudgetExt ? &budgetProps : nullptr;
+    vkGetPhysicalDeviceMemoryProperties2(rend->physicalDevice, &memProps);
+
+    uint32_t heapIndex = 0;
+    for (uint32_t i = 0; i < memProps.memoryProperties.memoryHeapCount; i++) {
+        const VkMemoryHeap& heap = memProps.memoryProperties.memoryHeaps[i];
+        if ((heap.flags & VK_MEMORY_HEAP_DEVICE_LOCAL_BIT) && heap.size > memProps.memoryProperties.memoryHeaps[heapIndex].size) heapIndex = i;
+    }
+
+    VkDeviceSize available = memProps.memoryProperties.memoryHeaps[heapIndex].size;
+    if (rend->hasMemoryBudgetExt) {
+        // The budget covers every allocation of the process and of other processes, the viewports get what is left plus what they hold. 
+        VkDeviceSize heapBudget = budgetProps.heapBudget[heapIndex];
+        VkDeviceSize otherUsage = budgetProps.heapUsage[heapIndex] > viewportBytes ? budgetProps.heapUsage[heapIndex] - viewportBytes : 0;
+        available = heapBudget > otherUsage ? heapBudget - otherUsage : 0;
+    }
+    return (VkDeviceSize)(c_vlkn::deviceMemoryBudgetFraction * available);
+
+}
+void Core::enforceMemoryBudget(Instance* inst) {
+
+    std::vector<ViewportInstance>& vpInstances = inst->vpRend.vpInstances;
+    uint64_t frameNumber = inst->rend.frameNumber;
 
-    vkDestroyFramebuffer (device, vpInst->framebuffer,    nullptr);
-    vkDestroyImageView   (device, vpInst->depthImageView, nullptr);
-    vkFreeMemory         (device, vpInst->depthImageMem,  nullptr);
-    vkDestroyImage       (device, vpInst->depthImage,     nullptr);
-    vkDestroyImageView   (device, vpInst->colorImageView, nullptr);
-    vkFreeMemory         (device, vpInst->colorImageMem,  nullptr);
-    vkDestroyImage       (device, vpInst->colorImage,     nullptr);
-    vkDestroyImageView   (device, vpInst->imageView,      nullptr);
-    vkFreeMemory         (device, vpInst->imageMem,       nullptr);
-    vkDestroyImage       (device, vpInst->image,          nullptr);
+    VkDeviceSize geometryBytes = 0, imageBytes = 0;
+    for (ViewportInstance& vpInstance : vpInstances) {
+        geometryBytes += vpInstance.geometryBytes;
+        imageBytes    += vpInstance.imageBytes;
+    }
+    VkDeviceSize budget = getDeviceMemoryBudget(&inst->rend, geometryBytes + imageBytes);
+
+    // Least recently viewed hidden viewports first
+    std::vector<size_t> hiddenViewports;
+    for (size_t i = 0; i < vpInstances.size(); i++) {
+        if (!inst->gui.vpDatas[i].visible) hiddenViewports.push_back(i);
+    }
+    std::sort(hiddenViewports.begin(), hiddenViewports.end(), [&vpInstances](size_t a, size_t b) { return vpInstances[a].lastVisibleFrame < vpInstances[b].lastVisibleFrame; });
+
+    for (size_t i : hiddenViewports) {
+
+        ViewportInstance& vpInstance = vpInstances[i];
+        if (vpInstance.framebuffer == VK_NULL_HANDLE) continue;
+        bool overBudget = geometryBytes + imageBytes > budget;
+        if (!overBudget && frameNumber - vpInstance.lastVisibleFrame < c_vlkn::releaseTargetsAfterFrames) continue;
+
+        imageBytes -= vpInstance.imageBytes;
+        destroyVpImageResources(&inst->rend, &vpInstance);
+        inst->gui.vpDatas[i].framebufferTexID = nullptr;
+#ifdef DEVINFO
+        inst->gui.stats.renderTargetReleases++;
+#endif
+
+    }
+
+    for (size_t i : hiddenViewports) {
+
+        if (geometryBytes + imageBytes <= budget) break;
+
+        ViewportInstance& vpInstance = vpInstances[i];
+        if (vpInstance.vertBuff == VK_NULL_HANDLE) continue;
+
+        geometryBytes -= vpInstance.geometryBytes;
+        destroyGeometryData(&inst->rend, &vpInstance);
+#ifdef DEVINFO
+        inst->gui.stats.geometryEvictions++;
+#endif
+
+    }
+
+#ifdef DEVINFO
+    inst->gui.stats.deviceMemoryBudget = budget;
+    inst->gui.stats.geometryBytes      = geometryBytes;
+    inst->gui.stats.renderTargetBytes  = imageBytes;
+    inst->gui.stats.hostLoadBudget     = inst->loadQueue.loads.empty() ? 0 : inst->loadQueue.budget;
+    inst->gui.stats.hostLoadBytes      = inst->loadQueue.loads.empty() ? 0 : inst->loadQueue.budgetInUse;
+
+    const DeviceAllocator& allocator = inst->rend.allocator;
+    inst->gui.stats.memoryBlocks      = 0;
+    inst->gui.stats.memoryBlockBytes  = 0;
+    inst->gui.stats.subAllocations    = 0;
+    inst->gui.stats.subAllocatedBytes = 0;
+    inst->gui.stats.requestedBytes    = 0;
+    inst->gui.stats.largestFreeRange  = 0;
+    for (const MemoryBlock& block : allocator.blocks) {
+        if (block.memory == VK_NULL_HANDLE) continue;
+        inst->gui.stats.memoryBlocks++;
+        inst->gui.stats.memoryBlockBytes  += block.ranges.blockSize;
+        inst->gui.stats.subAllocations    += block.ranges.allocationCount;
+        inst->gui.stats.subAllocatedBytes += block.ranges.allocatedBytes;
+        inst->gui.stats.requestedBytes    += block.ranges.requestedBytes;
+        inst->gui.stats.largestFreeRange   = std::max(inst->gui.stats.largestFreeRange, block.ranges.largestFree());
+    }
+    inst->gui.stats.dedicatedAllocations = allocator.dedicatedCount;
+    inst->gui.stats.dedicatedBytes       = allocator.dedicatedBytes;
+#endif
+
+}
+void Core::destroyGeometryData(VlknRenderInstance* rend, ViewportInstance* vpInst) {
+
+    // The frames never used the buffers of an upload that is still running, the transfer queue has to finish with them
+    if (vpInst->geometryPending) {
+        submitStagingRing(rend);
+        waitForUpload(rend, vpInst->uploadValue);
+    }
+    vpInst->geometryPending = false;
+
+    retireObject(rend, VK_OBJECT_TYPE_BUFFER,        (uint64_t)vpInst->indexBuff);
+    retireMemory(rend, &vpInst->indexBuffMem);
+    retireObject(rend, VK_OBJECT_TYPE_BUFFER,        (uint64_t)vpInst->vertBuff);
+    retireMemory(rend, &vpInst->vertBuffMem);
+    retireObject(rend, VK_OBJECT_TYPE_BUFFER,        (uint64_t)vpInst->colorBuff);
+    retireMemory(rend, &vpInst->colorBuffMem);
+
+    vpInst->vertBuff      = VK_NULL_HANDLE;
+    vpInst->indexBuff     = VK_NULL_HANDLE;
+    vpInst->colorBuff     = VK_NULL_HANDLE;
+    vpInst->geometryBytes = 0;
+    vpInst->resourceVersion++;
+
+}
+void Core::destroyVpImageResources(VlknRenderInstance* rend, ViewportInstance* vpInst) {
+
+    retireObject(rend, VK_OBJECT_TYPE_DESCRIPTOR_SET, (uint64_t)vpInst->descriptorSet);
+    retireObject(rend, VK_OBJECT_TYPE_FRAMEBUFFER,    (uint64_t)vpInst->framebuffer);
+    retireObject(rend, VK_OBJECT_TYPE_IMAGE_VIEW,     (uint64_t)vpInst->depthImageView);
+    retireObject(rend, VK_OBJECT_TYPE_IMAGE,          (uint64_t)vpInst->depthImage);
+    retireMemory(rend, &vpInst->depthImageMem);
+    retireObject(rend, VK_OBJECT_TYPE_IMAGE_VIEW,     (uint64_t)vpInst->colorImageView);
+    retireObject(rend, VK_OBJECT_TYPE_IMAGE,          (uint64_t)vpInst->colorImage);
+    retireMemory(rend, &vpInst->colorImageMem);
+    retireObject(rend, VK_OBJECT_TYPE_IMAGE_VIEW,     (uint64_t)vpInst->imageView);
+    retireObject(rend, VK_OBJECT_TYPE_IMAGE,          (uint64_t)vpInst->image);
+    retireMemory(rend, &vpInst->imageMem);
+
+    vpInst->descriptorSet = VK_NULL_HANDLE;
+    vpInst->framebuffer   = VK_NULL_HANDLE;
+    vpInst->imageBytes    = 0;
+    vpInst->resourceVersion++;
 
 }
 
@@ -625,6 +1693,8 @@ LRESULT CALLBACK Core::Callback::WindowProc(HWND hwnd, UINT uMsg, WPARAM wParam,
         inst->wind.m_size.y = HIWORD(lParam);
 
         recreateSwapchain(inst);
+        // The frame loop doesn't run while the window is resized
+        inst->pacer.cycleStarted(secondsNow());
         App::runCycle(inst);
 
         return 0; 
@@ -7,6 +7,9 @@
 #include <vulkan/vulkan.h>
 
 #include "Gui/Gui.hpp"
+#include "ViewportRender.hpp"
+#include "FramePacer.hpp"
+#include "BuddyAllocator.hpp"
 
 #include <imgui.h>
 #include <imgui_impl_win32.h>
@@ -20,10 +23,17 @@
 
 #include <Timer.hpp>
 
+#include <ModelLoader.hpp>
+
 #include <vector>
+#include <memory>
+#include <atomic>
+#include <chrono>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
 
 // macros
-#define arraySize(array) (sizeof(array) / sizeof(array[0]))
 #define CORE_ASSERT(exp) assert(exp); // to quickly change the assert function if anyone wishes todo so.
 
 #ifdef DEBUG
@@ -52,6 +62,135 @@ struct SwapchainImageObjects {
 };
 constexpr size_t c_MaxImageCount = 4;
 
+constexpr uint32_t c_MaxFramesInFlight = 3;
+
+constexpr uint32_t c_MaxProfiledViewports = 16;
+constexpr uint32_t c_TimestampsPerFrame   = 2 + 3 * c_MaxProfiledViewports; // main pass, and each viewport pass with its edges
+constexpr uint32_t c_NoTimestamp          = UINT32_MAX;
+
+/// Queries of a viewport render pass in the query pool of its frame. 
+struct ViewportTimestamps {
+
+    uint32_t viewport; // index into ViewportsRenderInstance::vpInstances
+    uint32_t begin;
+    uint32_t edges;    // c_NoTimestamp if the edges weren't drawn
+    uint32_t end;
+
+};
+
+/// GPU timestamps written by one frame, read back once its frame context comes around again so reading never stalls. 
+struct FrameTimestamps {
+
+    VkQueryPool                     queryPool;  // VK_NULL_HANDLE if the graphics queue has no timestamps
+    uint32_t                        queryCount; // written by the frame
+    uint32_t                        mainPassBegin;
+    uint32_t                        mainPassEnd;
+    std::vector<ViewportTimestamps> viewports;
+
+};
+
+/// What one frame in flight records into and synchronizes with, so the CPU can record a frame while the GPU still draws the previous one. 
+struct FrameContext {
+
+    VkCommandBuffer commandBuff;
+    VkSemaphore     imageReadySemaphore;
+    VkFence         frameFinishedFence; // signaled once the GPU is done with the frame
+    FrameTimestamps timestamps;         // DEVINFO only
+
+};
+
+constexpr uint32_t c_DedicatedAllocation = UINT32_MAX;
+
+/// Memory of one buffer or image, a range of a MemoryBlock or a VkDeviceMemory of its own. 
+struct MemoryAllocation {
+
+    VkDeviceMemory memory;  // VK_NULL_HANDLE if nothing is allocated
+    VkDeviceSize   offset;
+    VkDeviceSize   size;    // as required by the buffer or image
+    uint32_t       block;   // index into DeviceAllocator::blocks or c_DedicatedAllocation
+    uint32_t       order;   // BuddyAllocator order of the range
+    char*          pMapped; // at offset, nullptr if the memory is not host visible
+
+};
+
+/// Large VkDeviceMemory that buffers or images are placed in. 
+struct MemoryBlock {
+
+    VkDeviceMemory memory;          // VK_NULL_HANDLE once the block is freed, the slot is reused
+    uint32_t       memoryTypeIndex;
+    bool           linear;          // holds buffers, images get their own blocks so bufferImageGranularity never matters
+    char*          pMapped;         // stays mapped while the block lives if the memory is host visible
+    BuddyAllocator ranges;
+
+};
+
+/// Sub-allocates the buffers and images of the viewports and the staging ring instead of giving each its own VkDeviceMemory. 
+struct DeviceAllocator {
+
+    VkPhysicalDeviceMemoryProperties memProps;
+    std::vector<MemoryBlock>         blocks;
+    uint32_t                         dedicatedCount;
+    VkDeviceSize                     dedicatedBytes;
+
+};
+
+/// A Vulkan object that the frames in flight may still use. 
+struct RetiredObject {
+
+    uint64_t         frameNumber; // VlknRenderInstance::frameNumber when it was retired
+    VkObjectType     type;
+    uint64_t         handle;
+    MemoryAllocation allocation;  // freed instead of handle for VK_OBJECT_TYPE_DEVICE_MEMORY
+
+};
+
+/// When a frame was done on the GPU and on the display, in Core::secondsNow time. 
+struct WatchedFrame {
+
+    uint64_t frameNumber;
+    double   gpuDoneTime;
+    double   presentTime; // 0 without VK_KHR_present_wait, or if the frame went to a replaced swapchain
+
+};
+
+/// Stamps the end of each submitted frame from its own thread, so the times don't depend on when the main thread looks. 
+struct FrameWatcher {
+
+    std::thread               thread;
+    std::mutex                mutex;     // guards everything below
+    std::condition_variable   changed;
+    uint64_t                  submitted; // frames handed to the watcher
+    uint64_t                  watched;   // frames whose fence the watcher is done with
+    bool                      quit;
+    std::vector<WatchedFrame> timings;   // taken by Core::collectFrameTimings
+
+};
+
+constexpr uint32_t c_StagingSegmentCount = 4;
+
+// Fixed size host visible buffer that all uploads are streamed through. 
+// The ring is split into segments that each have their own command buffer and timeline value,
+// so the CPU can fill one segment while the GPU is still copying out of the others.
+// Segments are submitted to the transfer queue, rendering doesn't wait for them. 
+// A mesh is staged once its load is done: the loaders dedup and may regenerate normals until the end, 
+// so the final buffers and their sizes aren't known while parsing. Parsing of the other queued loads overlaps the copies. 
+struct StagingRing {
+
+    VkBuffer         buff;
+    MemoryAllocation mem;
+    char*            pMappedData;
+    VkDeviceSize     segmentSize;
+    VkCommandPool    commandPool;   // of the transfer queue family
+    VkCommandBuffer  commandBuffs[c_StagingSegmentCount];
+    VkSemaphore      timeline;      // signaled with the value of each segment once its copies are done
+    uint64_t         segmentValues[c_StagingSegmentCount];
+    uint64_t         submittedValue; // value of the last submitted segment
+    uint32_t         segmentIndex;  // segment currently being filled
+    VkDeviceSize     segmentOffset; // bytes already used in the current segment
+    bool             recording;     // commandBuffs[segmentIndex] has begun recording
+
+};
+
 struct VlknRenderInstance {
 
     VkInstance               instance;
@@ -61,21 +200,53 @@ struct VlknRenderInstance {
     uint32_t                 presentQueueIndex;
     VkPhysicalDevice         physicalDevice;
     VkDevice                 device;
+    uint32_t                 transferQueueIndex; // graphicsQueueIndex if the device has no separate transfer family
     VkQueue                  graphicsQueue;
     VkQueue                  presentQueue;
+    VkQueue                  transferQueue;
     VkExtent2D               windowImageExtent;
     VkPresentModeKHR         presentMode;
     VkSwapchainKHR           swapchain;
     uint32_t                 imageCount;
     SwapchainImageObjects    swapchainImageObjects[4]; 
-    VkSemaphore              imageReadySemaphore; 
-    VkFence                  frameFinishedFence;
+    FrameContext             frames[c_MaxFramesInFlight]; // c_vlkn::framesInFlight of them are used
     VkRenderPass             renderPass;
     VkCommandPool            commandPool;
-    VkCommandBuffer          commandBuff;
+    VkCommandBuffer          commandBuff;        // of the frame being recorded
     VkDescriptorPool         descriptorPool;
-    
-    float                    frameWaitTime;
+    VkPipelineCache          pipelineCache;      // shared by every pipeline, ImGui's too
+    std::unique_ptr<char[]>  pipelineCachePath;  // in the app data directory
+    DeviceAllocator          allocator;
+    StagingRing              stagingRing;
+    bool                     hasMemoryBudgetExt; // VK_EXT_memory_budget is enabled
+    bool                     hasPresentWait;     // VK_KHR_present_id and VK_KHR_present_wait are enabled
+    PFN_vkWaitForPresentKHR  waitForPresentKHR;
+    std::mutex               swapchainMutex;     // guards swapchain, firstPresentId and presentWaitSwapchain across threads
+    uint64_t                 firstPresentId;     // of the current swapchain, present ids are frameNumber + 1
+    VkSwapchainKHR           presentWaitSwapchain; // the frame watcher is waiting on, it isn't destroyed meanwhile
+    FrameWatcher             frameWatcher;
+    float                    timestampPeriod;    // nanoseconds per timestamp tick, 0 if the graphics queue has no timestamps
+    uint64_t                 timestampMask;      // valid bits of a timestamp
+    uint64_t                 frameNumber;        // frames submitted since launch
+    std::vector<RetiredObject> retiredObjects;   // destroyed by Core::destroyRetiredObjects once their frame is done
+
+};
+
+/// Everything the image of a viewport depends on, it is only drawn again when this changes. 
+/// Resizes are covered by resourceVersion since they create new render targets. 
+struct ViewportRenderState {
+
+    glm::mat4 model;
+    float     zoomDistance;
+    float     farPlaneClip;
+    bool      showEdges;
+    uint32_t  partsVersion;    // Gui::ViewportGuiData::partsVersion
+    uint32_t  resourceVersion; // ViewportInstance::resourceVersion
+
+    bool operator==(const ViewportRenderState& other) const {
+        return model == other.model && zoomDistance == other.zoomDistance && farPlaneClip == other.farPlaneClip && 
+            showEdges == other.showEdges && partsVersion == other.partsVersion && resourceVersion == other.resourceVersion;
+    }
 
 };
 
@@ -83,29 +254,41 @@ struct VlknRenderInstance {
 struct ViewportInstance {
 
     VkImage                 image;
-    VkDeviceMemory          imageMem;
+    MemoryAllocation        imageMem;
     VkImageView             imageView;
     VkFramebuffer           framebuffer;
     VkImage                 colorImage;
-    VkDeviceMemory          colorImageMem;
+    MemoryAllocation        colorImageMem;
     VkImageView             colorImageView;
     VkImage                 depthImage;
-    VkDeviceMemory          depthImageMem;
+    MemoryAllocation        depthImageMem;
     VkImageView             depthImageView;
     VkBuffer                vertBuff;
-    VkDeviceMemory          vertBuffMem;
+    MemoryAllocation        vertBuffMem;
     VkBuffer                indexBuff;
-    VkDeviceMemory          indexBuffMem;
+    MemoryAllocation        indexBuffMem;
+    VkBuffer                colorBuff;        // RGBA8 per vertex, VK_NULL_HANDLE if the file has no colors
+    MemoryAllocation        colorBuffMem;
     VkDescriptorSet         descriptorSet;
+    VkDeviceSize            geometryBytes;    // device memory of vertBuff, indexBuff and colorBuff, 0 while evicted
+    VkDeviceSize            imageBytes;       // device memory of the render targets, 0 while released
+    uint64_t                uploadValue;      // StagingRing::timeline value the geometry upload is done at
+    bool                    geometryPending;  // the geometry is still uploading or its buffers aren't acquired by the graphics queue yet
+    uint64_t                lastVisibleFrame;
+    uint32_t                resourceVersion;  // incremented when the render targets or the geometry are created or destroyed
+    ViewportRenderState     renderedState;    // inputs of the image in the render target
+    bool                    reloadQueued;     // evicted geometry is being reloaded from filePath
+    bool                    reloadFailed;     // filePath couldn't be reloaded, the viewport stays empty instead of retrying every frame
+    std::unique_ptr<char[]> filePath;
+    mload::LoadSettings     loadSettings;     // settings the file was opened with, reused when reloading
+    std::vector<MeshPart>     meshParts;      // empty if the file has no parts, the index buffer is drawn at once then
+    std::vector<MeshInstance> meshInstances;  // empty if every part is drawn once without a transform
 
 };
 
 struct ViewportsRenderInstance {
 
-    VkRenderPass          renderPass;
-    VkPipelineLayout      pipelineLayout;
-    VkPipeline            graphicsPipeline;
-    VkPipeline            meshOutlinePipeline; 
+    ViewportPipelines     pipelines;
     VkSampler             frameSampler;
     VkDescriptorSetLayout descriptorSetLayout;
     VkImage               logoImg;
@@ -124,12 +307,48 @@ struct ViewportsRenderInstance {
 
 };
 
+// A file parsed on the shared worker pool. Everything but progress and done belongs to the worker until done is set. 
+struct PendingLoad {
+
+    std::unique_ptr<char[]>    filePath;
+    const char*                fileTitle;   // points into filePath
+    HWND                       notifyHwnd;  // woken up when the progress changes or the load finishes
+    size_t                     fileSize;    // bytes
+    size_t                     budgetBytes; // host memory reserved from LoadQueue::budget while parsing
+    bool                       reload;      // refills the evicted geometry of the open viewport with the same filePath
+    bool                       started;
+    std::atomic<float>         progress;
+    std::atomic<bool>          done;
+    mload::Success             result;
+    mload::LoadSettings        settings;
+    mload::ModelInfo           modelInfo;
+    mload::PipelineStats       pipelineStats;
+    bool                       isTextFormat;
+    std::vector<mload::Vertex> vertices;
+    std::vector<uint32_t>      indices;
+
+};
+
+// Only touched by the main thread. 
+struct LoadQueue {
+
+    std::vector<std::unique_ptr<PendingLoad>> loads;
+    size_t                                    budget;      // bytes, set when a batch starts
+    size_t                                    budgetInUse; // bytes
+    std::chrono::steady_clock::time_point     batchStart;
+    uint32_t                                  batchFileCount;
+    size_t                                    batchBytes;
+
+};
+
 struct Instance {
 
     WindowInstance          wind{};
     VlknRenderInstance      rend{};
     ViewportsRenderInstance vpRend{};
     Gui::DrawData           gui{};
+    LoadQueue               loadQueue{};
+    FramePacer              pacer{};
 
 };
 
@@ -141,19 +360,99 @@ struct  VertexIndexBuffersInfo {
     void*  indexData; 
     size_t indexDataSize;
 
+    void*  colorData;     // optional, RGBA8 per vertex
+    size_t colorDataSize;
+
 };
 
 // functions
-void     createSwapchain           (Instance* inst);
+void     createSwapchain           (Instance* inst, VkSwapchainKHR oldSwapchain);
 void     createFramebuffers        (VlknRenderInstance* rend); 
 void     cleanupSwapchainResources (VlknRenderInstance* rend);
+/// Creates the swapchain from the old one without waiting on the device, the old images are retired. 
 void     recreateSwapchain         (Instance* inst);
-
+/// Queues the object to be destroyed once every frame that may use it is done on the GPU. 
+void     retireObject              (VlknRenderInstance* rend, VkObjectType type, uint64_t handle);
+/// Destroys the retired objects whose frames are done, or all of them when the device is idle. 
+void     destroyRetiredObjects     (VlknRenderInstance* rend, bool deviceIdle);
+
+void     initDeviceAllocator       (VlknRenderInstance* rend);
+/// Frees the empty blocks, every allocation must be freed before. 
+void     destroyDeviceAllocator    (VlknRenderInstance* rend);
+/// Places the memory in a block of a type with the properties, allocations of c_vlkn::dedicatedAllocationSize or more get their own VkDeviceMemory. 
+/// @param linear true for buffers, false for optimal tiling images
+MemoryAllocation allocateMemory    (VlknRenderInstance* rend, const VkMemoryRequirements& requirements, VkMemoryPropertyFlags properties, bool linear);
+void     freeMemory                (VlknRenderInstance* rend, MemoryAllocation* allocation);
+/// Like Core::retireObject, the allocation is freed once every frame that may use it is done. 
+void     retireMemory              (VlknRenderInstance* rend, MemoryAllocation* allocation);
+/// Creates the buffer and binds it to memory from Core::allocateMemory. 
+void     createBuffer              (VlknRenderInstance* rend, VkDeviceSize size, VkBufferUsageFlags usage, VkMemoryPropertyFlags properties, VkBuffer* buff, MemoryAllocation* allocation);
+/// Binds the image to device local memory from Core::allocateMemory. 
+void     allocateImageMemory       (VlknRenderInstance* rend, VkImage image, MemoryAllocation* allocation);
+
+/// Creates rend->pipelineCache from the file of an earlier run, empty if there is none or another device or driver wrote it. 
+/// @return true if the file was loaded
+bool     createPipelineCache       (VlknRenderInstance* rend);
+/// Writes the pipeline cache to its file for the next run and destroys it. 
+void     destroyPipelineCache      (VlknRenderInstance* rend);
+
+void     createStagingRing         (VlknRenderInstance* rend);
+void     destroyStagingRing        (VlknRenderInstance* rend);
+/// Copies data into the staging ring and records the copy to dstBuff. Segments are submitted as they fill up.
+/// The graphics queue family gets the ownership of dstBuff after the copy, so each buffer is uploaded with one call. 
+void     stageBufferUpload         (VlknRenderInstance* rend, VkBuffer dstBuff, const void* data, VkDeviceSize size);
+/// Timeline value that the uploads staged so far are done at. 
+uint64_t stagedUploadValue         (VlknRenderInstance* rend);
+/// Submits the partially filled segment without waiting for it. 
+void     submitStagingRing         (VlknRenderInstance* rend);
+bool     uploadDone                (VlknRenderInstance* rend, uint64_t uploadValue);
+void     waitForUpload             (VlknRenderInstance* rend, uint64_t uploadValue);
+/// Records the acquire of the buffers of uploads that are done into the frame command buffer, before any render pass. 
+/// @return timeline value the frame submission has to wait for, 0 if no geometry became ready
+uint64_t acquireUploadedGeometry   (Instance* inst);
+
+/// Seconds on a steady clock, the clock of the frame loop and the frame pacer. 
+double   secondsNow                ();
+/// Starts the thread that stamps when each submitted frame is done on the GPU and, with VK_KHR_present_wait, on the display. 
+void     startFrameWatcher         (VlknRenderInstance* rend);
+void     stopFrameWatcher          (VlknRenderInstance* rend);
+/// Hands the frame that was just submitted to the watcher. 
+void     watchFrame                (VlknRenderInstance* rend);
+/// Waits until the watcher is done with the fence the next frame reuses, so it can be reset. 
+void     waitForFenceWatched       (VlknRenderInstance* rend);
+/// Passes the timings the watcher stamped since the last call to the pacer. 
+void     collectFrameTimings       (VlknRenderInstance* rend, FramePacer* pacer);
+
+/// Creates a timestamp query pool for each frame context, if the graphics queue supports timestamps. 
+void     createFrameTimestamps     (VlknRenderInstance* rend);
+void     destroyFrameTimestamps    (VlknRenderInstance* rend);
+/// Resets the queries of the frame, recorded into the frame command buffer before any render pass. 
+void     beginFrameTimestamps      (VlknRenderInstance* rend, FrameTimestamps* timestamps);
+/// @return the query index, c_NoTimestamp if there are no timestamps or the pool is full
+uint32_t writeTimestamp            (VlknRenderInstance* rend, FrameTimestamps* timestamps, VkPipelineStageFlagBits stage);
+/// Adds the GPU times of a finished frame to the rolling averages of the DEVINFO stats. 
+void     readFrameTimestamps       (Instance* inst, FrameTimestamps* timestamps);
+/// Drops the viewport timestamps of the frames in flight, their indices are wrong once a viewport is removed. 
+void     discardViewportTimestamps (VlknRenderInstance* rend);
+
+/// Stages the geometry upload. The viewport draws it once Core::acquireUploadedGeometry finds the upload done. 
 void     createGeometryData        (Instance* inst, ViewportInstance* vpInst, VertexIndexBuffersInfo* buffsInfo);
 void     createVpImageResources    (Instance* inst, ViewportInstance* vpInst, const VkExtent2D size);
+/// Queues the file to be parsed on the worker pool. @return false if the file is already open or queued 
 bool     openMeshFile              (Instance* inst, const char* file);
-void     destroyGeometryData       (VkDevice device, ViewportInstance* vpInst);
-void     destroyVpImageResources   (VkDevice device, ViewportInstance* vpInst);   
+/// Starts queued loads that fit in the memory budget and opens the finished ones, uploading them in one batch. 
+void     updateLoads               (Instance* inst);
+/// Blocks until every started load has finished. 
+void     waitForLoads              (Instance* inst);
+/// Retires the buffers of the viewport, see Core::retireObject.
+void     destroyGeometryData       (VlknRenderInstance* rend, ViewportInstance* vpInst);
+/// Retires the render targets and the descriptor set of the viewport, see Core::retireObject.
+void     destroyVpImageResources   (VlknRenderInstance* rend, ViewportInstance* vpInst);   
+/// Queues the evicted geometry of the viewport to be loaded again from its source file. 
+void     reloadGeometryData        (Instance* inst, ViewportInstance* vpInst);
+/// Releases the render targets of viewports that have been hidden for a while, and while the viewports use more device memory 
+/// than the budget, releases hidden render targets and then evicts geometry, least recently viewed first. 
+void     enforceMemoryBudget       (Instance* inst);
 
     namespace Callback {
 
@@ -6,17 +6,47 @@ constexpr float c_WindowAspectRatio = 1.5;
 constexpr float c_WindowPercentSize = 0.85;
 /// Min window width and height
 constexpr int c_minWidth = 300, c_minHeight = 300; 
+/// Host memory a load is estimated to need per byte of the file (file data, vertex/index buffers and the dedup map).
+constexpr size_t c_LoadBytesPerFileByte = 4;
+/// Fraction of the available physical memory that loads may use while parsing at the same time. 
+constexpr double c_LoadMemoryBudgetFraction = 0.5;
 
 namespace c_vlkn {
 
 constexpr VkColorSpaceKHR       colorSpace        = VK_COLOR_SPACE_SRGB_NONLINEAR_KHR;
 constexpr VkFormat              format            = VK_FORMAT_R8G8B8A8_UNORM;
 constexpr VkSampleCountFlagBits sampleCount       = VK_SAMPLE_COUNT_8_BIT;
-constexpr VkPresentModeKHR      presentMode       = VK_PRESENT_MODE_IMMEDIATE_KHR; // NOTE: The framerate is limited by a sleep (check bottom of App::render()) to reduce input lag but not render unnecessary frames.
+constexpr VkPresentModeKHR      presentMode       = VK_PRESENT_MODE_IMMEDIATE_KHR; // NOTE: The framerate is limited by Core::runFrameLoop to reduce input lag but not render unnecessary frames.
 constexpr VkPresentModeKHR      backupPresentMode = VK_PRESENT_MODE_FIFO_KHR;
 constexpr uint32_t              imageCount        = 2; 
+/// Frames the CPU records ahead of the GPU, each with its own Core::FrameContext. At most imageCount because ImGui keeps its vertex buffers per swapchain image.
+constexpr uint32_t              framesInFlight    = 2;
+static_assert(framesInFlight <= imageCount && framesInFlight <= Core::c_MaxFramesInFlight, "Too many frames in flight");
 constexpr uint32_t              maxSets           = 101;
 
 constexpr VkFormat depthFormat = VK_FORMAT_D32_SFLOAT;
 
+/// Size of one staging ring segment. The whole ring is Core::c_StagingSegmentCount times this (64 MB). 
+constexpr VkDeviceSize stagingSegmentSize = 16 * 1024 * 1024;
+
+/// Size of the VkDeviceMemory blocks that Core::DeviceAllocator places buffers and images in. 
+constexpr VkDeviceSize memoryBlockSize         = 64 * 1024 * 1024;
+/// Allocations this large get a VkDeviceMemory of their own instead of taking most of a block. 
+constexpr VkDeviceSize dedicatedAllocationSize = 16 * 1024 * 1024;
+/// Smallest range a block is split into. 
+constexpr VkDeviceSize minAllocationSize       = 256;
+
+/// Fraction of the device local heap (or of its VK_EXT_memory_budget budget) the viewports may use. 
+constexpr double deviceMemoryBudgetFraction = 0.8;
+/// Render targets of a viewport are released after it has been hidden for this many frames. 
+constexpr uint64_t releaseTargetsAfterFrames = 600;
+
+/// Weight of the newest frame in the rolling averages of the GPU pass times. 
+constexpr float    gpuTimeSmoothing = 0.05f;
+
+/// The frame watcher waits for presents in slices of this many nanoseconds and checks the fences of later frames in between. 
+constexpr uint64_t presentWaitSlice = 200000;
+/// Frames that take longer than this to reach the display after the GPU is done get no present time (seconds). 
+constexpr double   presentWaitLimit = 0.1;
+
 }
\ No newline at end of file
@@ -28,6 +28,11 @@ bool getCustomIniData(CustomIniData* dataIn, const char* iniPath) {
 			fgets(line, sizeof line, ini);
 			int count = sscanf(line, "Sensitivity=%i", &dataIn->sensitivity);
 			assert(count == 1);
+			// Entries added after the first release are optional so older ini files still load.
+			while (fgets(line, sizeof line, ini) && line[0] != '\n') {
+				sscanf(line, "NormalMode=%i",  &dataIn->normalMode);
+				sscanf(line, "CreaseAngle=%i", &dataIn->creaseAngle);
+			}
 			PreferencesFound = true; 
 		}
 	}
@@ -52,7 +57,7 @@ void setCustomIniData(const CustomIniData& dataOut, const char* iniPath) {
 		dataOut.windowHeight,
 		dataOut.windowMaximized
 	);
-	fprintf(ini, "[Preferences]\nSensitivity=%i\n\n", dataOut.sensitivity);
+	fprintf(ini, "[Preferences]\nSensitivity=%i\nNormalMode=%i\nCreaseAngle=%i\n\n", dataOut.sensitivity, dataOut.normalMode, dataOut.creaseAngle);
 
 	fclose(ini);
 
@@ -3,6 +3,8 @@
 struct CustomIniData {
 
     int sensitivity; 
+    int normalMode;  // mload::NormalMode
+    int creaseAngle; // degrees
 
     int windowWidth, windowHeight;
     int windowPosX, windowPosY;
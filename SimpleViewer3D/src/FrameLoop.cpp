@@ -0,0 +1,32 @@
+#include "FrameLoop.hpp"
+
+void Core::runFrameLoop(LoopPlatform* platform, FramePacer* pacer) {
+
+    uint32_t cyclesLeft = 1; // draw the first frame without waiting for input
+
+    while (true) {
+
+        uint32_t eventCount = 0;
+        if (!platform->dispatchEvents(&eventCount)) return;
+        if (eventCount > 0) cyclesLeft = c_CyclesAfterEvents;
+
+        if (cyclesLeft == 0) {
+            platform->waitForEvents(-1.0);
+            continue;
+        }
+
+        // Events that arrive while waiting are handled together before the cycle
+        double time      = platform->now();
+        double nextCycle = pacer->nextCycleStart(time);
+        if (time < nextCycle) {
+            platform->waitForEvents(nextCycle - time);
+            continue;
+        }
+        pacer->cycleStarted(time);
+
+        cyclesLeft--;
+        if (platform->runCycle() && cyclesLeft == 0) cyclesLeft = 1;
+
+    }
+
+}
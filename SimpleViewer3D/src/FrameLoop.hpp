@@ -0,0 +1,33 @@
+#pragma once
+
+// Main loop scheduling that doesn't depend on a window, so it can be driven by a fake clock and event source.
+
+#include "FramePacer.hpp"
+
+#include <stdint.h>
+
+namespace Core {
+
+/// What the frame loop needs from the platform. 
+struct LoopPlatform {
+
+    virtual ~LoopPlatform() = default;
+    /// Seconds since any fixed point in time. 
+    virtual double now() = 0;
+    /// Handles every pending event without blocking and adds how many there were to eventCount. Returns false once the app should quit. 
+    virtual bool   dispatchEvents(uint32_t* eventCount) = 0;
+    /// Blocks until an event is pending or timeout seconds have passed. A negative timeout waits for the next event. 
+    virtual void   waitForEvents(double timeout) = 0;
+    /// Runs one cycle of the app. Returns true while it has more to show without new events, e.g. a running load. 
+    virtual bool   runCycle() = 0;
+
+};
+
+/// GUI state such as hover highlights settles a cycle after the input that changed it. 
+constexpr uint32_t c_CyclesAfterEvents = 2;
+
+/// Runs until the platform asks to quit. All pending events are handled before a cycle, so a burst of input costs one cycle, 
+/// cycles start when the pacer schedules them, and when there is nothing to do the loop blocks until the next event. 
+void runFrameLoop(LoopPlatform* platform, FramePacer* pacer);
+
+}
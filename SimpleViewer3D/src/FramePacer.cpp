@@ -0,0 +1,115 @@
+#include "FramePacer.hpp"
+
+#include <algorithm>
+#include <cmath>
+
+/// Added to the margin for each missed deadline, an eighth of it is taken off for each deadline that is made. 
+constexpr double c_MarginStep = 0.0005;
+constexpr double c_MinMargin  = 0.0005;
+/// Present times are reported with some error, later than this after the deadline counts as a miss. 
+constexpr double c_DeadlineTolerance = 0.0002;
+/// Percentile of the recent CPU and GPU times the estimate uses. 
+constexpr float  c_WorkPercentile = 0.95f;
+
+static float percentile(float* values, uint32_t count, float fraction) {
+
+    if (count == 0) return 0.0f;
+    uint32_t index = std::min(count - 1, (uint32_t)(fraction * count));
+    std::nth_element(values, values + index, values + count);
+    return values[index];
+
+}
+
+void Core::FramePacer::init(double interval) {
+
+    *this = {};
+    refreshInterval = interval;
+    margin          = c_MinMargin;
+
+}
+static double workEstimate(const Core::FramePacer* pacer) {
+
+    float    cpuTimes[Core::c_PacerHistory], gpuTimes[Core::c_PacerHistory];
+    uint32_t cpuCount = 0, gpuCount = 0;
+    for (const Core::FrameTimings& frame : pacer->frames) {
+        if (frame.submitTime  != 0.0) cpuTimes[cpuCount++] = (float)(frame.submitTime  - frame.inputTime);
+        if (frame.gpuDoneTime != 0.0) gpuTimes[gpuCount++] = (float)(frame.gpuDoneTime - frame.submitTime);
+    }
+    return percentile(cpuTimes, cpuCount, c_WorkPercentile) + percentile(gpuTimes, gpuCount, c_WorkPercentile) + pacer->margin;
+
+}
+double Core::FramePacer::nextCycleStart(double now) {
+
+    if (plannedStart != 0.0) return plannedStart;
+
+    // The first refresh the frame can make, at most one frame per refresh
+    double work     = workEstimate(this);
+    double earliest = std::max(now + work, lastDeadline + 0.5 * refreshInterval);
+    double anchor   = gridAnchor != 0.0 ? gridAnchor : earliest;
+    plannedDeadline = anchor + std::ceil((earliest - anchor) / refreshInterval) * refreshInterval;
+    plannedStart    = std::max(now, plannedDeadline - work);
+    return plannedStart;
+
+}
+void Core::FramePacer::cycleStarted(double time) {
+
+    if (plannedStart == 0.0) nextCycleStart(time);
+    lastDeadline   = plannedDeadline;
+    cycleInputTime = time;
+    plannedStart   = 0.0;
+    if (!hasPresentTimes) gridAnchor = lastDeadline;
+
+}
+void Core::FramePacer::frameSubmitted(uint64_t frameNumber, double time) {
+
+    FrameTimings& frame = frames[frameNumber % c_PacerHistory];
+    frame = {};
+    frame.frameNumber = frameNumber;
+    frame.deadline    = lastDeadline;
+    frame.inputTime   = cycleInputTime;
+    frame.submitTime  = time;
+
+}
+static void frameFinished(Core::FramePacer* pacer, const Core::FrameTimings& frame, double time) {
+
+    if (time > frame.deadline + c_DeadlineTolerance) {
+        pacer->margin = std::min(pacer->margin + c_MarginStep, pacer->refreshInterval);
+        pacer->missedDeadlines++;
+    }
+    else {
+        pacer->margin = std::max(pacer->margin - c_MarginStep / 8, c_MinMargin);
+    }
+
+}
+void Core::FramePacer::frameGpuDone(uint64_t frameNumber, double time) {
+
+    FrameTimings& frame = frames[frameNumber % c_PacerHistory];
+    if (frame.frameNumber != frameNumber || frame.submitTime == 0.0) return;
+    frame.gpuDoneTime = time;
+    if (!hasPresentTimes) frameFinished(this, frame, time);
+
+}
+void Core::FramePacer::framePresented(uint64_t frameNumber, double time) {
+
+    FrameTimings& frame = frames[frameNumber % c_PacerHistory];
+    if (frame.frameNumber != frameNumber || frame.submitTime == 0.0) return;
+    frame.presentTime = time;
+    hasPresentTimes   = true;
+    gridAnchor        = time;
+    frameFinished(this, frame, time);
+
+}
+Core::LatencyStats Core::FramePacer::latency() const {
+
+    float        latencies[c_PacerHistory];
+    LatencyStats stats{};
+    stats.toPresent = hasPresentTimes;
+    for (const FrameTimings& frame : frames) {
+        double end = hasPresentTimes ? frame.presentTime : frame.gpuDoneTime;
+        if (end != 0.0) latencies[stats.sampleCount++] = (float)(end - frame.inputTime);
+    }
+    stats.median = percentile(latencies, stats.sampleCount, 0.5f);
+    stats.p99    = percentile(latencies, stats.sampleCount, 0.99f);
+    return stats;
+
+}
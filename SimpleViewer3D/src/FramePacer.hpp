@@ -0,0 +1,62 @@
+#pragma once
+
+// Decides when the frame loop samples input, from measured frame timings. Doesn't depend on a window or on Vulkan, 
+// so it can be driven by a simulated clock and display.
+
+#include <stdint.h>
+
+namespace Core {
+
+/// Frames the work estimates and the latency percentiles are taken over. 
+constexpr uint32_t c_PacerHistory = 128;
+
+/// Timings of one frame in seconds on the loop clock, 0 while unknown. 
+struct FrameTimings {
+
+    uint64_t frameNumber;
+    double   deadline;    // refresh the frame was scheduled to make
+    double   inputTime;   // the cycle started and sampled input
+    double   submitTime;  // the CPU submitted the frame
+    double   gpuDoneTime; // the frame fence was signaled
+    double   presentTime; // the frame reached the display, only with present timing
+
+};
+
+struct LatencyStats {
+
+    float    median;       // seconds from input to present, or to GPU completion without present timing
+    float    p99;
+    uint32_t sampleCount;
+    bool     toPresent;
+
+};
+
+/// Schedules each cycle to start as late as the recent frames allow while still finishing before the next refresh. 
+/// The refresh grid follows the present times when they are reported, and the slack on top of the estimates 
+/// grows when a frame misses its deadline and slowly shrinks while they are made. 
+struct FramePacer {
+
+    double       refreshInterval;
+    double       margin;          // seconds of slack on top of the work estimate
+    double       gridAnchor;      // a refresh of the display, or the last deadline without present timing
+    double       lastDeadline;
+    double       plannedStart;    // 0 until the loop asks for the next cycle
+    double       plannedDeadline;
+    double       cycleInputTime;  // of the running cycle, assigned to the frame it submits
+    bool         hasPresentTimes;
+    FrameTimings frames[c_PacerHistory];
+    uint32_t     missedDeadlines;
+
+    void         init           (double refreshInterval);
+    /// When the next cycle should start. Stays the same until cycleStarted, so the loop can wait for it. 
+    double       nextCycleStart (double now);
+    void         cycleStarted   (double time);
+    void         frameSubmitted (uint64_t frameNumber, double time);
+    void         frameGpuDone   (uint64_t frameNumber, double time);
+    void         framePresented (uint64_t frameNumber, double time);
+    /// Seconds from input to the end of the frame it went into, over the last c_PacerHistory frames. 
+    LatencyStats latency        () const;
+
+};
+
+}
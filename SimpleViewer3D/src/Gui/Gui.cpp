@@ -1,6 +1,7 @@
 #include "Gui.hpp"
 
 #include <imgui_internal.h>
+#include <Timer.hpp>
 
 #include <algorithm>
 
@@ -57,7 +58,7 @@ void Gui::init(InitInfo* initInfo, GuiStyleEx* styleEx, float guiDpi) {
     imguiInitInfo.Device          = initInfo->device;
     imguiInitInfo.QueueFamily     = initInfo->graphicsQueueIndex;
     imguiInitInfo.Queue           = initInfo->graphicsQueue;
-    imguiInitInfo.PipelineCache   = VK_NULL_HANDLE;
+    imguiInitInfo.PipelineCache   = initInfo->pipelineCache;
     imguiInitInfo.DescriptorPool  = initInfo->descriptorPool;
     imguiInitInfo.MinImageCount   = initInfo->imageCount;
     imguiInitInfo.ImageCount      = initInfo->imageCount;
@@ -66,8 +67,11 @@ void Gui::init(InitInfo* initInfo, GuiStyleEx* styleEx, float guiDpi) {
     imguiInitInfo.PipelineInfoMain.MSAASamples     = VK_SAMPLE_COUNT_1_BIT;
     imguiInitInfo.Allocator = nullptr;
     imguiInitInfo.CheckVkResultFn = [](VkResult err) { assert(err == VK_SUCCESS && "check_vk_result failed"); };
-    
-    ImGui_ImplVulkan_Init(&imguiInitInfo);
+
+    {
+        scopedTimer(t1, initInfo->pipelineTimer);
+        ImGui_ImplVulkan_Init(&imguiInitInfo);
+    }
 
     // Style
     {
@@ -255,6 +259,13 @@ void Gui::draw(HWND hwnd, Commands* commands, DrawData* data) {
             if (ImGui::BeginMenu("Preferences")) { 
                 ImGui::Text("Sensitivity"); ImGui::SameLine();
                 ImGui::SliderFloat("##Sense", &data->sensitivity, 1.0f, 100.0f, " % .0f", ImGuiSliderFlags_ClampOnInput);
+                ImGui::Text("Normals"); ImGui::SameLine();
+                const char* normalModes[] = { "From File", "Flat", "Smooth" }; // Matches mload::NormalMode
+                ImGui::Combo("##Normals", &data->normalMode, normalModes, IM_ARRAYSIZE(normalModes));
+                ImGui::BeginDisabled(data->normalMode != 2);
+                ImGui::Text("Crease Angle"); ImGui::SameLine();
+                ImGui::SliderFloat("##Crease", &data->creaseAngle, 0.0f, 180.0f, "%.0f deg", ImGuiSliderFlags_ClampOnInput);
+                ImGui::EndDisabled();
                 ImGui::EndMenu(); 
             }
             ImGui::PopStyleVar(); 
@@ -458,6 +469,51 @@ void Gui::draw(HWND hwnd, Commands* commands, DrawData* data) {
 
         ImGui::SeparatorText("Viewports Data");
         ImGui::Text("Viewport resizes: %u", data->stats.resizeCount);
+        ImGui::Text("Part draws: %u, culled: %u", data->stats.partDraws, data->stats.partsCulled);
+        ImGui::Text("Viewport renders: %u, skipped: %u", data->stats.viewportRenders, data->stats.viewportRendersSkipped);
+
+        ImGui::SeparatorText("Frame Pacing");
+        ImGui::Text("Input to %s: %.2fms median, %.2fms p99", data->stats.latencyToPresent ? "present" : "GPU done", 1000 * data->stats.inputLatencyMedian, 1000 * data->stats.inputLatencyP99);
+        ImGui::Text("Margin: %.2fms, missed deadlines: %u", 1000 * data->stats.pacingMargin, data->stats.missedDeadlines);
+
+        ImGui::SeparatorText("GPU Times");
+        if (data->stats.gpuTimestamps) {
+            ImGui::Text("Main pass: %.3fms (avg %.3fms)", data->stats.gpuMainPassMs, data->stats.gpuMainPassAvgMs);
+            ImGui::Text("Viewport passes: %.3fms (avg %.3fms)", data->stats.gpuViewportPassesMs, data->stats.gpuViewportPassesAvgMs);
+            for (const ViewportGuiData& vpData : data->vpDatas) {
+                ImGui::Text("  %s: %.3fms, edges %.3fms", vpData.objectName.get(), vpData.gpuPassAvgMs, vpData.gpuEdgesAvgMs);
+            }
+        }
+        else ImGui::Text("No timestamps on the graphics queue");
+
+        ImGui::SeparatorText("Memory");
+        constexpr float MB = 1024.0f * 1024.0f;
+        ImGui::Text("Device budget: %.1f MB", data->stats.deviceMemoryBudget / MB);
+        ImGui::Text("Geometry: %.1f MB", data->stats.geometryBytes / MB);
+        ImGui::Text("Render targets: %.1f MB", data->stats.renderTargetBytes / MB);
+        ImGui::Text("Geometry evictions: %u", data->stats.geometryEvictions);
+        ImGui::Text("Render target releases: %u", data->stats.renderTargetReleases);
+        ImGui::Text("Host load memory: %.1f / %.1f MB", data->stats.hostLoadBytes / MB, data->stats.hostLoadBudget / MB);
+        uint64_t freeBlockBytes = data->stats.memoryBlockBytes - data->stats.subAllocatedBytes;
+        float fragmentation = freeBlockBytes > 0 ? 1.0f - (float)data->stats.largestFreeRange / freeBlockBytes : 0.0f;
+        float roundingWaste = data->stats.subAllocatedBytes > 0 ? 1.0f - (float)data->stats.requestedBytes / data->stats.subAllocatedBytes : 0.0f;
+        ImGui::Text("Memory blocks: %u, %.1f / %.1f MB in %u allocations", data->stats.memoryBlocks, data->stats.subAllocatedBytes / MB, data->stats.memoryBlockBytes / MB, data->stats.subAllocations);
+        ImGui::Text("Rounding waste: %.0f%%, largest free: %.1f MB (%.0f%% fragmented)", 100 * roundingWaste, data->stats.largestFreeRange / MB, 100 * fragmentation);
+        ImGui::Text("Dedicated allocations: %u, %.1f MB", data->stats.dedicatedAllocations, data->stats.dedicatedBytes / MB);
+
+        ImGui::SeparatorText("File Loading");
+        ImGui::Text("Last batch: %u files", data->stats.lastLoadFileCount);
+        ImGui::Text("Throughput: %.1f files/s, %.1f MB/s", data->stats.lastLoadFilesPerSec, data->stats.lastLoadMBPerSec);
+        ImGui::Text("Last pipelined load: %.2fms", 1000 * data->stats.lastPipelineSeconds);
+        const char* stageNames[] = { "Read", "Parse", "Dedup", "Finish" };
+        for (int stage = 0; stage < IM_ARRAYSIZE(stageNames); stage++) {
+            float utilization = data->stats.lastPipelineSeconds > 0.0f ? data->stats.lastPipelineStageSeconds[stage] / data->stats.lastPipelineSeconds : 0.0f;
+            ImGui::Text("  %-6s %.2fms (%.0f%%)", stageNames[stage], 1000 * data->stats.lastPipelineStageSeconds[stage], 100 * utilization);
+        }
+
+        ImGui::SeparatorText("Benchmarks");
+        if (ImGui::Button("Run Benchmarks")) *commands |= Gui::cmd_runBenchmarksBit;
+        ImGui::TextUnformatted(data->stats.benchmarkReport.c_str());
 
         ImGui::SeparatorText("Performance Times");
         for (int i = 0; i < data->stats.perfTimes.timerCount; i++) 
@@ -493,7 +549,9 @@ void Gui::draw(HWND hwnd, Commands* commands, DrawData* data) {
                     vpData.resize = true; 
                     vpData.size = currentVpSize; 
                 }
-                ImGui::Image(vpData.framebufferTexID, vpData.size);
+                // No render target until the first resize, or while it is released
+                if (vpData.framebufferTexID) ImGui::Image(vpData.framebufferTexID, vpData.size);
+                else                         ImGui::Dummy(vpData.size);
 
                 ImGui::SetCursorPos(ImGui::GetCursorStartPos() + ImVec2(0, 15));
                 if (ImGui::TreeNodeEx("File Info", ImGuiTreeNodeFlags_SpanTextWidth | ImGuiTreeNodeFlags_DefaultOpen)) {
@@ -520,9 +578,63 @@ void Gui::draw(HWND hwnd, Commands* commands, DrawData* data) {
                         ImGui::Text("Text Format?");
                         ImGui::TableSetColumnIndex(1);
                         ImGui::Text("%s", vpData.isTextFormat ? "Yes" : "No");
+                        ImGui::TableNextRow();
+                        ImGui::TableSetColumnIndex(0);
+                        ImGui::Text("Vertex Colors?");
+                        ImGui::TableSetColumnIndex(1);
+                        ImGui::Text("%s", vpData.hasVertexColors ? "Yes" : "No");
+                        if (vpData.normalMode != 0) {
+                            const char* normalModes[] = { "From File", "Flat", "Smooth" };
+                            int   vertexChange  = (int)vpData.uniqueVertexCount - (int)vpData.fileVertexCount;
+                            float percentChange = vpData.fileVertexCount != 0 ? 100.0f * vertexChange / vpData.fileVertexCount : 0.0f;
+                            ImGui::TableNextRow();
+                            ImGui::TableSetColumnIndex(0);
+                            ImGui::Text("Normals");
+                            ImGui::TableSetColumnIndex(1);
+                            ImGui::Text("%s", normalModes[vpData.normalMode]);
+                            ImGui::TableNextRow();
+                            ImGui::TableSetColumnIndex(0);
+                            ImGui::Text("Vertex Change");
+                            ImGui::TableSetColumnIndex(1);
+                            ImGui::Text("%u -> %u (%+.1f%%)", vpData.fileVertexCount, vpData.uniqueVertexCount, percentChange);
+                        }
                         ImGui::EndTable(); 
 
                     }
+                    if (vpData.parts.size() > 1 && ImGui::TreeNodeEx("Parts", ImGuiTreeNodeFlags_SpanTextWidth)) {
+
+                        if (ImGui::SmallButton("Show All")) {
+                            for (PartGuiData& part : vpData.parts) part.visible = true;
+                            vpData.partsVersion++;
+                        }
+                        constexpr int c_maxPartRows = 12;
+                        float tableHeight = ImGui::GetTextLineHeightWithSpacing() * (std::min((int)vpData.parts.size(), c_maxPartRows) + 0.5f);
+                        if (ImGui::BeginTable("Parts Table", 3, ImGuiTableFlags_SizingFixedFit | ImGuiTableFlags_ScrollY, ImVec2(0.0f, tableHeight))) {
+
+                            ImGuiListClipper clipper;
+                            clipper.Begin((int)vpData.parts.size());
+                            while (clipper.Step()) {
+                                for (int row = clipper.DisplayStart; row < clipper.DisplayEnd; row++) {
+                                    PartGuiData& part = vpData.parts[row];
+                                    ImGui::PushID(row);
+                                    ImGui::TableNextRow();
+                                    ImGui::TableSetColumnIndex(0);
+                                    if (ImGui::Checkbox(part.name.c_str(), &part.visible)) vpData.partsVersion++;
+                                    ImGui::TableSetColumnIndex(1);
+                                    ImGui::Text("%u", part.triangleCount);
+                                    ImGui::TableSetColumnIndex(2);
+                                    if (ImGui::SmallButton("Isolate")) {
+                                        for (PartGuiData& other : vpData.parts) other.visible = &other == &part;
+                                        vpData.partsVersion++;
+                                    }
+                                    ImGui::PopID();
+                                }
+                            }
+                            ImGui::EndTable();
+
+                        }
+                        ImGui::TreePop();
+                    }
                     ImGui::TreePop(); 
                 }
 
@@ -575,6 +687,44 @@ void Gui::draw(HWND hwnd, Commands* commands, DrawData* data) {
     //BOOKMARK: fix bug where the window won't close when clicked from menu because the window loses focus when the menu is clicked. 
 
     ImGui::PopStyleVar();
+
+    if (data->loads.size() > 0) {
+
+        ImGui::SetNextWindowSize(ImVec2(20.0f * data->styleEx.sizes.fontSize, 0.0f), ImGuiCond_Always);
+        ImGuiWindowFlags windFlags = ImGuiWindowFlags_NoCollapse | ImGuiWindowFlags_NoSavedSettings | ImGuiWindowFlags_NoDocking;
+        if (ImGui::Begin("Loading", nullptr, windFlags)) {
+
+            ImGui::Text("%u of %u files open", data->loadsFinished, data->loadsFinished + (uint32_t)data->loads.size());
+            ImGui::Text("%.1f files/s, %.1f MB/s", data->loadFilesPerSec, data->loadMBPerSec);
+            ImGui::Separator();
+            for (LoadGuiData& load : data->loads) {
+                ImGui::TextUnformatted(load.fileTitle);
+                ImGui::ProgressBar(load.progress, ImVec2(-1.0f, 0.0f), load.started ? nullptr : "Waiting");
+            }
+
+        }
+        ImGui::End();
+
+    }
+
+    if (data->loadErrors.size() > 0) {
+
+        ImGui::SetNextWindowSize(ImVec2(20.0f * data->styleEx.sizes.fontSize, 0.0f), ImGuiCond_Always);
+        ImGuiWindowFlags windFlags = ImGuiWindowFlags_NoCollapse | ImGuiWindowFlags_NoSavedSettings | ImGuiWindowFlags_NoDocking;
+        if (ImGui::Begin("Could Not Open", nullptr, windFlags)) {
+
+            for (LoadErrorGuiData& error : data->loadErrors) {
+                ImGui::TextUnformatted(error.fileTitle.c_str());
+                ImGui::TextDisabled("%s", error.reason);
+            }
+            ImGui::Separator();
+            if (ImGui::Button("Dismiss")) data->loadErrors.clear();
+
+        }
+        ImGui::End();
+
+    }
+
     ImGui::EndFrame();
 
 }
@@ -14,6 +14,7 @@
 
 #include <memory>
 #include <vector>
+#include <string>
 
 namespace Gui {
 
@@ -25,10 +26,11 @@ enum _Commands : uint32_t {
 	cmd_restoreWindowBit  = 1 << 3,
 	cmd_closeWindowBit    = 1 << 4,
 	cmd_openDialogBit     = 1 << 5,
+	cmd_runBenchmarksBit  = 1 << 6, // DEVINFO only
 	// When adding new commands, make sure you adjust the c_cmdCount below. 
 
 };
-constexpr size_t c_cmdCount = 5; 
+constexpr size_t c_cmdCount = 6; 
 static_assert(c_cmdCount <= sizeof(Commands) * 8);
 
 struct InitInfo {
@@ -40,10 +42,12 @@ struct InitInfo {
 	uint32_t         graphicsQueueIndex;
 	VkQueue          graphicsQueue; 
 	VkDescriptorPool descriptorPool;
+	VkPipelineCache  pipelineCache;
 	VkRenderPass     renderPass; 
 	uint32_t         subpass;
 	uint32_t         imageCount;
 	const char*      iniPath;
+	float*           pipelineTimer; // gets the time ImGui's Vulkan backend takes to create its pipeline through pipelineCache
 
 };
 
@@ -100,6 +104,50 @@ struct AppStats {
 
 	uint32_t         resizeCount;
 	PerformanceTimes perfTimes; 
+	uint32_t         lastLoadFileCount;  // files in the last finished batch of loads
+	float            lastLoadFilesPerSec;
+	float            lastLoadMBPerSec;
+	uint64_t         deviceMemoryBudget; // bytes
+	uint64_t         geometryBytes;
+	uint64_t         renderTargetBytes;
+	uint32_t         geometryEvictions;
+	uint32_t         renderTargetReleases;
+	uint64_t         hostLoadBudget;     // bytes
+	uint64_t         hostLoadBytes;
+	uint32_t         memoryBlocks;       // see Core::DeviceAllocator
+	uint64_t         memoryBlockBytes;
+	uint32_t         subAllocations;
+	uint64_t         subAllocatedBytes;  // rounded up to the buddy ranges
+	uint64_t         requestedBytes;     // what the sub-allocations asked for
+	uint64_t         largestFreeRange;   // bytes, of all blocks
+	uint32_t         dedicatedAllocations;
+	uint64_t         dedicatedBytes;
+	std::string      benchmarkReport;
+	float            lastPipelineSeconds;         // wall time of the last pipelined load
+	float            lastPipelineStageSeconds[4]; // busy time of its read, parse, dedup and finish stages
+	uint32_t         partDraws;   // draw calls for parts in the last frame
+	uint32_t         partsCulled; // parts outside the frustum in the last frame
+	uint32_t         viewportRenders;        // visible viewports drawn in the last frame
+	uint32_t         viewportRendersSkipped; // visible viewports that kept their last image
+	float            inputLatencyMedian;     // seconds, see Core::FramePacer::latency
+	float            inputLatencyP99;
+	bool             latencyToPresent;       // to GPU completion without VK_KHR_present_wait
+	float            pacingMargin;           // seconds
+	uint32_t         missedDeadlines;
+	bool             gpuTimestamps;          // false if the graphics queue has no timestamps
+	float            gpuMainPassMs;          // of the last finished frame
+	float            gpuMainPassAvgMs;       // rolling average, see c_vlkn::gpuTimeSmoothing
+	float            gpuViewportPassesMs;    // all viewport passes of the last finished frame
+	float            gpuViewportPassesAvgMs;
+
+};
+
+/// A part of the file listed in the File Info panel of its viewport. 
+struct PartGuiData {
+
+	std::string name;
+	uint32_t    triangleCount;
+	bool        visible;
 
 };
 
@@ -122,11 +170,35 @@ struct ViewportGuiData {
 	uint32_t                indexCount;
 	uint32_t                uniqueVertexCount;
 	bool                    isTextFormat; 
+	int                     normalMode;      // mload::NormalMode the file was opened with
+	uint32_t                fileVertexCount; // unique vertex count before normal generation
+	bool                    hasVertexColors; // drawn with the colors of the file instead of the default gray
+	std::vector<PartGuiData> parts;          // one per Core::ViewportInstance::meshParts entry
+	uint32_t                partsVersion;    // incremented when parts are shown or hidden
+	float                   gpuPassAvgMs;    // DEVINFO, rolling average of the GPU time of its render pass
+	float                   gpuEdgesAvgMs;   // DEVINFO, part of gpuPassAvgMs spent drawing the edges
 
 	glm::vec2& panPos() { return *(glm::vec2*)&model[3]; }
 
 };
 
+/// A file that is being parsed in the background. 
+struct LoadGuiData {
+
+	const char* fileTitle;
+	float       progress; // 0 to 1
+	bool        started;  // false while the load waits for the memory budget
+
+};
+
+/// A file that couldn't be opened, or reloaded after its geometry was evicted. 
+struct LoadErrorGuiData {
+
+	std::string fileTitle;
+	const char* reason;
+
+};
+
 struct DrawData {
 
 	GuiStyleEx       styleEx;
@@ -137,10 +209,17 @@ struct DrawData {
 	ImVec2           mouseControlsSize; 
 	ViewportGuiData* lastFocusedVp;
 	float            sensitivity; 
+	int              normalMode;  // mload::NormalMode used for newly opened files
+	float            creaseAngle; // degrees
 #ifdef DEVINFO
 	AppStats stats{};
 #endif
 	std::vector<ViewportGuiData> vpDatas;
+	std::vector<LoadGuiData>     loads;
+	uint32_t                     loadsFinished;   // files of the current batch that are already open
+	float                        loadFilesPerSec; // throughput of the current batch
+	float                        loadMBPerSec;
+	std::vector<LoadErrorGuiData> loadErrors;    // shown until dismissed
 
 };
 
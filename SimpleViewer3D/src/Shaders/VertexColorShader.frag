@@ -0,0 +1,21 @@
+#version 450
+
+//ins
+layout(location = 0) in vec3 fragPos;
+layout(location = 1) in vec3 fragNormal;
+layout(location = 2) in vec4 fragCol;
+
+// outs
+layout(location = 0) out vec4 fragColor;
+
+
+// constants
+const float c_amb     = 0.25;
+const float c_diff    = 0.6;
+
+void main() {
+
+	float diff = c_diff * max(dot(fragNormal, vec3(0.0, 0.0, 1.0)), 0.0);
+	fragColor = vec4((c_amb + diff) * fragCol.rgb, fragCol.a); 
+
+}
\ No newline at end of file
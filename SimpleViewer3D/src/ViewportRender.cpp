@@ -0,0 +1,373 @@
+#include "ViewportRender.hpp"
+
+#include "FileArrays/shader_vert_spv.h"
+#include "FileArrays/shader_frag_spv.h"
+#include "FileArrays/MeshOutlineShader_vert_spv.h"
+#include "FileArrays/MeshOutlineShader_frag_spv.h"
+#include "FileArrays/VertexColorShader_vert_spv.h"
+#include "FileArrays/VertexColorShader_frag_spv.h"
+
+#include <ModelLoader.hpp>
+
+#include <glm/gtc/matrix_transform.hpp>
+
+#include <cstddef>
+
+VkResult Core::createViewportPipelines(VkDevice device, VkPipelineCache pipelineCache, VkFormat colorFormat, VkFormat depthFormat, VkSampleCountFlagBits sampleCount, VkImageLayout outputLayout, ViewportPipelines* pipelines) {
+
+    // A resolve attachment has to have a multisampled source
+    const bool resolve = sampleCount != VK_SAMPLE_COUNT_1_BIT;
+
+    // Render Pass Creation
+    {
+
+        VkAttachmentDescription colorAttachment{};
+        colorAttachment.flags          = 0;
+        colorAttachment.format         = colorFormat;
+        colorAttachment.samples        = sampleCount;
+        colorAttachment.loadOp         = VK_ATTACHMENT_LOAD_OP_CLEAR;
+        colorAttachment.storeOp        = VK_ATTACHMENT_STORE_OP_STORE;
+        colorAttachment.stencilLoadOp  = VK_ATTACHMENT_LOAD_OP_DONT_CARE;
+        colorAttachment.stencilStoreOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
+        colorAttachment.initialLayout  = VK_IMAGE_LAYOUT_UNDEFINED;
+        colorAttachment.finalLayout    = resolve ? VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL : outputLayout;
+
+        VkAttachmentReference colorAttachmentRef{};
+        colorAttachmentRef.attachment = 0;
+        colorAttachmentRef.layout     = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL;
+
+        VkAttachmentDescription depthAttachment{};
+        depthAttachment.format         = depthFormat; 
+        depthAttachment.samples        = sampleCount;
+        depthAttachment.loadOp         = VK_ATTACHMENT_LOAD_OP_CLEAR;
+        depthAttachment.storeOp        = VK_ATTACHMENT_STORE_OP_DONT_CARE;
+        depthAttachment.stencilLoadOp  = VK_ATTACHMENT_LOAD_OP_DONT_CARE;
+        depthAttachment.stencilStoreOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
+        depthAttachment.initialLayout  = VK_IMAGE_LAYOUT_UNDEFINED;
+        depthAttachment.finalLayout    = VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL; 
+
+        VkAttachmentReference depthAttachmentRef{};
+        depthAttachmentRef.attachment = 1;
+        depthAttachmentRef.layout     = VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL;
+
+        VkAttachmentDescription colorAttachmentResolve{}; 
+        colorAttachmentResolve.format         = colorFormat;
+        colorAttachmentResolve.samples        = VK_SAMPLE_COUNT_1_BIT; 
+        colorAttachmentResolve.loadOp         = VK_ATTACHMENT_LOAD_OP_DONT_CARE;
+        colorAttachmentResolve.storeOp        = VK_ATTACHMENT_STORE_OP_STORE;
+        colorAttachmentResolve.stencilLoadOp  = VK_ATTACHMENT_LOAD_OP_DONT_CARE; 
+        colorAttachmentResolve.stencilStoreOp = VK_ATTACHMENT_STORE_OP_DONT_CARE; 
+        colorAttachmentResolve.initialLayout  = VK_IMAGE_LAYOUT_UNDEFINED;
+        colorAttachmentResolve.finalLayout    = outputLayout; 
+
+        VkAttachmentReference colorAttachmentResolveRef{}; 
+        colorAttachmentResolveRef.attachment = 2; 
+        colorAttachmentResolveRef.layout = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL; 
+
+        VkSubpassDescription subpass{};
+        subpass.pipelineBindPoint = VK_PIPELINE_BIND_POINT_GRAPHICS;
+        subpass.colorAttachmentCount     = 1;
+        subpass.pColorAttachments        = &colorAttachmentRef;
+        subpass.pDepthStencilAttachment  = &depthAttachmentRef;
+        subpass.pResolveAttachments      = resolve ? &colorAttachmentResolveRef : nullptr;
+
+        VkSubpassDependency dependencies[2]{};
+        dependencies[0].srcSubpass    = VK_SUBPASS_EXTERNAL;
+        dependencies[0].dstSubpass    = 0;
+        // The previous frame in flight may still sample or write the same images, 
+        // its color and depth writes have to be done before this pass clears and writes them again
+        dependencies[0].srcStageMask  = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT | VK_PIPELINE_STAGE_EARLY_FRAGMENT_TESTS_BIT | VK_PIPELINE_STAGE_LATE_FRAGMENT_TESTS_BIT | VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT;
+        dependencies[0].srcAccessMask = VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT          | VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT;
+        dependencies[0].dstStageMask  = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT | VK_PIPELINE_STAGE_EARLY_FRAGMENT_TESTS_BIT;
+        dependencies[0].dstAccessMask = VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT          | VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT;
+        // The composite samples the image in this frame, and in later frames while the viewport is unchanged
+        dependencies[1].srcSubpass    = 0;
+        dependencies[1].dstSubpass    = VK_SUBPASS_EXTERNAL;
+        dependencies[1].srcStageMask  = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT;
+        dependencies[1].srcAccessMask = VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT;
+        dependencies[1].dstStageMask  = VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT;
+        dependencies[1].dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
+
+        VkAttachmentDescription attachments[] = { colorAttachment, depthAttachment, colorAttachmentResolve, };
+        VkRenderPassCreateInfo renderPassInfo{};
+        renderPassInfo.sType = VK_STRUCTURE_TYPE_RENDER_PASS_CREATE_INFO;
+        renderPassInfo.flags           = 0;
+        renderPassInfo.attachmentCount = resolve ? 3 : 2;
+        renderPassInfo.pAttachments    = attachments;
+        renderPassInfo.subpassCount    = 1;
+        renderPassInfo.pSubpasses      = &subpass;
+        renderPassInfo.dependencyCount = arraySize(dependencies);
+        renderPassInfo.pDependencies   = dependencies;
+
+        VkResult err = vkCreateRenderPass(device, &renderPassInfo, nullptr, &pipelines->renderPass);
+        if (err != VK_SUCCESS) return err;
+
+    }
+
+    // Graphics Pipeline Creation
+    {
+
+        VkPipelineShaderStageCreateInfo shaderStages[2]{};
+
+        VkShaderModuleCreateInfo vertModuleCreateInfo{};
+        vertModuleCreateInfo.sType = VK_STRUCTURE_TYPE_SHADER_MODULE_CREATE_INFO;
+        vertModuleCreateInfo.codeSize = sizeof(shader_vert_spv);
+        vertModuleCreateInfo.pCode    = (uint32_t*)shader_vert_spv;
+
+        VkShaderModule vertModule;
+        VkResult err = vkCreateShaderModule(device, &vertModuleCreateInfo, nullptr, &vertModule);
+        if (err != VK_SUCCESS) return err;
+
+        shaderStages[0].sType  = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
+        shaderStages[0].flags  = 0;
+        shaderStages[0].stage  = VK_SHADER_STAGE_VERTEX_BIT;
+        shaderStages[0].module = vertModule;
+        shaderStages[0].pName  = "main";
+
+        VkShaderModuleCreateInfo fragModuleCreateInfo{};
+        fragModuleCreateInfo.sType = VK_STRUCTURE_TYPE_SHADER_MODULE_CREATE_INFO;
+        fragModuleCreateInfo.codeSize = sizeof(shader_frag_spv);
+        fragModuleCreateInfo.pCode = (uint32_t*)shader_frag_spv;
+
+        VkShaderModule fragModule;
+        err = vkCreateShaderModule(device, &fragModuleCreateInfo, nullptr, &fragModule);
+        if (err != VK_SUCCESS) return err;
+
+        shaderStages[1].sType  = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
+        shaderStages[1].flags  = 0;
+        shaderStages[1].stage  = VK_SHADER_STAGE_FRAGMENT_BIT;
+        shaderStages[1].module = fragModule;
+        shaderStages[1].pName  = "main";
+
+        VkVertexInputBindingDescription bindingDescription{};
+        bindingDescription.binding   = 0;
+        bindingDescription.stride    = sizeof(mload::Vertex);
+        bindingDescription.inputRate = VK_VERTEX_INPUT_RATE_VERTEX;
+
+        VkVertexInputAttributeDescription attribDescriptions[2]{};
+        attribDescriptions[0].binding  = 0;
+        attribDescriptions[0].location = 0;
+        attribDescriptions[0].format   = VK_FORMAT_R32G32B32_SFLOAT;
+        attribDescriptions[0].offset   = offsetof(mload::Vertex, pos);
+
+        attribDescriptions[1].binding  = 0;
+        attribDescriptions[1].location = 1;
+        attribDescriptions[1].format   = VK_FORMAT_R32G32B32_SFLOAT;
+        attribDescriptions[1].offset   = offsetof(mload::Vertex, normal);
+
+        VkPipelineVertexInputStateCreateInfo vertexInputInfo{};
+        vertexInputInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_VERTEX_INPUT_STATE_CREATE_INFO;
+        vertexInputInfo.vertexBindingDescriptionCount = 1;
+        vertexInputInfo.pVertexBindingDescriptions = &bindingDescription;
+        vertexInputInfo.vertexAttributeDescriptionCount = arraySize(attribDescriptions);
+        vertexInputInfo.pVertexAttributeDescriptions = attribDescriptions;
+
+        VkPipelineInputAssemblyStateCreateInfo inputAssembly{};
+        inputAssembly.sType = VK_STRUCTURE_TYPE_PIPELINE_INPUT_ASSEMBLY_STATE_CREATE_INFO;
+        inputAssembly.topology               = VK_PRIMITIVE_TOPOLOGY_TRIANGLE_LIST;
+        inputAssembly.primitiveRestartEnable = VK_FALSE;
+
+        VkPipelineViewportStateCreateInfo viewportState{};
+        viewportState.sType = VK_STRUCTURE_TYPE_PIPELINE_VIEWPORT_STATE_CREATE_INFO;
+        viewportState.viewportCount = 1;
+        viewportState.scissorCount  = 1;
+
+        VkPipelineRasterizationStateCreateInfo rasterizer{};
+        rasterizer.sType = VK_STRUCTURE_TYPE_PIPELINE_RASTERIZATION_STATE_CREATE_INFO;
+        rasterizer.depthClampEnable        = VK_FALSE;
+        rasterizer.rasterizerDiscardEnable = VK_FALSE;
+        rasterizer.polygonMode             = VK_POLYGON_MODE_FILL;
+        rasterizer.lineWidth               = 1.0f;
+        rasterizer.cullMode                = VK_CULL_MODE_FRONT_BIT;
+        rasterizer.frontFace               = VK_FRONT_FACE_COUNTER_CLOCKWISE;
+        rasterizer.depthBiasEnable         = VK_FALSE;
+
+        VkPipelineMultisampleStateCreateInfo multisampling{};
+        multisampling.sType = VK_STRUCTURE_TYPE_PIPELINE_MULTISAMPLE_STATE_CREATE_INFO;
+        multisampling.sampleShadingEnable = VK_FALSE;
+        multisampling.rasterizationSamples = sampleCount;
+
+        VkPipelineDepthStencilStateCreateInfo depthStencil{};
+        depthStencil.sType = VK_STRUCTURE_TYPE_PIPELINE_DEPTH_STENCIL_STATE_CREATE_INFO; 
+        depthStencil.depthTestEnable       = VK_TRUE;
+        depthStencil.depthWriteEnable      = VK_TRUE;
+        depthStencil.depthCompareOp        = VK_COMPARE_OP_LESS;
+        depthStencil.depthBoundsTestEnable = VK_FALSE;
+        depthStencil.minDepthBounds        = 0.0f;
+        depthStencil.maxDepthBounds        = 1.0f;
+        depthStencil.stencilTestEnable     = VK_FALSE;
+
+        VkPipelineColorBlendAttachmentState colorBlendAttachment{};
+        colorBlendAttachment.colorWriteMask = VK_COLOR_COMPONENT_R_BIT | VK_COLOR_COMPONENT_G_BIT | VK_COLOR_COMPONENT_B_BIT | VK_COLOR_COMPONENT_A_BIT;
+        colorBlendAttachment.blendEnable    = VK_FALSE;
+
+        VkPipelineColorBlendStateCreateInfo colorBlending{};
+        colorBlending.sType = VK_STRUCTURE_TYPE_PIPELINE_COLOR_BLEND_STATE_CREATE_INFO;
+        colorBlending.logicOpEnable   = VK_FALSE;
+        colorBlending.logicOp         = VK_LOGIC_OP_COPY;
+        colorBlending.attachmentCount = 1;
+        colorBlending.pAttachments    = &colorBlendAttachment;
+
+        VkDynamicState dynamicStates[] = { VK_DYNAMIC_STATE_VIEWPORT, VK_DYNAMIC_STATE_SCISSOR }; 
+
+        VkPipelineDynamicStateCreateInfo dynamicState{};
+        dynamicState.sType = VK_STRUCTURE_TYPE_PIPELINE_DYNAMIC_STATE_CREATE_INFO;
+        dynamicState.dynamicStateCount = arraySize(dynamicStates);
+        dynamicState.pDynamicStates    = dynamicStates;
+
+        VkPushConstantRange pcRange{};
+        pcRange.stageFlags = VK_SHADER_STAGE_VERTEX_BIT;
+        pcRange.offset     = 0;
+        pcRange.size       = sizeof(PushConstants); 
+
+        VkPipelineLayoutCreateInfo pipelineLayoutInfo{};
+        pipelineLayoutInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
+        pipelineLayoutInfo.flags                  = 0; 
+        pipelineLayoutInfo.setLayoutCount         = 0;
+        pipelineLayoutInfo.pushConstantRangeCount = 1;
+        pipelineLayoutInfo.pPushConstantRanges    = &pcRange;
+
+        err = vkCreatePipelineLayout(device, &pipelineLayoutInfo, nullptr, &pipelines->pipelineLayout);
+        if (err != VK_SUCCESS) return err;
+
+        VkGraphicsPipelineCreateInfo pipelineInfo{};
+        pipelineInfo.sType = VK_STRUCTURE_TYPE_GRAPHICS_PIPELINE_CREATE_INFO;
+        pipelineInfo.flags               = 0;
+        pipelineInfo.stageCount          = arraySize(shaderStages);
+        pipelineInfo.pStages             = shaderStages;
+        pipelineInfo.pVertexInputState   = &vertexInputInfo;
+        pipelineInfo.pInputAssemblyState = &inputAssembly;
+        pipelineInfo.pTessellationState  = nullptr;
+        pipelineInfo.pViewportState      = &viewportState;
+        pipelineInfo.pRasterizationState = &rasterizer;
+        pipelineInfo.pMultisampleState   = &multisampling;
+        pipelineInfo.pDepthStencilState  = &depthStencil;
+        pipelineInfo.pColorBlendState    = &colorBlending;
+        pipelineInfo.pDynamicState       = &dynamicState;
+        pipelineInfo.layout              = pipelines->pipelineLayout;
+        pipelineInfo.renderPass          = pipelines->renderPass;
+        pipelineInfo.subpass             = 0;
+        pipelineInfo.basePipelineHandle  = VK_NULL_HANDLE;
+
+        err = vkCreateGraphicsPipelines(device, pipelineCache, 1, &pipelineInfo, nullptr, &pipelines->graphicsPipeline);
+        if (err != VK_SUCCESS) return err;
+
+        vkDestroyShaderModule(device, vertModule, nullptr);
+        vkDestroyShaderModule(device, fragModule, nullptr);
+
+        // Vertex color pipeline, the colors come from their own buffer so files without them keep the smaller vertices
+        vertModuleCreateInfo.codeSize = sizeof(VertexColorShader_vert_spv);
+        vertModuleCreateInfo.pCode    = (uint32_t*)VertexColorShader_vert_spv;
+
+        err = vkCreateShaderModule(device, &vertModuleCreateInfo, nullptr, &vertModule);
+        if (err != VK_SUCCESS) return err;
+
+        shaderStages[0].module = vertModule;
+
+        fragModuleCreateInfo.codeSize = sizeof(VertexColorShader_frag_spv);
+        fragModuleCreateInfo.pCode    = (uint32_t*)VertexColorShader_frag_spv;
+
+        err = vkCreateShaderModule(device, &fragModuleCreateInfo, nullptr, &fragModule);
+        if (err != VK_SUCCESS) return err;
+
+        shaderStages[1].module = fragModule;
+
+        VkVertexInputBindingDescription colorBindingDescriptions[2]{};
+        colorBindingDescriptions[0] = bindingDescription;
+        colorBindingDescriptions[1].binding   = 1;
+        colorBindingDescriptions[1].stride    = sizeof(uint32_t);
+        colorBindingDescriptions[1].inputRate = VK_VERTEX_INPUT_RATE_VERTEX;
+
+        VkVertexInputAttributeDescription colorAttribDescriptions[3]{};
+        colorAttribDescriptions[0] = attribDescriptions[0];
+        colorAttribDescriptions[1] = attribDescriptions[1];
+        colorAttribDescriptions[2].binding  = 1;
+        colorAttribDescriptions[2].location = 2;
+        colorAttribDescriptions[2].format   = VK_FORMAT_R8G8B8A8_UNORM;
+        colorAttribDescriptions[2].offset   = 0;
+
+        vertexInputInfo.vertexBindingDescriptionCount   = arraySize(colorBindingDescriptions);
+        vertexInputInfo.pVertexBindingDescriptions      = colorBindingDescriptions;
+        vertexInputInfo.vertexAttributeDescriptionCount = arraySize(colorAttribDescriptions);
+        vertexInputInfo.pVertexAttributeDescriptions    = colorAttribDescriptions;
+
+        err = vkCreateGraphicsPipelines(device, pipelineCache, 1, &pipelineInfo, nullptr, &pipelines->vertexColorPipeline);
+        if (err != VK_SUCCESS) return err;
+
+        vkDestroyShaderModule(device, vertModule, nullptr);
+        vkDestroyShaderModule(device, fragModule, nullptr);
+
+        vertexInputInfo.vertexBindingDescriptionCount = 1;
+        vertexInputInfo.pVertexBindingDescriptions    = &bindingDescription;
+
+        // Mesh outline pipeline
+        vertModuleCreateInfo.codeSize = sizeof(MeshOutlineShader_vert_spv);
+        vertModuleCreateInfo.pCode    = (uint32_t*)MeshOutlineShader_vert_spv;
+
+        err = vkCreateShaderModule(device, &vertModuleCreateInfo, nullptr, &vertModule);
+        if (err != VK_SUCCESS) return err;
+
+        shaderStages[0].module = vertModule;
+
+        fragModuleCreateInfo.codeSize = sizeof(MeshOutlineShader_frag_spv);
+        fragModuleCreateInfo.pCode    = (uint32_t*)MeshOutlineShader_frag_spv;
+
+        err = vkCreateShaderModule(device, &fragModuleCreateInfo, nullptr, &fragModule);
+        if (err != VK_SUCCESS) return err;
+
+        shaderStages[1].module = fragModule;
+        
+        vertexInputInfo.vertexAttributeDescriptionCount = 1;
+        vertexInputInfo.pVertexAttributeDescriptions    = attribDescriptions;
+
+        rasterizer.polygonMode = VK_POLYGON_MODE_LINE;   
+
+        err = vkCreateGraphicsPipelines(device, pipelineCache, 1, &pipelineInfo, nullptr, &pipelines->meshOutlinePipeline); 
+        if (err != VK_SUCCESS) return err;
+
+        vkDestroyShaderModule(device, vertModule, nullptr);
+        vkDestroyShaderModule(device, fragModule, nullptr);
+
+    }
+
+    return VK_SUCCESS;
+
+}
+void Core::destroyViewportPipelines(VkDevice device, ViewportPipelines* pipelines) {
+
+    vkDestroyPipeline       (device, pipelines->graphicsPipeline,    nullptr);
+    vkDestroyPipeline       (device, pipelines->meshOutlinePipeline, nullptr);
+    vkDestroyPipeline       (device, pipelines->vertexColorPipeline, nullptr);
+    vkDestroyPipelineLayout (device, pipelines->pipelineLayout,      nullptr);
+    vkDestroyRenderPass     (device, pipelines->renderPass,          nullptr);
+
+}
+
+Core::PushConstants Core::viewportPushConstants(const glm::mat4& model, const glm::vec3& modelCenter, float zoomDistance, float aspectRatio, float farPlaneClip) {
+
+    PushConstants pushConstants; 
+    pushConstants.view = model * glm::translate(glm::mat4(1.0f), -modelCenter);
+    pushConstants.view = glm::translate(glm::mat4(1.0f), glm::vec3(0.0f, 0.0f, zoomDistance))  * pushConstants.view;
+    pushConstants.proj = glm::perspective(glm::radians(45.0f), aspectRatio, 0.01f, farPlaneClip);
+    return pushConstants;
+
+}
+bool Core::boxOutsideFrustum(const glm::mat4& clip, const glm::vec3& boundsMin, const glm::vec3& boundsMax) {
+
+    int outside[6]{};
+    for (int corner = 0; corner < 8; corner++) {
+        glm::vec3 p(corner & 1 ? boundsMax.x : boundsMin.x, corner & 2 ? boundsMax.y : boundsMin.y, corner & 4 ? boundsMax.z : boundsMin.z);
+        glm::vec4 c = clip * glm::vec4(p, 1.0f);
+        outside[0] += c.x < -c.w;
+        outside[1] += c.x >  c.w;
+        outside[2] += c.y < -c.w;
+        outside[3] += c.y >  c.w;
+        outside[4] += c.z < -c.w;
+        outside[5] += c.z >  c.w;
+    }
+    for (int plane = 0; plane < 6; plane++) {
+        if (outside[plane] == 8) return true;
+    }
+    return false;
+
+}
@@ -0,0 +1,64 @@
+#pragma once
+
+// Viewport drawing that doesn't depend on a window or a swapchain. Used by the app and by the headless renderer, 
+// so both draw the same images.
+
+#include <vulkan/vulkan.h>
+
+#include <glm/glm.hpp>
+
+// macros
+#define arraySize(array) (sizeof(array) / sizeof(array[0]))
+
+namespace Core {
+
+/// Background of the viewports. 
+constexpr VkClearColorValue c_ViewportClearColor = { { 18 / 255.0f, 18 / 255.0f, 18 / 255.0f, 1.0f } };
+
+struct PushConstants {
+    glm::mat4 view, proj; 
+};
+
+/// A range of the index buffer from one part of the file, e.g. an .obj group. 
+struct MeshPart {
+
+    uint32_t  firstIndex;
+    uint32_t  indexCount;
+    glm::vec3 boundsMin; // in part space, for frustum culling
+    glm::vec3 boundsMax;
+
+};
+
+/// A part drawn with a transform, e.g. one 3MF build item. 
+struct MeshInstance {
+
+    uint32_t  part; // index into ViewportInstance::meshParts
+    glm::mat4 transform;
+
+};
+
+struct ViewportPipelines {
+
+    VkRenderPass          renderPass;
+    VkPipelineLayout      pipelineLayout;
+    VkPipeline            graphicsPipeline;
+    VkPipeline            meshOutlinePipeline; 
+    VkPipeline            vertexColorPipeline;  // graphicsPipeline with a second vertex buffer of colors
+
+};
+
+/// Creates the viewport render pass and the pipelines that draw into it. 
+/// Attachments of the framebuffers: the color image, the depth image and, if sampleCount isn't VK_SAMPLE_COUNT_1_BIT, the single sample image it is resolved into. 
+/// @param outputLayout  layout of the single sample image when the render pass ends
+/// @param pipelineCache may be VK_NULL_HANDLE
+VkResult createViewportPipelines  (VkDevice device, VkPipelineCache pipelineCache, VkFormat colorFormat, VkFormat depthFormat, VkSampleCountFlagBits sampleCount, VkImageLayout outputLayout, ViewportPipelines* pipelines);
+void     destroyViewportPipelines (VkDevice device, ViewportPipelines* pipelines);
+
+/// View and projection of the orbit camera. 
+/// @param model        rotation and pan of the viewport
+/// @param zoomDistance negative, the camera is this far along -z from the model center
+PushConstants viewportPushConstants(const glm::mat4& model, const glm::vec3& modelCenter, float zoomDistance, float aspectRatio, float farPlaneClip);
+/// True if all corners of the box are outside the same plane of the frustum of clip. 
+bool          boxOutsideFrustum    (const glm::mat4& clip, const glm::vec3& boundsMin, const glm::vec3& boundsMax);
+
+}
@@ -1,4 +1,39 @@
 #include "App.hpp"
+#include "FrameLoop.hpp"
+
+struct Win32LoopPlatform : Core::LoopPlatform {
+
+	Core::Instance* inst;
+	HANDLE          waitTimer; // high resolution, the refresh interval is shorter than the default timer resolution
+
+	double now() override { return Core::secondsNow(); }
+	bool dispatchEvents(uint32_t* eventCount) override {
+		MSG msg;
+		while (PeekMessage(&msg, NULL, 0, 0, PM_REMOVE)) {
+			if (msg.message == WM_QUIT) return false;
+			TranslateMessage(&msg);
+			DispatchMessageW(&msg);
+			++*eventCount;
+		}
+		return true;
+	}
+	void waitForEvents(double timeout) override {
+		if (timeout < 0.0) {
+			MsgWaitForMultipleObjectsEx(0, NULL, INFINITE, QS_ALLINPUT, MWMO_INPUTAVAILABLE);
+		}
+		else if (waitTimer != NULL) {
+			LARGE_INTEGER dueTime;
+			dueTime.QuadPart = -(LONGLONG)(timeout * 1e7); // relative, in 100ns units
+			SetWaitableTimer(waitTimer, &dueTime, 0, NULL, NULL, FALSE);
+			MsgWaitForMultipleObjectsEx(1, &waitTimer, INFINITE, QS_ALLINPUT, MWMO_INPUTAVAILABLE);
+		}
+		else {
+			MsgWaitForMultipleObjectsEx(0, NULL, (DWORD)(timeout * 1000.0), QS_ALLINPUT, MWMO_INPUTAVAILABLE);
+		}
+	}
+	bool runCycle() override { return App::runCycle(inst); }
+
+};
 
 int WINAPI WinMain(HINSTANCE hInstance, HINSTANCE hPrevInstance, LPSTR pCmdLine, int nCmdShow) {
 
@@ -7,15 +42,15 @@ int WINAPI WinMain(HINSTANCE hInstance, HINSTANCE hPrevInstance, LPSTR pCmdLine,
 
 	App::init(&mainInstance, initInfo);
 
-	MSG msg = {};
-	while (GetMessage(&msg, NULL, 0, 0)) {
-		TranslateMessage(&msg);
-		DispatchMessageW(&msg);
+	Win32LoopPlatform platform;
+	platform.inst      = &mainInstance;
+	platform.waitTimer = CreateWaitableTimerExW(NULL, NULL, CREATE_WAITABLE_TIMER_HIGH_RESOLUTION, TIMER_ALL_ACCESS);
 
-		App::runCycle(&mainInstance);
-	}
+	Core::runFrameLoop(&platform, &mainInstance.pacer);
+
+	if (platform.waitTimer != NULL) CloseHandle(platform.waitTimer);
 
 	App::close(&mainInstance);
 
 	return 0;
-}
\ No newline at end of file
+}
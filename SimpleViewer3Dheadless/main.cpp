@@ -0,0 +1,654 @@
+// Renders a model into offscreen images with the viewport render pass and pipelines of the app. No window, surface or swapchain
+// is created, so it runs on build machines with a software Vulkan driver (lavapipe) as well as on GPUs.
+// Reports the frame times and can write the last frame as a PNG for image regression tests.
+
+#include <ViewportRender.hpp>
+
+#include <ModelLoader.hpp>
+
+#include <glm/glm.hpp>
+
+#include <vector>
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+
+// Implemented by the miniz copy that Dependencies/zip/zip.c compiles. miniz.h carries its implementation, so only zip.c may include it, 
+// and the zip library's own header doesn't export the PNG writer. 
+extern "C" void* tdefl_write_image_to_png_file_in_memory_ex(const void* pImage, int w, int h, int num_chans, size_t* pLen_out, unsigned int level, int flip);
+
+constexpr VkFormat c_ColorFormat = VK_FORMAT_R8G8B8A8_UNORM;
+constexpr VkFormat c_DepthFormat = VK_FORMAT_D32_SFLOAT;
+
+struct Options {
+
+    const char*           modelPath    = nullptr;
+    uint32_t              width        = 1280;
+    uint32_t              height       = 720;
+    VkSampleCountFlagBits sampleCount  = VK_SAMPLE_COUNT_8_BIT; // the app's c_vlkn::sampleCount
+    uint32_t              frameCount   = 100;
+    uint32_t              warmupFrames = 5;
+    bool                  showEdges    = false;
+    const char*           pngPath      = nullptr;
+
+};
+
+struct Buffer {
+
+    VkBuffer       buff = VK_NULL_HANDLE;
+    VkDeviceMemory mem  = VK_NULL_HANDLE;
+
+};
+
+struct Image {
+
+    VkImage        image = VK_NULL_HANDLE;
+    VkDeviceMemory mem   = VK_NULL_HANDLE;
+    VkImageView    view  = VK_NULL_HANDLE;
+
+};
+
+struct HeadlessRenderer {
+
+    VkInstance       instance       = VK_NULL_HANDLE;
+    VkPhysicalDevice physicalDevice = VK_NULL_HANDLE;
+    VkDevice         device         = VK_NULL_HANDLE;
+    uint32_t         queueIndex     = 0;
+    VkQueue          queue          = VK_NULL_HANDLE;
+    VkCommandPool    commandPool    = VK_NULL_HANDLE;
+    VkCommandBuffer  commandBuff    = VK_NULL_HANDLE;
+    VkFence          fence          = VK_NULL_HANDLE;
+
+    // Created by renderModel
+    Core::ViewportPipelines pipelines{};
+    Image            output, colorImage, depthImage;
+    VkFramebuffer    framebuffer    = VK_NULL_HANDLE;
+    Buffer           vertBuff, indexBuff, colorBuff;
+    Buffer           readback;
+
+};
+
+static void printUsage() {
+
+    printf(
+        "usage: SimpleViewer3Dheadless <model> [options]\n"
+        "  --size WxH     viewport size in pixels (default 1280x720)\n"
+        "  --msaa N       samples per pixel, 1, 2, 4 or 8 (default 8), lowered to what the device supports\n"
+        "  --frames N     timed frames (default 100)\n"
+        "  --warmup N     untimed frames before them (default 5)\n"
+        "  --edges        draw the mesh outline like the Show Edges option\n"
+        "  --png FILE     write the last frame to FILE\n"
+    );
+
+}
+static bool parseOptions(int argc, char** argv, Options* options) {
+
+    for (int i = 1; i < argc; i++) {
+        const char* arg = argv[i];
+        bool hasValue = i + 1 < argc;
+        if (strcmp(arg, "--size") == 0 && hasValue) {
+            if (sscanf(argv[++i], "%ux%u", &options->width, &options->height) != 2 || options->width == 0 || options->height == 0) return false;
+        }
+        else if (strcmp(arg, "--msaa") == 0 && hasValue) {
+            int samples = atoi(argv[++i]);
+            if (samples != 1 && samples != 2 && samples != 4 && samples != 8) return false;
+            options->sampleCount = (VkSampleCountFlagBits)samples;
+        }
+        else if (strcmp(arg, "--frames") == 0 && hasValue) {
+            options->frameCount = (uint32_t)atoi(argv[++i]);
+            if (options->frameCount == 0) return false;
+        }
+        else if (strcmp(arg, "--warmup") == 0 && hasValue) options->warmupFrames = (uint32_t)atoi(argv[++i]);
+        else if (strcmp(arg, "--edges") == 0)              options->showEdges    = true;
+        else if (strcmp(arg, "--png") == 0 && hasValue)    options->pngPath      = argv[++i];
+        else if (arg[0] != '-' && options->modelPath == nullptr) options->modelPath = arg;
+        else return false;
+    }
+    return options->modelPath != nullptr;
+
+}
+
+static int fail(const char* msg, VkResult err = VK_SUCCESS) {
+
+    if (err != VK_SUCCESS) fprintf(stderr, "error: %s (VkResult %d)\n", msg, (int)err);
+    else                   fprintf(stderr, "error: %s\n", msg);
+    return 1;
+
+}
+
+/// @return UINT32_MAX if no memory type of typeBits has all of properties
+static uint32_t findMemoryType(const HeadlessRenderer& rend, uint32_t typeBits, VkMemoryPropertyFlags properties) {
+
+    VkPhysicalDeviceMemoryProperties memProps;
+    vkGetPhysicalDeviceMemoryProperties(rend.physicalDevice, &memProps);
+    for (uint32_t i = 0; i < memProps.memoryTypeCount; i++) {
+        if (typeBits & (1 << i) && (memProps.memoryTypes[i].propertyFlags & properties) == properties) return i;
+    }
+    return UINT32_MAX;
+
+}
+static VkResult createBuffer(const HeadlessRenderer& rend, VkDeviceSize size, VkBufferUsageFlags usage, VkMemoryPropertyFlags properties, Buffer* buffer) {
+
+    VkBufferCreateInfo buffInfo{};
+    buffInfo.sType       = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
+    buffInfo.size        = size;
+    buffInfo.usage       = usage;
+    buffInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+
+    VkResult err = vkCreateBuffer(rend.device, &buffInfo, nullptr, &buffer->buff);
+    if (err != VK_SUCCESS) return err;
+
+    VkMemoryRequirements memRequirements;
+    vkGetBufferMemoryRequirements(rend.device, buffer->buff, &memRequirements);
+
+    VkMemoryAllocateInfo allocInfo{};
+    allocInfo.sType           = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
+    allocInfo.allocationSize  = memRequirements.size;
+    allocInfo.memoryTypeIndex = findMemoryType(rend, memRequirements.memoryTypeBits, properties);
+    if (allocInfo.memoryTypeIndex == UINT32_MAX) return VK_ERROR_OUT_OF_DEVICE_MEMORY;
+
+    err = vkAllocateMemory(rend.device, &allocInfo, nullptr, &buffer->mem);
+    if (err != VK_SUCCESS) return err;
+    return vkBindBufferMemory(rend.device, buffer->buff, buffer->mem, 0);
+
+}
+static void destroyBuffer(const HeadlessRenderer& rend, Buffer* buffer) {
+
+    vkDestroyBuffer(rend.device, buffer->buff, nullptr);
+    vkFreeMemory   (rend.device, buffer->mem,  nullptr);
+    *buffer = {};
+
+}
+static VkResult createImage(const HeadlessRenderer& rend, const Options& options, VkFormat format, VkSampleCountFlagBits samples, VkImageUsageFlags usage, VkImageAspectFlags aspect, Image* image) {
+
+    VkImageCreateInfo imageInfo{};
+    imageInfo.sType         = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO;
+    imageInfo.imageType     = VK_IMAGE_TYPE_2D;
+    imageInfo.format        = format;
+    imageInfo.extent        = { options.width, options.height, 1 };
+    imageInfo.mipLevels     = 1;
+    imageInfo.arrayLayers   = 1;
+    imageInfo.samples       = samples;
+    imageInfo.tiling        = VK_IMAGE_TILING_OPTIMAL;
+    imageInfo.usage         = usage;
+    imageInfo.sharingMode   = VK_SHARING_MODE_EXCLUSIVE;
+    imageInfo.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+
+    VkResult err = vkCreateImage(rend.device, &imageInfo, nullptr, &image->image);
+    if (err != VK_SUCCESS) return err;
+
+    VkMemoryRequirements memRequirements;
+    vkGetImageMemoryRequirements(rend.device, image->image, &memRequirements);
+
+    VkMemoryAllocateInfo allocInfo{};
+    allocInfo.sType           = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
+    allocInfo.allocationSize  = memRequirements.size;
+    allocInfo.memoryTypeIndex = findMemoryType(rend, memRequirements.memoryTypeBits, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+    if (allocInfo.memoryTypeIndex == UINT32_MAX) return VK_ERROR_OUT_OF_DEVICE_MEMORY;
+
+    err = vkAllocateMemory(rend.device, &allocInfo, nullptr, &image->mem);
+    if (err != VK_SUCCESS) return err;
+    err = vkBindImageMemory(rend.device, image->image, image->mem, 0);
+    if (err != VK_SUCCESS) return err;
+
+    VkImageViewCreateInfo viewInfo{};
+    viewInfo.sType    = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO;
+    viewInfo.image    = image->image;
+    viewInfo.viewType = VK_IMAGE_VIEW_TYPE_2D;
+    viewInfo.format   = format;
+    viewInfo.subresourceRange.aspectMask = aspect;
+    viewInfo.subresourceRange.levelCount = 1;
+    viewInfo.subresourceRange.layerCount = 1;
+
+    return vkCreateImageView(rend.device, &viewInfo, nullptr, &image->view);
+
+}
+static void destroyImage(const HeadlessRenderer& rend, Image* image) {
+
+    vkDestroyImageView(rend.device, image->view,  nullptr);
+    vkDestroyImage    (rend.device, image->image, nullptr);
+    vkFreeMemory      (rend.device, image->mem,   nullptr);
+    *image = {};
+
+}
+
+/// Submits the command buffer and waits for it.
+static VkResult submitAndWait(const HeadlessRenderer& rend) {
+
+    VkSubmitInfo submitInfo{};
+    submitInfo.sType              = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+    submitInfo.commandBufferCount = 1;
+    submitInfo.pCommandBuffers    = &rend.commandBuff;
+
+    VkResult err = vkQueueSubmit(rend.queue, 1, &submitInfo, rend.fence);
+    if (err != VK_SUCCESS) return err;
+    err = vkWaitForFences(rend.device, 1, &rend.fence, VK_TRUE, UINT64_MAX);
+    if (err != VK_SUCCESS) return err;
+    return vkResetFences(rend.device, 1, &rend.fence);
+
+}
+/// Creates a device local buffer with data through a temporary host visible one.
+static VkResult uploadBuffer(const HeadlessRenderer& rend, const void* data, VkDeviceSize size, VkBufferUsageFlags usage, Buffer* buffer) {
+
+    // The staging buffer is destroyed on every path, buffer is left to the caller
+    Buffer staging;
+    VkResult err = createBuffer(rend, size, VK_BUFFER_USAGE_TRANSFER_SRC_BIT, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, &staging);
+
+    void* pMapped;
+    if (err == VK_SUCCESS) err = vkMapMemory(rend.device, staging.mem, 0, size, 0, &pMapped);
+    if (err == VK_SUCCESS) {
+        memcpy(pMapped, data, size);
+        vkUnmapMemory(rend.device, staging.mem);
+        err = createBuffer(rend, size, usage | VK_BUFFER_USAGE_TRANSFER_DST_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, buffer);
+    }
+    if (err == VK_SUCCESS) {
+        VkCommandBufferBeginInfo beginInfo{};
+        beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+        beginInfo.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+        vkBeginCommandBuffer(rend.commandBuff, &beginInfo);
+        VkBufferCopy region{ 0, 0, size };
+        vkCmdCopyBuffer(rend.commandBuff, staging.buff, buffer->buff, 1, &region);
+        vkEndCommandBuffer(rend.commandBuff);
+        err = submitAndWait(rend);
+    }
+
+    destroyBuffer(rend, &staging);
+    return err;
+
+}
+
+/// Lowers options->sampleCount to the highest count the device supports, software drivers such as lavapipe stop at 4. 
+static int initRenderer(HeadlessRenderer* rend, Options* options) {
+
+    // Instance creation, no surface extensions
+    {
+
+        VkApplicationInfo appInfo{};
+        appInfo.sType = VK_STRUCTURE_TYPE_APPLICATION_INFO;
+        appInfo.pApplicationName   = "Simple Viewer 3D Headless";
+        appInfo.applicationVersion = VK_MAKE_VERSION(1, 0, 0);
+        appInfo.pEngineName        = "No Engine";
+        appInfo.engineVersion      = VK_MAKE_VERSION(1, 0, 0);
+        appInfo.apiVersion         = VK_API_VERSION_1_0; // nothing past 1.0 is used, so older software drivers work too
+
+        VkInstanceCreateInfo createInfo{};
+        createInfo.sType = VK_STRUCTURE_TYPE_INSTANCE_CREATE_INFO;
+        createInfo.pApplicationInfo = &appInfo;
+
+#ifdef ENABLE_VK_VALIDATION_LAYERS
+        const char* layers[] = { "VK_LAYER_KHRONOS_validation" };
+        createInfo.enabledLayerCount   = arraySize(layers);
+        createInfo.ppEnabledLayerNames = layers;
+#endif
+
+        VkResult err = vkCreateInstance(&createInfo, nullptr, &rend->instance);
+        if (err != VK_SUCCESS) return fail("Vulkan instance creation failed", err);
+
+    }
+
+    // Pick physical device: a discrete GPU if there is one, otherwise the first device that can draw.
+    // A machine without a GPU only lists the software driver.
+    {
+
+        uint32_t deviceCount = 0;
+        vkEnumeratePhysicalDevices(rend->instance, &deviceCount, nullptr);
+        std::vector<VkPhysicalDevice> devices(deviceCount);
+        vkEnumeratePhysicalDevices(rend->instance, &deviceCount, devices.data());
+
+        bool discrete = false;
+        for (VkPhysicalDevice device : devices) {
+
+            VkPhysicalDeviceProperties props;
+            vkGetPhysicalDeviceProperties(device, &props);
+
+            uint32_t queueFamilyCount = 0;
+            vkGetPhysicalDeviceQueueFamilyProperties(device, &queueFamilyCount, nullptr);
+            std::vector<VkQueueFamilyProperties> queueFamilies(queueFamilyCount);
+            vkGetPhysicalDeviceQueueFamilyProperties(device, &queueFamilyCount, queueFamilies.data());
+
+            for (uint32_t i = 0; i < queueFamilyCount; i++) {
+                if ((queueFamilies[i].queueFlags & VK_QUEUE_GRAPHICS_BIT) == 0) continue;
+                if (rend->physicalDevice == VK_NULL_HANDLE || (!discrete && props.deviceType == VK_PHYSICAL_DEVICE_TYPE_DISCRETE_GPU)) {
+                    rend->physicalDevice = device;
+                    rend->queueIndex     = i;
+                    discrete             = props.deviceType == VK_PHYSICAL_DEVICE_TYPE_DISCRETE_GPU;
+                }
+                break;
+            }
+
+        }
+        if (rend->physicalDevice == VK_NULL_HANDLE) return fail("No Vulkan device can draw");
+
+        VkPhysicalDeviceProperties props;
+        vkGetPhysicalDeviceProperties(rend->physicalDevice, &props);
+        printf("Device: %s\n", props.deviceName);
+
+        // Every device supports 1 sample, so this ends
+        VkSampleCountFlags sampleCounts = props.limits.framebufferColorSampleCounts & props.limits.framebufferDepthSampleCounts;
+        VkSampleCountFlagBits requested = options->sampleCount;
+        while ((sampleCounts & options->sampleCount) == 0) options->sampleCount = (VkSampleCountFlagBits)(options->sampleCount >> 1);
+        if (options->sampleCount != requested) printf("%ux MSAA isn't supported, using %ux\n", (uint32_t)requested, (uint32_t)options->sampleCount);
+
+    }
+
+    // Logical device creation
+    {
+
+        float queuePriority = 1.0f;
+        VkDeviceQueueCreateInfo queueInfo{};
+        queueInfo.sType = VK_STRUCTURE_TYPE_DEVICE_QUEUE_CREATE_INFO;
+        queueInfo.queueFamilyIndex = rend->queueIndex;
+        queueInfo.queueCount       = 1;
+        queueInfo.pQueuePriorities = &queuePriority;
+
+        // The outline pipeline draws with VK_POLYGON_MODE_LINE
+        VkPhysicalDeviceFeatures features{};
+        features.fillModeNonSolid = VK_TRUE;
+
+        VkDeviceCreateInfo createInfo{};
+        createInfo.sType = VK_STRUCTURE_TYPE_DEVICE_CREATE_INFO;
+        createInfo.queueCreateInfoCount = 1;
+        createInfo.pQueueCreateInfos    = &queueInfo;
+        createInfo.pEnabledFeatures     = &features;
+
+        VkResult err = vkCreateDevice(rend->physicalDevice, &createInfo, nullptr, &rend->device);
+        if (err != VK_SUCCESS) return fail("Logical device creation failed", err);
+
+        vkGetDeviceQueue(rend->device, rend->queueIndex, 0, &rend->queue);
+
+    }
+
+    // Command pool, command buffer and fence creation
+    {
+
+        VkCommandPoolCreateInfo poolInfo{};
+        poolInfo.sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO;
+        poolInfo.flags            = VK_COMMAND_POOL_CREATE_RESET_COMMAND_BUFFER_BIT;
+        poolInfo.queueFamilyIndex = rend->queueIndex;
+
+        VkResult err = vkCreateCommandPool(rend->device, &poolInfo, nullptr, &rend->commandPool);
+        if (err != VK_SUCCESS) return fail("Command pool creation failed", err);
+
+        VkCommandBufferAllocateInfo allocInfo{};
+        allocInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+        allocInfo.commandPool        = rend->commandPool;
+        allocInfo.level              = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
+        allocInfo.commandBufferCount = 1;
+
+        err = vkAllocateCommandBuffers(rend->device, &allocInfo, &rend->commandBuff);
+        if (err != VK_SUCCESS) return fail("Command buffer allocation failed", err);
+
+        VkFenceCreateInfo fenceInfo{};
+        fenceInfo.sType = VK_STRUCTURE_TYPE_FENCE_CREATE_INFO;
+
+        err = vkCreateFence(rend->device, &fenceInfo, nullptr, &rend->fence);
+        if (err != VK_SUCCESS) return fail("Fence creation failed", err);
+
+    }
+
+    return 0;
+
+}
+
+/// Records one frame the way App::runCycle records a viewport: every part, or every instance of a part, outside the frustum is skipped.
+/// @param readback optional, gets a copy of the output image
+static void recordFrame(const HeadlessRenderer& rend, const Options& options, const Core::ViewportPipelines& pipelines, VkFramebuffer framebuffer, const Image& output,
+                        const Buffer& vertBuff, const Buffer& indexBuff, const Buffer& colorBuff, uint32_t indexCount, const std::vector<Core::MeshPart>& parts,
+                        const std::vector<Core::MeshInstance>& instances, const Core::PushConstants& camera, const Buffer* readback) {
+
+    VkCommandBufferBeginInfo beginInfo{};
+    beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+    vkBeginCommandBuffer(rend.commandBuff, &beginInfo);
+
+    VkClearValue clearValues[2]{};
+    clearValues[0].color        = Core::c_ViewportClearColor;
+    clearValues[1].depthStencil = { 1.0f, 0 };
+
+    VkRenderPassBeginInfo renderPassInfo{};
+    renderPassInfo.sType = VK_STRUCTURE_TYPE_RENDER_PASS_BEGIN_INFO;
+    renderPassInfo.renderPass        = pipelines.renderPass;
+    renderPassInfo.framebuffer       = framebuffer;
+    renderPassInfo.renderArea.extent = { options.width, options.height };
+    renderPassInfo.clearValueCount   = arraySize(clearValues);
+    renderPassInfo.pClearValues      = clearValues;
+    vkCmdBeginRenderPass(rend.commandBuff, &renderPassInfo, VK_SUBPASS_CONTENTS_INLINE);
+
+    const bool vertexColors = colorBuff.buff != VK_NULL_HANDLE;
+    VkPipeline passPipelines[] = { vertexColors ? pipelines.vertexColorPipeline : pipelines.graphicsPipeline, pipelines.meshOutlinePipeline };
+
+    VkViewport viewport{ 0.0f, 0.0f, (float)options.width, (float)options.height, 0.0f, 1.0f };
+    VkRect2D   scissor{ { 0, 0 }, { options.width, options.height } };
+    vkCmdSetViewport(rend.commandBuff, 0, 1, &viewport);
+    vkCmdSetScissor (rend.commandBuff, 0, 1, &scissor);
+
+    VkDeviceSize offsets[] = { 0 };
+    vkCmdBindVertexBuffers(rend.commandBuff, 0, 1, &vertBuff.buff, offsets);
+    if (vertexColors) vkCmdBindVertexBuffers(rend.commandBuff, 1, 1, &colorBuff.buff, offsets);
+    vkCmdBindIndexBuffer(rend.commandBuff, indexBuff.buff, 0, VK_INDEX_TYPE_UINT32);
+
+    const bool instanced = !instances.empty();
+    size_t drawCount = parts.empty() ? 1 : instanced ? instances.size() : parts.size();
+    for (uint32_t pass = 0; pass < (options.showEdges ? 2u : 1u); pass++) {
+        vkCmdBindPipeline(rend.commandBuff, VK_PIPELINE_BIND_POINT_GRAPHICS, passPipelines[pass]);
+        for (size_t draw = 0; draw < drawCount; draw++) {
+            Core::PushConstants pushConstants = camera;
+            uint32_t firstIndex = 0, count = indexCount;
+            if (!parts.empty()) {
+                const Core::MeshPart& part = parts[instanced ? instances[draw].part : draw];
+                if (instanced) pushConstants.view = camera.view * instances[draw].transform;
+                if (Core::boxOutsideFrustum(pushConstants.proj * pushConstants.view, part.boundsMin, part.boundsMax)) continue;
+                firstIndex = part.firstIndex;
+                count      = part.indexCount;
+            }
+            vkCmdPushConstants(rend.commandBuff, pipelines.pipelineLayout, VK_SHADER_STAGE_VERTEX_BIT, 0, sizeof pushConstants, &pushConstants);
+            vkCmdDrawIndexed(rend.commandBuff, count, 1, firstIndex, 0, 0);
+        }
+    }
+
+    vkCmdEndRenderPass(rend.commandBuff);
+
+    // The render pass leaves the output in VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL, the copy still has to wait for its writes
+    if (readback != nullptr) {
+        VkImageMemoryBarrier imageBarrier{};
+        imageBarrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+        imageBarrier.srcAccessMask       = VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT;
+        imageBarrier.dstAccessMask       = VK_ACCESS_TRANSFER_READ_BIT;
+        imageBarrier.oldLayout           = VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL;
+        imageBarrier.newLayout           = VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL;
+        imageBarrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+        imageBarrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+        imageBarrier.image               = output.image;
+        imageBarrier.subresourceRange    = { VK_IMAGE_ASPECT_COLOR_BIT, 0, 1, 0, 1 };
+        vkCmdPipelineBarrier(rend.commandBuff, VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT, 0, 0, nullptr, 0, nullptr, 1, &imageBarrier);
+
+        VkBufferImageCopy region{};
+        region.imageSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+        region.imageSubresource.layerCount = 1;
+        region.imageExtent = { options.width, options.height, 1 };
+        vkCmdCopyImageToBuffer(rend.commandBuff, output.image, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL, readback->buff, 1, &region);
+
+        VkBufferMemoryBarrier barrier{};
+        barrier.sType = VK_STRUCTURE_TYPE_BUFFER_MEMORY_BARRIER;
+        barrier.srcAccessMask       = VK_ACCESS_TRANSFER_WRITE_BIT;
+        barrier.dstAccessMask       = VK_ACCESS_HOST_READ_BIT;
+        barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+        barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+        barrier.buffer              = readback->buff;
+        barrier.size                = VK_WHOLE_SIZE;
+        vkCmdPipelineBarrier(rend.commandBuff, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_HOST_BIT, 0, 0, nullptr, 1, &barrier, 0, nullptr);
+    }
+
+    vkEndCommandBuffer(rend.commandBuff);
+
+}
+
+/// Draws the model into the offscreen images and reports the frame times. Everything it creates is kept in rend for destroyRenderer. 
+/// @return exit code of the process
+static int renderModel(HeadlessRenderer* rend, const Options& options, const std::vector<mload::Vertex>& vertices, const std::vector<uint32_t>& indices, const mload::ModelInfo& modelInfo) {
+
+    VkResult err = Core::createViewportPipelines(rend->device, VK_NULL_HANDLE, c_ColorFormat, c_DepthFormat, options.sampleCount, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL, &rend->pipelines);
+    if (err != VK_SUCCESS) return fail("Viewport pipeline creation failed", err);
+
+    // Render targets, the same attachments Core::createVpImageResources creates
+    const bool resolve = options.sampleCount != VK_SAMPLE_COUNT_1_BIT;
+    {
+
+        err = createImage(*rend, options, c_ColorFormat, VK_SAMPLE_COUNT_1_BIT, VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT | VK_IMAGE_USAGE_TRANSFER_SRC_BIT, VK_IMAGE_ASPECT_COLOR_BIT, &rend->output);
+        if (err != VK_SUCCESS) return fail("Output image creation failed", err);
+        if (resolve) {
+            err = createImage(*rend, options, c_ColorFormat, options.sampleCount, VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT | VK_IMAGE_USAGE_TRANSIENT_ATTACHMENT_BIT, VK_IMAGE_ASPECT_COLOR_BIT, &rend->colorImage);
+            if (err != VK_SUCCESS) return fail("Color image creation failed", err);
+        }
+        err = createImage(*rend, options, c_DepthFormat, options.sampleCount, VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT, VK_IMAGE_ASPECT_DEPTH_BIT, &rend->depthImage);
+        if (err != VK_SUCCESS) return fail("Depth image creation failed", err);
+
+        VkImageView multisampledAttachments[] = { rend->colorImage.view, rend->depthImage.view, rend->output.view };
+        VkImageView singleSampleAttachments[] = { rend->output.view, rend->depthImage.view };
+
+        VkFramebufferCreateInfo framebufferInfo{};
+        framebufferInfo.sType = VK_STRUCTURE_TYPE_FRAMEBUFFER_CREATE_INFO;
+        framebufferInfo.renderPass      = rend->pipelines.renderPass;
+        framebufferInfo.attachmentCount = resolve ? arraySize(multisampledAttachments) : arraySize(singleSampleAttachments);
+        framebufferInfo.pAttachments    = resolve ? multisampledAttachments : singleSampleAttachments;
+        framebufferInfo.width           = options.width;
+        framebufferInfo.height          = options.height;
+        framebufferInfo.layers          = 1;
+
+        err = vkCreateFramebuffer(rend->device, &framebufferInfo, nullptr, &rend->framebuffer);
+        if (err != VK_SUCCESS) return fail("Framebuffer creation failed", err);
+
+    }
+
+    // Geometry, the buffers Core::createGeometryData creates
+    err = uploadBuffer(*rend, vertices.data(), vertices.size() * sizeof(mload::Vertex), VK_BUFFER_USAGE_VERTEX_BUFFER_BIT, &rend->vertBuff);
+    if (err == VK_SUCCESS) err = uploadBuffer(*rend, indices.data(), indices.size() * sizeof(uint32_t), VK_BUFFER_USAGE_INDEX_BUFFER_BIT, &rend->indexBuff);
+    if (err == VK_SUCCESS && !modelInfo.colors.empty()) {
+        err = uploadBuffer(*rend, modelInfo.colors.data(), modelInfo.colors.size() * sizeof(uint32_t), VK_BUFFER_USAGE_VERTEX_BUFFER_BIT, &rend->colorBuff);
+    }
+    if (err != VK_SUCCESS) return fail("Geometry upload failed", err);
+
+    std::vector<Core::MeshPart> parts;
+    for (const mload::ModelPart& part : modelInfo.parts) {
+        parts.push_back({ part.firstIndex, part.indexCount, glm::vec3(part.boundsMin.x, part.boundsMin.y, part.boundsMin.z), glm::vec3(part.boundsMax.x, part.boundsMax.y, part.boundsMax.z) });
+    }
+    std::vector<Core::MeshInstance> instances;
+    for (const mload::ModelInstance& instance : modelInfo.instances) {
+        Core::MeshInstance meshInstance;
+        meshInstance.part = instance.part;
+        memcpy(&meshInstance.transform[0][0], instance.transform, sizeof(instance.transform));
+        instances.push_back(meshInstance);
+    }
+
+    // The camera of a newly opened viewport
+    float zoomDistance = -2.5f * modelInfo.radius;
+    Core::PushConstants camera = Core::viewportPushConstants(glm::mat4(1.0f), glm::vec3(modelInfo.center.x, modelInfo.center.y, modelInfo.center.z),
+                                                             zoomDistance, (float)options.width / options.height, -30.0f * zoomDistance);
+
+    // Timed frames, each one is submitted and waited for on its own so the time covers the whole frame
+    recordFrame(*rend, options, rend->pipelines, rend->framebuffer, rend->output, rend->vertBuff, rend->indexBuff, rend->colorBuff, (uint32_t)indices.size(), parts, instances, camera, nullptr);
+    for (uint32_t frame = 0; frame < options.warmupFrames; frame++) {
+        err = submitAndWait(*rend);
+        if (err != VK_SUCCESS) return fail("Frame submission failed", err);
+    }
+    std::vector<double> frameTimes(options.frameCount);
+    for (double& frameTime : frameTimes) {
+        auto frameStart = std::chrono::steady_clock::now();
+        err = submitAndWait(*rend);
+        if (err != VK_SUCCESS) return fail("Frame submission failed", err);
+        frameTime = 1e3 * std::chrono::duration<double>(std::chrono::steady_clock::now() - frameStart).count();
+    }
+
+    double sum = 0.0;
+    for (double frameTime : frameTimes) sum += frameTime;
+    std::sort(frameTimes.begin(), frameTimes.end());
+    printf("Viewport: %ux%u, %ux MSAA%s\n", options.width, options.height, (uint32_t)options.sampleCount, options.showEdges ? ", edges" : "");
+    printf("Frame time (ms) over %u frames: avg %.3f, min %.3f, median %.3f, p95 %.3f, max %.3f\n", options.frameCount,
+           sum / frameTimes.size(), frameTimes.front(), frameTimes[frameTimes.size() / 2], frameTimes[frameTimes.size() * 95 / 100], frameTimes.back());
+
+    if (options.pngPath == nullptr) return 0;
+
+    // Read back one more frame and write it as a PNG
+    VkDeviceSize imageSize = (VkDeviceSize)4 * options.width * options.height;
+    err = createBuffer(*rend, imageSize, VK_BUFFER_USAGE_TRANSFER_DST_BIT, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, &rend->readback);
+    if (err != VK_SUCCESS) return fail("Readback buffer creation failed", err);
+
+    vkResetCommandBuffer(rend->commandBuff, 0);
+    recordFrame(*rend, options, rend->pipelines, rend->framebuffer, rend->output, rend->vertBuff, rend->indexBuff, rend->colorBuff, (uint32_t)indices.size(), parts, instances, camera, &rend->readback);
+    err = submitAndWait(*rend);
+    if (err != VK_SUCCESS) return fail("Frame submission failed", err);
+
+    void* pPixels;
+    err = vkMapMemory(rend->device, rend->readback.mem, 0, imageSize, 0, &pPixels);
+    if (err != VK_SUCCESS) return fail("Readback buffer mapping failed", err);
+    size_t pngSize = 0;
+    void* png = tdefl_write_image_to_png_file_in_memory_ex(pPixels, (int)options.width, (int)options.height, 4, &pngSize, 6, 0);
+    vkUnmapMemory(rend->device, rend->readback.mem);
+
+    int exitCode = 0;
+    FILE* file = png != nullptr ? fopen(options.pngPath, "wb") : nullptr;
+    if (file != nullptr && fwrite(png, 1, pngSize, file) == pngSize) printf("Wrote %s\n", options.pngPath);
+    else exitCode = fail("Writing the PNG failed");
+    if (file != nullptr) fclose(file);
+    free(png);
+
+    return exitCode;
+
+}
+/// Destroys what initRenderer and renderModel created, also when they stopped part way. 
+static void destroyRenderer(HeadlessRenderer* rend) {
+
+    if (rend->device != VK_NULL_HANDLE) {
+
+        vkDeviceWaitIdle(rend->device);
+        destroyBuffer(*rend, &rend->readback);
+        destroyBuffer(*rend, &rend->colorBuff);
+        destroyBuffer(*rend, &rend->indexBuff);
+        destroyBuffer(*rend, &rend->vertBuff);
+        vkDestroyFramebuffer(rend->device, rend->framebuffer, nullptr);
+        destroyImage(*rend, &rend->depthImage);
+        destroyImage(*rend, &rend->colorImage);
+        destroyImage(*rend, &rend->output);
+        Core::destroyViewportPipelines(rend->device, &rend->pipelines);
+        vkDestroyFence      (rend->device, rend->fence,       nullptr);
+        vkDestroyCommandPool(rend->device, rend->commandPool, nullptr);
+        vkDestroyDevice     (rend->device,                    nullptr);
+
+    }
+    if (rend->instance != VK_NULL_HANDLE) vkDestroyInstance(rend->instance, nullptr);
+    *rend = {};
+
+}
+
+int main(int argc, char** argv) {
+
+    Options options;
+    if (!parseOptions(argc, argv, &options)) {
+        printUsage();
+        return 2;
+    }
+
+    // Load the model with the settings the app opens files with
+    std::vector<mload::Vertex> vertices;
+    std::vector<uint32_t>      indices;
+    mload::ModelInfo           modelInfo;
+    bool isTextFormat;
+    auto loadStart = std::chrono::steady_clock::now();
+    mload::Success loadResult = mload::openModelPipelined(options.modelPath, &vertices, &indices, &isTextFormat, nullptr, &modelInfo);
+    if (loadResult != mload::SUCCESS) {
+        fprintf(stderr, "error: failed to open %s (mload::Success %d)\n", options.modelPath, (int)loadResult);
+        return 1;
+    }
+    double loadSeconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - loadStart).count();
+    printf("Model: %s, %zu triangles, %zu vertices, loaded in %.1f ms\n", options.modelPath, indices.size() / 3, vertices.size(), 1e3 * loadSeconds);
+
+    // Every error path returns here, so the Vulkan objects are destroyed in one place
+    HeadlessRenderer rend;
+    int exitCode = initRenderer(&rend, &options);
+    if (exitCode == 0) exitCode = renderModel(&rend, options, vertices, indices, modelInfo);
+    destroyRenderer(&rend);
+
+    return exitCode;
+
+}
@@ -0,0 +1,83 @@
+project "SimpleViewer3Dheadless"
+    kind       "ConsoleApp"
+    language   "C++"
+    cppdialect "C++17"
+    targetdir  "bin/%{cfg.buildcfg}" 
+    objdir     "bin/obj"
+
+    -- The viewport code and its shaders are shared with the app. The shader arrays are generated in its source tree. 
+    viewerDir = "%{wks.location}/SimpleViewer3D"
+    python    = os.host() == "windows" and "python" or "python3"
+
+    if not os.isdir "../SimpleViewer3D/bin/shaderObjs" then
+        os.mkdir "../SimpleViewer3D/bin/shaderObjs"
+    end
+    os.execute("cd ../SimpleViewer3D && " .. python .. " TouchShaderArrays.py")
+
+    includedirs {
+        "%{os.getenv('VULKAN_SDK')}/include",
+        "%{wks.location}/Dependencies/*",
+        viewerDir .. "/src",
+    }
+
+    libdirs     { "%{os.getenv('VULKAN_SDK')}/lib" }
+
+    files {
+        "*.cpp", 
+        "*.hpp", 
+        viewerDir .. "/src/ViewportRender.cpp",
+        viewerDir .. "/src/ViewportRender.hpp",
+        viewerDir .. "/src/FileArrays/*_spv.cpp",
+        viewerDir .. "/src/Shaders/**.vert", 
+        viewerDir .. "/src/Shaders/**.frag",
+        "%{wks.location}/Dependencies/ModelLoader/*.cpp",
+        "%{wks.location}/Dependencies/ModelLoader/*.hpp",
+        "%{wks.location}/Dependencies/zip/*.c",
+        "%{wks.location}/Dependencies/zip/*.h",
+    }
+
+	flags { "MultiProcessorCompile" }
+
+    defines     { "_CRT_SECURE_NO_WARNINGS" }
+
+    floatingpoint    "Fast"
+    vectorextensions "AVX2"
+
+    filter "files:**.vert or files:**.frag"
+        buildmessage "Compiling shader: %{file.relpath}"
+        buildcommands { 
+            "glslc %{file.abspath} -o %{wks.location}/SimpleViewer3D/bin/shaderObjs/%{file.name}.spv -O", 
+            python .. " %{wks.location}/FileToArray.py %{wks.location}/SimpleViewer3D/bin/shaderObjs/%{file.name}.spv %{wks.location}/SimpleViewer3D/src/FileArrays/" 
+        } 
+        buildoutputs {
+            "%{wks.location}/SimpleViewer3D/bin/shaderObjs/%{file.name}.spv",
+        }
+
+    filter "system:windows"
+        links { "vulkan-1" }
+
+    filter "system:linux"
+        links { "vulkan", "pthread" }
+
+    filter "configurations:Debug"
+        defines { "DEBUG", "ENABLE_VK_VALIDATION_LAYERS" }
+        symbols "On"
+        runtime "Debug"
+
+    filter "configurations:OptDebug"
+        defines  { "DEBUG", "ENABLE_VK_VALIDATION_LAYERS" }
+        symbols "On"
+        optimize "Speed"
+        inlining "Auto"
+        runtime "Release"
+
+    filter "configurations:DevRelease or configurations:Dist"
+        defines  { "NDEBUG" }
+        optimize "Speed"
+        symbols  "Off"
+        inlining "Auto"
+        runtime "Release"
+        linktimeoptimization "On"
+
+    filter "platforms:x64"
+        architecture "x86_64"
@@ -0,0 +1,158 @@
+// Checks Core::BuddyAllocator on a small block, the offsets are plain numbers so no device memory is involved.
+
+#include "Tests.hpp"
+
+#include <BuddyAllocator.hpp>
+
+#include <vector>
+
+constexpr uint64_t c_BlockSize = 1024;
+constexpr uint64_t c_MinSize   = 64;
+constexpr uint32_t c_MinRanges = (uint32_t)(c_BlockSize / c_MinSize);
+
+struct Allocation {
+
+    uint64_t offset;
+    uint32_t order;
+    uint64_t size;
+
+};
+
+static bool allocate(Core::BuddyAllocator* allocator, uint64_t size, uint64_t alignment, Allocation* allocation) {
+
+    allocation->size = size;
+    return allocator->allocate(size, alignment, &allocation->offset, &allocation->order);
+
+}
+
+/// Small ranges split the block in halves, freeing them merges the buddies back into the whole block.
+static void testSplitMerge() {
+
+    Core::BuddyAllocator allocator;
+    allocator.init(c_BlockSize, c_MinSize);
+    TEST_CHECK(allocator.orderCount == 5);
+    TEST_CHECK(allocator.largestFree() == c_BlockSize);
+
+    Allocation a, b;
+    TEST_CHECK(allocate(&allocator, 40, 1, &a));
+    TEST_CHECK(allocate(&allocator, 64, 1, &b));
+    TEST_CHECK(a.order == 0 && b.order == 0);
+    TEST_CHECK(a.offset != b.offset);
+    TEST_CHECK((a.offset ^ b.offset) == c_MinSize); // buddies of the same split
+    TEST_CHECK(allocator.largestFree() == c_BlockSize / 2);
+    TEST_CHECK(allocator.allocationCount == 2);
+    TEST_CHECK(allocator.allocatedBytes == 2 * c_MinSize);
+    TEST_CHECK(allocator.requestedBytes == 40 + 64);
+
+    allocator.free(a.offset, a.order, a.size);
+    TEST_CHECK(allocator.largestFree() == c_BlockSize / 2);
+    allocator.free(b.offset, b.order, b.size);
+    TEST_CHECK(allocator.largestFree() == c_BlockSize);
+    TEST_CHECK(allocator.allocationCount == 0 && allocator.allocatedBytes == 0 && allocator.requestedBytes == 0);
+    for (uint32_t order = 0; order + 1 < allocator.orderCount; order++) TEST_CHECK(allocator.freeOffsets[order].empty());
+
+    // A range that is not a power of two rounds up to the next order
+    Allocation c;
+    TEST_CHECK(allocate(&allocator, 3 * c_MinSize, 1, &c));
+    TEST_CHECK(c.order == 2);
+    TEST_CHECK(allocator.allocatedBytes == 4 * c_MinSize);
+
+}
+
+/// Offsets are a multiple of the alignment even if the size alone would fit a smaller range.
+static void testAlignment() {
+
+    Core::BuddyAllocator allocator;
+    allocator.init(c_BlockSize, c_MinSize);
+
+    Allocation small, aligned;
+    TEST_CHECK(allocate(&allocator, 16, 16, &small));
+    TEST_CHECK(allocate(&allocator, 16, 256, &aligned));
+    TEST_CHECK(aligned.offset % 256 == 0);
+    TEST_CHECK(aligned.offset != small.offset);
+    TEST_CHECK((c_MinSize << aligned.order) >= 256);
+
+    for (uint64_t alignment = c_MinSize; alignment <= c_BlockSize / 2; alignment *= 2) {
+        Allocation allocation;
+        if (!TEST_CHECK(allocate(&allocator, 1, alignment, &allocation))) continue;
+        TEST_CHECK(allocation.offset % alignment == 0);
+        allocator.free(allocation.offset, allocation.order, allocation.size);
+    }
+
+    // The whole block is the largest alignment that can be met
+    allocator.free(small.offset, small.order, small.size);
+    allocator.free(aligned.offset, aligned.order, aligned.size);
+    Allocation whole;
+    TEST_CHECK(allocate(&allocator, 1, c_BlockSize, &whole) && whole.offset == 0);
+    Allocation tooAligned;
+    TEST_CHECK(!allocate(&allocator, 1, 2 * c_BlockSize, &tooAligned));
+
+}
+
+/// Allocations fail once no free range is large enough, and freeing makes room again.
+static void testExhaustion() {
+
+    Core::BuddyAllocator allocator;
+    allocator.init(c_BlockSize, c_MinSize);
+
+    Allocation tooLarge;
+    TEST_CHECK(!allocate(&allocator, c_BlockSize + 1, 1, &tooLarge));
+
+    std::vector<Allocation> allocations(c_MinRanges);
+    for (Allocation& allocation : allocations) TEST_CHECK(allocate(&allocator, c_MinSize, 1, &allocation));
+    TEST_CHECK(allocator.largestFree() == 0);
+    TEST_CHECK(allocator.allocatedBytes == c_BlockSize);
+
+    Allocation extra;
+    TEST_CHECK(!allocate(&allocator, 1, 1, &extra));
+    TEST_CHECK(allocator.allocationCount == c_MinRanges);
+
+    // Every range is used exactly once
+    std::vector<bool> used(c_MinRanges, false);
+    for (const Allocation& allocation : allocations) {
+        uint32_t index = (uint32_t)(allocation.offset / c_MinSize);
+        TEST_CHECK(allocation.offset % c_MinSize == 0 && index < c_MinRanges && !used[index]);
+        if (index < c_MinRanges) used[index] = true;
+    }
+
+    allocator.free(allocations[3].offset, allocations[3].order, allocations[3].size);
+    TEST_CHECK(allocate(&allocator, 1, 1, &extra));
+    TEST_CHECK(extra.offset == allocations[3].offset);
+
+}
+
+/// Fragmented free space reports its largest range, not the free bytes.
+static void testLargestFree() {
+
+    Core::BuddyAllocator allocator;
+    allocator.init(c_BlockSize, c_MinSize);
+
+    std::vector<Allocation> allocations(c_MinRanges);
+    for (Allocation& allocation : allocations) allocate(&allocator, c_MinSize, 1, &allocation);
+
+    // Every other range, none of the freed ones are buddies
+    for (const Allocation& allocation : allocations) {
+        if ((allocation.offset / c_MinSize) % 2 == 0) allocator.free(allocation.offset, allocation.order, allocation.size);
+    }
+    TEST_CHECK(allocator.allocatedBytes == c_BlockSize / 2);
+    TEST_CHECK(allocator.largestFree() == c_MinSize);
+    Allocation larger;
+    TEST_CHECK(!allocate(&allocator, 2 * c_MinSize, 1, &larger));
+
+    // Freeing the rest merges everything back
+    for (const Allocation& allocation : allocations) {
+        if ((allocation.offset / c_MinSize) % 2 == 1) allocator.free(allocation.offset, allocation.order, allocation.size);
+    }
+    TEST_CHECK(allocator.largestFree() == c_BlockSize);
+    TEST_CHECK(allocator.allocationCount == 0);
+
+}
+
+void testBuddyAllocator() {
+
+    testSplitMerge();
+    testAlignment();
+    testExhaustion();
+    testLargestFree();
+
+}
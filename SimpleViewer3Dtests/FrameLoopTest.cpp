@@ -0,0 +1,123 @@
+// Drives Core::runFrameLoop with a simulated clock and scripted input, nothing waits for real time.
+
+#include "Tests.hpp"
+
+#include <FrameLoop.hpp>
+
+#include <vector>
+#include <algorithm>
+
+constexpr double c_Refresh   = 1.0 / 60.0;
+constexpr double c_CycleCost = 0.002; // simulated CPU time of one cycle
+
+/// Delivers events at scripted times and moves the clock forward only when the loop waits or runs a cycle.
+struct FakePlatform : Core::LoopPlatform {
+
+    double              time      = 1.0;
+    double              endTime   = 2.0;   // dispatchEvents asks to quit from then on
+    double              busyUntil = 0.0;   // runCycle reports more to show before this
+    std::vector<double> eventTimes;        // sorted
+    size_t              nextEvent = 0;
+    std::vector<double> cycleTimes;
+    uint32_t            waits         = 0;
+    uint32_t            blockingWaits = 0; // waits without a timeout
+
+    double nextEventTime() const { return nextEvent < eventTimes.size() ? eventTimes[nextEvent] : endTime; }
+
+    double now() override { return time; }
+    bool dispatchEvents(uint32_t* eventCount) override {
+        for (; nextEvent < eventTimes.size() && eventTimes[nextEvent] <= time; nextEvent++) (*eventCount)++;
+        return time < endTime;
+    }
+    void waitForEvents(double timeout) override {
+        waits++;
+        if (timeout < 0.0) blockingWaits++;
+        double wakeTime = nextEventTime();
+        if (timeout >= 0.0) wakeTime = std::min(wakeTime, time + timeout);
+        time = std::max(time, wakeTime);
+    }
+    bool runCycle() override {
+        cycleTimes.push_back(time);
+        time += c_CycleCost;
+        return time < busyUntil;
+    }
+
+    uint32_t cyclesBetween(double start, double end) const {
+        return (uint32_t)std::count_if(cycleTimes.begin(), cycleTimes.end(), [=](double t) { return t >= start && t < end; });
+    }
+
+};
+
+static void runLoop(FakePlatform* platform) {
+
+    Core::FramePacer pacer;
+    pacer.init(c_Refresh);
+    Core::runFrameLoop(platform, &pacer);
+
+}
+
+/// Without input or work only the first frame is drawn, then the loop blocks until an event.
+static void testIdleBlocks() {
+
+    FakePlatform platform;
+    runLoop(&platform);
+
+    TEST_CHECK(platform.cycleTimes.size() == 1);
+    TEST_CHECK(platform.blockingWaits == 1);
+    TEST_CHECK(platform.waits <= 2);
+
+}
+
+/// A burst of input is handled before the next cycle instead of a cycle per event.
+static void testInputBurstCoalesced() {
+
+    FakePlatform platform;
+    for (int i = 0; i < 100; i++) platform.eventTimes.push_back(1.5 + i * 0.00002);
+    runLoop(&platform);
+
+    // The first event can start a cycle right away, the rest arrive during it and are handled together after it
+    uint32_t burstCycles = platform.cyclesBetween(1.5, platform.endTime);
+    TEST_CHECK(burstCycles >= Core::c_CyclesAfterEvents && burstCycles <= Core::c_CyclesAfterEvents + 1);
+    TEST_CHECK(platform.nextEvent == platform.eventTimes.size());
+    // Blocked again after the burst, not polling
+    TEST_CHECK(platform.blockingWaits == 2);
+
+}
+
+/// Input spread over many refreshes runs at most one cycle per refresh.
+static void testContinuousInputPaced() {
+
+    FakePlatform platform;
+    for (double t = 1.2; t < 1.7; t += 0.001) platform.eventTimes.push_back(t);
+    runLoop(&platform);
+
+    uint32_t cycles = platform.cyclesBetween(1.2, 1.7);
+    uint32_t refreshes = (uint32_t)(0.5 / c_Refresh);
+    TEST_CHECK(cycles >= refreshes - 2 && cycles <= refreshes + 2);
+    for (size_t i = 1; i < platform.cycleTimes.size(); i++) TEST_CHECK(platform.cycleTimes[i] - platform.cycleTimes[i - 1] > 0.5 * c_Refresh);
+
+}
+
+/// While the app has more to show, e.g. a load, it keeps cycling at the refresh rate without input.
+static void testBusyAppKeepsCycling() {
+
+    FakePlatform platform;
+    platform.busyUntil = 1.5;
+    runLoop(&platform);
+
+    uint32_t cycles = platform.cyclesBetween(1.0, 1.5);
+    uint32_t refreshes = (uint32_t)(0.5 / c_Refresh);
+    TEST_CHECK(cycles >= refreshes - 2 && cycles <= refreshes + 2);
+    TEST_CHECK(platform.cyclesBetween(1.6, platform.endTime) == 0);
+    TEST_CHECK(platform.blockingWaits == 1);
+
+}
+
+void testFrameLoop() {
+
+    testIdleBlocks();
+    testInputBurstCoalesced();
+    testContinuousInputPaced();
+    testBusyAppKeepsCycling();
+
+}
@@ -0,0 +1,103 @@
+// Drives Core::FramePacer with a simulated display and frame costs, nothing waits for real time.
+
+#include "Tests.hpp"
+
+#include <FramePacer.hpp>
+
+#include <cmath>
+
+constexpr double c_Refresh = 1.0 / 60.0;
+
+/// A display refreshing every c_Refresh from time 1.0 that reports when each frame reached it.
+struct SimulatedDisplay {
+
+    Core::FramePacer pacer;
+    double           time        = 1.0;
+    uint64_t         frameNumber = 0;
+    double           lastLatency = 0.0; // input to present of the last frame
+
+    SimulatedDisplay() { pacer.init(c_Refresh); }
+
+    /// Runs a frame that takes cpuTime seconds to record and gpuTime seconds to render.
+    void runFrame(double cpuTime, double gpuTime) {
+
+        time = std::fmax(time, pacer.nextCycleStart(time));
+        pacer.cycleStarted(time);
+        double inputTime = time;
+
+        double submitTime  = time + cpuTime;
+        double gpuDoneTime = submitTime + gpuTime;
+        double presentTime = 1.0 + std::ceil((gpuDoneTime - 1.0) / c_Refresh) * c_Refresh;
+        pacer.frameSubmitted(frameNumber, submitTime);
+        pacer.frameGpuDone  (frameNumber, gpuDoneTime);
+        pacer.framePresented(frameNumber, presentTime);
+        frameNumber++;
+
+        lastLatency = presentTime - inputTime;
+        time        = submitTime;
+
+    }
+
+};
+
+/// Frames that fit make every refresh, and input is sampled late enough to be shown within one refresh.
+static void testSteadyState() {
+
+    SimulatedDisplay display;
+    for (int i = 0; i < 60; i++) display.runFrame(0.003, 0.004);
+    uint32_t warmupMisses = display.pacer.missedDeadlines;
+    for (int i = 0; i < 240; i++) display.runFrame(0.003, 0.004);
+
+    TEST_CHECK(display.pacer.missedDeadlines == warmupMisses);
+    TEST_CHECK(display.lastLatency < c_Refresh);
+
+    Core::LatencyStats latency = display.pacer.latency();
+    TEST_CHECK(latency.toPresent);
+    TEST_CHECK(latency.sampleCount == Core::c_PacerHistory);
+    TEST_CHECK(latency.median < c_Refresh && latency.p99 < c_Refresh);
+
+}
+
+/// A slow frame misses its deadline and widens the margin.
+static void testMissedDeadline() {
+
+    SimulatedDisplay display;
+    for (int i = 0; i < 120; i++) display.runFrame(0.003, 0.004);
+    uint32_t misses = display.pacer.missedDeadlines;
+    double   margin = display.pacer.margin;
+
+    display.runFrame(0.003, 0.025);
+
+    TEST_CHECK(display.pacer.missedDeadlines == misses + 1);
+    TEST_CHECK(display.pacer.margin > margin);
+
+}
+
+/// After a spike the frames make their deadlines again and the margin shrinks back.
+static void testRecovery() {
+
+    SimulatedDisplay display;
+    for (int i = 0; i < 120; i++) display.runFrame(0.003, 0.004);
+    double steadyMargin = display.pacer.margin;
+    for (int i = 0; i < 3; i++) display.runFrame(0.003, 0.025);
+    double spikeMargin = display.pacer.margin;
+    uint32_t misses    = display.pacer.missedDeadlines;
+
+    // Longer than the history, so the spike no longer counts in the work estimate
+    for (int i = 0; i < 2 * (int)Core::c_PacerHistory; i++) display.runFrame(0.003, 0.004);
+
+    TEST_CHECK(spikeMargin > steadyMargin);
+    TEST_CHECK(display.pacer.missedDeadlines == misses);
+    TEST_CHECK(display.pacer.margin < spikeMargin);
+    TEST_CHECK(std::fabs(display.pacer.margin - steadyMargin) < 1e-9);
+    TEST_CHECK(display.lastLatency < c_Refresh);
+
+}
+
+void testFramePacer() {
+
+    testSteadyState();
+    testMissedDeadline();
+    testRecovery();
+
+}
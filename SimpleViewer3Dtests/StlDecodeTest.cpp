@@ -0,0 +1,11 @@
+// Checks the SIMD STL decode kernel against the scalar reference, with the instruction set and float model the app builds with.
+
+#include "Tests.hpp"
+
+#include <StlDecode.hpp>
+
+void testStlDecode() {
+
+    for (uint32_t seed : { 0x5EEDu, 0xC0FFEEu, 0xDEADBEEFu }) TEST_CHECK(mload::fuzzStlDecode(seed, 1 << 16) == 0);
+
+}
@@ -0,0 +1,24 @@
+#pragma once
+
+// Minimal checks for the tests in this project. A failed check is printed and the test continues. 
+
+#include <cstdio>
+
+extern int g_FailedChecks;
+
+#define TEST_CHECK(condition) testCheck((condition), #condition, __FILE__, __LINE__)
+
+inline bool testCheck(bool passed, const char* condition, const char* file, int line) {
+
+    if (!passed) {
+        fprintf(stderr, "%s(%d): check failed: %s\n", file, line, condition);
+        g_FailedChecks++;
+    }
+    return passed;
+
+}
+
+void testFrameLoop();
+void testFramePacer();
+void testStlDecode();
+void testBuddyAllocator();
@@ -0,0 +1,21 @@
+// Runs every test and exits with 1 if a check failed. 
+
+#include "Tests.hpp"
+
+int g_FailedChecks = 0;
+
+int main() {
+
+    testFrameLoop();
+    testFramePacer();
+    testStlDecode();
+    testBuddyAllocator();
+
+    if (g_FailedChecks > 0) {
+        fprintf(stderr, "%d checks failed\n", g_FailedChecks);
+        return 1;
+    }
+    printf("All tests passed\n");
+    return 0;
+
+}
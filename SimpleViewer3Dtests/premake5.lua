@@ -0,0 +1,55 @@
+project "SimpleViewer3Dtests"
+    kind       "ConsoleApp"
+    language   "C++"
+    cppdialect "C++17"
+    targetdir  "bin/%{cfg.buildcfg}" 
+    objdir     "bin/obj"
+
+    -- Tests of the app and loader modules that don't need a window or Vulkan. 
+    viewerDir = "%{wks.location}/SimpleViewer3D"
+
+    includedirs {
+        viewerDir .. "/src",
+        "%{wks.location}/Dependencies/ModelLoader",
+    }
+
+    files {
+        "*.cpp", 
+        "*.hpp", 
+        viewerDir .. "/src/FrameLoop.cpp",
+        viewerDir .. "/src/FrameLoop.hpp",
+        viewerDir .. "/src/FramePacer.cpp",
+        viewerDir .. "/src/FramePacer.hpp",
+        viewerDir .. "/src/BuddyAllocator.cpp",
+        viewerDir .. "/src/BuddyAllocator.hpp",
+        "%{wks.location}/Dependencies/ModelLoader/StlDecode.cpp",
+        "%{wks.location}/Dependencies/ModelLoader/StlDecode.hpp",
+        "%{wks.location}/Dependencies/ModelLoader/WorkerPool.cpp",
+        "%{wks.location}/Dependencies/ModelLoader/WorkerPool.hpp",
+    }
+
+	flags { "MultiProcessorCompile" }
+
+    -- The same as the app, so the decode kernels are checked the way they ship
+    floatingpoint    "Fast"
+    vectorextensions "AVX2"
+
+    filter "system:linux"
+        links { "pthread" }
+
+    filter "configurations:Debug"
+        defines { "DEBUG" }
+        symbols "On"
+        runtime "Debug"
+
+    filter "configurations:OptDebug"
+        defines  { "DEBUG" }
+        symbols "On"
+        optimize "Speed"
+        runtime "Release"
+
+    filter "configurations:DevRelease or configurations:Dist"
+        defines  { "NDEBUG" }
+        optimize "Speed"
+        symbols  "Off"
+        runtime "Release"
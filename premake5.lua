@@ -7,4 +7,6 @@ startproject "SimpleViewer3D"
 include "SimpleViewer3D"
 include "SimpleViewer3Dlauncher"
 include "SimpleViewer3Duninstaller"
-include "SimpleViewer3Dinstaller"
\ No newline at end of file
+include "SimpleViewer3Dinstaller"
+include "SimpleViewer3Dheadless"
+include "SimpleViewer3Dtests"
\ No newline at end of file